@@ -53,6 +53,49 @@ static int inject_size_set;
  */
 static int offset_rma_start = 0;
 
+/* Per-iteration samples, only taken when --lat-hist is given.  The buckets
+ * are allocated on first use and kept for the life of the test.
+ */
+static struct ft_hist lat_hist;
+
+static struct ft_hist *lat_hist_start(void)
+{
+	if (!opts.lat_hist)
+		return NULL;
+
+	if (!lat_hist.counts && ft_hist_init(&lat_hist))
+		return NULL;
+
+	ft_hist_reset(&lat_hist);
+	return &lat_hist;
+}
+
+static inline uint64_t lat_stamp(struct ft_hist *hist)
+{
+	return hist ? ft_gettime_ns() : 0;
+}
+
+/* Record the time since the stamp, divided over the transfers it covers. */
+static inline void lat_record(struct ft_hist *hist, int iter, uint64_t stamp,
+			      int xfers)
+{
+	if (hist && iter >= opts.warmup_iterations)
+		ft_hist_record(hist, (ft_gettime_ns() - stamp) / xfers);
+}
+
+static void report_perf(int xfers_per_iter, struct ft_hist *hist)
+{
+	if (hist)
+		show_perf_hist(NULL, opts.transfer_size, opts.iterations,
+			       &start, &end, xfers_per_iter, hist);
+	else if (opts.machr)
+		show_perf_mr(opts.transfer_size, opts.iterations, &start, &end,
+			     xfers_per_iter, opts.argc, opts.argv);
+	else
+		show_perf(NULL, opts.transfer_size, opts.iterations, &start,
+			  &end, xfers_per_iter);
+}
+
 void ft_parse_benchmark_opts(int op, char *optarg)
 {
 	switch (op) {
@@ -94,14 +137,16 @@ void ft_benchmark_usage(void)
 }
 
 /* Pingpong latency test with pre-posted receive buffers. */
-static int pingpong_pre_posted_rx(size_t inject_size)
+static int pingpong_pre_posted_rx(size_t inject_size, struct ft_hist *hist)
 {
+	uint64_t stamp;
 	int ret, i;
 
 	if (opts.dst_addr) {
 		for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 			if (i == opts.warmup_iterations)
 				ft_start();
+			stamp = lat_stamp(hist);
 
 			if (opts.transfer_size <= inject_size)
 				ret = ft_inject(ep, remote_fi_addr,
@@ -115,11 +160,14 @@ static int pingpong_pre_posted_rx(size_t inject_size)
 			ret = ft_rx(ep, opts.transfer_size);
 			if (ret)
 				return ret;
+
+			lat_record(hist, i, stamp, 2);
 		}
 	} else {
 		for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 			if (i == opts.warmup_iterations)
 				ft_start();
+			stamp = lat_stamp(hist);
 
 			ret = ft_rx(ep, opts.transfer_size);
 			if (ret)
@@ -133,6 +181,8 @@ static int pingpong_pre_posted_rx(size_t inject_size)
 					    opts.transfer_size, &tx_ctx);
 			if (ret)
 				return ret;
+
+			lat_record(hist, i, stamp, 2);
 		}
 	}
 	ft_stop();
@@ -141,14 +191,16 @@ static int pingpong_pre_posted_rx(size_t inject_size)
 }
 
 /* Pingpong latency test without pre-posted receive buffers. */
-static int pingpong_no_pre_posted_rx(size_t inject_size)
+static int pingpong_no_pre_posted_rx(size_t inject_size, struct ft_hist *hist)
 {
+	uint64_t stamp;
 	int ret, i;
 
 	if (opts.dst_addr) {
 		for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 			if (i == opts.warmup_iterations)
 				ft_start();
+			stamp = lat_stamp(hist);
 
 			if (opts.transfer_size <= inject_size)
 				ret = ft_inject(ep, remote_fi_addr,
@@ -166,11 +218,14 @@ static int pingpong_no_pre_posted_rx(size_t inject_size)
 			ret = ft_get_rx_comp(rx_seq);
 			if (ret)
 				return ret;
+
+			lat_record(hist, i, stamp, 2);
 		}
 	} else {
 		for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 			if (i == opts.warmup_iterations)
 				ft_start();
+			stamp = lat_stamp(hist);
 
 			ret = ft_post_rx(ep, opts.transfer_size, &rx_ctx);
 			if (ret)
@@ -195,6 +250,8 @@ static int pingpong_no_pre_posted_rx(size_t inject_size)
 					    opts.transfer_size, &tx_ctx);
 			if (ret)
 				return ret;
+
+			lat_record(hist, i, stamp, 2);
 		}
 	}
 	ft_stop();
@@ -206,6 +263,7 @@ int pingpong(void)
 {
 	int ret;
 	size_t inject_size = fi->tx_attr->inject_size;
+	struct ft_hist *hist = lat_hist_start();
 
 	ret = fi_getopt(&ep->fid, FI_OPT_ENDPOINT, FI_OPT_INJECT_MSG_SIZE,
 			&inject_size, &(size_t){sizeof inject_size});
@@ -236,7 +294,7 @@ int pingpong(void)
 				return ret;
 		}
 
-		ret = pingpong_no_pre_posted_rx(inject_size);
+		ret = pingpong_no_pre_posted_rx(inject_size, hist);
 		if (ret)
 			return ret;
 	} else {
@@ -244,17 +302,12 @@ int pingpong(void)
 		if (ret)
 			return ret;
 
-		ret = pingpong_pre_posted_rx(inject_size);
+		ret = pingpong_pre_posted_rx(inject_size, hist);
 		if (ret)
 			return ret;
 	}
 
-	if (opts.machr)
-		show_perf_mr(opts.transfer_size, opts.iterations, &start, &end, 2,
-				opts.argc, opts.argv);
-	else
-		show_perf(NULL, opts.transfer_size, opts.iterations, &start, &end, 2);
-
+	report_perf(2, hist);
 	return 0;
 }
 
@@ -297,6 +350,8 @@ int pingpong_rma_write(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote)
 {
 	int ret, i;
 	size_t inject_size = fi->tx_attr->inject_size;
+	struct ft_hist *hist = lat_hist_start();
+	uint64_t stamp;
 
 	ret = fi_getopt(&ep->fid, FI_OPT_ENDPOINT, FI_OPT_INJECT_RMA_SIZE,
 			&inject_size, &(size_t){sizeof inject_size});
@@ -336,6 +391,7 @@ int pingpong_rma_write(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote)
 
 			if (i == opts.warmup_iterations)
 				ft_start();
+			stamp = lat_stamp(hist);
 
 			if (rma_op == FT_RMA_WRITE)
 				*(tx_buf + opts.transfer_size - 1) = (char)i;
@@ -353,11 +409,14 @@ int pingpong_rma_write(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote)
 			ret = ft_rx_rma(i, rma_op, ep, opts.transfer_size);
 			if (ret)
 				return ret;
+
+			lat_record(hist, i, stamp, 2);
 		}
 	} else {
 		for (i = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 			if (i == opts.warmup_iterations)
 				ft_start();
+			stamp = lat_stamp(hist);
 
 			ret = ft_rx_rma(i, rma_op, ep, opts.transfer_size);
 			if (ret)
@@ -375,16 +434,13 @@ int pingpong_rma_write(enum ft_rma_opcodes rma_op, struct fi_rma_iov *remote)
 						opts.transfer_size, &tx_ctx);
 			if (ret)
 				return ret;
+
+			lat_record(hist, i, stamp, 2);
 		}
 	}
 	ft_stop();
 
-	if (opts.machr)
-		show_perf_mr(opts.transfer_size, opts.iterations, &start, &end, 2,
-				opts.argc, opts.argv);
-	else
-		show_perf(NULL, opts.transfer_size, opts.iterations, &start, &end, 2);
-
+	report_perf(2, hist);
 	return 0;
 }
 
@@ -582,8 +638,9 @@ static uint64_t set_fi_more_flag(int i, int j, uint64_t flags)
 int bandwidth(void)
 {
 	int ret, i, j;
-	uint64_t flags = 0;
+	uint64_t flags = 0, stamp = 0;
 	size_t inject_size = fi->tx_attr->inject_size;
+	struct ft_hist *hist = lat_hist_start();
 
 	ret = fi_getopt(&ep->fid, FI_OPT_ENDPOINT, FI_OPT_INJECT_MSG_SIZE,
 			&inject_size, &(size_t){sizeof inject_size});
@@ -613,6 +670,8 @@ int bandwidth(void)
 		for (i = j = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 			if (i == opts.warmup_iterations)
 				ft_start();
+			if (j == 0)
+				stamp = lat_stamp(hist);
 
 			if (ft_check_opts(FT_OPT_VERIFY_DATA)) {
 				ret = ft_fill_buf(tx_ctx_arr[j].buf,
@@ -644,6 +703,7 @@ int bandwidth(void)
 				ret = bw_tx_comp();
 				if (ret)
 					return ret;
+				lat_record(hist, i - j + 1, stamp, j);
 				j = 0;
 			}
 		}
@@ -654,6 +714,8 @@ int bandwidth(void)
 		for (i = j = 0; i < opts.iterations + opts.warmup_iterations; i++) {
 			if (i == opts.warmup_iterations)
 				ft_start();
+			if (j == 0)
+				stamp = lat_stamp(hist);
 
 			if (opts.use_fi_more) {
 				flags = set_fi_more_flag(i, j, flags);
@@ -676,6 +738,7 @@ int bandwidth(void)
 				ret = bw_rx_comp(j);
 				if (ret)
 					return ret;
+				lat_record(hist, i - j + 1, stamp, j);
 				j = 0;
 			}
 		}
@@ -685,12 +748,7 @@ int bandwidth(void)
 	}
 	ft_stop();
 
-	if (opts.machr)
-		show_perf_mr(opts.transfer_size, opts.iterations, &start, &end, 1,
-				opts.argc, opts.argv);
-	else
-		show_perf(NULL, opts.transfer_size, opts.iterations, &start, &end, 1);
-
+	report_perf(1, hist);
 	return 0;
 }
 
@@ -77,6 +77,10 @@
  *        ep, cq           ep, cq         ep, cq
  *        buf, mr          buf, mr        buf, mr
  *
+ * With -W each pair keeps a window of transfers in flight and the test also
+ * reports the message rate of every pair, which together with -A (one core
+ * per pair) shows how the provider scales with the number of pairs.
+ *
  * WARNING: Not all options are supported in this test!
  */
 
@@ -93,6 +97,10 @@ static char oob_buffer[BUFFER_SIZE];
 static size_t num_eps = 1;
 static bool bidir = false;
 static ssize_t xfer_size = 1;
+static int window = 1;
+static bool pin_threads = false;
+static int *cores = NULL;
+static int num_cores = 0;
 pthread_barrier_t barrier;
 
 struct thread_args {
@@ -106,11 +114,13 @@ struct thread_args {
 	struct fid_mr *rx_mr;
 	void *tx_mr_desc;
 	void *rx_mr_desc;
-	struct fi_context2 send_ctx;
-	struct fi_context2 recv_ctx;
+	struct fi_context2 *send_ctx;
+	struct fi_context2 *recv_ctx;
 	char *tx_buf;
 	char *rx_buf;
 	int id;
+	int core;
+	uint64_t elapsed;
 	int ret;
 };
 
@@ -148,6 +158,9 @@ static void cleanup_ofi(void)
 				printf("fi_close(domain[%d]) failed: %d\n", i,
 					ret);
 		}
+
+		free(targs[i].send_ctx);
+		free(targs[i].recv_ctx);
 	}
 
 	if (shared_av) {
@@ -174,6 +187,7 @@ static void cleanup_ofi(void)
 		fi_freeinfo(hints);
 	if (targs)
 		free(targs);
+	free(cores);
 }
 
 static int init_av(int i)
@@ -251,6 +265,13 @@ static int init_ofi(void)
 	for (i = 0; i < num_eps; i++) {
 		memset(&cq_attr, 0, sizeof(cq_attr));
 
+		targs[i].send_ctx = calloc(window, sizeof(*targs[i].send_ctx));
+		targs[i].recv_ctx = calloc(window, sizeof(*targs[i].recv_ctx));
+		if (!targs[i].send_ctx || !targs[i].recv_ctx) {
+			printf("context calloc failed ep[%d]\n", i);
+			return -FI_ENOMEM;
+		}
+
 		if (opts.threading == FI_THREAD_COMPLETION) {
 			targs[i].domain = shared_domain;
 			targs[i].av = shared_av;
@@ -278,7 +299,7 @@ static int init_ofi(void)
 			return ret;
 		}
 
-		cq_attr.size = 128;
+		cq_attr.size = MAX(128, window);
 		cq_attr.format = FI_CQ_FORMAT_CONTEXT;
 		ret = fi_cq_open(targs[i].domain, &cq_attr, &targs[i].cq, NULL);
 		if (ret) {
@@ -409,28 +430,30 @@ static void force_progress(struct fid_cq *cq)
 	(void) fi_cq_read(cq, NULL, 0);
 }
 
-static int read_cq(struct fid_cq *cqueue)
+static int read_cq(struct fid_cq *cqueue, int count)
 {
-	struct fi_cq_entry cq_entry;
+	struct fi_cq_entry cq_entry[16];
 	int ret;
 
 	do {
-		ret = fi_cq_read(cqueue, &cq_entry, 1);
+		ret = fi_cq_read(cqueue, cq_entry,
+				 MIN(count, ARRAY_SIZE(cq_entry)));
 		if (ret < 0 && ret != -FI_EAGAIN)
 			return ret;
-		if (ret == 1)
-			return 0;
-	} while (1);
+		if (ret > 0)
+			count -= ret;
+	} while (count > 0);
+
+	return 0;
 }
 
-static int post_send(void *context)
+static int post_send(struct thread_args *targs, struct fi_context2 *ctx)
 {
 	int ret;
-	struct thread_args *targs = context;
 
 	do {
 		ret = fi_send(targs->ep, targs->tx_buf, xfer_size,
-			      targs->tx_mr, targs->fiaddr, &targs->send_ctx);
+			      targs->tx_mr_desc, targs->fiaddr, ctx);
 		if (ret != -FI_EAGAIN)
 			return ret;
 
@@ -438,14 +461,13 @@ static int post_send(void *context)
 	} while (1);
 }
 
-static int post_recv(void *context)
+static int post_recv(struct thread_args *targs, struct fi_context2 *ctx)
 {
 	int ret;
-	struct thread_args *targs = context;
 
 	do {
 		ret = fi_recv(targs->ep, targs->rx_buf, xfer_size,
-			      targs->rx_mr, targs->fiaddr, &targs->recv_ctx);
+			      targs->rx_mr_desc, targs->fiaddr, ctx);
 		if (ret != -FI_EAGAIN)
 			return ret;
 
@@ -455,14 +477,16 @@ static int post_recv(void *context)
 
 static int bw_send(void *context)
 {
-	int ret;
+	int i, ret;
 	struct thread_args *targs = context;
 
-	ret = post_send(context);
-	if (ret)
-		return ret;
+	for (i = 0; i < window; i++) {
+		ret = post_send(targs, &targs->send_ctx[i]);
+		if (ret)
+			return ret;
+	}
 
-	ret = read_cq(targs->cq);
+	ret = read_cq(targs->cq, window);
 	if (ret) {
 		printf("send read_cq error: %d\n", ret);
 		return ret;
@@ -472,14 +496,16 @@ static int bw_send(void *context)
 
 static int bw_recv(void *context)
 {
-	int ret = FI_SUCCESS;
+	int i, ret = FI_SUCCESS;
 	struct thread_args *targs = context;
 
-	ret = post_recv(context);
-	if (ret)
-		return ret;
+	for (i = 0; i < window; i++) {
+		ret = post_recv(targs, &targs->recv_ctx[i]);
+		if (ret)
+			return ret;
+	}
 
-	ret = read_cq(targs->cq);
+	ret = read_cq(targs->cq, window);
 	if (ret) {
 		printf("recv read_cq error: %d\n", ret);
 		return ret;
@@ -488,12 +514,61 @@ static int bw_recv(void *context)
 	return 0;
 }
 
+/* Cores allowed by the process affinity mask, see --pin-core */
+static int init_cores(void)
+{
+#ifdef __linux__
+	cpu_set_t mask;
+	int cpu;
+
+	if (sched_getaffinity(0, sizeof(mask), &mask))
+		return -errno;
+
+	cores = calloc(CPU_COUNT(&mask), sizeof(*cores));
+	if (!cores)
+		return -FI_ENOMEM;
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &mask))
+			cores[num_cores++] = cpu;
+	}
+
+	if (num_cores < num_eps)
+		printf("Warning: %zu endpoints share %d cores\n", num_eps,
+		       num_cores);
+	return 0;
+#else
+	return -FI_ENOSYS;
+#endif
+}
+
+static void pin_thread(struct thread_args *targs)
+{
+#ifdef __linux__
+	cpu_set_t mask;
+	int ret;
+
+	targs->core = cores[targs->id % num_cores];
+	CPU_ZERO(&mask);
+	CPU_SET(targs->core, &mask);
+	ret = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+	if (ret) {
+		printf("ep[%d] pin to core %d failed: %d\n", targs->id,
+		       targs->core, ret);
+		targs->core = -1;
+	}
+#endif
+}
+
 static void *uni_bandwidth(void *context)
 {
 	int i, ret;
-	const struct thread_args *targs = context;
+	struct thread_args *targs = context;
+	uint64_t stamp;
 
 	ft_hmem_init_thread(opts.iface, opts.device);
+	if (pin_threads)
+		pin_thread(targs);
 
 	pthread_barrier_wait(&barrier);
 	for (i = 0; i < opts.warmup_iterations; i++) {
@@ -508,6 +583,7 @@ static void *uni_bandwidth(void *context)
 	pthread_barrier_wait(&barrier);
 	if (targs->id == 0)
 		ft_start();
+	stamp = ft_gettime_ns();
 	for (i = 0; i < opts.iterations; i++) {
 		ret = opts.dst_addr ? bw_send(context) : bw_recv(context);
 		if (ret) {
@@ -515,6 +591,7 @@ static void *uni_bandwidth(void *context)
 			break;
 		}
 	}
+	targs->elapsed = ft_gettime_ns() - stamp;
 	pthread_barrier_wait(&barrier);
 	if (targs->id == 0)
 		ft_stop();
@@ -526,8 +603,11 @@ static void *bi_bandwidth(void *context)
 {
 	int i, ret;
 	struct thread_args *targs = context;
+	uint64_t stamp;
 
 	ft_hmem_init_thread(opts.iface, opts.device);
+	if (pin_threads)
+		pin_thread(targs);
 
 	pthread_barrier_wait(&barrier);
 	for (i = 0; i < opts.warmup_iterations; i++) {
@@ -548,6 +628,7 @@ static void *bi_bandwidth(void *context)
 	pthread_barrier_wait(&barrier);
 	if (targs->id == 0)
 		ft_start();
+	stamp = ft_gettime_ns();
 
 	for (i = 0; i < opts.iterations; i++) {
 		ret = opts.dst_addr ? bw_send(context) : bw_recv(context);
@@ -563,6 +644,7 @@ static void *bi_bandwidth(void *context)
 			break;
 		}
 	}
+	targs->elapsed = ft_gettime_ns() - stamp;
 	pthread_barrier_wait(&barrier);
 	if (targs->id == 0)
 		ft_stop();
@@ -570,12 +652,39 @@ static void *bi_bandwidth(void *context)
 	return NULL;
 }
 
+/* Message rate of each pair, to spot pairs that fall behind */
+static void show_pairs(void)
+{
+	long long msgs = (long long) opts.iterations * window * (bidir ? 2 : 1);
+	double rate;
+	int i;
+
+	for (i = 0; i < num_eps; i++) {
+		rate = targs[i].elapsed ?
+		       msgs * 1000.0 / targs[i].elapsed : 0;
+		if (opts.json)
+			printf("{\"pair\": %d, \"core\": %d, "
+			       "\"xfer_size\": %zd, \"messages\": %lld, "
+			       "\"time_sec\": %f, \"mmsgs_per_sec\": %f}\n",
+			       i, targs[i].core, xfer_size, msgs,
+			       targs[i].elapsed / 1e9, rate);
+		else if (opts.machr)
+			printf("- { pair: %d, core: %d, xfer_size: %zd, "
+			       "messages: %lld, Mmsgs/sec: %f }\n",
+			       i, targs[i].core, xfer_size, msgs, rate);
+		else
+			printf("  pair %-4d core %-4d %11.3f Mmsgs/sec\n",
+			       i, targs[i].core, rate);
+	}
+}
+
 static int run_size(void)
 {
 	int i, err, ret = FI_SUCCESS;
 
 	for (i = 0; i < num_eps; i++) {
 		targs[i].id = i;
+		targs[i].core = -1;
 		targs[i].ret = FI_SUCCESS;
 		ret = reg_mrs(&targs[i]);
 		if (ret)
@@ -601,9 +710,13 @@ static int run_size(void)
 
 	if (opts.machr)
 		show_perf_mr(xfer_size, opts.iterations, &start, &end,
-			     num_eps, opts.argc, opts.argv);
+			     num_eps * window, opts.argc, opts.argv);
 	else
-		show_perf(NULL, xfer_size, opts.iterations, &start, &end, num_eps);
+		show_perf(NULL, xfer_size, opts.iterations, &start, &end,
+			  num_eps * window);
+
+	if (window > 1 || pin_threads)
+		show_pairs();
 
 out:
 	for (i = 0; i < num_eps; i++) {
@@ -668,6 +781,11 @@ static void usage(void)
 	FT_PRINT_OPTS_USAGE("-n <num endpoints>",
 			    "number of endpoints (threads) to use");
 	FT_PRINT_OPTS_USAGE("-U", "enable FI_DELIVERY_COMPLETE");
+	FT_PRINT_OPTS_USAGE("-W <window>",
+			    "transfers kept in flight by each endpoint "
+			    "(default 1); reports per pair message rates");
+	FT_PRINT_OPTS_USAGE("-A", "pin each endpoint thread to its own core "
+			    "from the allowed set (see --pin-core)");
 	FT_PRINT_OPTS_USAGE("--threading <model>",
 			    "domain (default): per-thread domain/av; "
 			    "completion: shared domain/av, per-thread cq");
@@ -687,7 +805,7 @@ int main(int argc, char **argv)
 	if (!hints)
 		return EXIT_FAILURE;
 
-	while ((op = getopt_long(argc, argv, "gn:Uh" CS_OPTS INFO_OPTS API_OPTS
+	while ((op = getopt_long(argc, argv, "gn:UhA" CS_OPTS INFO_OPTS API_OPTS
 		BENCHMARK_OPTS, long_opts, &lopt_idx)) != -1) {
 		switch (op) {
 		default:
@@ -707,6 +825,12 @@ int main(int argc, char **argv)
 		case 'U':
 			hints->tx_attr->op_flags |= FI_DELIVERY_COMPLETE;
 			break;
+		case 'W':
+			window = atoi(optarg);
+			break;
+		case 'A':
+			pin_threads = true;
+			break;
 		case '?':
 		case 'h':
 			ft_csusage(argv[0], "Multi-Threaded Bandwidth test for "
@@ -721,6 +845,19 @@ int main(int argc, char **argv)
 	if (optind < argc)
 		opts.dst_addr = argv[optind];
 
+	if (window < 1) {
+		printf("invalid window size: %d\n", window);
+		return EXIT_FAILURE;
+	}
+
+	if (pin_threads) {
+		ret = init_cores();
+		if (ret) {
+			FT_PRINTERR("init_cores", ret);
+			return EXIT_FAILURE;
+		}
+	}
+
 	hints->ep_attr->type = FI_EP_RDM;
 	hints->domain_attr->resource_mgmt = FI_RM_ENABLED;
 	hints->domain_attr->threading = opts.threading;
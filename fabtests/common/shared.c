@@ -3371,6 +3371,191 @@ int64_t get_elapsed(const struct timespec *b, const struct timespec *a,
 	return elapsed / p;
 }
 
+static int ft_hist_msb(uint64_t value)
+{
+#ifdef __GNUC__
+	return 63 - __builtin_clzll(value);
+#else
+	int msb = 0;
+
+	while (value >>= 1)
+		msb++;
+	return msb;
+#endif
+}
+
+static size_t ft_hist_index(uint64_t value)
+{
+	int shift;
+
+	if (value < FT_HIST_SUB_COUNT)
+		return value;
+
+	shift = ft_hist_msb(value) - (FT_HIST_SUB_BITS - 1);
+	return FT_HIST_SUB_COUNT + (shift - 1) * (FT_HIST_SUB_COUNT / 2) +
+	       ((value >> shift) - FT_HIST_SUB_COUNT / 2);
+}
+
+/* Highest value that maps to the given bucket */
+static uint64_t ft_hist_value(size_t index)
+{
+	uint64_t sub;
+	int shift;
+
+	if (index < FT_HIST_SUB_COUNT)
+		return index;
+
+	index -= FT_HIST_SUB_COUNT;
+	shift = index / (FT_HIST_SUB_COUNT / 2) + 1;
+	sub = index % (FT_HIST_SUB_COUNT / 2) + FT_HIST_SUB_COUNT / 2;
+	return ((sub + 1) << shift) - 1;
+}
+
+int ft_hist_init(struct ft_hist *hist)
+{
+	hist->counts = calloc(FT_HIST_BUCKETS, sizeof(*hist->counts));
+	if (!hist->counts)
+		return -FI_ENOMEM;
+
+	ft_hist_reset(hist);
+	return 0;
+}
+
+void ft_hist_free(struct ft_hist *hist)
+{
+	free(hist->counts);
+	hist->counts = NULL;
+}
+
+void ft_hist_reset(struct ft_hist *hist)
+{
+	memset(hist->counts, 0, FT_HIST_BUCKETS * sizeof(*hist->counts));
+	hist->count = 0;
+	hist->min = UINT64_MAX;
+	hist->max = 0;
+	hist->sum = 0;
+}
+
+void ft_hist_record(struct ft_hist *hist, uint64_t value)
+{
+	hist->counts[ft_hist_index(value)]++;
+	hist->count++;
+	hist->sum += value;
+	if (value < hist->min)
+		hist->min = value;
+	if (value > hist->max)
+		hist->max = value;
+}
+
+void ft_hist_merge(struct ft_hist *dst, const struct ft_hist *src)
+{
+	size_t i;
+
+	for (i = 0; i < FT_HIST_BUCKETS; i++)
+		dst->counts[i] += src->counts[i];
+
+	dst->count += src->count;
+	dst->sum += src->sum;
+	if (src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+uint64_t ft_hist_percentile(const struct ft_hist *hist, double pct)
+{
+	uint64_t target, total = 0;
+	size_t i;
+
+	if (!hist->count)
+		return 0;
+
+	target = (uint64_t) (pct / 100.0 * hist->count + 0.5);
+	if (target < 1)
+		target = 1;
+	if (target > hist->count)
+		target = hist->count;
+
+	for (i = 0; i < FT_HIST_BUCKETS; i++) {
+		total += hist->counts[i];
+		if (total >= target)
+			break;
+	}
+
+	if (i == FT_HIST_BUCKETS)
+		return hist->max;
+
+	return MAX(MIN(ft_hist_value(i), hist->max), hist->min);
+}
+
+static void ft_print_json_str(const char *str)
+{
+	putchar('"');
+	for (; str && *str; str++) {
+		if (*str == '"' || *str == '\\')
+			putchar('\\');
+		if ((unsigned char) *str >= 0x20)
+			putchar(*str);
+	}
+	putchar('"');
+}
+
+/*
+ * One JSON object per line, so that results from a sweep can be
+ * collected with standard line oriented tools.
+ */
+static void show_perf_json(char *name, size_t tsize, int iters,
+			   struct timespec *start, struct timespec *end,
+			   int xfers_per_iter, struct ft_hist *hist)
+{
+	int64_t elapsed = get_elapsed(start, end, MICRO);
+	long long bytes = (long long) iters * tsize * xfers_per_iter;
+	double usec_per_xfer = elapsed ?
+			(double) elapsed / iters / xfers_per_iter : 0;
+	const char *test = NULL;
+	uint32_t version = fi_version();
+
+	if (opts.argv && opts.argv[0]) {
+		test = strrchr(opts.argv[0], '/');
+		test = test ? test + 1 : opts.argv[0];
+	}
+
+	printf("{\"test\": ");
+	ft_print_json_str(test);
+	printf(", \"libfabric\": \"%d.%d\"", FI_MAJOR(version),
+	       FI_MINOR(version));
+	if (fi && fi->fabric_attr && fi->fabric_attr->prov_name) {
+		printf(", \"provider\": ");
+		ft_print_json_str(fi->fabric_attr->prov_name);
+	}
+	if (name) {
+		printf(", \"name\": ");
+		ft_print_json_str(name);
+	}
+	printf(", \"xfer_size\": %zu", tsize);
+	printf(", \"iterations\": %d", iters);
+	printf(", \"total\": %lld", bytes);
+	printf(", \"time_sec\": %f", elapsed / 1000000.0);
+	printf(", \"mb_per_sec\": %f", elapsed ? bytes / (1.0 * elapsed) : 0);
+	printf(", \"usec_per_xfer\": %f", usec_per_xfer);
+	printf(", \"mxfers_per_sec\": %f",
+	       usec_per_xfer ? 1.0 / usec_per_xfer : 0);
+	if (hist && hist->count) {
+		printf(", \"latency_usec\": {\"samples\": %" PRIu64, hist->count);
+		printf(", \"min\": %.3f", hist->min / 1000.0);
+		printf(", \"avg\": %.3f", hist->sum / 1000.0 / hist->count);
+		printf(", \"p50\": %.3f",
+		       ft_hist_percentile(hist, 50.0) / 1000.0);
+		printf(", \"p99\": %.3f",
+		       ft_hist_percentile(hist, 99.0) / 1000.0);
+		printf(", \"p99.9\": %.3f",
+		       ft_hist_percentile(hist, 99.9) / 1000.0);
+		printf(", \"max\": %.3f}", hist->max / 1000.0);
+	}
+	printf("}\n");
+	fflush(stdout);
+}
+
 void show_perf(char *name, size_t tsize, int iters, struct timespec *start,
 		struct timespec *end, int xfers_per_iter)
 {
@@ -3380,6 +3565,12 @@ void show_perf(char *name, size_t tsize, int iters, struct timespec *start,
 	long long bytes = (long long) iters * tsize * xfers_per_iter;
 	float usec_per_xfer;
 
+	if (opts.json) {
+		show_perf_json(name, tsize, iters, start, end, xfers_per_iter,
+			       NULL);
+		return;
+	}
+
 	if (name) {
 		if (header) {
 			printf("%-50s%-8s%-8s%-8s%8s %10s%13s%13s\n",
@@ -3412,8 +3603,9 @@ void show_perf(char *name, size_t tsize, int iters, struct timespec *start,
 		usec_per_xfer, 1.0/usec_per_xfer);
 }
 
-void show_perf_mr(size_t tsize, int iters, struct timespec *start,
-		  struct timespec *end, int xfers_per_iter, int argc, char *argv[])
+static void show_perf_mr_hist(size_t tsize, int iters, struct timespec *start,
+			      struct timespec *end, int xfers_per_iter,
+			      int argc, char *argv[], struct ft_hist *hist)
 {
 	static int header = 1;
 	int64_t elapsed = get_elapsed(start, end, MICRO);
@@ -3421,6 +3613,12 @@ void show_perf_mr(size_t tsize, int iters, struct timespec *start,
 	int i;
 	float usec_per_xfer;
 
+	if (opts.json) {
+		show_perf_json(NULL, tsize, iters, start, end, xfers_per_iter,
+			       hist);
+		return;
+	}
+
 	if (header) {
 		printf("---\n");
 
@@ -3441,9 +3639,78 @@ void show_perf_mr(size_t tsize, int iters, struct timespec *start,
 	printf("MB/sec: %f, ", (total) / (1.0 * elapsed));
 	printf("usec/xfer: %f, ", usec_per_xfer);
 	printf("Mxfers/sec: %f", 1.0/usec_per_xfer);
+	if (hist && hist->count) {
+		printf(", lat_min: %f", hist->min / 1000.0);
+		printf(", lat_p50: %f", ft_hist_percentile(hist, 50.0) / 1000.0);
+		printf(", lat_p99: %f", ft_hist_percentile(hist, 99.0) / 1000.0);
+		printf(", lat_p99.9: %f",
+		       ft_hist_percentile(hist, 99.9) / 1000.0);
+		printf(", lat_max: %f", hist->max / 1000.0);
+	}
 	printf(" }\n");
 }
 
+void show_perf_mr(size_t tsize, int iters, struct timespec *start,
+		  struct timespec *end, int xfers_per_iter, int argc, char *argv[])
+{
+	show_perf_mr_hist(tsize, iters, start, end, xfers_per_iter, argc, argv,
+			  NULL);
+}
+
+/*
+ * Same as show_perf(), with the latency distribution of the recorded
+ * samples appended.  Samples are in nanoseconds and reported in usec.
+ */
+void show_perf_hist(char *name, size_t tsize, int iters,
+		    struct timespec *start, struct timespec *end,
+		    int xfers_per_iter, struct ft_hist *hist)
+{
+	static int header = 1;
+	char str[FT_STR_LEN];
+	int64_t elapsed = get_elapsed(start, end, MICRO);
+	long long bytes = (long long) iters * tsize * xfers_per_iter;
+	float usec_per_xfer;
+
+	if (opts.json) {
+		show_perf_json(name, tsize, iters, start, end, xfers_per_iter,
+			       hist);
+		return;
+	}
+
+	if (opts.machr) {
+		show_perf_mr_hist(tsize, iters, start, end, xfers_per_iter,
+				  opts.argc, opts.argv, hist);
+		return;
+	}
+
+	if (header) {
+		if (name)
+			printf("%-50s", "name");
+		printf("%-8s%-8s%-8s%8s %10s%13s%10s%10s%10s%10s%10s\n",
+		       "bytes", "iters", "total", "time", "MB/sec",
+		       "usec/xfer", "min", "p50", "p99", "p99.9", "max");
+		header = 0;
+	}
+
+	if (name)
+		printf("%-50s", name);
+
+	printf("%-8s", size_str(str, tsize));
+
+	printf("%-8s", cnt_str(str, iters));
+
+	printf("%-8s", size_str(str, bytes));
+
+	usec_per_xfer = ((float)elapsed / iters / xfers_per_iter);
+	printf("%8.2fs%10.2f%13.2f%10.2f%10.2f%10.2f%10.2f%10.2f\n",
+	       elapsed / 1000000.0, bytes / (1.0 * elapsed), usec_per_xfer,
+	       hist->count ? hist->min / 1000.0 : 0,
+	       ft_hist_percentile(hist, 50.0) / 1000.0,
+	       ft_hist_percentile(hist, 99.0) / 1000.0,
+	       ft_hist_percentile(hist, 99.9) / 1000.0,
+	       hist->max / 1000.0);
+}
+
 void ft_addr_usage()
 {
 	FT_PRINT_OPTS_USAGE("-B <src_port>", "non default source port number");
@@ -4608,6 +4875,11 @@ void ft_longopts_usage()
 		"Completion semantic for inband sync:\n"
 		"transmit_complete, delivery_complete (default),\n"
 		"commit_complete");
+	FT_PRINT_OPTS_USAGE("--json",
+		"Report performance results as one JSON object per line");
+	FT_PRINT_OPTS_USAGE("--lat-hist",
+		"Timestamp every iteration of benchmark tests and report\n"
+		"the latency distribution (min/p50/p99/p99.9/max)");
 }
 
 int debug_assert;
@@ -4625,6 +4897,8 @@ struct option long_opts[] = {
 	{"no-rx-cq-data", no_argument, NULL, LONG_OPT_NO_RX_CQ_DATA},
 	{"expect-error", required_argument, NULL, LONG_OPT_EXPECT_ERROR},
 	{"sync-comp", required_argument, NULL, LONG_OPT_SYNC_COMP},
+	{"json", no_argument, NULL, LONG_OPT_JSON},
+	{"lat-hist", no_argument, NULL, LONG_OPT_LAT_HIST},
 	{NULL, 0, NULL, 0},
 };
 
@@ -4706,6 +4980,12 @@ int ft_parse_long_opts(int op, char *optarg)
 			return EXIT_FAILURE;
 		}
 		return 0;
+	case LONG_OPT_JSON:
+		opts.json = 1;
+		return 0;
+	case LONG_OPT_LAT_HIST:
+		opts.lat_hist = 1;
+		return 0;
 	default:
 		return EXIT_FAILURE;
 	}
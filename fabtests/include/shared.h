@@ -211,6 +211,8 @@ struct ft_opts {
 	int options;
 	enum ft_comp_method comp_method;
 	int machr;
+	int json;
+	int lat_hist;
 	enum ft_rma_opcodes rma_op;
 	enum ft_cqdata_opcodes cqdata_op;
 	char *oob_port;
@@ -678,6 +680,35 @@ void show_perf(char *name, size_t tsize, int iters, struct timespec *start,
 		struct timespec *end, int xfers_per_iter);
 void show_perf_mr(size_t tsize, int iters, struct timespec *start,
 		struct timespec *end, int xfers_per_iter, int argc, char *argv[]);
+
+/*
+ * Log-linear latency histogram in the style of HdrHistogram.  Values below
+ * FT_HIST_SUB_COUNT are counted exactly; larger values land in one of
+ * FT_HIST_SUB_COUNT / 2 linear sub-buckets per power of two, which bounds
+ * the relative error of a reported percentile to 1/64.
+ */
+#define FT_HIST_SUB_BITS	7
+#define FT_HIST_SUB_COUNT	(1 << FT_HIST_SUB_BITS)
+#define FT_HIST_BUCKETS \
+	(FT_HIST_SUB_COUNT + (64 - FT_HIST_SUB_BITS) * (FT_HIST_SUB_COUNT / 2))
+
+struct ft_hist {
+	uint64_t *counts;
+	uint64_t count;
+	uint64_t min;
+	uint64_t max;
+	uint64_t sum;
+};
+
+int ft_hist_init(struct ft_hist *hist);
+void ft_hist_free(struct ft_hist *hist);
+void ft_hist_reset(struct ft_hist *hist);
+void ft_hist_record(struct ft_hist *hist, uint64_t value);
+void ft_hist_merge(struct ft_hist *dst, const struct ft_hist *src);
+uint64_t ft_hist_percentile(const struct ft_hist *hist, double pct);
+void show_perf_hist(char *name, size_t tsize, int iters,
+		struct timespec *start, struct timespec *end,
+		int xfers_per_iter, struct ft_hist *hist);
 void ft_parse_opts_range(char *optarg);
 int ft_send_recv_greeting(struct fid_ep *ep);
 int ft_send_greeting(struct fid_ep *ep);
@@ -708,6 +739,8 @@ enum {
 	LONG_OPT_NO_RX_CQ_DATA,
 	LONG_OPT_EXPECT_ERROR,
 	LONG_OPT_SYNC_COMP,
+	LONG_OPT_JSON,
+	LONG_OPT_LAT_HIST,
 };
 
 extern int debug_assert;
@@ -57,6 +57,10 @@ enum multi_pattern {
 	PATTERN_RING,
 	PATTERN_GATHER,
 	PATTERN_BROADCAST,
+	PATTERN_ALL_TO_ALL,
+	PATTERN_INCAST,
+	PATTERN_PERMUTATION,
+	PATTERN_HALO,
 };
 
 enum multi_pm_type {
@@ -100,6 +104,9 @@ struct multinode_xfer_state {
 	/* pattern iterator state */
 	int			cur_source;
 	int			cur_target;
+	/* messages left to the current peer of a burst pattern */
+	size_t			source_left;
+	size_t			target_left;
 
 	bool			all_recvs_posted;
 	bool			all_sends_posted;
@@ -47,8 +47,14 @@ struct pattern_ops {
 	char *name;
 	int (*next_source)(int *cur);
 	int (*next_target) (int *cur);
+	/* Optional, called before every iteration of the pattern */
+	int (*init)(int iter);
+	/* Send a full window to each target rather than a single message */
+	bool burst;
 };
 
 extern struct pattern_ops patterns[];
 
+void pattern_free_res(void);
+
 
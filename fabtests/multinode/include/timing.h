@@ -50,3 +50,5 @@ int multi_timer_gather(struct multi_timer *all_timer,
 		       struct multi_timer *timers, int timer_count);
 int multi_timer_iter_gather(struct multi_timer *gather_timers,
 				struct multi_timer *timers, int iteration);
+int multi_timer_rank_report(struct multi_timer *timers, int timer_count,
+			    size_t sends);
@@ -206,13 +206,30 @@ err:
 	return ft_exit_code(ret ? ret : cleanup_ret);
 }
 
+/* Advance a pattern iterator, repeating every peer of a burst pattern */
+static int multi_pattern_next(int (*next)(int *cur), int *cur, size_t *left)
+{
+	int ret;
+
+	if (*left) {
+		(*left)--;
+		return 0;
+	}
+
+	ret = next(cur);
+	if (!ret && pattern->burst)
+		*left = opts.window_size - 1;
+	return ret;
+}
+
 int multi_msg_recv(void)
 {
 	int ret, offset;
 
 	/* post receives */
 	while (!state.all_recvs_posted && state.rx_window) {
-		ret = pattern->next_source(&state.cur_source);
+		ret = multi_pattern_next(pattern->next_source,
+					 &state.cur_source, &state.source_left);
 		if (ret == -FI_ENODATA) {
 			state.all_recvs_posted = true;
 			break;
@@ -244,7 +261,8 @@ int multi_msg_send(void)
 	fi_addr_t dest;
 
 	while (!state.all_sends_posted && state.tx_window) {
-		ret = pattern->next_target(&state.cur_target);
+		ret = multi_pattern_next(pattern->next_target,
+					 &state.cur_target, &state.target_left);
 		if (ret == -FI_ENODATA) {
 			state.all_sends_posted = true;
 			break;
@@ -305,7 +323,8 @@ int multi_rma_write(void)
 	int ret, rc;
 
 	while (!state.all_sends_posted && state.tx_window) {
-		ret = pattern->next_target(&state.cur_target);
+		ret = multi_pattern_next(pattern->next_target,
+					 &state.cur_target, &state.target_left);
 		if (ret == -FI_ENODATA) {
 			state.all_sends_posted = true;
 			break;
@@ -448,6 +467,8 @@ static inline void multi_init_state(void)
 {
 	state.cur_source = PATTERN_NO_CURRENT;
 	state.cur_target = PATTERN_NO_CURRENT;
+	state.source_left = 0;
+	state.target_left = 0;
 
 	state.all_completions_done = false;
 	state.all_recvs_posted = false;
@@ -463,6 +484,11 @@ static int multi_run_test(void)
 
 	for (state.iter = 0; state.iter < opts.iterations; state.iter++) {
 		multi_init_state();
+		if (pattern->init) {
+			ret = pattern->init(state.iter);
+			if (ret)
+				return ret;
+		}
 		for (i = 0; i < pm_job.num_ranks && ft_check_opts(FT_OPT_PERF); i++)
 			multi_timer_init(&timers[timer_index(state.iter, i)],
 					 pm_job.my_rank);
@@ -500,10 +526,41 @@ static void pm_job_free_res(void)
 	free(pm_job.names);
 	free(pm_job.fi_addrs);
 	free(pm_job.multi_iovs);
+	pattern_free_res();
 
 	FT_CLOSE_FID(mr_barrier);
 }
 
+static int multi_run_pattern(struct pattern_ops *ops)
+{
+	size_t sends = state.sends_posted;
+	int ret;
+
+	PRINTF("starting %s... ", ops->name);
+	pattern = ops;
+	ret = multi_run_test();
+	if (ret) {
+		PRINTF("failed\n");
+		return ret;
+	}
+	PRINTF("passed\n");
+
+	if (ft_check_opts(FT_OPT_PERF)) {
+		ret = multi_timer_analyze(timers, opts.iterations *
+						  pm_job.num_ranks);
+		if (ret)
+			return ret;
+
+		ret = multi_timer_rank_report(timers, opts.iterations *
+						      pm_job.num_ranks,
+					      state.sends_posted - sends);
+		if (ret)
+			return ret;
+	}
+	fflush(stdout);
+	return 0;
+}
+
 int multinode_run_tests(int argc, char **argv)
 {
 	int ret = FI_SUCCESS, cleanup_ret;
@@ -517,44 +574,12 @@ int multinode_run_tests(int argc, char **argv)
 		timers = calloc(opts.iterations * pm_job.num_ranks, sizeof(*timers));
 
 	if (pm_job.pattern != -1) {
-		PRINTF("starting %s... ", patterns[pm_job.pattern].name);
-		pattern = &patterns[pm_job.pattern];
-		ret = multi_run_test();
-		if (ret) {
-			PRINTF("failed\n");
-			goto out;
-		}
-		PRINTF("passed\n");
-
-		if (ft_check_opts(FT_OPT_PERF)) {
-			ret = multi_timer_analyze(timers, opts.iterations *
-							  pm_job.num_ranks);
-			if (ret)
-				goto out;
-		}
-		fflush(stdout);
-
+		ret = multi_run_pattern(&patterns[pm_job.pattern]);
 	} else {
-		for (i = 0; i < NUM_TESTS && !ret; i++) {
-			PRINTF("starting %s... ", patterns[i].name);
-			pattern = &patterns[i];
-			ret = multi_run_test();
-			if (ret) {
-				PRINTF("failed\n");
-				goto out;
-			}
-			PRINTF("passed\n");
-
-			if (ft_check_opts(FT_OPT_PERF)) {
-				ret = multi_timer_analyze(timers, opts.iterations
-							* pm_job.num_ranks);
-				if (ret)
-					goto out;
-			}
-			fflush(stdout);
-		}
+		for (i = 0; i < NUM_TESTS && !ret; i++)
+			ret = multi_run_pattern(&patterns[i]);
 	}
-out:
+
 	pm_job_free_res();
 	cleanup_ret = ft_free_res();
 	return ft_exit_code(ret ? ret : cleanup_ret);
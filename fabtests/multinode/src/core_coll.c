@@ -386,19 +386,13 @@ out:
 	return err;
 }
 
-static int broadcast_test_run(enum fi_collective_op coll_op, enum fi_op op,
-		enum fi_datatype datatype)
+static int broadcast_count_run(size_t data_cnt, fi_addr_t root)
 {
 	uint64_t done_flag;
 	uint64_t *result, *data;
 	uint64_t i;
-	fi_addr_t root = 0;
-	size_t data_cnt = pm_job.num_ranks;
 	int err;
 
-	assert(coll_op == FI_BROADCAST);
-	assert(datatype == FI_UINT64);
-
 	result = malloc(data_cnt * sizeof(*result));
 	if (!result)
 		return -FI_ENOMEM;
@@ -409,8 +403,8 @@ static int broadcast_test_run(enum fi_collective_op coll_op, enum fi_op op,
 		return -FI_ENOMEM;
 	}
 
-	for (i = 0; i < pm_job.num_ranks; ++i)
-		data[i] = pm_job.num_ranks - 1 - i;
+	for (i = 0; i < data_cnt; ++i)
+		data[i] = data_cnt - 1 - i;
 
 	coll_addr = fi_mc_addr(coll_mc);
 	if (pm_job.my_rank == root) {
@@ -436,8 +430,9 @@ static int broadcast_test_run(enum fi_collective_op coll_op, enum fi_op op,
 
 	for (i = 0; i < data_cnt; i++) {
 		if (result[i] != data[i]) {
-			FT_DEBUG("broadcast failed; expect: %" PRIu64 ", "
-				 "actual: %" PRIu64 "\n", data[i], result[i]);
+			FT_DEBUG("broadcast failed; count %zu, expect: %" PRIu64
+				 ", actual: %" PRIu64 "\n", data_cnt, data[i],
+				 result[i]);
 			err = -1;
 			goto out;
 		}
@@ -450,6 +445,552 @@ out:
 	return err;
 }
 
+static int broadcast_test_run(enum fi_collective_op coll_op, enum fi_op op,
+		enum fi_datatype datatype)
+{
+	int err;
+
+	assert(coll_op == FI_BROADCAST);
+	assert(datatype == FI_UINT64);
+
+	/*
+	 * The sizes select the binomial tree, scatter + allgather and
+	 * pipelined chain algorithms of the coll provider.
+	 */
+	err = broadcast_count_run(pm_job.num_ranks, 0);
+	if (err)
+		return err;
+
+	err = broadcast_count_run(4096 * pm_job.num_ranks,
+				  pm_job.num_ranks - 1);
+	if (err)
+		return err;
+
+	return broadcast_count_run(256 * 1024, 1 % pm_job.num_ranks);
+}
+
+static int alltoall_count_run(size_t count)
+{
+	uint64_t done_flag;
+	uint64_t *data, *result;
+	uint64_t i, j, expect;
+	int err;
+
+	data = malloc(pm_job.num_ranks * count * sizeof(*data));
+	if (!data)
+		return -FI_ENOMEM;
+
+	result = malloc(pm_job.num_ranks * count * sizeof(*result));
+	if (!result) {
+		free(data);
+		return -FI_ENOMEM;
+	}
+
+	/* tag each element with its source rank, destination rank and index */
+	for (i = 0; i < pm_job.num_ranks; i++) {
+		for (j = 0; j < count; j++)
+			data[i * count + j] =
+				((uint64_t) pm_job.my_rank << 40) |
+				(i << 20) | j;
+	}
+
+	coll_addr = fi_mc_addr(coll_mc);
+	err = fi_alltoall(ep, data, count, NULL, result, NULL, coll_addr,
+			  FI_UINT64, 0, &done_flag);
+	if (err) {
+		FT_PRINTERR("collective alltoall failed - fi_alltoall", err);
+		goto out;
+	}
+
+	err = wait_for_comp(&done_flag);
+	if (err)
+		goto out;
+
+	for (i = 0; i < pm_job.num_ranks; i++) {
+		for (j = 0; j < count; j++) {
+			expect = (i << 40) | ((uint64_t) pm_job.my_rank << 20) | j;
+			if (result[i * count + j] != expect) {
+				FT_DEBUG("alltoall failed; count %zu, expect: %"
+					 PRIu64 ", actual: %" PRIu64 "\n",
+					 count, expect, result[i * count + j]);
+				err = -FI_ENOEQ;
+				goto out;
+			}
+		}
+	}
+
+out:
+	free(result);
+	free(data);
+	return err;
+}
+
+static int alltoall_test_run(enum fi_collective_op coll_op, enum fi_op op,
+		enum fi_datatype datatype)
+{
+	int err;
+
+	assert(coll_op == FI_ALLTOALL);
+	assert(datatype == FI_UINT64);
+
+	/* small blocks use Bruck's algorithm, large ones pairwise exchange */
+	err = alltoall_count_run(1);
+	if (err)
+		return err;
+
+	return alltoall_count_run(1024);
+}
+
+static int sum_reduce_test_run(enum fi_collective_op coll_op, enum fi_op op,
+		enum fi_datatype datatype)
+{
+	uint64_t done_flag;
+	uint64_t data[4], result[4];
+	uint64_t i, expect;
+	fi_addr_t root = pm_job.num_ranks - 1;
+	size_t count = 4;
+	int err;
+
+	assert(coll_op == FI_REDUCE);
+	assert(op == FI_SUM);
+	assert(datatype == FI_UINT64);
+
+	for (i = 0; i < count; i++)
+		data[i] = pm_job.my_rank + i;
+
+	coll_addr = fi_mc_addr(coll_mc);
+	err = fi_reduce(ep, data, count, NULL, result, NULL, coll_addr, root,
+			FI_UINT64, FI_SUM, 0, &done_flag);
+	if (err) {
+		FT_PRINTERR("collective reduce failed - fi_reduce", err);
+		return err;
+	}
+
+	err = wait_for_comp(&done_flag);
+	if (err || pm_job.my_rank != root)
+		return err;
+
+	for (i = 0; i < count; i++) {
+		expect = pm_job.num_ranks * (pm_job.num_ranks - 1) / 2 +
+			 pm_job.num_ranks * i;
+		if (result[i] != expect) {
+			FT_DEBUG("reduce failed; expect: %" PRIu64 ", actual: %"
+				 PRIu64 "\n", expect, result[i]);
+			return -FI_ENOEQ;
+		}
+	}
+
+	return FI_SUCCESS;
+}
+
+static int sum_reduce_scatter_test_run(enum fi_collective_op coll_op,
+		enum fi_op op, enum fi_datatype datatype)
+{
+	uint64_t done_flag;
+	uint64_t *data;
+	uint64_t result[2];
+	uint64_t i, expect;
+	size_t count = 2;
+	int err;
+
+	assert(coll_op == FI_REDUCE_SCATTER);
+	assert(op == FI_SUM);
+	assert(datatype == FI_UINT64);
+
+	data = malloc(pm_job.num_ranks * count * sizeof(*data));
+	if (!data)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < pm_job.num_ranks * count; i++)
+		data[i] = pm_job.my_rank * 1000 + i;
+
+	coll_addr = fi_mc_addr(coll_mc);
+	err = fi_reduce_scatter(ep, data, count, NULL, result, NULL, coll_addr,
+				FI_UINT64, FI_SUM, 0, &done_flag);
+	if (err) {
+		FT_PRINTERR("collective reduce_scatter failed - "
+			    "fi_reduce_scatter", err);
+		goto out;
+	}
+
+	err = wait_for_comp(&done_flag);
+	if (err)
+		goto out;
+
+	for (i = 0; i < count; i++) {
+		expect = 1000 * pm_job.num_ranks * (pm_job.num_ranks - 1) / 2 +
+			 pm_job.num_ranks * (pm_job.my_rank * count + i);
+		if (result[i] != expect) {
+			FT_DEBUG("reduce_scatter failed; expect: %" PRIu64
+				 ", actual: %" PRIu64 "\n", expect, result[i]);
+			err = -FI_ENOEQ;
+			goto out;
+		}
+	}
+
+out:
+	free(data);
+	return err;
+}
+
+static int gather_test_run(enum fi_collective_op coll_op, enum fi_op op,
+		enum fi_datatype datatype)
+{
+	uint64_t done_flag;
+	uint64_t data[2];
+	uint64_t *result;
+	uint64_t i, j, expect;
+	fi_addr_t root = pm_job.num_ranks - 1;
+	size_t count = 2;
+	int err;
+
+	assert(coll_op == FI_GATHER);
+	assert(datatype == FI_UINT64);
+
+	result = malloc(pm_job.num_ranks * count * sizeof(*result));
+	if (!result)
+		return -FI_ENOMEM;
+
+	for (j = 0; j < count; j++)
+		data[j] = pm_job.my_rank * 10 + j;
+
+	coll_addr = fi_mc_addr(coll_mc);
+	err = fi_gather(ep, data, count, NULL, result, NULL, coll_addr, root,
+			FI_UINT64, 0, &done_flag);
+	if (err) {
+		FT_PRINTERR("collective gather failed - fi_gather", err);
+		goto out;
+	}
+
+	err = wait_for_comp(&done_flag);
+	if (err || pm_job.my_rank != root)
+		goto out;
+
+	for (i = 0; i < pm_job.num_ranks; i++) {
+		for (j = 0; j < count; j++) {
+			expect = i * 10 + j;
+			if (result[i * count + j] != expect) {
+				FT_DEBUG("gather failed; expect: %" PRIu64
+					 ", actual: %" PRIu64 "\n", expect,
+					 result[i * count + j]);
+				err = -FI_ENOEQ;
+				goto out;
+			}
+		}
+	}
+
+out:
+	free(result);
+	return err;
+}
+
+/*
+ * Size sweeps: every power of two element count up to
+ * COLL_SWEEP_MAX_COUNT, verified on every iteration and timed with -T.
+ */
+#define COLL_SWEEP_MAX_COUNT	(1 << 14)
+#define COLL_SWEEP_ITERATIONS	10
+
+static int coll_sweep_iterations(void)
+{
+	return ft_check_opts(FT_OPT_ITER) ? opts.iterations :
+					    COLL_SWEEP_ITERATIONS;
+}
+
+static void coll_sweep_report(const char *name, size_t count,
+			      struct ft_hist *hist)
+{
+	if (!ft_check_opts(FT_OPT_PERF) || !hist->count)
+		return;
+
+	if (count == 1)
+		PRINTF("%-12s %12s %12s %12s %12s %12s\n", "Collective",
+		       "Bytes", "Avg (us)", "p50 (us)", "p99 (us)", "Max (us)");
+
+	PRINTF("%-12s %12zu %12.2f %12.2f %12.2f %12.2f\n", name,
+	       count * sizeof(uint64_t), hist->sum / 1000.0 / hist->count,
+	       ft_hist_percentile(hist, 50.0) / 1000.0,
+	       ft_hist_percentile(hist, 99.0) / 1000.0, hist->max / 1000.0);
+}
+
+static int sum_all_reduce_sweep_run(enum fi_collective_op coll_op,
+		enum fi_op op, enum fi_datatype datatype)
+{
+	uint64_t done_flag, expect, start;
+	uint64_t *data, *result;
+	uint64_t ranks = pm_job.num_ranks;
+	struct ft_hist hist;
+	size_t count, i;
+	int iter, iters = coll_sweep_iterations();
+	int ret;
+
+	assert(coll_op == FI_ALLREDUCE);
+	assert(op == FI_SUM);
+	assert(datatype == FI_UINT64);
+
+	ret = ft_hist_init(&hist);
+	if (ret)
+		return ret;
+
+	data = malloc(COLL_SWEEP_MAX_COUNT * sizeof(*data));
+	result = malloc(COLL_SWEEP_MAX_COUNT * sizeof(*result));
+	if (!data || !result) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	coll_addr = fi_mc_addr(coll_mc);
+	for (count = 1; count <= COLL_SWEEP_MAX_COUNT; count <<= 1) {
+		ft_hist_reset(&hist);
+		for (iter = 0; iter < iters; iter++) {
+			for (i = 0; i < count; i++)
+				data[i] = pm_job.my_rank + i + iter;
+
+			start = ft_gettime_ns();
+			ret = fi_allreduce(ep, data, count, NULL, result, NULL,
+					   coll_addr, FI_UINT64, FI_SUM, 0,
+					   &done_flag);
+			if (ret) {
+				FT_PRINTERR("fi_allreduce", ret);
+				goto out;
+			}
+
+			ret = wait_for_comp(&done_flag);
+			if (ret)
+				goto out;
+			ft_hist_record(&hist, ft_gettime_ns() - start);
+
+			for (i = 0; i < count; i++) {
+				expect = ranks * (ranks - 1) / 2 +
+					 ranks * (i + iter);
+				if (result[i] != expect) {
+					FT_DEBUG("allreduce failed; count: %zu, "
+						 "expect[%zu]: %" PRIu64 ", "
+						 "actual: %" PRIu64 "\n", count,
+						 i, expect, result[i]);
+					ret = -FI_ENOEQ;
+					goto out;
+				}
+			}
+		}
+		coll_sweep_report("allreduce", count, &hist);
+	}
+
+out:
+	free(data);
+	free(result);
+	ft_hist_free(&hist);
+	return ret;
+}
+
+static int all_gather_sweep_run(enum fi_collective_op coll_op, enum fi_op op,
+		enum fi_datatype datatype)
+{
+	uint64_t done_flag, expect, start;
+	uint64_t *data, *result;
+	struct ft_hist hist;
+	size_t count, i, rank;
+	int iter, iters = coll_sweep_iterations();
+	int ret;
+
+	assert(coll_op == FI_ALLGATHER);
+	assert(datatype == FI_UINT64);
+
+	ret = ft_hist_init(&hist);
+	if (ret)
+		return ret;
+
+	data = malloc(COLL_SWEEP_MAX_COUNT * sizeof(*data));
+	result = malloc(COLL_SWEEP_MAX_COUNT * pm_job.num_ranks *
+			sizeof(*result));
+	if (!data || !result) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	coll_addr = fi_mc_addr(coll_mc);
+	for (count = 1; count <= COLL_SWEEP_MAX_COUNT; count <<= 1) {
+		ft_hist_reset(&hist);
+		for (iter = 0; iter < iters; iter++) {
+			for (i = 0; i < count; i++)
+				data[i] = pm_job.my_rank * count + i + iter;
+
+			start = ft_gettime_ns();
+			ret = fi_allgather(ep, data, count, NULL, result, NULL,
+					   coll_addr, FI_UINT64, 0, &done_flag);
+			if (ret) {
+				FT_PRINTERR("fi_allgather", ret);
+				goto out;
+			}
+
+			ret = wait_for_comp(&done_flag);
+			if (ret)
+				goto out;
+			ft_hist_record(&hist, ft_gettime_ns() - start);
+
+			for (rank = 0; rank < pm_job.num_ranks; rank++) {
+				for (i = 0; i < count; i++) {
+					expect = rank * count + i + iter;
+					if (result[rank * count + i] == expect)
+						continue;
+
+					FT_DEBUG("allgather failed; count: %zu, "
+						 "expect[%zu]: %" PRIu64 ", "
+						 "actual: %" PRIu64 "\n", count,
+						 rank * count + i, expect,
+						 result[rank * count + i]);
+					ret = -FI_ENOEQ;
+					goto out;
+				}
+			}
+		}
+		coll_sweep_report("allgather", count, &hist);
+	}
+
+out:
+	free(data);
+	free(result);
+	ft_hist_free(&hist);
+	return ret;
+}
+
+/*
+ * Repeat collectives with the same parameters but moving buffers, so
+ * that providers which cache schedules replay them on new buffers.
+ */
+#define COLL_REPEAT_ITERATIONS	4
+#define COLL_REPEAT_MAX_COUNT	64
+
+static int coll_repeat_allreduce(uint64_t *data, uint64_t *result,
+				 size_t count, uint64_t seed)
+{
+	uint64_t done_flag, expect;
+	uint64_t ranks = pm_job.num_ranks;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < count; i++)
+		data[i] = pm_job.my_rank + i + seed;
+
+	ret = fi_allreduce(ep, data, count, NULL, result, NULL, coll_addr,
+			   FI_UINT64, FI_SUM, 0, &done_flag);
+	if (ret) {
+		FT_PRINTERR("fi_allreduce", ret);
+		return ret;
+	}
+
+	ret = wait_for_comp(&done_flag);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < count; i++) {
+		expect = ranks * (ranks - 1) / 2 + ranks * (i + seed);
+		if (result[i] != expect) {
+			FT_DEBUG("allreduce failed; count: %zu, expect[%zu]: "
+				 "%" PRIu64 ", actual: %" PRIu64 "\n", count,
+				 i, expect, result[i]);
+			return -FI_ENOEQ;
+		}
+	}
+	return 0;
+}
+
+static int coll_repeat_allgather(uint64_t *data, uint64_t *result,
+				 size_t count, uint64_t seed)
+{
+	uint64_t done_flag, expect;
+	size_t i, rank;
+	int ret;
+
+	for (i = 0; i < count; i++)
+		data[i] = pm_job.my_rank * count + i + seed;
+
+	ret = fi_allgather(ep, data, count, NULL, result, NULL, coll_addr,
+			   FI_UINT64, 0, &done_flag);
+	if (ret) {
+		FT_PRINTERR("fi_allgather", ret);
+		return ret;
+	}
+
+	ret = wait_for_comp(&done_flag);
+	if (ret)
+		return ret;
+
+	for (rank = 0; rank < pm_job.num_ranks; rank++) {
+		for (i = 0; i < count; i++) {
+			expect = rank * count + i + seed;
+			if (result[rank * count + i] == expect)
+				continue;
+
+			FT_DEBUG("allgather failed; count: %zu, expect[%zu]: "
+				 "%" PRIu64 ", actual: %" PRIu64 "\n", count,
+				 rank * count + i, expect,
+				 result[rank * count + i]);
+			return -FI_ENOEQ;
+		}
+	}
+	return 0;
+}
+
+static int coll_repeat_test_run(enum fi_collective_op coll_op, enum fi_op op,
+		enum fi_datatype datatype)
+{
+	static const size_t counts[] = { 1, 5, COLL_REPEAT_MAX_COUNT };
+	uint64_t done_flag;
+	uint64_t *bufs[2] = { NULL, NULL };
+	uint64_t *data, *result;
+	size_t buf_cnt, c;
+	int iter, ret = -FI_ENOMEM;
+
+	/* each buffer holds an allgather result plus a few elements of
+	 * slack to shift the buffers between iterations */
+	buf_cnt = 2 * (COLL_REPEAT_MAX_COUNT * pm_job.num_ranks +
+		       COLL_REPEAT_ITERATIONS);
+	bufs[0] = malloc(buf_cnt * sizeof(**bufs));
+	bufs[1] = malloc(buf_cnt * sizeof(**bufs));
+	if (!bufs[0] || !bufs[1])
+		goto out;
+
+	coll_addr = fi_mc_addr(coll_mc);
+	for (iter = 0; iter < COLL_REPEAT_ITERATIONS; iter++) {
+		data = bufs[iter % 2] + iter;
+		result = data + buf_cnt / 2;
+
+		for (c = 0; c < ARRAY_SIZE(counts); c++) {
+			ret = coll_repeat_allreduce(data, result, counts[c],
+						    iter);
+			if (ret)
+				goto out;
+
+			/* in place */
+			ret = coll_repeat_allreduce(result, result, counts[c],
+						    iter);
+			if (ret)
+				goto out;
+
+			ret = coll_repeat_allgather(data, result, counts[c],
+						    iter);
+			if (ret)
+				goto out;
+		}
+
+		ret = fi_barrier(ep, coll_addr, &done_flag);
+		if (ret) {
+			FT_PRINTERR("fi_barrier", ret);
+			goto out;
+		}
+
+		ret = wait_for_comp(&done_flag);
+		if (ret)
+			goto out;
+	}
+
+out:
+	free(bufs[0]);
+	free(bufs[1]);
+	return ret;
+}
+
 struct coll_test tests[] = {
 	{
 		.name = "join_test",
@@ -514,6 +1055,69 @@ struct coll_test tests[] = {
 		.op = FI_NOOP,
 		.datatype = FI_UINT64
 	},
+	{
+		.name = "alltoall_test",
+		.setup = coll_setup,
+		.run = alltoall_test_run,
+		.teardown = coll_teardown,
+		.coll_op = FI_ALLTOALL,
+		.op = FI_NOOP,
+		.datatype = FI_UINT64
+	},
+	{
+		.name = "sum_reduce_test",
+		.setup = coll_setup,
+		.run = sum_reduce_test_run,
+		.teardown = coll_teardown,
+		.coll_op = FI_REDUCE,
+		.op = FI_SUM,
+		.datatype = FI_UINT64
+	},
+	{
+		.name = "sum_reduce_scatter_test",
+		.setup = coll_setup,
+		.run = sum_reduce_scatter_test_run,
+		.teardown = coll_teardown,
+		.coll_op = FI_REDUCE_SCATTER,
+		.op = FI_SUM,
+		.datatype = FI_UINT64
+	},
+	{
+		.name = "gather_test",
+		.setup = coll_setup,
+		.run = gather_test_run,
+		.teardown = coll_teardown,
+		.coll_op = FI_GATHER,
+		.op = FI_NOOP,
+		.datatype = FI_UINT64
+	},
+	{
+		.name = "sum_all_reduce_sweep",
+		.setup = coll_setup,
+		.run = sum_all_reduce_sweep_run,
+		.teardown = coll_teardown,
+		.coll_op = FI_ALLREDUCE,
+		.op = FI_SUM,
+		.datatype = FI_UINT64,
+	},
+	{
+		.name = "all_gather_sweep",
+		.setup = coll_setup,
+		.run = all_gather_sweep_run,
+		.teardown = coll_teardown,
+		.coll_op = FI_ALLGATHER,
+		.op = FI_NOOP,
+		.datatype = FI_UINT64,
+	},
+	{
+		.name = "repeat_test",
+		.setup = coll_setup,
+		.run = coll_repeat_test_run,
+		.teardown = coll_teardown,
+		.coll_op = FI_ALLREDUCE,
+		.op = FI_SUM,
+		.datatype = FI_UINT64,
+	},
 	{
 		.name = "empty_test_to_stop_the_sequence_of_execution",
 		.run = NULL,
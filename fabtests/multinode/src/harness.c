@@ -81,6 +81,14 @@ static enum multi_pattern parse_pattern(char *pattern)
 		return PATTERN_GATHER;
 	} else if (strcmp(pattern, "broadcast") == 0) {
 		return PATTERN_BROADCAST;
+	} else if (strcmp(pattern, "all_to_all") == 0) {
+		return PATTERN_ALL_TO_ALL;
+	} else if (strcmp(pattern, "incast") == 0) {
+		return PATTERN_INCAST;
+	} else if (strcmp(pattern, "permutation") == 0) {
+		return PATTERN_PERMUTATION;
+	} else if (strcmp(pattern, "halo") == 0) {
+		return PATTERN_HALO;
 	} else {
 		printf("Warn: Invalid pattern, defaulting to full_mesh\n");
 		return PATTERN_MESH;
@@ -427,8 +435,9 @@ int main(int argc, char **argv)
 			FT_PRINT_OPTS_USAGE("-T", "pass to enable performance "
 					    "timing mode");
 			FT_PRINT_OPTS_USAGE("-z <pattern>", "full_mesh, ring, "
-					    "gather, or broadcast pattern. "
-					    "Default: All\n");
+					    "gather, broadcast, all_to_all, "
+					    "incast, permutation or halo "
+					    "pattern. Default: All\n");
 
 			fprintf(stderr, "General Fabtests options: \n\n");
 			FT_PRINT_OPTS_USAGE("-f <fabric>", "fabric name");
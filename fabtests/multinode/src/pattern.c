@@ -102,6 +102,163 @@ static int mesh_next(int *cur)
 	return 0;
 }
 
+/*
+ * Rank r sends to r + 1, r + 2, ... and receives from r - 1, r - 2, ...
+ * so that every rank has a different first target.
+ */
+static int all_to_all_next(int *cur, int dir)
+{
+	int rank = pm_job.my_rank, num_ranks = pm_job.num_ranks;
+	int step;
+
+	if (*cur == PATTERN_NO_CURRENT)
+		step = 1;
+	else
+		step = ((*cur - rank) * dir + num_ranks) % num_ranks + 1;
+
+	if (step >= num_ranks)
+		return -FI_ENODATA;
+
+	*cur = (rank + dir * step + num_ranks) % num_ranks;
+	return 0;
+}
+
+static int all_to_all_source(int *cur)
+{
+	return all_to_all_next(cur, -1);
+}
+
+static int all_to_all_target(int *cur)
+{
+	return all_to_all_next(cur, 1);
+}
+
+/*
+ * A new random single-cycle permutation (Sattolo's algorithm) is drawn for
+ * every iteration, so no rank ever sends to itself.  All ranks derive it
+ * from the iteration number and agree on it without any exchange.
+ */
+static int *perm_target, *perm_source;
+
+static int permutation_init(int iter)
+{
+	uint64_t seed = 0x9E3779B97F4A7C15ULL * (iter + 1);
+	int i, j, tmp;
+
+	if (!perm_target) {
+		perm_target = calloc(pm_job.num_ranks, sizeof(*perm_target));
+		perm_source = calloc(pm_job.num_ranks, sizeof(*perm_source));
+		if (!perm_target || !perm_source)
+			return -FI_ENOMEM;
+	}
+
+	for (i = 0; i < pm_job.num_ranks; i++)
+		perm_target[i] = i;
+
+	for (i = pm_job.num_ranks - 1; i > 0; i--) {
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		j = seed % i;
+
+		tmp = perm_target[i];
+		perm_target[i] = perm_target[j];
+		perm_target[j] = tmp;
+	}
+
+	for (i = 0; i < pm_job.num_ranks; i++)
+		perm_source[perm_target[i]] = i;
+
+	return 0;
+}
+
+static int permutation_source(int *cur)
+{
+	if (*cur != PATTERN_NO_CURRENT || pm_job.num_ranks < 2)
+		return -FI_ENODATA;
+
+	*cur = perm_source[pm_job.my_rank];
+	return 0;
+}
+
+static int permutation_target(int *cur)
+{
+	if (*cur != PATTERN_NO_CURRENT || pm_job.num_ranks < 2)
+		return -FI_ENODATA;
+
+	*cur = perm_target[pm_job.my_rank];
+	return 0;
+}
+
+/*
+ * Nearest neighbour exchange on a periodic 2D grid, as close to square as
+ * the number of ranks allows.  The neighbourhood is symmetric, so the same
+ * peers are used as sources and targets.
+ */
+static int halo_peers[4];
+static int halo_count;
+
+static void halo_add_peer(int peer)
+{
+	int i;
+
+	if (peer == pm_job.my_rank)
+		return;
+
+	for (i = 0; i < halo_count; i++) {
+		if (halo_peers[i] == peer)
+			return;
+	}
+
+	halo_peers[halo_count++] = peer;
+}
+
+static int halo_init(int iter)
+{
+	int nx, ny, x, y;
+
+	for (ny = 1; (ny + 1) * (ny + 1) <= pm_job.num_ranks; ny++)
+		;
+	while (pm_job.num_ranks % ny)
+		ny--;
+	nx = pm_job.num_ranks / ny;
+
+	x = pm_job.my_rank % nx;
+	y = pm_job.my_rank / nx;
+
+	halo_count = 0;
+	halo_add_peer(y * nx + (x + nx - 1) % nx);
+	halo_add_peer(y * nx + (x + 1) % nx);
+	halo_add_peer(((y + ny - 1) % ny) * nx + x);
+	halo_add_peer(((y + 1) % ny) * nx + x);
+	return 0;
+}
+
+static int halo_next(int *cur)
+{
+	int i = 0;
+
+	if (*cur != PATTERN_NO_CURRENT) {
+		while (i < halo_count && halo_peers[i] != *cur)
+			i++;
+		i++;
+	}
+
+	if (i >= halo_count)
+		return -FI_ENODATA;
+
+	*cur = halo_peers[i];
+	return 0;
+}
+
+void pattern_free_res(void)
+{
+	free(perm_target);
+	free(perm_source);
+	perm_target = NULL;
+	perm_source = NULL;
+}
+
 struct pattern_ops patterns[] = {
 	{
 		.name = "full_mesh",
@@ -123,6 +280,29 @@ struct pattern_ops patterns[] = {
 		.next_source = broadcast_gather_current,
 		.next_target = broadcast_gather_next,
 	},
+	{
+		.name = "all_to_all",
+		.next_source = all_to_all_source,
+		.next_target = all_to_all_target,
+	},
+	{
+		.name = "incast",
+		.next_source = broadcast_gather_next,
+		.next_target = broadcast_gather_current,
+		.burst = true,
+	},
+	{
+		.name = "permutation",
+		.next_source = permutation_source,
+		.next_target = permutation_target,
+		.init = permutation_init,
+	},
+	{
+		.name = "halo",
+		.next_source = halo_next,
+		.next_target = halo_next,
+		.init = halo_init,
+	},
 };
 
 const int NUM_TESTS = ARRAY_SIZE(patterns);
@@ -199,3 +199,83 @@ int multi_timer_iter_gather(struct multi_timer *gather_timers,
 	free(iter_timers);
 	return ret;
 }
+
+struct multi_rank_stats {
+	uint64_t rank;
+	uint64_t sends;
+	uint64_t active_ns;
+	uint64_t lat_p50;
+	uint64_t lat_p99;
+	uint64_t lat_max;
+};
+
+/*
+ * Per rank bandwidth and send completion times.  The active time of an
+ * iteration runs from the first send of the rank to its last completion,
+ * so time spent in the barrier between iterations is not counted.
+ */
+int multi_timer_rank_report(struct multi_timer *timers, int timer_count,
+			    size_t sends)
+{
+	int i, j, ret, iterations = timer_count / pm_job.num_ranks;
+	struct multi_rank_stats stats = {0}, *all_stats;
+	struct multi_timer *timer;
+	struct ft_hist hist;
+	long first_start, last_end;
+
+	ret = ft_hist_init(&hist);
+	if (ret)
+		return ret;
+
+	all_stats = calloc(pm_job.num_ranks, sizeof(*all_stats));
+	if (!all_stats) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < iterations; i++) {
+		first_start = 0;
+		last_end = 0;
+		for (j = 0; j < pm_job.num_ranks; j++) {
+			timer = &timers[i * pm_job.num_ranks + j];
+			if (timer->start == 0 || timer->end == 0)
+				continue;
+
+			ft_hist_record(&hist, timer->end - timer->start);
+			if (timer->start < first_start || first_start == 0)
+				first_start = timer->start;
+			if (timer->end > last_end)
+				last_end = timer->end;
+		}
+		stats.active_ns += last_end - first_start;
+	}
+
+	stats.rank = pm_job.my_rank;
+	stats.sends = sends;
+	stats.lat_p50 = ft_hist_percentile(&hist, 50.0);
+	stats.lat_p99 = ft_hist_percentile(&hist, 99.0);
+	stats.lat_max = hist.max;
+
+	ret = pm_allgather(&stats, all_stats, sizeof(stats));
+	if (ret) {
+		PRINTF("gather rank stats error: %i\n", ret);
+		goto out;
+	}
+
+	PRINTF("%-10s %16s %16s %16s %16s %16s\n", "Rank", "Sends", "MB/sec",
+	       "p50 Send (ns)", "p99 Send (ns)", "Max Send (ns)");
+	for (i = 0; i < pm_job.num_ranks; i++) {
+		PRINTF("%-10" PRIu64 " %16" PRIu64 " %16.3f %16" PRIu64
+		       " %16" PRIu64 " %16" PRIu64 "\n", all_stats[i].rank,
+		       all_stats[i].sends, all_stats[i].active_ns ?
+		       all_stats[i].sends * opts.transfer_size * 1000.0 /
+		       all_stats[i].active_ns : 0,
+		       all_stats[i].lat_p50, all_stats[i].lat_p99,
+		       all_stats[i].lat_max);
+	}
+
+out:
+	free(all_stats);
+	ft_hist_free(&hist);
+	return ret;
+}
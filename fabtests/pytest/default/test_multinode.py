@@ -1,3 +1,4 @@
+import copy
 import pytest
 from common import MultinodeTest
 
@@ -24,3 +25,60 @@ def test_multinode_coll(cmdline_args):
     test = MultinodeTest(cmdline_args, server_base_command, client_base_command,
                          client_hostname_list, run_client_asynchronously=True)
     test.run()
+
+@pytest.mark.multinode
+@pytest.mark.parametrize("node_size", [1, 2])
+def test_multinode_coll_node_size(cmdline_args, node_size):
+
+    numproc = 3
+    cmdline_args_copy = copy.copy(cmdline_args)
+    # group the ranks into nodes of node_size ranks to run the node-aware
+    # collectives without a multi-node cluster
+    cmdline_args_copy.append_environ("FI_OFF_COLL_HIERARCHICAL=1")
+    cmdline_args_copy.append_environ(f"FI_OFF_COLL_NODE_SIZE={node_size}")
+    client_hostname_list = [cmdline_args.client_id, ] * (numproc - 1)
+    client_base_command = "fi_multinode_coll"
+    server_base_command = client_base_command
+    test = MultinodeTest(cmdline_args_copy, server_base_command,
+                         client_base_command, client_hostname_list,
+                         run_client_asynchronously=True)
+    test.run()
+
+@pytest.mark.multinode
+@pytest.mark.parametrize("accept_batch", [1, 32])
+def test_multinode_accept_batch(cmdline_args, accept_batch):
+
+    numproc = 4
+    cmdline_args_copy = copy.copy(cmdline_args)
+    # eager connect makes every rank connect to all others at once, so
+    # connection requests queue up on each listening socket
+    cmdline_args_copy.append_environ(f"FI_OFI_RXM_EAGER_CONNECT={numproc}")
+    cmdline_args_copy.append_environ(f"FI_TCP_EAGER_CONNECT={numproc}")
+    cmdline_args_copy.append_environ(f"FI_TCP_ACCEPT_BATCH={accept_batch}")
+    client_hostname_list = [cmdline_args.client_id, ] * (numproc - 1)
+    client_base_command = f"fi_multinode_coll -n {numproc}"
+    server_base_command = client_base_command
+    test = MultinodeTest(cmdline_args_copy, server_base_command,
+                         client_base_command, client_hostname_list,
+                         run_client_asynchronously=True)
+    test.run()
+
+# Connections are closed and re-established during the run.  With a short
+# idle timeout all ranks close their connections at about the same time,
+# so close requests cross.
+@pytest.mark.multinode
+@pytest.mark.parametrize("conn_env", ["FI_OFI_RXM_MAX_CONNS=1",
+                                      "FI_OFI_RXM_CONN_IDLE_TIMEOUT=100"])
+def test_multinode_conn_limits(cmdline_args, conn_env):
+
+    numproc = 4
+    cmdline_args_copy = copy.copy(cmdline_args)
+    cmdline_args_copy.append_environ(conn_env)
+    cmdline_args_copy.append_environ("FI_OFI_RXM_CM_PROGRESS_INTERVAL=1000")
+    client_hostname_list = [cmdline_args.client_id, ] * (numproc - 1)
+    client_base_command = f"fi_multinode_coll -n {numproc}"
+    server_base_command = client_base_command
+    test = MultinodeTest(cmdline_args_copy, server_base_command,
+                         client_base_command, client_hostname_list,
+                         run_client_asynchronously=True)
+    test.run()
@@ -42,6 +42,17 @@ def test_rdm_shared_av(cmdline_args):
     test = ClientServerTest(cmdline_args, "fi_rdm_shared_av")
     test.run()
 
+# fi_rdm inserts the peer after enabling its endpoint.  fi_multi_ep -A
+# enables endpoints on an AV that already holds the peer.
+@pytest.mark.functional
+@pytest.mark.parametrize("command", ["fi_rdm", "fi_multi_ep -e rdm -v -A"])
+def test_rdm_eager_connect(cmdline_args, command):
+    from common import ClientServerTest
+    test = ClientServerTest(cmdline_args, command,
+                            additional_env="FI_OFI_RXM_EAGER_CONNECT=2 "
+                                           "FI_TCP_EAGER_CONNECT=2")
+    test.run()
+
 @pytest.mark.pr_ci
 @pytest.mark.functional
 def test_rdm_bw_functional(cmdline_args, completion_semantic):
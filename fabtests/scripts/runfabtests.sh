@@ -245,6 +245,8 @@ unit_tests=(
 	"fi_cq_test"
 	"fi_mr_test"
 	"fi_cntr_test"
+	"fi_trigger_test"
+	"fi_more_test"
 	"fi_setopt_test"
 )
 
@@ -37,6 +37,8 @@
 #include <string.h>
 #include <netdb.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 
@@ -1001,6 +1003,147 @@ fail:
 	return TEST_RET_VAL(ret, testret);
 }
 
+struct av_shared_args {
+	struct fid_av *av;
+	uint8_t *addrbuf;
+	size_t addrlen;
+	int count;
+	int ret;
+};
+
+static void *av_shared_insert(void *arg)
+{
+	struct av_shared_args *args = arg;
+	fi_addr_t fi_addr;
+	int i, ret;
+
+	for (i = 0; i < args->count; i++) {
+		ret = fi_av_insert(args->av, args->addrbuf + i * args->addrlen,
+				   1, &fi_addr, 0, NULL);
+		if (ret != 1) {
+			args->ret = ret < 0 ? ret : -FI_EOTHER;
+			break;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Tests:
+ * - lookup through a read-only mapping of a named AV while its creator
+ *   is still inserting
+ */
+static int
+av_shared_concurrent(void)
+{
+	int testret, ret, i, num_addr;
+	struct fid_av *av = NULL, *rd_av = NULL;
+	struct fi_av_attr attr = {0};
+	struct av_shared_args args = {0};
+	uint8_t addrbuf[4096];
+	uint8_t lookup_buf[4096];
+	char name[64];
+	size_t lookup_len;
+	ssize_t addrlen;
+	fi_addr_t fi_addr;
+	pthread_t thread;
+
+	testret = FAIL;
+	addrlen = av_get_addrlen(fi);
+	if (addrlen < 0) {
+		ret = (int) addrlen;
+		goto fail;
+	}
+
+	num_addr = MIN(MAX_ADDR - 1, sizeof(addrbuf) / addrlen);
+	ret = av_create_address_list(good_address, 0, num_addr, addrbuf, 0,
+				     sizeof(addrbuf));
+	if (ret < 0)
+		goto fail;
+
+	snprintf(name, sizeof(name), "/fi_av_test.%d", getpid());
+	attr.type = av_type;
+	attr.count = num_addr;
+	attr.name = name;
+	ret = fi_av_open(domain, &attr, &av, NULL);
+	if (ret) {
+		sprintf(err_buf, "fi_av_open(%s) = %d, %s", name, ret,
+			fi_strerror(-ret));
+		goto fail;
+	}
+
+	attr.flags = FI_READ;
+	ret = fi_av_open(domain, &attr, &rd_av, NULL);
+	if (ret) {
+		sprintf(err_buf, "fi_av_open(%s, FI_READ) = %d, %s", name,
+			ret, fi_strerror(-ret));
+		goto fail;
+	}
+
+	args.av = av;
+	args.addrbuf = addrbuf;
+	args.addrlen = addrlen;
+	args.count = num_addr;
+	ret = pthread_create(&thread, NULL, av_shared_insert, &args);
+	if (ret) {
+		sprintf(err_buf, "pthread_create ret=%d", ret);
+		ret = -ret;
+		goto fail;
+	}
+
+	/*
+	 * The creator assigns fi_addr's in insertion order.  Once an
+	 * fi_addr can be looked up, inserting the same address into the
+	 * read-only mapping must find it in the lookup table.
+	 */
+	for (i = 0; i < num_addr; i++) {
+		do {
+			lookup_len = sizeof(lookup_buf);
+			ret = fi_av_lookup(rd_av, i, lookup_buf, &lookup_len);
+		} while (ret == -FI_EINVAL && !args.ret);
+		if (ret) {
+			sprintf(err_buf, "fi_av_lookup ret=%d, %s", ret,
+				fi_strerror(-ret));
+			break;
+		}
+
+		if (lookup_len != addrlen ||
+		    memcmp(lookup_buf, addrbuf + i * addrlen, addrlen)) {
+			sprintf(err_buf, "fi_av_lookup returned incorrect "
+				"address data for fi_addr %d", i);
+			ret = -FI_EOTHER;
+			break;
+		}
+
+		ret = fi_av_insert(rd_av, addrbuf + i * addrlen, 1, &fi_addr,
+				   0, NULL);
+		if (ret != 1 || fi_addr != i) {
+			sprintf(err_buf, "fi_av_insert on read-only AV ret=%d, "
+				"fi_addr=%" PRIu64 ", expected %d", ret,
+				fi_addr, i);
+			ret = -FI_EOTHER;
+			break;
+		}
+		ret = 0;
+	}
+
+	pthread_join(thread, NULL);
+	if (args.ret) {
+		sprintf(err_buf, "fi_av_insert ret=%d, %s", args.ret,
+			fi_strerror(-args.ret));
+		ret = args.ret;
+		goto fail;
+	}
+	if (ret)
+		goto fail;
+
+	testret = PASS;
+fail:
+	FT_CLOSE_FID(rd_av);
+	FT_CLOSE_FID(av);
+	return TEST_RET_VAL(ret, testret);
+}
+
 struct test_entry test_array_good[] = {
 	TEST_ENTRY(av_open_close, "Test open and close AVs of varying sizes"),
 	TEST_ENTRY(av_good, "Test AV insert with good address"),
@@ -1008,6 +1151,8 @@ struct test_entry test_array_good[] = {
 	TEST_ENTRY(av_insert_stages, "Test AV insert at various stages"),
 	TEST_ENTRY(av_lookup_good, "Test AV lookup with good address"),
 	TEST_ENTRY(av_remove_good, "Test AV remove with good address"),
+	TEST_ENTRY(av_shared_concurrent,
+		   "Test shared AV lookup during concurrent insert"),
 	{ NULL, "" }
 };
 
@@ -35,6 +35,8 @@
 #include <stdlib.h>
 #include <getopt.h>
 #include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include <rdma/fi_errno.h>
 
@@ -44,6 +46,7 @@
 
 static char err_buf[512];
 #define MAX_COUNTER_CHECK 100
+#define CNTR_WAIT_COUNT 100
 
 
 static int cntr_loop()
@@ -54,6 +57,9 @@ static int cntr_loop()
 	int ret, testret = FAIL, timeout = 5000;
 
 	cntr_cnt = MIN(fi->domain_attr->cntr_cnt, MAX_COUNTER_CHECK);
+	if (!cntr_cnt)
+		return SKIPPED;
+
 	struct fid_cntr **cntrs = calloc(cntr_cnt, sizeof(struct fid_cntr *));
 	if (!cntrs) {
 		perror("calloc");
@@ -141,8 +147,158 @@ close:
 	return TEST_RET_VAL(ret, testret);
 }
 
+static void *cntr_wait_updater(void *arg)
+{
+	struct fid_cntr *cntr = arg;
+	int i;
+
+	for (i = 0; i < CNTR_WAIT_COUNT; i++) {
+		usleep(1000);
+		(void) fi_cntr_add(cntr, 1);
+	}
+
+	usleep(10000);
+	(void) fi_cntr_adderr(cntr, 1);
+	return NULL;
+}
+
+/*
+ * Block in fi_cntr_wait while another thread updates the counter.  The
+ * waiter must see the threshold, then the error, and then a timeout below
+ * the threshold once the error has been read.
+ */
+static int cntr_wait_check(struct fid_domain *dom)
+{
+	struct fi_cntr_attr attr = {
+		.events = FI_CNTR_EVENTS_COMP,
+		.wait_obj = FI_WAIT_UNSPEC,
+	};
+	struct fid_cntr *cntr;
+	pthread_t thread;
+	uint64_t value;
+	int ret, testret = FAIL;
+
+	ret = fi_cntr_open(dom, &attr, &cntr, NULL);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_cntr_open failed", ret);
+		return TEST_RET_VAL(ret, testret);
+	}
+
+	ret = fi_cntr_wait(cntr, 0, 0);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_cntr_wait failed", ret);
+		goto close;
+	}
+
+	ret = pthread_create(&thread, NULL, cntr_wait_updater, cntr);
+	if (ret) {
+		ret = -ret;
+		FT_UNIT_STRERR(err_buf, "pthread_create failed", ret);
+		goto close;
+	}
+
+	ret = fi_cntr_wait(cntr, CNTR_WAIT_COUNT, 5000);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_cntr_wait failed", ret);
+		goto join;
+	}
+
+	value = fi_cntr_read(cntr);
+	if (value < CNTR_WAIT_COUNT) {
+		sprintf(err_buf, "fi_cntr_read returned %" PRIu64 ", "
+			"expected at least %d", value, CNTR_WAIT_COUNT);
+		goto join;
+	}
+
+	ret = fi_cntr_wait(cntr, CNTR_WAIT_COUNT + 1, 5000);
+	if (ret != -FI_EAVAIL) {
+		FT_UNIT_STRERR(err_buf, "fi_cntr_wait did not report the "
+			       "error", ret);
+		goto join;
+	}
+
+	ret = 0;
+	if (fi_cntr_readerr(cntr) != 1) {
+		sprintf(err_buf, "fi_cntr_readerr returned wrong value");
+		goto join;
+	}
+
+	ret = fi_cntr_wait(cntr, CNTR_WAIT_COUNT + 1, 10);
+	if (ret != -FI_ETIMEDOUT) {
+		FT_UNIT_STRERR(err_buf, "fi_cntr_wait did not time out", ret);
+		goto join;
+	}
+
+	ret = 0;
+	testret = PASS;
+
+join:
+	pthread_join(thread, NULL);
+close:
+	fi_close(&cntr->fid);
+	return TEST_RET_VAL(ret, testret);
+}
+
+static int cntr_wait_thread()
+{
+	return cntr_wait_check(domain);
+}
+
+/*
+ * Same as cntr_wait_thread, on a domain opened with FI_PROGRESS_AUTO, where
+ * the provider rather than the waiter may drive progress.
+ */
+static int cntr_wait_auto_progress()
+{
+	struct fi_info *auto_hints, *auto_info = NULL;
+	struct fid_fabric *auto_fabric = NULL;
+	struct fid_domain *auto_domain = NULL;
+	int ret, testret = FAIL;
+
+	if (fi->domain_attr->data_progress == FI_PROGRESS_AUTO)
+		return cntr_wait_check(domain);
+
+	auto_hints = fi_dupinfo(hints);
+	if (!auto_hints)
+		return FAIL;
+
+	auto_hints->domain_attr->data_progress = FI_PROGRESS_AUTO;
+	ret = fi_getinfo(FT_FIVERSION, NULL, 0, 0, auto_hints, &auto_info);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_getinfo failed", ret);
+		goto out;
+	}
+
+	ret = fi_fabric(auto_info->fabric_attr, &auto_fabric, NULL);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_fabric failed", ret);
+		goto out;
+	}
+
+	ret = fi_domain(auto_fabric, auto_info, &auto_domain, NULL);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_domain failed", ret);
+		goto out;
+	}
+
+	testret = cntr_wait_check(auto_domain);
+
+out:
+	if (auto_domain)
+		fi_close(&auto_domain->fid);
+	if (auto_fabric)
+		fi_close(&auto_fabric->fid);
+	fi_freeinfo(auto_info);
+	fi_freeinfo(auto_hints);
+	return ret ? TEST_RET_VAL(ret, testret) : testret;
+}
+
 struct test_entry test_array[] = {
 	TEST_ENTRY(cntr_loop, "Test counter open/set/read/close operations"),
+	TEST_ENTRY(cntr_wait_thread, "Test fi_cntr_wait with a concurrent "
+		   "updater"),
+	TEST_ENTRY(cntr_wait_auto_progress, "Test fi_cntr_wait with a "
+		   "concurrent updater and FI_PROGRESS_AUTO"),
 	{ NULL, "" }
 };
 
@@ -182,9 +338,6 @@ int main(int argc, char **argv)
 		goto out;
 	}
 
-	if (!fi->domain_attr->cntr_cnt)
-		goto out;
-
 	ret = ft_open_fabric_res();
 	if (ret)
 		goto out;
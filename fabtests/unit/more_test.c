@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2026 The Libfabric Contributors. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include <rdma/fi_cm.h>
+#include <rdma/fi_errno.h>
+
+#include "unit_common.h"
+#include "shared.h"
+
+#define MORE_MSG_CNT	8
+#define MORE_MSG_SIZE	64
+#define MORE_TIMEOUT	5
+
+static char err_buf[512];
+static char tx_bufs[MORE_MSG_CNT][MORE_MSG_SIZE];
+static char rx_bufs[MORE_MSG_CNT][MORE_MSG_SIZE];
+static struct fi_context2 tx_ctxs[MORE_MSG_CNT];
+static struct fi_context2 rx_ctxs[MORE_MSG_CNT];
+static fi_addr_t self_addr;
+
+static int more_post_recvs(void)
+{
+	int i, ret;
+
+	memset(rx_bufs, 0, sizeof(rx_bufs));
+	for (i = 0; i < MORE_MSG_CNT; i++) {
+		ret = fi_recv(ep, rx_bufs[i], MORE_MSG_SIZE, NULL, self_addr,
+			      &rx_ctxs[i]);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static int more_sendmsg(struct fid_ep *tx_ep, fi_addr_t addr, int i,
+			uint64_t flags)
+{
+	struct iovec iov;
+	struct fi_msg msg = {0};
+	int ret;
+
+	snprintf(tx_bufs[i], MORE_MSG_SIZE, "message %d", i);
+	iov.iov_base = tx_bufs[i];
+	iov.iov_len = MORE_MSG_SIZE;
+	msg.msg_iov = &iov;
+	msg.iov_count = 1;
+	msg.addr = addr;
+	msg.context = &tx_ctxs[i];
+
+	do {
+		ret = fi_sendmsg(tx_ep, &msg, flags | FI_COMPLETION);
+		if (ret == -FI_EAGAIN)
+			(void) fi_cq_read(txcq, NULL, 0);
+	} while (ret == -FI_EAGAIN);
+
+	return ret;
+}
+
+/* Wait for tx_cnt send and all the receive completions, and check that the
+ * messages were received in the order they were posted.
+ */
+static int more_check(uint64_t tx_cnt)
+{
+	char expected[MORE_MSG_SIZE];
+	uint64_t tx_done = 0, rx_done = 0;
+	int i, ret;
+
+	ret = ft_get_cq_comp(txcq, &tx_done, tx_cnt, MORE_TIMEOUT);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "send completions missing", ret);
+		return ret;
+	}
+
+	ret = ft_get_cq_comp(rxcq, &rx_done, MORE_MSG_CNT, MORE_TIMEOUT);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "receive completions missing", ret);
+		return ret;
+	}
+
+	for (i = 0; i < MORE_MSG_CNT; i++) {
+		snprintf(expected, sizeof(expected), "message %d", i);
+		if (strcmp(rx_bufs[i], expected)) {
+			sprintf(err_buf, "received \"%.*s\", expected \"%s\"",
+				MORE_MSG_SIZE, rx_bufs[i], expected);
+			return -FI_EOTHER;
+		}
+	}
+	return 0;
+}
+
+/* The first send posted without FI_MORE must start the whole batch */
+static int more_doorbell()
+{
+	int i, ret, testret = FAIL;
+
+	ret = more_post_recvs();
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_recv failed", ret);
+		goto out;
+	}
+
+	for (i = 0; i < MORE_MSG_CNT; i++) {
+		ret = more_sendmsg(ep, self_addr, i,
+				   i < MORE_MSG_CNT - 1 ? FI_MORE : 0);
+		if (ret) {
+			FT_UNIT_STRERR(err_buf, "fi_sendmsg failed", ret);
+			goto out;
+		}
+	}
+
+	ret = more_check(MORE_MSG_CNT);
+	if (ret)
+		goto out;
+
+	testret = PASS;
+out:
+	return TEST_RET_VAL(ret, testret);
+}
+
+/* An inject following sends posted with FI_MORE must not overtake them */
+static int more_inject()
+{
+	int i, ret, testret = FAIL;
+
+	if (fi->tx_attr->inject_size < MORE_MSG_SIZE) {
+		ret = -FI_ENODATA;
+		goto out;
+	}
+
+	ret = more_post_recvs();
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_recv failed", ret);
+		goto out;
+	}
+
+	for (i = 0; i < MORE_MSG_CNT - 1; i++) {
+		ret = more_sendmsg(ep, self_addr, i, FI_MORE);
+		if (ret) {
+			FT_UNIT_STRERR(err_buf, "fi_sendmsg failed", ret);
+			goto out;
+		}
+	}
+
+	snprintf(tx_bufs[i], MORE_MSG_SIZE, "message %d", i);
+	ret = fi_inject(ep, tx_bufs[i], MORE_MSG_SIZE, self_addr);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_inject failed", ret);
+		goto out;
+	}
+
+	ret = more_check(MORE_MSG_CNT - 1);
+	if (ret)
+		goto out;
+
+	testret = PASS;
+out:
+	return TEST_RET_VAL(ret, testret);
+}
+
+/* Sends still waiting for their doorbell are dropped when the endpoint
+ * closes, possibly with a canceled completion.
+ */
+static int more_close()
+{
+	struct fi_cq_err_entry err_entry;
+	struct fid_ep *test_ep;
+	fi_addr_t test_addr;
+	char name[FT_MAX_CTRL_MSG];
+	size_t len = sizeof(name);
+	int i, ret, testret = FAIL;
+
+	ret = fi_endpoint(domain, fi, &test_ep, NULL);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_endpoint failed", ret);
+		goto out;
+	}
+
+	ret = ft_enable_ep(test_ep, eq, av, txcq, rxcq, NULL, NULL, NULL);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_enable failed", ret);
+		goto close;
+	}
+
+	/* nothing receives on the new endpoint, keep the messages off
+	 * the one used by the other tests */
+	ret = fi_getname(&test_ep->fid, name, &len);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_getname failed", ret);
+		goto close;
+	}
+
+	ret = fi_av_insert(av, name, 1, &test_addr, 0, NULL);
+	if (ret != 1) {
+		FT_UNIT_STRERR(err_buf, "fi_av_insert failed", ret);
+		ret = ret < 0 ? ret : -FI_EOTHER;
+		goto close;
+	}
+
+	for (i = 0; i < MORE_MSG_CNT; i++) {
+		ret = more_sendmsg(test_ep, test_addr, i, FI_MORE);
+		if (ret) {
+			FT_UNIT_STRERR(err_buf, "fi_sendmsg failed", ret);
+			goto close;
+		}
+	}
+
+close:
+	i = fi_close(&test_ep->fid);
+	if (i) {
+		FT_UNIT_STRERR(err_buf, "fi_close failed", i);
+		ret = ret ? ret : i;
+	}
+	if (ret)
+		goto out;
+
+	do {
+		ret = fi_cq_read(txcq, &err_entry, 1);
+		if (ret == -FI_EAVAIL)
+			ret = fi_cq_readerr(txcq, &err_entry, 0);
+	} while (ret > 0);
+	if (ret != -FI_EAGAIN) {
+		FT_UNIT_STRERR(err_buf, "fi_cq_read failed", ret);
+		goto out;
+	}
+
+	ret = 0;
+	testret = PASS;
+out:
+	return TEST_RET_VAL(ret, testret);
+}
+
+struct test_entry test_array[] = {
+	TEST_ENTRY(more_doorbell, "Test sends batched with FI_MORE"),
+	TEST_ENTRY(more_inject, "Test an inject after sends with FI_MORE"),
+	TEST_ENTRY(more_close, "Test closing an endpoint with sends "
+		   "waiting for FI_MORE"),
+	{ NULL, "" }
+};
+
+static void usage(char *name)
+{
+	ft_unit_usage(name, "Unit test for sends posted with FI_MORE on "
+		      "datagram endpoints");
+}
+
+static int more_init_ep(void)
+{
+	char name[FT_MAX_CTRL_MSG];
+	size_t len = sizeof(name);
+	int ret;
+
+	ret = fi_endpoint(domain, fi, &ep, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_endpoint", ret);
+		return ret;
+	}
+
+	ret = ft_enable_ep(ep, eq, av, txcq, rxcq, NULL, NULL, NULL);
+	if (ret)
+		return ret;
+
+	ret = fi_getname(&ep->fid, name, &len);
+	if (ret) {
+		FT_PRINTERR("fi_getname", ret);
+		return ret;
+	}
+
+	ret = fi_av_insert(av, name, 1, &self_addr, 0, NULL);
+	if (ret != 1) {
+		FT_PRINTERR("fi_av_insert", ret);
+		return ret < 0 ? ret : -FI_EOTHER;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret, cleanup_ret;
+	int failed = 0;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, FAB_OPTS "h")) != -1) {
+		switch (op) {
+		default:
+			ft_parseinfo(op, optarg, hints, &opts);
+			break;
+		case '?':
+		case 'h':
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	hints->caps |= FI_MSG;
+	hints->ep_attr->type = FI_EP_DGRAM;
+	hints->mode = FI_CONTEXT | FI_CONTEXT2;
+
+	ret = fi_getinfo(FT_FIVERSION, NULL, 0, 0, hints, &fi);
+	if (ret) {
+		FT_PRINTERR("fi_getinfo", ret);
+		goto out;
+	}
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		goto out;
+
+	ret = ft_alloc_ep_res(fi, &txcq, &rxcq, &txcntr, &rxcntr, &rma_cntr,
+			      &av);
+	if (ret)
+		goto out;
+
+	ret = more_init_ep();
+	if (ret)
+		goto out;
+
+	printf("Testing FI_MORE on fabric %s\n", fi->fabric_attr->name);
+
+	failed = run_tests(test_array, err_buf);
+	if (failed > 0)
+		printf("Summary: %d tests failed\n", failed);
+	else
+		printf("Summary: all tests passed\n");
+
+out:
+	cleanup_ret = ft_free_res();
+	return ret ? ft_exit_code(ret) :
+		cleanup_ret ? ft_exit_code(cleanup_ret) :
+			(failed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
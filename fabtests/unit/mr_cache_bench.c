@@ -0,0 +1,656 @@
+/*
+ * Copyright (c) Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Replays an MR cache trace, recorded with FI_MR_CACHE_TRACE, through the
+ * memory registration calls of a provider.  Each search of the trace
+ * becomes an fi_mr_regattr() and each release an fi_close() of the
+ * matching MR, so the provider's MR cache sees the same sequence of
+ * lookups as the traced application.
+ *
+ * The replay runs once per cache configuration, each in a child process
+ * so that FI_MR_CACHE_MAX_SIZE/FI_MR_CACHE_MAX_COUNT take effect.  The
+ * child traces its own cache to compute the hit rate, the registration
+ * and deregistration counts and the registered footprint.
+ */
+
+#include <unistd.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <getopt.h>
+#include <glob.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unit_common.h"
+#include "shared.h"
+
+#define MAX_CONFIGS 32
+
+struct trace_op {
+	char type;
+	uint64_t id;
+	uint64_t addr;
+	size_t len;
+	/* S: previous unreleased search of the same entry,
+	 * D: search released by this op */
+	ssize_t link;
+};
+
+struct trace_range {
+	uint64_t start;
+	uint64_t end;
+	uint64_t offset;
+};
+
+struct cache_config {
+	char max_size[32];
+	char max_count[32];
+};
+
+struct replay_stats {
+	size_t searches;
+	size_t hits;
+	size_t regs;
+	size_t deregs;
+	size_t cur_cnt;
+	size_t peak_cnt;
+	size_t cur_bytes;
+	size_t peak_bytes;
+	char *hit_map;
+	size_t hit_map_cnt;
+};
+
+static struct trace_op *ops;
+static size_t op_cnt, search_cnt, skipped_cnt;
+static struct trace_range *ranges;
+static size_t range_cnt;
+static size_t arena_size;
+static size_t max_arena = 1ULL << 32;
+static int replay_cnt = 1;
+static struct cache_config configs[MAX_CONFIGS];
+static int config_cnt;
+static char *trace_path;
+static size_t page_size;
+
+static int cmp_range(const void *a, const void *b)
+{
+	const struct trace_range *r1 = a, *r2 = b;
+
+	return r1->start < r2->start ? -1 : r1->start > r2->start;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t v1 = *(const uint64_t *) a, v2 = *(const uint64_t *) b;
+
+	return v1 < v2 ? -1 : v1 > v2;
+}
+
+/* Pair every release with the most recent unreleased search of its entry */
+static int link_ops(void)
+{
+	ssize_t *table;
+	uint64_t *keys;
+	size_t size, mask, i, h;
+
+	for (size = 64; size < search_cnt * 2; size <<= 1)
+		;
+	mask = size - 1;
+
+	table = malloc(size * sizeof(*table));
+	keys = malloc(size * sizeof(*keys));
+	if (!table || !keys) {
+		free(table);
+		free(keys);
+		return -FI_ENOMEM;
+	}
+	for (i = 0; i < size; i++)
+		table[i] = -2;
+
+	for (i = 0; i < op_cnt; i++) {
+		h = (ops[i].id * 0x9e3779b97f4a7c15ULL) >> 20;
+		for (h &= mask; table[h] != -2 && keys[h] != ops[i].id;
+		     h = (h + 1) & mask)
+			;
+
+		if (ops[i].type == 'S') {
+			ops[i].link = table[h] == -2 ? -1 : table[h];
+			keys[h] = ops[i].id;
+			table[h] = i;
+		} else if (table[h] >= 0) {
+			ops[i].link = table[h];
+			table[h] = ops[table[h]].link;
+		}
+	}
+
+	free(table);
+	free(keys);
+	return 0;
+}
+
+/*
+ * The traced buffers are spread over the address space of the traced
+ * process.  Merge them into ranges and lay the ranges out back to back,
+ * keeping the page offsets, so the replay arena stays small.
+ */
+static int build_ranges(void)
+{
+	size_t i, j;
+
+	ranges = calloc(search_cnt, sizeof(*ranges));
+	if (!ranges)
+		return -FI_ENOMEM;
+
+	for (i = 0, j = 0; i < op_cnt; i++) {
+		if (ops[i].type != 'S')
+			continue;
+		ranges[j].start = ops[i].addr;
+		ranges[j++].end = ops[i].addr + ops[i].len;
+	}
+	qsort(ranges, search_cnt, sizeof(*ranges), cmp_range);
+
+	for (i = 0, range_cnt = 0; i < search_cnt; i++) {
+		if (range_cnt &&
+		    ranges[i].start <= ranges[range_cnt - 1].end) {
+			ranges[range_cnt - 1].end =
+				MAX(ranges[range_cnt - 1].end, ranges[i].end);
+			continue;
+		}
+		ranges[range_cnt++] = ranges[i];
+	}
+
+	for (i = 0, arena_size = 0; i < range_cnt; i++) {
+		arena_size = ft_get_aligned_size(arena_size, page_size) +
+			     (ranges[i].start & (page_size - 1));
+		ranges[i].offset = arena_size;
+		arena_size += ranges[i].end - ranges[i].start;
+	}
+	arena_size = ft_get_aligned_size(arena_size, page_size);
+
+	if (arena_size > max_arena) {
+		fprintf(stderr, "Trace needs a %zu byte arena, limit is %zu\n",
+			arena_size, max_arena);
+		return -FI_ENOMEM;
+	}
+	return 0;
+}
+
+static void *replay_addr(char *arena, uint64_t addr)
+{
+	size_t lo = 0, hi = range_cnt, mid;
+
+	while (hi - lo > 1) {
+		mid = (lo + hi) / 2;
+		if (ranges[mid].start <= addr)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return arena + ranges[lo].offset + (addr - ranges[lo].start);
+}
+
+static int read_trace(const char *path)
+{
+	struct trace_op op, *tmp;
+	size_t size = 0;
+	char line[256];
+	int iface;
+	FILE *file;
+
+	file = fopen(path, "r");
+	if (!file) {
+		FT_PRINTERR("fopen", -errno);
+		return -errno;
+	}
+
+	while (fgets(line, sizeof(line), file)) {
+		memset(&op, 0, sizeof(op));
+		op.link = -1;
+		op.type = line[0];
+		if (op.type == 'S') {
+			if (sscanf(line, "S %" SCNx64 " %" SCNx64 " %zu %d",
+				   &op.id, &op.addr, &op.len, &iface) != 4)
+				continue;
+			/* only host memory can be replayed */
+			if (iface != FI_HMEM_SYSTEM || !op.len) {
+				skipped_cnt++;
+				continue;
+			}
+			search_cnt++;
+		} else if (op.type == 'D') {
+			if (sscanf(line, "D %" SCNx64, &op.id) != 1)
+				continue;
+		} else {
+			continue;
+		}
+
+		if (op_cnt == size) {
+			size = size ? size * 2 : 4096;
+			tmp = realloc(ops, size * sizeof(*ops));
+			if (!tmp) {
+				fclose(file);
+				return -FI_ENOMEM;
+			}
+			ops = tmp;
+		}
+		ops[op_cnt++] = op;
+	}
+	fclose(file);
+
+	if (!search_cnt) {
+		fprintf(stderr, "No host memory searches in %s\n", path);
+		return -FI_EINVAL;
+	}
+	return 0;
+}
+
+/* Summarize the trace the replayed cache wrote for this process */
+static void read_replay_trace(const char *prefix, struct replay_stats *stats)
+{
+	char pattern[PATH_MAX + 16], line[256], hit;
+	uint64_t addr;
+	size_t i, len;
+	glob_t files;
+	FILE *file;
+
+	snprintf(pattern, sizeof(pattern), "%s.%d.*", prefix, (int) getpid());
+	if (glob(pattern, 0, NULL, &files))
+		return;
+
+	for (i = 0; i < files.gl_pathc; i++) {
+		file = fopen(files.gl_pathv[i], "r");
+		if (!file)
+			continue;
+
+		while (fgets(line, sizeof(line), file)) {
+			switch (line[0]) {
+			case 'S':
+				if (sscanf(line, "S %*x %*x %*u %*d %c",
+					   &hit) != 1)
+					break;
+				if (stats->hit_map_cnt < search_cnt * replay_cnt)
+					stats->hit_map[stats->hit_map_cnt++] =
+						hit == 'H';
+				stats->searches++;
+				stats->hits += hit == 'H';
+				break;
+			case 'R':
+				if (sscanf(line, "R %" SCNx64 " %zu",
+					   &addr, &len) != 2)
+					break;
+				stats->regs++;
+				stats->cur_cnt++;
+				stats->cur_bytes += len;
+				stats->peak_cnt = MAX(stats->peak_cnt,
+						      stats->cur_cnt);
+				stats->peak_bytes = MAX(stats->peak_bytes,
+							stats->cur_bytes);
+				break;
+			case 'U':
+				if (sscanf(line, "U %" SCNx64 " %zu",
+					   &addr, &len) != 2)
+					break;
+				stats->deregs++;
+				stats->cur_cnt--;
+				stats->cur_bytes -= len;
+				break;
+			default:
+				break;
+			}
+		}
+		fclose(file);
+		unlink(files.gl_pathv[i]);
+	}
+	globfree(&files);
+}
+
+static void print_latency(uint64_t *lat, size_t cnt)
+{
+	if (!cnt) {
+		printf(" %8s %8s %8s %8s %8s", "-", "-", "-", "-", "-");
+		return;
+	}
+
+	qsort(lat, cnt, sizeof(*lat), cmp_u64);
+	printf(" %8.2f %8.2f %8.2f %8.2f %8.2f",
+	       lat[cnt / 2] / 1000.0, lat[cnt * 90 / 100] / 1000.0,
+	       lat[cnt * 99 / 100] / 1000.0, lat[cnt * 999 / 1000] / 1000.0,
+	       lat[cnt - 1] / 1000.0);
+}
+
+static void print_header(void)
+{
+	printf("%-10s %-10s %9s %7s %9s %9s %9s %12s %8s %8s %8s %8s %8s\n",
+	       "max_size", "max_count", "searches", "hit%", "regs", "deregs",
+	       "peak_regs", "peak_bytes", "p50(us)", "p90", "p99", "p99.9",
+	       "max");
+}
+
+static void print_result(struct cache_config *config, const char *prov_name,
+			 struct replay_stats *stats, uint64_t *lat,
+			 size_t lat_cnt)
+{
+	uint64_t *hit_lat, *miss_lat;
+	size_t i, hit_cnt = 0, miss_cnt = 0;
+
+	printf("%-10s %-10s %9zu %6.2f%% %9zu %9zu %9zu %12zu",
+	       config->max_size, config->max_count, stats->searches,
+	       stats->searches ? 100.0 * stats->hits / stats->searches : 0.0,
+	       stats->regs, stats->deregs, stats->peak_cnt,
+	       stats->peak_bytes);
+
+	/* Split the latencies by outcome when every replayed lookup can be
+	 * matched with a search of the cache trace. */
+	if (stats->hit_map_cnt != lat_cnt) {
+		print_latency(lat, lat_cnt);
+		printf("\n");
+		if (!stats->searches)
+			printf("  provider %s does not use the MR cache\n",
+			       prov_name);
+		return;
+	}
+
+	hit_lat = malloc(lat_cnt * sizeof(*hit_lat));
+	miss_lat = malloc(lat_cnt * sizeof(*miss_lat));
+	if (!hit_lat || !miss_lat)
+		goto out;
+
+	for (i = 0; i < lat_cnt; i++) {
+		if (stats->hit_map[i])
+			hit_lat[hit_cnt++] = lat[i];
+		else
+			miss_lat[miss_cnt++] = lat[i];
+	}
+
+	print_latency(lat, lat_cnt);
+	printf("\n%-91s hits:", "");
+	print_latency(hit_lat, hit_cnt);
+	printf("\n%-89s misses:", "");
+	print_latency(miss_lat, miss_cnt);
+	printf("\n");
+out:
+	free(hit_lat);
+	free(miss_lat);
+}
+
+static int replay(char *arena, struct fid_mr **mrs, uint64_t *lat)
+{
+	struct fi_mr_attr attr = {0};
+	struct iovec iov;
+	uint64_t start;
+	size_t i, j = 0;
+	int ret, pass;
+
+	attr.mr_iov = &iov;
+	attr.iov_count = 1;
+	attr.access = ft_info_to_mr_access(fi);
+	attr.iface = FI_HMEM_SYSTEM;
+
+	for (pass = 0; pass < replay_cnt; pass++) {
+		for (i = 0; i < op_cnt; i++) {
+			if (ops[i].type == 'D') {
+				if (ops[i].link < 0 || !mrs[ops[i].link])
+					continue;
+				fi_close(&mrs[ops[i].link]->fid);
+				mrs[ops[i].link] = NULL;
+				continue;
+			}
+
+			iov.iov_base = replay_addr(arena, ops[i].addr);
+			iov.iov_len = ops[i].len;
+			attr.requested_key = i;
+
+			start = ft_gettime_ns();
+			ret = fi_mr_regattr(domain, &attr, 0, &mrs[i]);
+			lat[j++] = ft_gettime_ns() - start;
+			if (ret) {
+				FT_PRINTERR("fi_mr_regattr", ret);
+				return ret;
+			}
+		}
+
+		for (i = 0; i < op_cnt; i++) {
+			if (mrs[i]) {
+				fi_close(&mrs[i]->fid);
+				mrs[i] = NULL;
+			}
+		}
+	}
+	return 0;
+}
+
+static int run_config(struct cache_config *config)
+{
+	struct replay_stats stats = {0};
+	char prefix[PATH_MAX], prov_name[FI_NAME_MAX];
+	struct fid_mr **mrs = NULL;
+	uint64_t *lat = NULL;
+	char *arena;
+	int ret;
+
+	if (strcmp(config->max_size, "default"))
+		setenv("FI_MR_CACHE_MAX_SIZE", config->max_size, 1);
+	if (strcmp(config->max_count, "default"))
+		setenv("FI_MR_CACHE_MAX_COUNT", config->max_count, 1);
+
+	snprintf(prefix, sizeof(prefix), "%s/fi_mr_cache_bench",
+		 getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp");
+	setenv("FI_MR_CACHE_TRACE", prefix, 1);
+
+	arena = mmap(NULL, arena_size, PROT_READ | PROT_WRITE,
+		     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (arena == MAP_FAILED) {
+		FT_PRINTERR("mmap", -errno);
+		return -errno;
+	}
+
+	mrs = calloc(op_cnt, sizeof(*mrs));
+	lat = calloc(search_cnt * replay_cnt, sizeof(*lat));
+	stats.hit_map = calloc(search_cnt * replay_cnt, 1);
+	if (!mrs || !lat || !stats.hit_map) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	ret = fi_getinfo(FT_FIVERSION, NULL, 0, 0, hints, &fi);
+	if (ret) {
+		FT_PRINTERR("fi_getinfo", ret);
+		goto out;
+	}
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		goto out;
+
+	snprintf(prov_name, sizeof(prov_name), "%s",
+		 fi->fabric_attr->prov_name);
+	ret = replay(arena, mrs, lat);
+
+	/* closing the domain flushes the cache and its trace */
+	ft_free_res();
+	if (ret)
+		goto out;
+
+	read_replay_trace(prefix, &stats);
+	print_result(config, prov_name, &stats, lat, search_cnt * replay_cnt);
+out:
+	free(stats.hit_map);
+	free(lat);
+	free(mrs);
+	munmap(arena, arena_size);
+	return ret;
+}
+
+static int parse_configs(char *arg)
+{
+	char *config, *count, *save;
+
+	for (config = strtok_r(arg, ",", &save); config;
+	     config = strtok_r(NULL, ",", &save)) {
+		if (config_cnt == MAX_CONFIGS)
+			return -FI_EINVAL;
+
+		count = strchr(config, ':');
+		if (count)
+			*count++ = '\0';
+
+		snprintf(configs[config_cnt].max_size,
+			 sizeof(configs[config_cnt].max_size), "%s",
+			 *config ? config : "default");
+		snprintf(configs[config_cnt].max_count,
+			 sizeof(configs[config_cnt].max_count), "%s",
+			 count && *count ? count : "default");
+		config_cnt++;
+	}
+	return config_cnt ? 0 : -FI_EINVAL;
+}
+
+static void usage(char *name)
+{
+	ft_unit_usage(name,
+		"Replay an MR cache trace recorded with FI_MR_CACHE_TRACE\n"
+		"through a provider's memory registration calls and report\n"
+		"the hit rate, registration and deregistration counts,\n"
+		"registered footprint and registration latency percentiles\n"
+		"for each MR cache configuration.");
+	FT_PRINT_OPTS_USAGE("-t <file>", "MR cache trace to replay");
+	FT_PRINT_OPTS_USAGE("-c <size:count,...>",
+			    "FI_MR_CACHE_MAX_SIZE:FI_MR_CACHE_MAX_COUNT pairs "
+			    "to run, either may be left empty "
+			    "(default: current environment)");
+	FT_PRINT_OPTS_USAGE("-r <count>", "number of replays per configuration");
+	FT_PRINT_OPTS_USAGE("-m <bytes>", "largest replay arena to map");
+}
+
+int main(int argc, char **argv)
+{
+	int ret, status, op, i;
+	pid_t pid;
+
+	page_size = sysconf(_SC_PAGESIZE);
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, FAB_OPTS "ht:c:r:m:")) != -1) {
+		switch (op) {
+		default:
+			ft_parseinfo(op, optarg, hints, &opts);
+			break;
+		case 't':
+			trace_path = optarg;
+			break;
+		case 'c':
+			if (parse_configs(optarg)) {
+				FT_PRINTERR("Invalid cache configurations",
+					    -FI_EINVAL);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'r':
+			replay_cnt = atoi(optarg);
+			break;
+		case 'm':
+			max_arena = strtoull(optarg, NULL, 0);
+			break;
+		case '?':
+		case 'h':
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!trace_path || replay_cnt < 1) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (!config_cnt) {
+		strcpy(configs[0].max_size, "default");
+		strcpy(configs[0].max_count, "default");
+		config_cnt = 1;
+	}
+
+	hints->mode = ~0;
+	hints->domain_attr->mode = ~0;
+	hints->domain_attr->mr_mode = ~OFI_MR_DEPRECATED;
+	hints->caps |= FI_MSG | FI_RMA;
+
+	ret = read_trace(trace_path);
+	if (ret)
+		goto out;
+
+	ret = link_ops();
+	if (ret)
+		goto out;
+
+	ret = build_ranges();
+	if (ret)
+		goto out;
+
+	printf("Replaying %zu searches (%zu skipped) over %zu bytes, "
+	       "%d time(s)\n", search_cnt, skipped_cnt, arena_size,
+	       replay_cnt);
+	print_header();
+	fflush(stdout);
+
+	/* libfabric reads the MR cache settings once, so every configuration
+	 * runs in a fresh process */
+	for (i = 0; i < config_cnt; i++) {
+		pid = fork();
+		if (pid < 0) {
+			ret = -errno;
+			FT_PRINTERR("fork", ret);
+			break;
+		}
+		if (!pid) {
+			ret = run_config(&configs[i]);
+			fflush(stdout);
+			_exit(ret ? EXIT_FAILURE : EXIT_SUCCESS);
+		}
+
+		if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+		    WEXITSTATUS(status))
+			ret = -FI_EOTHER;
+	}
+
+out:
+	free(ranges);
+	free(ops);
+	fi_freeinfo(hints);
+	return ft_exit_code(ret);
+}
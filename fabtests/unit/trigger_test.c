@@ -0,0 +1,374 @@
+/*
+ * Copyright (c) 2026 The Libfabric Contributors. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+
+#include <rdma/fi_errno.h>
+#include <rdma/fi_trigger.h>
+
+#include "unit_common.h"
+#include "shared.h"
+
+#define TRIGGER_THRESHOLD 3
+#define TRIGGER_VALUE 5
+
+static char err_buf[512];
+static struct fid_cntr *trig_cntr, *target_cntr;
+static struct fi_op_cntr cntr_op;
+static struct fi_deferred_work work;
+
+static int trigger_open_cntrs(void)
+{
+	int ret;
+
+	ret = ft_cntr_open(&trig_cntr);
+	if (ret)
+		return ret;
+
+	ret = ft_cntr_open(&target_cntr);
+	if (ret) {
+		FT_CLOSE_FID(trig_cntr);
+		return ret;
+	}
+	return 0;
+}
+
+static void trigger_close_cntrs(void)
+{
+	FT_CLOSE_FID(target_cntr);
+	FT_CLOSE_FID(trig_cntr);
+}
+
+/* Add TRIGGER_VALUE to the target counter once the triggering counter
+ * reaches TRIGGER_THRESHOLD.
+ */
+static int trigger_queue_add(void)
+{
+	memset(&work, 0, sizeof(work));
+	work.threshold = TRIGGER_THRESHOLD;
+	work.triggering_cntr = trig_cntr;
+	work.op_type = FI_OP_CNTR_ADD;
+	work.op.cntr = &cntr_op;
+	cntr_op.cntr = target_cntr;
+	cntr_op.value = TRIGGER_VALUE;
+
+	return fi_control(&domain->fid, FI_QUEUE_WORK, &work);
+}
+
+/* Reading a counter issues the operations that became ready */
+static int trigger_check_target(uint64_t expected)
+{
+	uint64_t value;
+
+	value = fi_cntr_read(target_cntr);
+	if (value != expected) {
+		sprintf(err_buf, "target counter is %" PRIu64 ", expected %"
+			PRIu64, value, expected);
+		return -FI_EOTHER;
+	}
+	return 0;
+}
+
+static int trigger_threshold()
+{
+	int ret, testret = FAIL;
+
+	ret = trigger_open_cntrs();
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_cntr_open failed", ret);
+		return TEST_RET_VAL(ret, testret);
+	}
+
+	ret = trigger_queue_add();
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "FI_QUEUE_WORK failed", ret);
+		goto close;
+	}
+
+	/* errors do not count towards the threshold */
+	(void) fi_cntr_add(trig_cntr, TRIGGER_THRESHOLD - 1);
+	(void) fi_cntr_adderr(trig_cntr, TRIGGER_THRESHOLD);
+	ret = trigger_check_target(0);
+	if (ret)
+		goto close;
+
+	(void) fi_cntr_add(trig_cntr, 1);
+	ret = trigger_check_target(TRIGGER_VALUE);
+	if (ret)
+		goto close;
+
+	ret = fi_control(&domain->fid, FI_CANCEL_WORK, &work);
+	if (ret != -FI_ENOENT) {
+		FT_UNIT_STRERR(err_buf, "issued work was canceled", ret);
+		goto close;
+	}
+
+	ret = 0;
+	testret = PASS;
+close:
+	trigger_close_cntrs();
+	return TEST_RET_VAL(ret, testret);
+}
+
+static int trigger_cancel()
+{
+	int ret, testret = FAIL;
+
+	ret = trigger_open_cntrs();
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_cntr_open failed", ret);
+		return TEST_RET_VAL(ret, testret);
+	}
+
+	ret = trigger_queue_add();
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "FI_QUEUE_WORK failed", ret);
+		goto close;
+	}
+
+	ret = fi_control(&domain->fid, FI_CANCEL_WORK, &work);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "FI_CANCEL_WORK failed", ret);
+		goto close;
+	}
+
+	ret = fi_control(&domain->fid, FI_CANCEL_WORK, &work);
+	if (ret != -FI_ENOENT) {
+		FT_UNIT_STRERR(err_buf, "work was canceled twice", ret);
+		goto close;
+	}
+
+	ret = trigger_queue_add();
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "FI_QUEUE_WORK failed", ret);
+		goto close;
+	}
+
+	ret = fi_control(&domain->fid, FI_FLUSH_WORK, NULL);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "FI_FLUSH_WORK failed", ret);
+		goto close;
+	}
+
+	(void) fi_cntr_add(trig_cntr, TRIGGER_THRESHOLD);
+	ret = trigger_check_target(0);
+	if (ret)
+		goto close;
+
+	testret = PASS;
+close:
+	trigger_close_cntrs();
+	return TEST_RET_VAL(ret, testret);
+}
+
+/* Work queued to an endpoint is dropped when the endpoint is closed */
+static int trigger_ep_close()
+{
+	struct fi_op_msg msg_op = {0};
+	struct fid_ep *test_ep;
+	int ret, testret = FAIL;
+
+	ret = trigger_open_cntrs();
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_cntr_open failed", ret);
+		return TEST_RET_VAL(ret, testret);
+	}
+
+	/* there is no way to tell whether the work was dropped otherwise */
+	ret = trigger_queue_add();
+	if (!ret)
+		ret = fi_control(&domain->fid, FI_CANCEL_WORK, &work);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "FI_CANCEL_WORK failed", ret);
+		goto close;
+	}
+
+	ret = fi_endpoint(domain, fi, &test_ep, NULL);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_endpoint failed", ret);
+		goto close;
+	}
+
+	ret = ft_enable_ep(test_ep, eq, av, txcq, rxcq, NULL, NULL, NULL);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_enable failed", ret);
+		fi_close(&test_ep->fid);
+		goto close;
+	}
+
+	memset(&work, 0, sizeof(work));
+	work.threshold = TRIGGER_THRESHOLD;
+	work.triggering_cntr = trig_cntr;
+	work.op_type = FI_OP_SEND;
+	work.op.msg = &msg_op;
+	msg_op.ep = test_ep;
+	msg_op.msg.addr = FI_ADDR_UNSPEC;
+	msg_op.msg.context = &work.context;
+
+	ret = fi_control(&domain->fid, FI_QUEUE_WORK, &work);
+	fi_close(&test_ep->fid);
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "FI_QUEUE_WORK failed", ret);
+		goto close;
+	}
+
+	ret = fi_control(&domain->fid, FI_CANCEL_WORK, &work);
+	if (ret != -FI_ENOENT) {
+		FT_UNIT_STRERR(err_buf, "work of closed endpoint was not "
+			       "dropped", ret);
+		goto close;
+	}
+
+	/* must not issue the send on the closed endpoint */
+	(void) fi_cntr_add(trig_cntr, TRIGGER_THRESHOLD);
+	(void) fi_cntr_read(trig_cntr);
+
+	ret = 0;
+	testret = PASS;
+close:
+	trigger_close_cntrs();
+	return TEST_RET_VAL(ret, testret);
+}
+
+/* Deferred work must target an endpoint */
+static int trigger_bad_ep()
+{
+	struct fi_op_msg msg_op = {0};
+	int ret, testret = FAIL;
+
+	ret = trigger_open_cntrs();
+	if (ret) {
+		FT_UNIT_STRERR(err_buf, "fi_cntr_open failed", ret);
+		return TEST_RET_VAL(ret, testret);
+	}
+
+	memset(&work, 0, sizeof(work));
+	work.threshold = TRIGGER_THRESHOLD;
+	work.triggering_cntr = trig_cntr;
+	work.op_type = FI_OP_SEND;
+	work.op.msg = &msg_op;
+	msg_op.ep = (struct fid_ep *) target_cntr;
+	msg_op.msg.addr = FI_ADDR_UNSPEC;
+	msg_op.msg.context = &work.context;
+
+	ret = fi_control(&domain->fid, FI_QUEUE_WORK, &work);
+	if (ret != -FI_EINVAL) {
+		if (!ret)
+			(void) fi_control(&domain->fid, FI_CANCEL_WORK, &work);
+		FT_UNIT_STRERR(err_buf, "work targeting a counter was not "
+			       "rejected", ret);
+		ret = -FI_EOTHER;
+		goto close;
+	}
+
+	ret = 0;
+	testret = PASS;
+close:
+	trigger_close_cntrs();
+	return TEST_RET_VAL(ret, testret);
+}
+
+struct test_entry test_array[] = {
+	TEST_ENTRY(trigger_threshold, "Test deferred work threshold"),
+	TEST_ENTRY(trigger_cancel, "Test canceling and flushing deferred "
+		   "work"),
+	TEST_ENTRY(trigger_ep_close, "Test deferred work of a closed "
+		   "endpoint"),
+	TEST_ENTRY(trigger_bad_ep, "Test deferred work of an invalid "
+		   "endpoint"),
+	{ NULL, "" }
+};
+
+static void usage(char *name)
+{
+	ft_unit_usage(name, "Unit test for triggered operations");
+}
+
+int main(int argc, char **argv)
+{
+	int op, ret, cleanup_ret;
+	int failed = 0;
+
+	hints = fi_allocinfo();
+	if (!hints)
+		return EXIT_FAILURE;
+
+	while ((op = getopt(argc, argv, FAB_OPTS "h")) != -1) {
+		switch (op) {
+		default:
+			ft_parseinfo(op, optarg, hints, &opts);
+			break;
+		case '?':
+		case 'h':
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	hints->caps |= FI_MSG | FI_TRIGGER;
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->mode = ~0;
+	hints->domain_attr->mode = ~0;
+	hints->domain_attr->mr_mode = ~OFI_MR_DEPRECATED;
+
+	ret = fi_getinfo(FT_FIVERSION, NULL, 0, 0, hints, &fi);
+	if (ret) {
+		FT_PRINTERR("fi_getinfo", ret);
+		goto out;
+	}
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		goto out;
+
+	ret = ft_alloc_ep_res(fi, &txcq, &rxcq, &txcntr, &rxcntr, &rma_cntr,
+			      &av);
+	if (ret)
+		goto out;
+
+	printf("Testing triggered operations on fabric %s\n",
+	       fi->fabric_attr->name);
+
+	failed = run_tests(test_array, err_buf);
+	if (failed > 0)
+		printf("Summary: %d tests failed\n", failed);
+	else
+		printf("Summary: all tests passed\n");
+
+out:
+	cleanup_ret = ft_free_res();
+	return ret ? ft_exit_code(ret) :
+		cleanup_ret ? ft_exit_code(cleanup_ret) :
+			(failed > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -48,6 +48,7 @@
 #include <sys/socket.h>
 
 #include <linux/errqueue.h>
+#include <linux/futex.h>
 #include <ifaddrs.h>
 #include "unix/osd.h"
 #include "rdma/fi_errno.h"
@@ -70,6 +71,10 @@ static inline int ofi_alloc_hugepage_buf(void **memptr, size_t size)
 	return ofi_mmap_anon_pages(memptr, size, MAP_HUGETLB);
 }
 
+int ofi_alloc_hugepage_buf_size(void **memptr, size_t size, size_t page_size);
+int ofi_get_numa_node(void);
+int ofi_mbind_node(void *addr, size_t size, int node);
+
 static inline int ofi_hugepage_enabled(void)
 {
 	size_t len;
@@ -155,6 +160,32 @@ static inline int ofi_pidfd_getfd(int pidfd, int targetfd, unsigned int flags)
 	return syscall(__NR_pidfd_getfd, pidfd, targetfd, flags);
 }
 
+/* Sleep while the 32-bit word at addr holds val, for at most timeout ms
+ * (< 0 waits forever).  Returns -FI_EAGAIN if the word has changed.
+ */
+static inline int ofi_futex_wait(void *addr, int32_t val, int timeout)
+{
+	struct timespec ts, *tsp = NULL;
+
+	if (timeout >= 0) {
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (timeout % 1000) * 1000000;
+		tsp = &ts;
+	}
+
+	return syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, tsp,
+		       NULL, 0) ? -errno : 0;
+}
+
+static inline int ofi_futex_wake(void *addr, int count)
+{
+	long ret;
+
+	ret = syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL,
+		      NULL, 0);
+	return ret < 0 ? -errno : (int) ret;
+}
+
 static inline ssize_t ofi_read_socket(SOCKET fd, void *buf, size_t count)
 {
 	return read(fd, buf, count);
@@ -50,6 +50,10 @@ enum util_coll_op_type {
 	UTIL_COLL_BROADCAST_OP,
 	UTIL_COLL_ALLGATHER_OP,
 	UTIL_COLL_SCATTER_OP,
+	UTIL_COLL_ALLTOALL_OP,
+	UTIL_COLL_REDUCE_SCATTER_OP,
+	UTIL_COLL_REDUCE_OP,
+	UTIL_COLL_GATHER_OP,
 };
 
 static const char * const log_util_coll_op_type[] = {
@@ -58,7 +62,11 @@ static const char * const log_util_coll_op_type[] = {
 	[UTIL_COLL_ALLREDUCE_OP] = "COLL_ALLREDUCE",
 	[UTIL_COLL_BROADCAST_OP] = "COLL_BROADCAST",
 	[UTIL_COLL_ALLGATHER_OP] = "COLL_ALLGATHER",
-	[UTIL_COLL_SCATTER_OP] = "COLL_SCATTER"
+	[UTIL_COLL_SCATTER_OP] = "COLL_SCATTER",
+	[UTIL_COLL_ALLTOALL_OP] = "COLL_ALLTOALL",
+	[UTIL_COLL_REDUCE_SCATTER_OP] = "COLL_REDUCE_SCATTER",
+	[UTIL_COLL_REDUCE_OP] = "COLL_REDUCE",
+	[UTIL_COLL_GATHER_OP] = "COLL_GATHER"
 };
 
 enum coll_work_type {
@@ -86,6 +94,8 @@ struct util_coll_operation;
 struct util_coll_work_item {
 	struct slist_entry		ready_entry;
 	struct dlist_entry		waiting_entry;
+	/* all items of a persistent schedule, in schedule order */
+	struct dlist_entry		sched_entry;
 	struct util_coll_operation 	*coll_op;
 	enum coll_work_type		type;
 	enum coll_state			state;
@@ -122,6 +132,21 @@ struct join_data {
 	struct util_coll_mc *new_mc;
 	struct ofi_bitmask data;
 	struct ofi_bitmask tmp;
+	uint64_t host_id;
+	uint64_t *hosts;
+};
+
+/*
+ * Ranks of a collective group arranged by node.  The ranks of node i
+ * are members[node_start[i]] up to members[node_start[i + 1]], in rank
+ * order, and the first of them is the node leader.
+ */
+struct util_coll_topo {
+	size_t		num_nodes;
+	uint64_t	*node;
+	uint64_t	*node_start;
+	uint64_t	*members;
+	uint64_t	*leaders;
 };
 
 struct barrier_data {
@@ -157,9 +182,28 @@ struct util_coll_operation {
 		struct allreduce_data	allreduce;
 		void			*scatter;
 		struct broadcast_data	broadcast;
+		/* alltoall, reduce_scatter, reduce and gather */
+		void			*scratch;
 	} data;
 	util_coll_comp_fn_t		comp_fn;
 	uint64_t			flags;
+
+	/*
+	 * Persistent schedules are cached by the mc and by the ep, and
+	 * replayed with new buffers by collectives with the same parameters.
+	 */
+	struct dlist_entry		cache_entry;
+	struct dlist_entry		ep_cache_entry;
+	struct dlist_entry		sched_list;
+	bool				persistent;
+	bool				busy;
+	size_t				count;
+	enum fi_datatype		datatype;
+	enum fi_op			op;
+	const void			*send_buf;
+	size_t				send_size;
+	void				*result;
+	size_t				result_size;
 };
 
 struct ofi_coll_cq {
@@ -339,20 +339,70 @@ enum ofi_lock_type {
 	OFI_LOCK_SPINLOCK,
 	OFI_LOCK_NOOP,
 	OFI_LOCK_NONE,
+	OFI_LOCK_RWLOCK,
+	OFI_LOCK_SHARDED,
 };
 
+/*
+ * OFI_LOCK_RWLOCK and OFI_LOCK_SHARDED let lookups in read-mostly
+ * structures proceed in parallel through ofi_genlock_rdlock().
+ * ofi_genlock_lock() still takes the lock exclusively.  A sharded lock
+ * keeps one mutex per cache line: readers take only the shard assigned
+ * to their thread, so they do not bounce a shared reader count between
+ * CPUs, and writers take every shard.  Other lock types treat read
+ * locks as exclusive.
+ */
+#define OFI_GENLOCK_SHARDS 16
+
+struct ofi_genlock_shard {
+	ofi_mutex_t	lock;
+} __attribute__((__aligned__(64)));
+
 struct ofi_genlock {
 	enum ofi_lock_type	lock_type;
 	union {
 		ofi_mutex_t	mutex;
 		ofi_spin_t	spinlock;
+		pthread_rwlock_t rwlock;
+		struct ofi_genlock_shard *shards;
 	} base;
 };
 
+extern OFI_THREAD_LOCAL unsigned int ofi_genlock_shard_id;
+unsigned int ofi_genlock_shard_assign(void);
+
+static inline struct ofi_genlock_shard *
+ofi_genlock_shard(struct ofi_genlock *lock)
+{
+	unsigned int id = ofi_genlock_shard_id;
+
+	if (OFI_UNLIKELY(!id))
+		id = ofi_genlock_shard_assign();
+	return &lock->base.shards[id - 1];
+}
+
 int ofi_genlock_init(struct ofi_genlock *lock,
 		     enum ofi_lock_type lock_type);
 void ofi_genlock_destroy(struct ofi_genlock *lock);
 
+/* pthread rwlocks have no owner, so only report whether anyone holds it */
+static inline int ofi_rwlock_held(pthread_rwlock_t *rwlock)
+{
+#if ENABLE_DEBUG
+	if (pthread_rwlock_trywrlock(rwlock))
+		return 1;
+
+	pthread_rwlock_unlock(rwlock);
+	return 0;
+#else
+	return 1;
+#endif
+}
+
+/*
+ * Read and write lockers of a sharded lock both hold the shard of the
+ * calling thread.
+ */
 static inline int ofi_genlock_held(struct ofi_genlock *lock)
 {
 	switch (lock->lock_type) {
@@ -362,6 +412,10 @@ static inline int ofi_genlock_held(struct ofi_genlock *lock)
 	case OFI_LOCK_NOOP:
 		/* Use mutex for debug no-op support */
 		return ofi_mutex_held_op(&lock->base.mutex);
+	case OFI_LOCK_RWLOCK:
+		return ofi_rwlock_held(&lock->base.rwlock);
+	case OFI_LOCK_SHARDED:
+		return ofi_mutex_held(&ofi_genlock_shard(lock)->lock);
 	case OFI_LOCK_NONE:
 	default:
 		return 1;
@@ -370,6 +424,8 @@ static inline int ofi_genlock_held(struct ofi_genlock *lock)
 
 static inline void ofi_genlock_lock(struct ofi_genlock *lock)
 {
+	int i;
+
 	switch (lock->lock_type) {
 	case OFI_LOCK_SPINLOCK:
 		ofi_spin_lock_op(&lock->base.spinlock);
@@ -381,6 +437,13 @@ static inline void ofi_genlock_lock(struct ofi_genlock *lock)
 		/* Use mutex for debug no-op support */
 		ofi_mutex_lock_noop(&lock->base.mutex);
 		break;
+	case OFI_LOCK_RWLOCK:
+		pthread_rwlock_wrlock(&lock->base.rwlock);
+		break;
+	case OFI_LOCK_SHARDED:
+		for (i = 0; i < OFI_GENLOCK_SHARDS; i++)
+			ofi_mutex_lock(&lock->base.shards[i].lock);
+		break;
 	case OFI_LOCK_NONE:
 	default:
 		break;
@@ -389,6 +452,8 @@ static inline void ofi_genlock_lock(struct ofi_genlock *lock)
 
 static inline void ofi_genlock_unlock(struct ofi_genlock *lock)
 {
+	int i;
+
 	switch (lock->lock_type) {
 	case OFI_LOCK_SPINLOCK:
 		ofi_spin_unlock_op(&lock->base.spinlock);
@@ -400,12 +465,49 @@ static inline void ofi_genlock_unlock(struct ofi_genlock *lock)
 		/* Use mutex for debug no-op support */
 		ofi_mutex_unlock_noop(&lock->base.mutex);
 		break;
+	case OFI_LOCK_RWLOCK:
+		pthread_rwlock_unlock(&lock->base.rwlock);
+		break;
+	case OFI_LOCK_SHARDED:
+		for (i = OFI_GENLOCK_SHARDS - 1; i >= 0; i--)
+			ofi_mutex_unlock(&lock->base.shards[i].lock);
+		break;
 	case OFI_LOCK_NONE:
 	default:
 		break;
 	}
 }
 
+static inline void ofi_genlock_rdlock(struct ofi_genlock *lock)
+{
+	switch (lock->lock_type) {
+	case OFI_LOCK_RWLOCK:
+		pthread_rwlock_rdlock(&lock->base.rwlock);
+		break;
+	case OFI_LOCK_SHARDED:
+		ofi_mutex_lock(&ofi_genlock_shard(lock)->lock);
+		break;
+	default:
+		ofi_genlock_lock(lock);
+		break;
+	}
+}
+
+static inline void ofi_genlock_rdunlock(struct ofi_genlock *lock)
+{
+	switch (lock->lock_type) {
+	case OFI_LOCK_RWLOCK:
+		pthread_rwlock_unlock(&lock->base.rwlock);
+		break;
+	case OFI_LOCK_SHARDED:
+		ofi_mutex_unlock(&ofi_genlock_shard(lock)->lock);
+		break;
+	default:
+		ofi_genlock_unlock(lock);
+		break;
+	}
+}
+
 #ifdef __cplusplus
 }
 #endif
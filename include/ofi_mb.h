@@ -200,6 +200,11 @@ static inline void ofi_rmb(void)
 	atomic_thread_fence(memory_order_acquire);
 }
 
+static inline void ofi_mb(void)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+}
+
 #elif defined(HAVE_BUILTIN_MM_ATOMICS)
 
 static inline void ofi_wmb(void)
@@ -212,6 +217,11 @@ static inline void ofi_rmb(void)
 	__atomic_thread_fence(__ATOMIC_ACQUIRE);
 }
 
+static inline void ofi_mb(void)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
 #elif defined(_MSC_VER)
 #include <intrin.h>
 
@@ -225,6 +235,11 @@ static inline void ofi_rmb(void)
 	_mm_lfence();
 }
 
+static inline void ofi_mb(void)
+{
+	_mm_mfence();
+}
+
 #else
 #error "Neither built-in atomics nor C11 atomics is supported by compiler."
 #endif
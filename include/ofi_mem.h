@@ -342,9 +342,13 @@ enum {
 	OFI_BUFPOOL_HUGEPAGES		= 1 << 3,
 	OFI_BUFPOOL_NONSHARED		= 1 << 4,
 	OFI_BUFPOOL_NO_ZERO		= 1 << 5,
+	OFI_BUFPOOL_MAGAZINE		= 1 << 6,
+	OFI_BUFPOOL_NUMA		= 1 << 7,
+	OFI_BUFPOOL_PREFAULT		= 1 << 8,
 };
 
 struct ofi_bufpool_region;
+struct ofi_bufpool_depot;
 
 struct ofi_bufpool_attr {
 	size_t 		size;
@@ -356,6 +360,19 @@ struct ofi_bufpool_attr {
 	void		(*init_fn)(struct ofi_bufpool_region *region, void *buf);
 	void 		*context;
 	int		flags;
+	/* huge page size with OFI_BUFPOOL_HUGEPAGES, 0 for the default */
+	size_t		page_size;
+	/* node with OFI_BUFPOOL_NUMA, -1 for the creating thread's node */
+	int		numa_node;
+};
+
+/* Memory layout of a pool, for checking its TLB footprint */
+struct ofi_bufpool_stats {
+	size_t		page_size;
+	size_t		huge_regions;
+	size_t		huge_fallbacks;
+	size_t		split_entries;
+	int		numa_node;
 };
 
 struct ofi_bufpool {
@@ -372,6 +389,12 @@ struct ofi_bufpool {
 	size_t				alloc_size;
 	size_t				region_size;
 	struct ofi_bufpool_attr		attr;
+	/* chunk_cnt before it was raised to fill a huge page */
+	size_t				base_chunk_cnt;
+
+	/* set for OFI_BUFPOOL_MAGAZINE pools, see ofi_buf_mag_alloc() */
+	struct ofi_bufpool_depot	*depot;
+	struct ofi_bufpool_stats	stats;
 };
 
 struct ofi_bufpool_region {
@@ -421,9 +444,27 @@ ofi_bufpool_create(struct ofi_bufpool **buf_pool,
 }
 
 void ofi_bufpool_destroy(struct ofi_bufpool *pool);
+void ofi_bufpool_fini(void);
+
+/*
+ * Per provider FI_<PROV>_BUFPOOL_* variables selecting huge pages, NUMA
+ * placement and pre-faulting for the provider's data path pools.
+ */
+void ofi_bufpool_param_define(struct fi_provider *prov);
+void ofi_bufpool_param_get(struct fi_provider *prov,
+			   struct ofi_bufpool_attr *attr);
 
 int ofi_bufpool_grow(struct ofi_bufpool *pool);
 
+/*
+ * OFI_BUFPOOL_MAGAZINE pools may be used by several threads without an
+ * external lock.  Each thread keeps a small cache of free buffers, and
+ * exchanges full and empty batches of buffers with a shared, locked depot.
+ * The pool must not be destroyed while other threads still use it.
+ */
+void *ofi_buf_mag_alloc(struct ofi_bufpool *pool);
+void ofi_buf_mag_free(struct ofi_bufpool *pool, void *buf);
+
 static inline struct ofi_bufpool_hdr *ofi_buf_hdr(void *buf)
 {
 	return (struct ofi_bufpool_hdr *)
@@ -475,6 +516,11 @@ static inline void ofi_buf_free(void *buf)
 	assert(ofi_buf_hdr(buf)->ftr->magic == OFI_MAGIC_SIZE_T);
 	assert(ofi_buf_is_valid(buf));
 
+	if (ofi_buf_pool(buf)->attr.flags & OFI_BUFPOOL_MAGAZINE) {
+		ofi_buf_mag_free(ofi_buf_pool(buf), buf);
+		return;
+	}
+
 	slist_insert_head(&ofi_buf_hdr(buf)->entry.slist,
 			  &ofi_buf_pool(buf)->free_list.entries);
 }
@@ -537,6 +583,9 @@ static inline void *ofi_buf_alloc(struct ofi_bufpool *pool)
 	struct ofi_bufpool_hdr *buf_hdr;
 
 	assert(!(pool->attr.flags & OFI_BUFPOOL_INDEXED));
+	if (pool->attr.flags & OFI_BUFPOOL_MAGAZINE)
+		return ofi_buf_mag_alloc(pool);
+
 	if (ofi_bufpool_empty(pool)) {
 		if (ofi_bufpool_grow(pool))
 			return NULL;
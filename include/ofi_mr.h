@@ -154,6 +154,7 @@ struct ofi_mr_entry {
 	struct ofi_mr_info		info;
 	struct ofi_rbnode		*node;
 	int				use_cnt;
+	bool				stale;
 	struct dlist_entry		list_entry;
 	union ofi_mr_hmem_info		hmem_info;
 	uint8_t				data[];
@@ -245,6 +246,9 @@ extern struct ofi_mem_monitor *uffd_monitor;
 struct ofi_memhooks {
 	struct ofi_mem_monitor          monitor;
 	struct dlist_entry		intercept_list;
+	/* intercepted events dropped by the range summary or delivered */
+	ofi_atomic64_t			filtered_cnt;
+	ofi_atomic64_t			delivered_cnt;
 };
 
 extern struct ofi_mem_monitor *memhooks_monitor;
@@ -280,13 +284,29 @@ extern struct ofi_mem_monitor *xpmem_monitor;
  * is used by the ofi_mr_xxx calls below, and may be accessed by a
  * provider when processing incoming RMA operations to verify that
  * a region has been registered for the specified operation.
+ *
+ * Maps that issue provider keys (FI_MR_PROV_KEY) hand out dense keys
+ * that index a slot table: the low 32 bits are the slot index and the
+ * upper 32 bits are a generation that is bumped each time the slot is
+ * freed.  Dense keys are verified in O(1) without taking the domain
+ * lock.  Keys chosen by the user, and keys with a zero generation,
+ * are kept in the rbtree.
  */
+#define OFI_MR_MAP_GEN_SHIFT	32
+#define OFI_MR_MAP_CHUNK_SIZE	256
+#define OFI_MR_MAP_MAX_CHUNKS	4096
+
+struct ofi_mr_map_slot;
 
 struct ofi_mr_map {
 	const struct fi_provider *prov;
 	struct ofi_rbmap	*rbtree;
 	uint64_t		key;
 	int			mode;
+
+	struct ofi_mr_map_slot	**slots;
+	size_t			chunk_cnt;
+	struct dlist_entry	free_slots;
 };
 
 int ofi_mr_map_init(const struct fi_provider *in_prov, int mode,
@@ -299,6 +319,10 @@ int ofi_mr_map_insert(struct ofi_mr_map *map,
 		      uint64_t flags);
 int ofi_mr_map_remove(struct ofi_mr_map *map, uint64_t key);
 void *ofi_mr_map_get(struct ofi_mr_map *map,  uint64_t key);
+int ofi_mr_map_foreach(struct ofi_mr_map *map,
+		       int (*func)(struct ofi_mr_map *map,
+				   struct fi_mr_attr *attr, void *context),
+		       void *context);
 
 int ofi_mr_map_verify(struct ofi_mr_map *map, uintptr_t *io_addr,
 		      size_t len, uint64_t key, uint64_t access,
@@ -315,6 +339,12 @@ int ofi_mr_map_verify(struct ofi_mr_map *map, uintptr_t *io_addr,
  * a dev_reg data structure, e.g. gdrcopy handle in cuda
  */
 #define OFI_HMEM_DATA_DEV_REG_HANDLE	(1ULL << 60)
+/**
+ * OFI_MR_MAP_KEEP_KEY inserts the region under attr->requested_key
+ * even if the map issues provider keys.  Used to mirror a region
+ * into another map under the key that was already handed out.
+ */
+#define OFI_MR_MAP_KEEP_KEY		(1ULL << 61)
 
 struct ofi_mr {
 	struct fid_mr mr_fid;
@@ -387,6 +417,8 @@ struct ofi_mr_cache_params {
 	size_t				max_cnt;
 	size_t				max_size;
 	char *				monitor;
+	char *				trace;
+	int				lazy_invalidate;
 	int				cuda_monitor_enabled;
 	int				rocr_monitor_enabled;
 	int				ze_monitor_enabled;
@@ -418,7 +450,9 @@ struct ofi_mr_cache {
 	size_t				delete_cnt;
 	size_t				hit_cnt;
 	size_t				notify_cnt;
+	size_t				stale_cnt;
 	struct ofi_bufpool		*entry_pool;
+	FILE				*trace_file;
 
 	int				(*add_region)(struct ofi_mr_cache *cache,
 						      struct ofi_mr_entry *entry);
@@ -215,7 +215,11 @@ ofi_sockapi_accept_socket(struct ofi_sockapi *sockapi, SOCKET sock,
 	OFI_UNUSED(sockapi);
 	OFI_UNUSED(ctx);
 
+#if HAVE_ACCEPT4
+	ret = accept4(sock, addr, addrlen, SOCK_CLOEXEC);
+#else
 	ret = accept(sock, addr, addrlen);
+#endif
 	if (ret < 0)
 		return -ofi_sockerr();
 	return ret;
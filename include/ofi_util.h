@@ -90,6 +90,12 @@ extern "C" {
 /* Memory registration should not be cached */
 #define OFI_MR_NOCACHE		BIT_ULL(60)
 
+/* Internal counter flag: the provider updates the counter from its own
+ * progress thread, so FI_WAIT_UNSPEC waiters may block without driving
+ * progress.  Set through ofi_cntr_init_auto_progress(), never by apps.
+ */
+#define OFI_CNTR_AUTO_PROGRESS	BIT_ULL(59)
+
 #define OFI_INFO_FIELD(provider, prov_attr, user_attr, prov_str, user_str, type) \
 	do {									\
 		FI_INFO(provider, FI_LOG_CORE, prov_str ": %s\n",		\
@@ -195,6 +201,8 @@ int ofi_trywait(struct fid_fabric *fabric, struct fid **fids, int count);
 /*
  * Domain
  */
+struct util_trigger;
+
 struct util_domain {
 	struct fid_domain	domain_fid;
 	struct dlist_entry	list_entry;
@@ -216,6 +224,13 @@ struct util_domain {
 	enum fi_threading	threading;
 	enum fi_progress	data_progress;
 	enum fi_progress	control_progress;
+
+	/* Triggered operations, see util_trigger.c */
+	ofi_mutex_t		trigger_lock;
+	struct dlist_entry	trigger_cntr_list;
+	struct dlist_entry	trigger_ready_list;
+	ofi_atomic32_t		trigger_ready_cnt;
+	struct util_trigger	*trigger_inflight;
 };
 
 int ofi_domain_init(struct fid_fabric *fabric_fid, const struct fi_info *info,
@@ -682,6 +697,9 @@ ofi_cq_write_src(struct util_cq *cq, void *context, uint64_t flags, size_t len,
 
 int ofi_cq_write_error(struct util_cq *cq,
 		       const struct fi_cq_err_entry *err_entry);
+/* Caller must hold the cq_lock and signal the CQ's wait object */
+int ofi_cq_insert_error(struct util_cq *cq,
+			const struct fi_cq_err_entry *err_entry);
 int ofi_cq_write_error_peek(struct util_cq *cq, uint64_t tag, void *context);
 int ofi_cq_write_error_trunc(struct util_cq *cq, void *context, uint64_t flags,
 			     size_t len, void *buf, uint64_t data, uint64_t tag,
@@ -753,6 +771,21 @@ struct util_cntr {
 
 	struct fid_peer_cntr	*peer_cntr;
 	uint64_t		flags;
+
+	/* Pending triggers sorted by threshold, protected by the domain
+	 * trigger_lock.
+	 */
+	struct dlist_entry	trigger_list;
+	struct dlist_entry	trigger_entry;
+	ofi_atomic32_t		trigger_cnt;
+
+	/* Futex wait mode, see util_cntr_futex_wait().  futex_seq is the
+	 * futex word, bumped when futex_threshold, the lowest threshold of
+	 * the blocked waiters, is reached.
+	 */
+	ofi_atomic32_t		futex_seq;
+	ofi_atomic32_t		futex_waiters;
+	ofi_atomic64_t		futex_threshold;
 };
 
 #define OFI_TIMEOUT_QUANTUM_MS 50
@@ -761,6 +794,11 @@ void ofi_cntr_progress(struct util_cntr *cntr);
 int ofi_cntr_init(const struct fi_provider *prov, struct fid_domain *domain,
 		  struct fi_cntr_attr *attr, struct util_cntr *cntr,
 		  ofi_cntr_progress_func progress, void *context);
+int ofi_cntr_init_auto_progress(const struct fi_provider *prov,
+				struct fid_domain *domain,
+				struct fi_cntr_attr *attr,
+				struct util_cntr *cntr,
+				ofi_cntr_progress_func progress, void *context);
 int ofi_cntr_cleanup(struct util_cntr *cntr);
 uint64_t ofi_cntr_read(struct fid_cntr *cntr_fid);
 uint64_t ofi_cntr_readerr(struct fid_cntr *cntr_fid);
@@ -770,6 +808,56 @@ int ofi_cntr_set(struct fid_cntr *cntr_fid, uint64_t value);
 int ofi_cntr_seterr(struct fid_cntr *cntr_fid, uint64_t value);
 int ofi_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold, int timeout);
 
+/*
+ * Triggered operations and deferred work
+ *
+ * Operations posted with FI_TRIGGER, or queued to the domain with
+ * fi_control(FI_QUEUE_WORK), wait on a util_cntr threshold.  Counter
+ * updates move the operations whose threshold was reached to the domain
+ * ready list.  Because counters are updated from within provider progress,
+ * the ready operations are only issued, through the regular fi_* calls,
+ * from ofi_trigger_progress().  The util CQ and counter read and wait
+ * calls invoke it after progressing their endpoints.
+ */
+#define OFI_TRIGGER_IOV_LIMIT 4
+
+void ofi_trigger_init(struct util_domain *domain);
+void ofi_trigger_cleanup(struct util_domain *domain);
+void ofi_trigger_cntr_cleanup(struct util_cntr *cntr);
+/* Must be called before the endpoint stops accepting data transfers */
+void ofi_trigger_ep_cleanup(struct util_ep *ep);
+void ofi_trigger_check(struct util_cntr *cntr);
+void ofi_trigger_run(struct util_domain *domain);
+bool ofi_trigger_pending(struct util_domain *domain);
+int ofi_trigger_control(struct util_domain *domain, int command, void *arg);
+
+ssize_t ofi_trigger_queue_msg(struct fid_ep *ep, const struct fi_msg *msg,
+			      uint64_t flags, enum fi_op_type op_type);
+ssize_t ofi_trigger_queue_tagged(struct fid_ep *ep,
+				 const struct fi_msg_tagged *msg,
+				 uint64_t flags, enum fi_op_type op_type);
+ssize_t ofi_trigger_queue_rma(struct fid_ep *ep, const struct fi_msg_rma *msg,
+			      uint64_t flags, enum fi_op_type op_type);
+ssize_t ofi_trigger_queue_atomic(struct fid_ep *ep,
+				 const struct fi_msg_atomic *msg,
+				 const struct fi_ioc *comparev,
+				 void **compare_desc, size_t compare_count,
+				 struct fi_ioc *resultv, void **result_desc,
+				 size_t result_count, uint64_t flags,
+				 enum fi_op_type op_type);
+
+static inline void ofi_trigger_cntr_update(struct util_cntr *cntr)
+{
+	if (ofi_atomic_get32(&cntr->trigger_cnt))
+		ofi_trigger_check(cntr);
+}
+
+static inline void ofi_trigger_progress(struct util_domain *domain)
+{
+	if (ofi_atomic_get32(&domain->trigger_ready_cnt))
+		ofi_trigger_run(domain);
+}
+
 static inline void util_cntr_signal(struct util_cntr *cntr)
 {
 	assert(cntr->wait);
@@ -845,6 +933,7 @@ static inline void ofi_ep_peer_rx_cntr_incerr(struct util_ep *ep, uint8_t op)
 struct util_av;
 struct util_av_set;
 struct util_peer_addr;
+struct util_coll_topo;
 
 struct util_coll_mc {
 	struct fid_mc		mc_fid;
@@ -853,6 +942,9 @@ struct util_coll_mc {
 	uint16_t		group_id;
 	uint16_t		seq;
 	ofi_atomic32_t		ref;
+	struct util_coll_topo	*topo;
+	struct dlist_entry	sched_cache;
+	size_t			sched_cache_cnt;
 };
 
 struct util_av_set {
@@ -867,9 +959,14 @@ struct util_av_set {
 	size_t			max_array_size;
 };
 
+struct util_av_slot {
+	uint64_t	hash;
+	ofi_atomic64_t	fi_addr;
+};
+
 struct util_av_entry {
 	ofi_atomic32_t	use_cnt;
-	UT_hash_handle	hh;
+	uint64_t	hash;
 	/*
 	 * data includes 'addr' and any other additional fields
 	 * associated with av_entry. 'addr' must be the first
@@ -879,6 +976,22 @@ struct util_av_entry {
 	char		data[];
 };
 
+/*
+ * A named AV is kept in /dev/shm so that all processes on a node share
+ * one copy.  The process that creates it inserts the addresses, others
+ * open it with FI_READ and map it read-only.  The header is followed by
+ * the lookup table and by the addresses, indexed by fi_addr.
+ */
+struct util_av_shm {
+	uint64_t		magic;
+	pid_t			pid;
+	uint32_t		addrlen;
+	uint64_t		capacity;
+	uint64_t		slot_cnt;
+	ofi_atomic64_t		count;
+	struct util_av_slot	slots[];
+};
+
 struct util_av {
 	struct fid_av		av_fid;
 	struct util_domain	*domain;
@@ -886,7 +999,15 @@ struct util_av {
 	struct ofi_genlock	lock;
 	const struct fi_provider *prov;
 
-	struct util_av_entry	*hash;
+	/*
+	 * Open-addressing table mapping addresses to fi_addr's.  Each
+	 * slot keeps the address hash so that probing and growing do not
+	 * touch the AV entries.
+	 */
+	struct util_av_slot	*slots;
+	size_t			slot_mask;
+	size_t			slot_used;
+	size_t			slot_deleted;
 	struct ofi_bufpool	*av_entry_pool;
 
 	struct util_av_set	*av_set;
@@ -902,9 +1023,20 @@ struct util_av {
 	struct ofi_genlock	ep_list_lock;
 	void			(*remove_handler)(struct util_ep *util_ep,
 						  struct util_peer_addr *peer);
+
+	/* Shared AVs keep provider context in a local array */
+	struct util_av_shm	*shm;
+	size_t			shm_size;
+	char			*shm_name;
+	char			*shm_addrs;
+	size_t			shm_stride;
+	char			*ctx_array;
+	size_t			context_len;
 };
 
 #define OFI_AV_DYN_ADDRLEN (1 << 0)
+/* Provider supports named AVs shared through /dev/shm */
+#define OFI_AV_SHAREABLE (1 << 1)
 
 struct util_av_attr {
 	/* Must be a multiple of 8 bytes */
@@ -962,16 +1094,24 @@ struct rxm_av {
 	struct fid_av *util_coll_av;
 	struct fid_av *offload_coll_av;
 	void (*foreach_ep)(struct util_av *av, struct util_ep *util_ep);
+	/* Called for each endpoint bound to the AV and each inserted peer */
+	void (*insert_handler)(struct util_ep *util_ep,
+			       struct util_peer_addr *peer);
 };
 
 int rxm_util_av_open(struct fid_domain *domain_fid, struct fi_av_attr *attr,
 		     struct fid_av **fid_av, void *context, size_t conn_size,
 		     void (*remove_handler)(struct util_ep *util_ep,
 					    struct util_peer_addr *peer),
+		     void (*insert_handler)(struct util_ep *util_ep,
+					    struct util_peer_addr *peer),
 		     void (*foreach_ep)(struct util_av *av,
 					struct util_ep *ep));
 size_t rxm_av_max_peers(struct rxm_av *av);
+void rxm_av_notify_ep(struct util_av *util_av, struct util_ep *util_ep);
 void rxm_ref_peer(struct util_peer_addr *peer);
+struct util_peer_addr **rxm_av_peer_ctx(struct util_av *util_av,
+					fi_addr_t fi_addr);
 void *rxm_av_alloc_conn(struct rxm_av *av);
 void rxm_av_free_conn(struct rxm_av *av, void *conn_ctx);
 
@@ -991,6 +1131,9 @@ size_t ofi_av_size(struct util_av *av);
 int ofi_av_insert_addr_at(struct util_av *av, const void *addr, fi_addr_t fi_addr);
 int ofi_av_insert_addr(struct util_av *av, const void *addr, fi_addr_t *fi_addr);
 int ofi_av_remove_addr(struct util_av *av, fi_addr_t fi_addr);
+void ofi_av_free_entry(struct util_av *av, struct util_av_entry *entry);
+int ofi_av_reserve(struct util_av *av, size_t count);
+bool ofi_av_is_valid(struct util_av *av, fi_addr_t fi_addr);
 fi_addr_t ofi_av_lookup_fi_addr_unsafe(struct util_av *av, const void *addr);
 fi_addr_t ofi_av_lookup_fi_addr(struct util_av *av, const void *addr);
 
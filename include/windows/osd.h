@@ -811,6 +811,16 @@ static inline size_t ofi_process_vm_writev(pid_t pid,
 	return -FI_ENOSYS;
 }
 
+static inline int ofi_futex_wait(void *addr, int32_t val, int timeout)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_futex_wake(void *addr, int count)
+{
+	return -FI_ENOSYS;
+}
+
 static inline ssize_t ofi_read_socket(SOCKET fd, void *buf, size_t count)
 {
 	return ofi_recv_socket(fd, buf, count, 0);
@@ -1010,6 +1020,22 @@ static inline int ofi_alloc_hugepage_buf(void **memptr, size_t size)
 	return -FI_ENOSYS;
 }
 
+static inline int ofi_alloc_hugepage_buf_size(void **memptr, size_t size,
+					      size_t page_size)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_get_numa_node(void)
+{
+	return -FI_ENOSYS;
+}
+
+static inline int ofi_mbind_node(void *addr, size_t size, int node)
+{
+	return -FI_ENOSYS;
+}
+
 static inline int ofi_hugepage_enabled(void)
 {
 	return 0;
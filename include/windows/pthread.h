@@ -147,6 +147,30 @@ static inline int pthread_yield(void)
 	return 0;
 }
 
+typedef DWORD			pthread_key_t;
+
+static inline int pthread_key_create(pthread_key_t *key,
+				     void (*destructor)(void *))
+{
+	*key = FlsAlloc((PFLS_CALLBACK_FUNCTION) destructor);
+	return *key == FLS_OUT_OF_INDEXES ? EAGAIN : 0;
+}
+
+static inline int pthread_key_delete(pthread_key_t key)
+{
+	return FlsFree(key) ? 0 : EINVAL;
+}
+
+static inline void *pthread_getspecific(pthread_key_t key)
+{
+	return FlsGetValue(key);
+}
+
+static inline int pthread_setspecific(pthread_key_t key, const void *value)
+{
+	return FlsSetValue(key, (void *) value) ? 0 : EINVAL;
+}
+
 /*
  * TODO: temporary solution
  * Need to re-implement
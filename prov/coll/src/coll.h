@@ -82,6 +82,25 @@ struct coll_av {
 	struct fid_peer_av *peer_av;
 };
 
+/*
+ * Scratch buffers of up to COLL_BUF_SIZE bytes are reused through the
+ * endpoint's buffer pool, larger ones are allocated from the heap.
+ */
+#define COLL_BUF_SIZE		(64 * 1024)
+
+struct coll_buf {
+	struct coll_ep	*ep;	/* NULL if allocated from the heap */
+	size_t		size;
+	uint8_t		data[];
+};
+
+union coll_work_item {
+	struct util_coll_work_item	hdr;
+	struct util_coll_xfer_item	xfer;
+	struct util_coll_reduce_item	reduce;
+	struct util_coll_copy_item	copy;
+};
+
 struct coll_ep {
 	struct util_ep util_ep;
 	struct fi_info *coll_info;
@@ -92,6 +111,13 @@ struct coll_ep {
 	 */
 	struct fi_info *peer_info;
 	struct fid_ep *peer_ep;
+
+	struct ofi_bufpool *buf_pool;
+	struct ofi_bufpool *item_pool;
+	ofi_mutex_t pool_lock;
+
+	/* persistent schedules run on this ep, from item_pool and buf_pool */
+	struct dlist_entry sched_cache;
 };
 
 struct coll_mr {
@@ -115,6 +141,14 @@ coll_mr_desc_to_hmem_iface_dev(void **desc, size_t count, uint64_t *device)
 	return ((struct coll_mr *) desc[0])->iface;
 }
 
+struct coll_env {
+	int	hierarchical;
+	size_t	node_size;
+	size_t	sched_cache_size;
+};
+
+extern struct coll_env coll_env;
+
 extern struct fi_provider coll_prov;
 extern struct util_prov coll_util_prov;
 extern struct fi_fabric_attr coll_fabric_attr;
@@ -150,6 +184,10 @@ int coll_join_collective(struct fid_ep *ep, const void *addr,
 
 void coll_ep_progress(struct util_ep *util_ep);
 
+int coll_sched_cache_cleanup(struct coll_ep *ep);
+
+void coll_collective_comp(struct util_coll_operation *coll_op);
+
 ssize_t coll_ep_barrier(struct fid_ep *ep, fi_addr_t coll_addr, void *context);
 
 ssize_t coll_ep_barrier2(struct fid_ep *ep, fi_addr_t coll_addr, uint64_t flags,
@@ -175,5 +213,28 @@ ssize_t coll_ep_broadcast(struct fid_ep *ep, void *buf, size_t count,
 			  void *desc, fi_addr_t coll_addr, fi_addr_t root_addr,
 			  enum fi_datatype datatype, uint64_t flags,
 			  void *context);
+
+ssize_t coll_ep_alltoall(struct fid_ep *ep, const void *buf, size_t count,
+			 void *desc, void *result, void *result_desc,
+			 fi_addr_t coll_addr, enum fi_datatype datatype,
+			 uint64_t flags, void *context);
+
+ssize_t coll_ep_reduce_scatter(struct fid_ep *ep, const void *buf,
+			       size_t count, void *desc, void *result,
+			       void *result_desc, fi_addr_t coll_addr,
+			       enum fi_datatype datatype, enum fi_op op,
+			       uint64_t flags, void *context);
+
+ssize_t coll_ep_reduce(struct fid_ep *ep, const void *buf, size_t count,
+		       void *desc, void *result, void *result_desc,
+		       fi_addr_t coll_addr, fi_addr_t root_addr,
+		       enum fi_datatype datatype, enum fi_op op,
+		       uint64_t flags, void *context);
+
+ssize_t coll_ep_gather(struct fid_ep *ep, const void *buf, size_t count,
+		       void *desc, void *result, void *result_desc,
+		       fi_addr_t coll_addr, fi_addr_t root_addr,
+		       enum fi_datatype datatype, uint64_t flags,
+		       void *context);
 #endif /* _COLL_H_ */
 
@@ -262,6 +262,7 @@ int coll_av_set(struct fid_av *av_fid, struct fi_av_set_attr *attr,
 
 	ofi_atomic_initialize32(&av_set->ref, 0);
 	av_set->coll_mc.av_set = av_set;
+	dlist_init(&av_set->coll_mc.sched_cache);
 	av_set->av_set_fid.ops = &coll_av_set_ops;
 	av_set->av_set_fid.fid.fclass = FI_CLASS_AV_SET;
 	av_set->av_set_fid.fid.context = context;
@@ -70,10 +70,376 @@ coll_create_op(struct fid_ep *ep, struct util_coll_mc *coll_mc,
 	coll_op->context = context;
 	coll_op->comp_fn = comp_fn;
 	dlist_init(&coll_op->work_queue);
+	dlist_init(&coll_op->sched_list);
 
 	return coll_op;
 }
 
+static void *coll_buf_alloc(struct util_coll_operation *coll_op, size_t size)
+{
+	struct coll_ep *ep;
+	struct coll_buf *buf;
+
+	ep = container_of(coll_op->ep, struct coll_ep, util_ep.ep_fid);
+	if (size <= COLL_BUF_SIZE) {
+		ofi_mutex_lock(&ep->pool_lock);
+		buf = ofi_buf_alloc(ep->buf_pool);
+		ofi_mutex_unlock(&ep->pool_lock);
+		if (!buf)
+			return NULL;
+		buf->ep = ep;
+	} else {
+		buf = malloc(sizeof(*buf) + size);
+		if (!buf)
+			return NULL;
+		buf->ep = NULL;
+	}
+
+	buf->size = size;
+	return buf->data;
+}
+
+static void coll_buf_free(void *data)
+{
+	struct coll_buf *buf;
+	struct coll_ep *ep;
+
+	if (!data)
+		return;
+
+	buf = container_of(data, struct coll_buf, data);
+	ep = buf->ep;
+	if (ep) {
+		ofi_mutex_lock(&ep->pool_lock);
+		ofi_buf_free(buf);
+		ofi_mutex_unlock(&ep->pool_lock);
+	} else {
+		free(buf);
+	}
+}
+
+static void *coll_alloc_item(struct util_coll_operation *coll_op)
+{
+	struct coll_ep *ep;
+	union coll_work_item *item;
+
+	ep = container_of(coll_op->ep, struct coll_ep, util_ep.ep_fid);
+	ofi_mutex_lock(&ep->pool_lock);
+	item = ofi_buf_alloc(ep->item_pool);
+	ofi_mutex_unlock(&ep->pool_lock);
+	if (item)
+		memset(item, 0, sizeof(*item));
+
+	return item;
+}
+
+static void coll_free_item(struct util_coll_work_item *item)
+{
+	struct coll_ep *ep;
+
+	ep = container_of(item->coll_op->ep, struct coll_ep, util_ep.ep_fid);
+	ofi_mutex_lock(&ep->pool_lock);
+	ofi_buf_free(item);
+	ofi_mutex_unlock(&ep->pool_lock);
+}
+
+/* Release an operation that is not in progress, with all of its items */
+static void coll_free_op(struct util_coll_operation *coll_op)
+{
+	struct util_coll_work_item *item;
+	struct dlist_entry *tmp;
+
+	if (coll_op->persistent) {
+		dlist_foreach_container_safe(&coll_op->sched_list,
+					     struct util_coll_work_item,
+					     item, sched_entry, tmp)
+			coll_free_item(item);
+	} else {
+		dlist_foreach_container_safe(&coll_op->work_queue,
+					     struct util_coll_work_item,
+					     item, waiting_entry, tmp)
+			coll_free_item(item);
+	}
+
+	free(coll_op);
+}
+
+/*
+ * Persistent schedules.  Allreduce, allgather and barrier schedules are
+ * built once and cached by the collective group, keyed by the operation
+ * parameters.  A later call with the same parameters replays an idle
+ * cached schedule: its items are requeued with the tags of a new
+ * collective id, and pointers into the user buffers of the first call
+ * are rebased onto the new buffers.  Scratch buffers stay with the
+ * schedule.
+ */
+static bool coll_sched_cacheable(struct util_coll_mc *coll_mc,
+				 const void *send_buf, size_t send_size,
+				 const void *result, size_t result_size)
+{
+	uintptr_t send = (uintptr_t) send_buf, res = (uintptr_t) result;
+
+	/* the world group is not closed through coll_close */
+	if (!coll_env.sched_cache_size ||
+	    coll_mc == &coll_mc->av_set->coll_mc)
+		return false;
+
+	/* rebasing needs the buffers to be either the same or disjoint */
+	return send == res || send + send_size <= res ||
+	       res + result_size <= send;
+}
+
+static struct util_coll_operation *
+coll_sched_cache_get(struct fid_ep *ep, struct util_coll_mc *coll_mc,
+		     enum util_coll_op_type type, size_t count,
+		     enum fi_datatype datatype, enum fi_op op,
+		     const void *send_buf, const void *result)
+{
+	struct coll_ep *coll_ep;
+	struct util_coll_operation *coll_op;
+
+	coll_ep = container_of(ep, struct coll_ep, util_ep.ep_fid);
+	ofi_mutex_lock(&coll_ep->pool_lock);
+	dlist_foreach_container(&coll_ep->sched_cache,
+				struct util_coll_operation, coll_op,
+				ep_cache_entry) {
+		if (coll_op->busy || coll_op->mc != coll_mc ||
+		    coll_op->type != type || coll_op->count != count ||
+		    coll_op->datatype != datatype || coll_op->op != op ||
+		    (coll_op->send_buf == coll_op->result) !=
+		    (send_buf == result))
+			continue;
+
+		coll_op->busy = true;
+		ofi_mutex_unlock(&coll_ep->pool_lock);
+		return coll_op;
+	}
+	ofi_mutex_unlock(&coll_ep->pool_lock);
+
+	return NULL;
+}
+
+static void coll_sched_cache_add(struct util_coll_operation *coll_op)
+{
+	struct coll_ep *ep;
+
+	ep = container_of(coll_op->ep, struct coll_ep, util_ep.ep_fid);
+	ofi_mutex_lock(&ep->pool_lock);
+	coll_op->busy = true;
+	dlist_insert_tail(&coll_op->cache_entry, &coll_op->mc->sched_cache);
+	dlist_insert_tail(&coll_op->ep_cache_entry, &ep->sched_cache);
+	coll_op->mc->sched_cache_cnt++;
+	ofi_mutex_unlock(&ep->pool_lock);
+}
+
+static void coll_sched_cache_release(struct util_coll_operation *coll_op)
+{
+	struct coll_ep *ep;
+
+	ep = container_of(coll_op->ep, struct coll_ep, util_ep.ep_fid);
+	ofi_mutex_lock(&ep->pool_lock);
+	coll_op->busy = false;
+	ofi_mutex_unlock(&ep->pool_lock);
+}
+
+static bool coll_sched_cache_busy(struct util_coll_operation *coll_op)
+{
+	struct coll_ep *ep;
+	bool busy;
+
+	ep = container_of(coll_op->ep, struct coll_ep, util_ep.ep_fid);
+	ofi_mutex_lock(&ep->pool_lock);
+	busy = coll_op->busy;
+	ofi_mutex_unlock(&ep->pool_lock);
+	return busy;
+}
+
+/* Drop an idle schedule from the caches and return it to its ep pools */
+static void coll_sched_cache_evict(struct util_coll_operation *coll_op)
+{
+	struct coll_ep *ep;
+
+	ep = container_of(coll_op->ep, struct coll_ep, util_ep.ep_fid);
+	ofi_mutex_lock(&ep->pool_lock);
+	dlist_remove(&coll_op->cache_entry);
+	dlist_remove(&coll_op->ep_cache_entry);
+	coll_op->mc->sched_cache_cnt--;
+	ofi_mutex_unlock(&ep->pool_lock);
+
+	if (coll_op->type == UTIL_COLL_ALLREDUCE_OP)
+		coll_buf_free(coll_op->data.allreduce.data);
+	coll_free_op(coll_op);
+}
+
+/*
+ * The items and scratch buffers of cached schedules come from the ep
+ * pools, so release them before the pools are destroyed.
+ */
+int coll_sched_cache_cleanup(struct coll_ep *ep)
+{
+	struct util_coll_operation *coll_op;
+
+	dlist_foreach_container(&ep->sched_cache, struct util_coll_operation,
+				coll_op, ep_cache_entry) {
+		if (coll_sched_cache_busy(coll_op))
+			return -FI_EBUSY;
+	}
+
+	while (!dlist_empty(&ep->sched_cache)) {
+		coll_op = container_of(ep->sched_cache.next,
+				       struct util_coll_operation,
+				       ep_cache_entry);
+		coll_sched_cache_evict(coll_op);
+	}
+	return FI_SUCCESS;
+}
+
+/*
+ * Prepare a new operation, as a persistent schedule if the group has
+ * room in its cache for one more.
+ */
+static struct util_coll_operation *
+coll_create_sched(struct fid_ep *ep, struct util_coll_mc *coll_mc,
+		  enum util_coll_op_type type, uint64_t flags, void *context,
+		  size_t count, enum fi_datatype datatype, enum fi_op op,
+		  const void *send_buf, size_t send_size,
+		  void *result, size_t result_size)
+{
+	struct util_coll_operation *coll_op;
+	struct coll_ep *coll_ep;
+	size_t cache_cnt;
+
+	coll_op = coll_create_op(ep, coll_mc, type, flags, context,
+				 coll_collective_comp);
+	if (!coll_op)
+		return NULL;
+
+	coll_ep = container_of(ep, struct coll_ep, util_ep.ep_fid);
+	ofi_mutex_lock(&coll_ep->pool_lock);
+	cache_cnt = coll_mc->sched_cache_cnt;
+	ofi_mutex_unlock(&coll_ep->pool_lock);
+
+	if (cache_cnt < coll_env.sched_cache_size &&
+	    coll_sched_cacheable(coll_mc, send_buf, send_size, result,
+				 result_size)) {
+		coll_op->persistent = true;
+		coll_op->count = count;
+		coll_op->datatype = datatype;
+		coll_op->op = op;
+		coll_op->send_buf = send_buf;
+		coll_op->send_size = send_size;
+		coll_op->result = result;
+		coll_op->result_size = result_size;
+	}
+
+	return coll_op;
+}
+
+static void *coll_sched_rebase(struct util_coll_operation *coll_op,
+			       void *buf, const void *send_buf, void *result)
+{
+	uintptr_t addr = (uintptr_t) buf;
+	uintptr_t old_result = (uintptr_t) coll_op->result;
+	uintptr_t old_send = (uintptr_t) coll_op->send_buf;
+
+	if (addr >= old_result && addr < old_result + coll_op->result_size)
+		return (char *) result + (addr - old_result);
+
+	if (addr >= old_send && addr < old_send + coll_op->send_size)
+		return (char *) send_buf + (addr - old_send);
+
+	return buf;
+}
+
+static void coll_sched_replay(struct util_coll_operation *coll_op,
+			      uint64_t flags, void *context,
+			      const void *send_buf, void *result)
+{
+	struct util_coll_work_item *item;
+	struct util_coll_xfer_item *xfer_item;
+	struct util_coll_copy_item *copy_item;
+	struct util_coll_reduce_item *reduce_item;
+	uint32_t rank;
+
+	coll_op->cid = coll_get_next_id(coll_op->mc);
+	coll_op->flags = flags;
+	coll_op->context = context;
+
+	dlist_foreach_container(&coll_op->sched_list,
+				struct util_coll_work_item, item,
+				sched_entry) {
+		item->state = UTIL_COLL_WAITING;
+		dlist_insert_tail(&item->waiting_entry, &coll_op->work_queue);
+
+		switch (item->type) {
+		case UTIL_COLL_SEND:
+		case UTIL_COLL_RECV:
+			xfer_item = container_of(item,
+						 struct util_coll_xfer_item,
+						 hdr);
+			rank = (uint32_t) (xfer_item->tag >> 32);
+			xfer_item->tag = coll_form_tag(coll_op->cid, rank);
+			xfer_item->buf = coll_sched_rebase(coll_op,
+							   xfer_item->buf,
+							   send_buf, result);
+			break;
+		case UTIL_COLL_REDUCE:
+			reduce_item = container_of(item,
+						   struct util_coll_reduce_item,
+						   hdr);
+			reduce_item->in_buf =
+				coll_sched_rebase(coll_op, reduce_item->in_buf,
+						  send_buf, result);
+			reduce_item->inout_buf =
+				coll_sched_rebase(coll_op,
+						  reduce_item->inout_buf,
+						  send_buf, result);
+			break;
+		case UTIL_COLL_COPY:
+			copy_item = container_of(item,
+						 struct util_coll_copy_item,
+						 hdr);
+			copy_item->in_buf =
+				coll_sched_rebase(coll_op, copy_item->in_buf,
+						  send_buf, result);
+			copy_item->out_buf =
+				coll_sched_rebase(coll_op, copy_item->out_buf,
+						  send_buf, result);
+			break;
+		default:
+			break;
+		}
+	}
+
+	coll_op->send_buf = send_buf;
+	coll_op->result = result;
+}
+
+/*
+ * A subset of the ranks of a collective group that an algorithm runs
+ * over, such as the ranks of one node.  Algorithms index members of the
+ * subset, and transfers go to the matching rank of the group.
+ */
+struct coll_group {
+	const uint64_t	*ranks;	/* NULL if member i is rank i */
+	uint64_t	size;
+	uint64_t	local;		/* our index in the subset */
+};
+
+static void coll_group_init(struct coll_group *group,
+			    struct util_coll_mc *coll_mc)
+{
+	group->ranks = NULL;
+	group->size = coll_mc->av_set->fi_addr_count;
+	group->local = coll_mc->local_rank;
+}
+
+static inline uint64_t coll_group_rank(const struct coll_group *group,
+				       uint64_t index)
+{
+	return group->ranks ? group->ranks[index] : index;
+}
+
 static void coll_log_work(struct util_coll_operation *coll_op)
 {
 #if ENABLE_DEBUG
@@ -183,11 +549,15 @@ static void coll_progress_work(struct util_ep *util_ep,
 			FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
 			       "Removing Completed Work item: %p \n", cur_item);
 			dlist_remove(&cur_item->waiting_entry);
-			free(cur_item);
+			if (!coll_op->persistent)
+				coll_free_item(cur_item);
 
 			/* if the work queue is empty, we're done */
 			if (dlist_empty(&coll_op->work_queue)) {
-				free(coll_op);
+				if (coll_op->persistent)
+					coll_sched_cache_release(coll_op);
+				else
+					free(coll_op);
 				return;
 			}
 			continue;
@@ -231,6 +601,8 @@ static void coll_bind_work(struct util_coll_operation *coll_op,
 {
 	item->coll_op = coll_op;
 	dlist_insert_tail(&item->waiting_entry, &coll_op->work_queue);
+	if (coll_op->persistent)
+		dlist_insert_tail(&item->sched_entry, &coll_op->sched_list);
 }
 
 static int coll_sched_send(struct util_coll_operation *coll_op,
@@ -239,7 +611,7 @@ static int coll_sched_send(struct util_coll_operation *coll_op,
 {
 	struct util_coll_xfer_item *xfer_item;
 
-	xfer_item = calloc(1, sizeof(*xfer_item));
+	xfer_item = coll_alloc_item(coll_op);
 	if (!xfer_item)
 		return -FI_ENOMEM;
 
@@ -263,7 +635,7 @@ static int coll_sched_recv(struct util_coll_operation *coll_op,
 {
 	struct util_coll_xfer_item *xfer_item;
 
-	xfer_item = calloc(1, sizeof(*xfer_item));
+	xfer_item = coll_alloc_item(coll_op);
 	if (!xfer_item)
 		return -FI_ENOMEM;
 
@@ -287,7 +659,7 @@ static int coll_sched_reduce(struct util_coll_operation *coll_op,
 {
 	struct util_coll_reduce_item *reduce_item;
 
-	reduce_item = calloc(1, sizeof(*reduce_item));
+	reduce_item = coll_alloc_item(coll_op);
 	if (!reduce_item)
 		return -FI_ENOMEM;
 
@@ -310,7 +682,7 @@ static int coll_sched_copy(struct util_coll_operation *coll_op,
 {
 	struct util_coll_copy_item *copy_item;
 
-	copy_item = calloc(1, sizeof(*copy_item));
+	copy_item = coll_alloc_item(coll_op);
 	if (!copy_item)
 		return -FI_ENOMEM;
 
@@ -330,7 +702,7 @@ static int coll_sched_comp(struct util_coll_operation *coll_op)
 {
 	struct util_coll_work_item *comp_item;
 
-	comp_item = calloc(1, sizeof(*comp_item));
+	comp_item = coll_alloc_item(coll_op);
 	if (!comp_item)
 		return -FI_ENOMEM;
 
@@ -343,36 +715,132 @@ static int coll_sched_comp(struct util_coll_operation *coll_op)
 }
 
 /*
- * TODO:
- * when this fails, clean up the already scheduled work in this function
+ * Binomial tree reduce of a group into acc at member root.  Unless
+ * send_buf is acc, acc is only written by inner nodes of the tree.
  */
-static int coll_do_allreduce(struct util_coll_operation *coll_op,
-			     const void *send_buf, void *result,
-			     void* tmp_buf, uint64_t count,
-			     enum fi_datatype datatype, enum fi_op op)
+static int coll_do_group_reduce(struct util_coll_operation *coll_op,
+				const struct coll_group *group,
+				const void *send_buf, void *acc, void *tmp,
+				size_t count, uint64_t root,
+				enum fi_datatype datatype, enum fi_op op)
+{
+	uint64_t relative, mask, remote;
+	int ret;
+
+	relative = (group->local + group->size - root) % group->size;
+
+	/* leaf nodes only send their own data */
+	if (relative % 2) {
+		remote = coll_group_rank(group, (group->local +
+					 group->size - 1) % group->size);
+		return coll_sched_send(coll_op, remote, (void *) send_buf,
+				       count, datatype, 1);
+	}
+
+	if (send_buf != acc) {
+		ret = coll_sched_copy(coll_op, (void *) send_buf, acc, count,
+				      datatype, 1);
+		if (ret)
+			return ret;
+	}
+
+	for (mask = 1; mask < group->size; mask <<= 1) {
+		if (relative & mask) {
+			remote = coll_group_rank(group, (group->local +
+						 group->size - mask) %
+						 group->size);
+			return coll_sched_send(coll_op, remote, acc, count,
+					       datatype, 1);
+		}
+
+		if (relative + mask >= group->size)
+			continue;
+
+		remote = coll_group_rank(group, (group->local + mask) %
+					 group->size);
+		ret = coll_sched_recv(coll_op, remote, tmp, count, datatype, 1);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_reduce(coll_op, tmp, acc, count, datatype,
+					op, 1);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+/* Binomial tree broadcast of buf from member root of a group */
+static int coll_do_group_bcast(struct util_coll_operation *coll_op,
+			       const struct coll_group *group, void *buf,
+			       size_t count, uint64_t root,
+			       enum fi_datatype datatype)
+{
+	uint64_t relative, mask, remote;
+	int ret;
+
+	relative = (group->local + group->size - root) % group->size;
+
+	for (mask = 1; mask < group->size; mask <<= 1) {
+		if (relative & mask) {
+			remote = coll_group_rank(group, (group->local +
+						 group->size - mask) %
+						 group->size);
+			ret = coll_sched_recv(coll_op, remote, buf, count,
+					      datatype, 1);
+			if (ret)
+				return ret;
+			break;
+		}
+	}
+
+	/*
+	 * Forward to the children, largest subtree first.  The sends may
+	 * overlap, but the last one, to the child at mask 1, fences.
+	 */
+	for (mask >>= 1; mask > 0; mask >>= 1) {
+		if (relative + mask >= group->size)
+			continue;
+
+		remote = coll_group_rank(group, (group->local + mask) %
+					 group->size);
+		ret = coll_sched_send(coll_op, remote, buf, count, datatype,
+				      mask == 1);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+/* Recursive doubling allreduce of a group, in place in result */
+static int coll_do_group_allreduce(struct util_coll_operation *coll_op,
+				   const struct coll_group *group,
+				   void *result, void *tmp_buf, uint64_t count,
+				   enum fi_datatype datatype, enum fi_op op)
 {
 	uint64_t rem, pof2, my_new_id;
 	uint64_t local, remote, next_remote;
 	int ret;
 	uint64_t mask = 1;
 
-	pof2 = rounddown_power_of_two(coll_op->mc->av_set->fi_addr_count);
-	rem = coll_op->mc->av_set->fi_addr_count - pof2;
-	local = coll_op->mc->local_rank;
-
-	/* copy initial send data to result */
-	memcpy(result, send_buf, count * ofi_datatype_size(datatype));
+	pof2 = rounddown_power_of_two(group->size);
+	rem = group->size - pof2;
+	local = group->local;
 
 	if (local < 2 * rem) {
 		if (local % 2 == 0) {
-			ret = coll_sched_send(coll_op, local + 1, result,
-					      count, datatype, 1);
+			ret = coll_sched_send(coll_op,
+					      coll_group_rank(group, local + 1),
+					      result, count, datatype, 1);
 			if (ret)
 				return ret;
 
 			my_new_id = (uint64_t)-1;
 		} else {
-			ret = coll_sched_recv(coll_op, local - 1,
+			ret = coll_sched_recv(coll_op,
+					      coll_group_rank(group, local - 1),
 					      tmp_buf, count, datatype, 1);
 			if (ret)
 				return ret;
@@ -395,14 +863,16 @@ static int coll_do_allreduce(struct util_coll_operation *coll_op,
 				next_remote + rem;
 
 			/* receive remote data into tmp buf */
-			ret = coll_sched_recv(coll_op, remote, tmp_buf,
-					      count, datatype, 0);
+			ret = coll_sched_recv(coll_op,
+					      coll_group_rank(group, remote),
+					      tmp_buf, count, datatype, 0);
 			if (ret)
 				return ret;
 
 			/* send result buf, which has the current total */
-			ret = coll_sched_send(coll_op, remote, result,
-					      count, datatype, 1);
+			ret = coll_sched_send(coll_op,
+					      coll_group_rank(group, remote),
+					      result, count, datatype, 1);
 			if (ret)
 				return ret;
 
@@ -434,13 +904,15 @@ static int coll_do_allreduce(struct util_coll_operation *coll_op,
 
 	if (local < 2 * rem) {
 		if (local % 2) {
-			ret = coll_sched_send(coll_op, local - 1, result,
-					      count, datatype, 1);
+			ret = coll_sched_send(coll_op,
+					      coll_group_rank(group, local - 1),
+					      result, count, datatype, 1);
 			if (ret)
 				return ret;
 		} else {
-			ret = coll_sched_recv(coll_op, local + 1, result,
-					      count, datatype, 1);
+			ret = coll_sched_recv(coll_op,
+					      coll_group_rank(group, local + 1),
+					      result, count, datatype, 1);
 			if (ret)
 				return ret;
 		}
@@ -448,6 +920,72 @@ static int coll_do_allreduce(struct util_coll_operation *coll_op,
 	return FI_SUCCESS;
 }
 
+/*
+ * Node-aware allreduce: reduce to the leader of each node, allreduce
+ * among the leaders, then broadcast the total within each node.  Only
+ * the leaders exchange data between nodes.
+ */
+static int coll_do_hier_allreduce(struct util_coll_operation *coll_op,
+				  void *result, void *tmp_buf, uint64_t count,
+				  enum fi_datatype datatype, enum fi_op op)
+{
+	struct util_coll_topo *topo = coll_op->mc->topo;
+	struct coll_group node_group, leader_group;
+	uint64_t local, node;
+	int ret;
+
+	local = coll_op->mc->local_rank;
+	node = topo->node[local];
+
+	node_group.ranks = &topo->members[topo->node_start[node]];
+	node_group.size = topo->node_start[node + 1] - topo->node_start[node];
+	for (node_group.local = 0; node_group.ranks[node_group.local] != local;
+	     node_group.local++)
+		;
+
+	ret = coll_do_group_reduce(coll_op, &node_group, result, result,
+				   tmp_buf, count, 0, datatype, op);
+	if (ret)
+		return ret;
+
+	if (node_group.local == 0) {
+		leader_group.ranks = topo->leaders;
+		leader_group.size = topo->num_nodes;
+		leader_group.local = node;
+
+		ret = coll_do_group_allreduce(coll_op, &leader_group, result,
+					      tmp_buf, count, datatype, op);
+		if (ret)
+			return ret;
+	}
+
+	return coll_do_group_bcast(coll_op, &node_group, result, count, 0,
+				   datatype);
+}
+
+/*
+ * TODO:
+ * when this fails, clean up the already scheduled work in this function
+ */
+static int coll_do_allreduce(struct util_coll_operation *coll_op,
+			     const void *send_buf, void *result,
+			     void* tmp_buf, uint64_t count,
+			     enum fi_datatype datatype, enum fi_op op)
+{
+	struct coll_group group;
+
+	/* copy initial send data to result */
+	memcpy(result, send_buf, count * ofi_datatype_size(datatype));
+
+	if (coll_op->mc->topo)
+		return coll_do_hier_allreduce(coll_op, result, tmp_buf, count,
+					      datatype, op);
+
+	coll_group_init(&group, coll_op->mc);
+	return coll_do_group_allreduce(coll_op, &group, result, tmp_buf,
+				       count, datatype, op);
+}
+
 /* allgather implemented using ring algorithm */
 static int coll_do_allgather(struct util_coll_operation *coll_op,
 			     const void *send_buf, void *result, size_t count,
@@ -536,7 +1074,8 @@ static int coll_do_scatter(struct util_coll_operation *coll_op,
 		cur_cnt = count *
 			  util_binomial_tree_values_to_recv(relative_rank,
 							    numranks);
-		*temp = malloc(cur_cnt * ofi_datatype_size(datatype));
+		*temp = coll_buf_alloc(coll_op,
+				       cur_cnt * ofi_datatype_size(datatype));
 		if (!*temp)
 			return -FI_ENOMEM;
 	}
@@ -550,7 +1089,8 @@ static int coll_do_scatter(struct util_coll_operation *coll_op,
 			 * E.g. if we're rank 3, data intended for ranks 0-2
 			 * will be moved to the end
 			 */
-			*temp = malloc(cur_cnt * ofi_datatype_size(datatype));
+			*temp = coll_buf_alloc(coll_op, cur_cnt *
+					       ofi_datatype_size(datatype));
 			if (!*temp)
 				return -FI_ENOMEM;
 
@@ -562,97 +1102,620 @@ static int coll_do_scatter(struct util_coll_operation *coll_op,
 			if (ret)
 				return ret;
 
-			ret = coll_sched_copy(coll_op, (char *) data,
-					      (char *) *temp + (numranks - local_rank) * nbytes,
-					      local_rank * count, datatype, 1);
+			ret = coll_sched_copy(coll_op, (char *) data,
+					      (char *) *temp + (numranks - local_rank) * nbytes,
+					      local_rank * count, datatype, 1);
+			if (ret)
+				return ret;
+		}
+	}
+
+	/* set up all receives */
+	mask = 0x1;
+	while (mask < numranks) {
+		if (relative_rank & mask) {
+			remote_rank = local_rank - mask;
+			if (remote_rank < 0)
+				remote_rank += numranks;
+
+			if (relative_rank % 2) {
+				/* leaf node, receive our data */
+				ret = coll_sched_recv(coll_op, remote_rank,
+						      result, count, datatype,
+						      1);
+				if (ret)
+					return ret;
+			} else {
+				/* branch node, receive data to forward */
+				ret = coll_sched_recv(coll_op, remote_rank,
+						      *temp, cur_cnt, datatype,
+						      1);
+				if (ret)
+					return ret;
+			}
+			break;
+		}
+		mask <<= 1;
+	}
+
+	/* set up all sends */
+	send_data = root == local_rank && root == 0 ? (void *) data : *temp;
+	mask >>= 1;
+	while (mask > 0) {
+		if (relative_rank + mask < numranks) {
+			/*
+			 * To this point, cur_cnt has represented the number of
+			 * values to expect to store in our data buf.  From here
+			 * on, cur_cnt is the number of values we have left to
+			 * forward from the data buf.
+			 */
+			send_cnt = cur_cnt - count * mask;
+
+			remote_rank = local_rank + mask;
+			if ((uint64_t) remote_rank >= numranks)
+				remote_rank -= numranks;
+
+			FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
+			       "MASK: 0x%0" PRIx64 " CUR_CNT: %zu SENDING: %zu TO: %" PRId64 "\n",
+			       mask, cur_cnt, send_cnt, remote_rank);
+
+			assert(send_cnt > 0);
+
+			ret = coll_sched_send(coll_op, remote_rank,
+					      (char *) send_data + nbytes * mask,
+					      send_cnt, datatype, 1);
+			if (ret)
+				return ret;
+
+			cur_cnt -= send_cnt;
+		}
+		mask >>= 1;
+	}
+
+	if (!(relative_rank % 2)) {
+		/*
+		 * for the root and all even nodes, we've got to copy
+		 * our local data to the result buffer
+		 */
+		ret = coll_sched_copy(coll_op, send_data, result,
+				      count, datatype, 1);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+/*
+ * Alltoall uses Bruck's algorithm for small blocks: it takes log2(n)
+ * steps, but forwards blocks through intermediate ranks.  Larger blocks
+ * are sent directly with a pairwise exchange in n - 1 steps.
+ */
+#define COLL_ALLTOALL_BRUCK_MAX	256
+
+static int coll_do_alltoall_bruck(struct util_coll_operation *coll_op,
+				  const void *send_buf, void *result,
+				  void **scratch, size_t count,
+				  enum fi_datatype datatype)
+{
+	uint64_t local_rank, numranks, i, k, nblocks;
+	char *rotated, *send_pack, *recv_pack;
+	size_t nbytes;
+	int ret;
+
+	local_rank = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	nbytes = count * ofi_datatype_size(datatype);
+
+	*scratch = coll_buf_alloc(coll_op, (numranks +
+				  2 * ((numranks + 1) / 2)) * nbytes);
+	if (!*scratch)
+		return -FI_ENOMEM;
+
+	rotated = *scratch;
+	send_pack = rotated + numranks * nbytes;
+	recv_pack = send_pack + ((numranks + 1) / 2) * nbytes;
+
+	/* rotate so that block i is destined to rank local + i */
+	ret = coll_sched_copy(coll_op, (char *) send_buf + local_rank * nbytes,
+			      rotated, (numranks - local_rank) * count,
+			      datatype, 1);
+	if (ret)
+		return ret;
+
+	if (local_rank) {
+		ret = coll_sched_copy(coll_op, (void *) send_buf,
+				      rotated + (numranks - local_rank) * nbytes,
+				      local_rank * count, datatype, 1);
+		if (ret)
+			return ret;
+	}
+
+	/* in step k, forward every block whose index has bit k set */
+	for (k = 1; k < numranks; k <<= 1) {
+		for (i = k, nblocks = 0; i < numranks; i++) {
+			if (!(i & k))
+				continue;
+
+			ret = coll_sched_copy(coll_op, rotated + i * nbytes,
+					      send_pack + nblocks++ * nbytes,
+					      count, datatype, 1);
+			if (ret)
+				return ret;
+		}
+
+		ret = coll_sched_send(coll_op, (local_rank + k) % numranks,
+				      send_pack, nblocks * count, datatype, 0);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_recv(coll_op,
+				      (local_rank + numranks - k) % numranks,
+				      recv_pack, nblocks * count, datatype, 1);
+		if (ret)
+			return ret;
+
+		for (i = k, nblocks = 0; i < numranks; i++) {
+			if (!(i & k))
+				continue;
+
+			ret = coll_sched_copy(coll_op,
+					      recv_pack + nblocks++ * nbytes,
+					      rotated + i * nbytes, count,
+					      datatype, 1);
+			if (ret)
+				return ret;
+		}
+	}
+
+	/* block i now holds the data sent to us by rank local - i */
+	for (i = 0; i < numranks; i++) {
+		ret = coll_sched_copy(coll_op, rotated + i * nbytes,
+				      (char *) result +
+				      ((local_rank + numranks - i) % numranks) *
+				      nbytes, count, datatype, 1);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+static int coll_do_alltoall_pairwise(struct util_coll_operation *coll_op,
+				     const void *send_buf, void *result,
+				     size_t count, enum fi_datatype datatype)
+{
+	uint64_t local_rank, numranks, i, dest, src;
+	size_t nbytes;
+	int ret;
+
+	local_rank = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	nbytes = count * ofi_datatype_size(datatype);
+
+	ret = coll_sched_copy(coll_op, (char *) send_buf + local_rank * nbytes,
+			      (char *) result + local_rank * nbytes, count,
+			      datatype, 1);
+	if (ret)
+		return ret;
+
+	for (i = 1; i < numranks; i++) {
+		dest = (local_rank + i) % numranks;
+		src = (local_rank + numranks - i) % numranks;
+
+		ret = coll_sched_send(coll_op, dest,
+				      (char *) send_buf + dest * nbytes,
+				      count, datatype, 0);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_recv(coll_op, src,
+				      (char *) result + src * nbytes,
+				      count, datatype, 1);
+		if (ret)
+			return ret;
+	}
+
+	return FI_SUCCESS;
+}
+
+static int coll_do_alltoall(struct util_coll_operation *coll_op,
+			    const void *send_buf, void *result,
+			    void **scratch, size_t count,
+			    enum fi_datatype datatype)
+{
+	if (count == 0)
+		return FI_SUCCESS;
+
+	if (count * ofi_datatype_size(datatype) <= COLL_ALLTOALL_BRUCK_MAX)
+		return coll_do_alltoall_bruck(coll_op, send_buf, result,
+					      scratch, count, datatype);
+
+	return coll_do_alltoall_pairwise(coll_op, send_buf, result, count,
+					 datatype);
+}
+
+/* Reduce implemented with binomial tree algorithm */
+static int coll_do_reduce(struct util_coll_operation *coll_op,
+			  const void *send_buf, void *result, void **scratch,
+			  size_t count, uint64_t root,
+			  enum fi_datatype datatype, enum fi_op op)
+{
+	struct coll_group group;
+	size_t nbytes;
+	void *acc = NULL, *tmp = NULL;
+
+	if (count == 0)
+		return FI_SUCCESS;
+
+	coll_group_init(&group, coll_op->mc);
+	nbytes = count * ofi_datatype_size(datatype);
+
+	/* leaf nodes send directly from send_buf */
+	if (!((group.local + group.size - root) % group.size % 2)) {
+		*scratch = coll_buf_alloc(coll_op, 2 * nbytes);
+		if (!*scratch)
+			return -FI_ENOMEM;
+
+		acc = group.local == root ? result : *scratch;
+		tmp = (char *) *scratch + nbytes;
+	}
+
+	return coll_do_group_reduce(coll_op, &group, send_buf, acc, tmp, count,
+				    root, datatype, op);
+}
+
+/* Gather implemented with binomial tree algorithm */
+static int coll_do_gather(struct util_coll_operation *coll_op,
+			  const void *send_buf, void *result, void **scratch,
+			  size_t count, uint64_t root,
+			  enum fi_datatype datatype)
+{
+	uint64_t local_rank, relative_rank, mask, last_mask, remote_rank;
+	size_t nbytes, numranks, nblocks, recv_cnt;
+	char *acc;
+	int ret;
+
+	local_rank = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	relative_rank = (local_rank + numranks - root) % numranks;
+	nbytes = count * ofi_datatype_size(datatype);
+
+	if (count == 0)
+		return FI_SUCCESS;
+
+	if (relative_rank % 2) {
+		remote_rank = (local_rank + numranks - 1) % numranks;
+		return coll_sched_send(coll_op, remote_rank, (void *) send_buf,
+				       count, datatype, 1);
+	}
+
+	/*
+	 * Collect the blocks of our subtree, in relative rank order.  Only
+	 * rank 0 as root can gather directly into the result buffer.
+	 */
+	nblocks = relative_rank ?
+		  util_binomial_tree_values_to_recv(relative_rank, numranks) :
+		  numranks;
+	if (local_rank == root && root == 0) {
+		acc = result;
+	} else {
+		*scratch = coll_buf_alloc(coll_op, nblocks * nbytes);
+		if (!*scratch)
+			return -FI_ENOMEM;
+		acc = *scratch;
+	}
+
+	ret = coll_sched_copy(coll_op, (void *) send_buf, acc, count,
+			      datatype, 1);
+	if (ret)
+		return ret;
+
+	/* receives from the children may overlap; fence on the last one */
+	for (mask = 1, last_mask = 0;
+	     mask < numranks && !(relative_rank & mask); mask <<= 1) {
+		if (relative_rank + mask < numranks)
+			last_mask = mask;
+	}
+
+	for (mask = 1; mask <= last_mask; mask <<= 1) {
+		if (relative_rank + mask >= numranks)
+			continue;
+
+		recv_cnt = MIN(mask, numranks - relative_rank - mask);
+		remote_rank = (local_rank + mask) % numranks;
+		ret = coll_sched_recv(coll_op, remote_rank, acc + mask * nbytes,
+				      recv_cnt * count, datatype,
+				      mask == last_mask);
+		if (ret)
+			return ret;
+	}
+
+	if (relative_rank) {
+		remote_rank = (local_rank + numranks -
+			       (relative_rank & -relative_rank)) % numranks;
+		return coll_sched_send(coll_op, remote_rank, acc,
+				       nblocks * count, datatype, 1);
+	}
+
+	if (acc == result)
+		return FI_SUCCESS;
+
+	/* block i belongs to rank root + i */
+	ret = coll_sched_copy(coll_op, acc, (char *) result + root * nbytes,
+			      (numranks - root) * count, datatype, 1);
+	if (ret)
+		return ret;
+
+	return coll_sched_copy(coll_op, acc + (numranks - root) * nbytes,
+			       result, root * count, datatype, 1);
+}
+
+/* offset, in blocks, of the results owned by a rank of the pof2 group */
+static size_t coll_reduce_scatter_disp(uint64_t new_rank, uint64_t rem)
+{
+	return new_rank < rem ? 2 * new_rank : new_rank + rem;
+}
+
+/*
+ * Reduce-scatter implemented with recursive halving.  With a non power
+ * of two number of ranks, the first 2 * rem ranks are paired up as in
+ * allreduce, and the odd rank of a pair owns the results of both.
+ */
+static int coll_do_reduce_scatter(struct util_coll_operation *coll_op,
+				  const void *send_buf, void *result,
+				  void **scratch, size_t count,
+				  enum fi_datatype datatype, enum fi_op op)
+{
+	uint64_t local_rank, numranks, pof2, rem, new_rank, remote_new;
+	uint64_t remote_rank, mask, lo, send_lo, keep_lo;
+	size_t nbytes, send_off, send_cnt, keep_off, keep_cnt;
+	char *acc, *tmp;
+	int ret;
+
+	local_rank = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	pof2 = rounddown_power_of_two(numranks);
+	rem = numranks - pof2;
+	nbytes = count * ofi_datatype_size(datatype);
+
+	if (count == 0)
+		return FI_SUCCESS;
+
+	if (local_rank < 2 * rem && local_rank % 2 == 0) {
+		ret = coll_sched_send(coll_op, local_rank + 1,
+				      (void *) send_buf, numranks * count,
+				      datatype, 1);
+		if (ret)
+			return ret;
+
+		return coll_sched_recv(coll_op, local_rank + 1, result, count,
+				       datatype, 1);
+	}
+
+	*scratch = coll_buf_alloc(coll_op, 2 * numranks * nbytes);
+	if (!*scratch)
+		return -FI_ENOMEM;
+
+	acc = *scratch;
+	tmp = acc + numranks * nbytes;
+
+	ret = coll_sched_copy(coll_op, (void *) send_buf, acc,
+			      numranks * count, datatype, 1);
+	if (ret)
+		return ret;
+
+	if (local_rank < 2 * rem) {
+		ret = coll_sched_recv(coll_op, local_rank - 1, tmp,
+				      numranks * count, datatype, 1);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_reduce(coll_op, tmp, acc, numranks * count,
+					datatype, op, 1);
+		if (ret)
+			return ret;
+
+		new_rank = local_rank / 2;
+	} else {
+		new_rank = local_rank - rem;
+	}
+
+	for (lo = 0, mask = pof2 >> 1; mask > 0; mask >>= 1) {
+		remote_new = new_rank ^ mask;
+		remote_rank = (remote_new < rem) ? remote_new * 2 + 1 :
+			      remote_new + rem;
+
+		if (new_rank & mask) {
+			send_lo = lo;
+			keep_lo = lo + mask;
+		} else {
+			send_lo = lo + mask;
+			keep_lo = lo;
+		}
+
+		send_off = coll_reduce_scatter_disp(send_lo, rem);
+		send_cnt = coll_reduce_scatter_disp(send_lo + mask, rem) -
+			   send_off;
+		keep_off = coll_reduce_scatter_disp(keep_lo, rem);
+		keep_cnt = coll_reduce_scatter_disp(keep_lo + mask, rem) -
+			   keep_off;
+
+		ret = coll_sched_recv(coll_op, remote_rank,
+				      tmp + keep_off * nbytes,
+				      keep_cnt * count, datatype, 0);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_send(coll_op, remote_rank,
+				      acc + send_off * nbytes,
+				      send_cnt * count, datatype, 1);
+		if (ret)
+			return ret;
+
+		ret = coll_sched_reduce(coll_op, tmp + keep_off * nbytes,
+					acc + keep_off * nbytes,
+					keep_cnt * count, datatype, op, 1);
+		if (ret)
+			return ret;
+
+		lo = keep_lo;
+	}
+
+	/* return the results of the paired even rank */
+	if (local_rank < 2 * rem) {
+		ret = coll_sched_send(coll_op, local_rank - 1,
+				      acc + (local_rank - 1) * nbytes,
+				      count, datatype, 0);
+		if (ret)
+			return ret;
+	}
+
+	return coll_sched_copy(coll_op, acc + local_rank * nbytes, result,
+			       count, datatype, 1);
+}
+
+/*
+ * Broadcast picks its algorithm by message size and rank count.  Small
+ * messages use a binomial tree, which takes log2(n) steps.  Medium
+ * messages that divide evenly among the ranks use scatter + ring
+ * allgather, which balances the bandwidth across all ranks.  Very large
+ * messages are split into segments and pipelined along a chain of ranks.
+ */
+#define COLL_BCAST_BINOMIAL_MAX		(16 * 1024)
+#define COLL_BCAST_PIPELINE_MIN		(1024 * 1024)
+#define COLL_BCAST_SEGMENT_SIZE		(64 * 1024)
+
+static int coll_do_bcast_binomial(struct util_coll_operation *coll_op,
+				  void *buf, size_t count, uint64_t root,
+				  enum fi_datatype datatype)
+{
+	struct coll_group group;
+
+	if (count == 0)
+		return FI_SUCCESS;
+
+	coll_group_init(&group, coll_op->mc);
+	return coll_do_group_bcast(coll_op, &group, buf, count, root,
+				   datatype);
+}
+
+/*
+ * Pipelined chain broadcast: each rank receives a segment from its
+ * predecessor and forwards it to its successor while the next segment
+ * is received.
+ */
+static int coll_do_bcast_pipeline(struct util_coll_operation *coll_op,
+				  void *buf, size_t count, uint64_t root,
+				  enum fi_datatype datatype)
+{
+	uint64_t local_rank, relative_rank, prev_rank, next_rank;
+	size_t numranks, seg_cnt, cur_cnt, offset;
+	char *seg;
+	int ret;
+
+	local_rank = coll_op->mc->local_rank;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	relative_rank = (local_rank + numranks - root) % numranks;
+	prev_rank = (local_rank + numranks - 1) % numranks;
+	next_rank = (local_rank + 1) % numranks;
+	seg_cnt = MAX(COLL_BCAST_SEGMENT_SIZE / ofi_datatype_size(datatype), 1);
+
+	for (offset = 0; offset < count; offset += cur_cnt) {
+		cur_cnt = MIN(seg_cnt, count - offset);
+		seg = (char *) buf + offset * ofi_datatype_size(datatype);
+
+		if (relative_rank) {
+			ret = coll_sched_recv(coll_op, prev_rank, seg, cur_cnt,
+					      datatype, 1);
+			if (ret)
+				return ret;
+		}
+
+		if (relative_rank < numranks - 1) {
+			ret = coll_sched_send(coll_op, next_rank, seg, cur_cnt,
+					      datatype,
+					      offset + cur_cnt == count);
 			if (ret)
 				return ret;
 		}
 	}
 
-	/* set up all receives */
-	mask = 0x1;
-	while (mask < numranks) {
-		if (relative_rank & mask) {
-			remote_rank = local_rank - mask;
-			if (remote_rank < 0)
-				remote_rank += numranks;
+	return FI_SUCCESS;
+}
 
-			if (relative_rank % 2) {
-				/* leaf node, receive our data */
-				ret = coll_sched_recv(coll_op, remote_rank,
-						      result, count, datatype,
-						      1);
-				if (ret)
-					return ret;
-			} else {
-				/* branch node, receive data to forward */
-				ret = coll_sched_recv(coll_op, remote_rank,
-						      *temp, cur_cnt, datatype,
-						      1);
-				if (ret)
-					return ret;
-			}
-			break;
-		}
-		mask <<= 1;
-	}
+static int
+coll_do_bcast_scatter_allgather(struct util_coll_operation *coll_op,
+				void *buf, size_t count, uint64_t root,
+				enum fi_datatype datatype)
+{
+	struct broadcast_data *data = &coll_op->data.broadcast;
+	size_t chunk_cnt;
+	int ret;
 
-	/* set up all sends */
-	send_data = root == local_rank && root == 0 ? (void *) data : *temp;
-	mask >>= 1;
-	while (mask > 0) {
-		if (relative_rank + mask < numranks) {
-			/*
-			 * To this point, cur_cnt has represented the number of
-			 * values to expect to store in our data buf.  From here
-			 * on, cur_cnt is the number of values we have left to
-			 * forward from the data buf.
-			 */
-			send_cnt = cur_cnt - count * mask;
+	chunk_cnt = count / coll_op->mc->av_set->fi_addr_count;
+	data->size = chunk_cnt * ofi_datatype_size(datatype);
+	data->chunk = coll_buf_alloc(coll_op, data->size);
+	if (!data->chunk)
+		return -FI_ENOMEM;
 
-			remote_rank = local_rank + mask;
-			if ((uint64_t) remote_rank >= numranks)
-				remote_rank -= numranks;
+	ret = coll_do_scatter(coll_op, buf, data->chunk, &data->scatter,
+			      chunk_cnt, root, datatype);
+	if (ret)
+		return ret;
 
-			FI_DBG(coll_op->mc->av_set->av->prov, FI_LOG_CQ,
-			       "MASK: 0x%0" PRIx64 " CUR_CNT: %zu SENDING: %zu TO: %" PRId64 "\n",
-			       mask, cur_cnt, send_cnt, remote_rank);
+	return coll_do_allgather(coll_op, data->chunk, buf, chunk_cnt,
+				 datatype);
+}
 
-			assert(send_cnt > 0);
+static int coll_do_broadcast(struct util_coll_operation *coll_op, void *buf,
+			     size_t count, uint64_t root,
+			     enum fi_datatype datatype)
+{
+	size_t numranks, nbytes;
 
-			ret = coll_sched_send(coll_op, remote_rank,
-					      (char *) send_data + nbytes * mask,
-					      send_cnt, datatype, 1);
-			if (ret)
-				return ret;
+	numranks = coll_op->mc->av_set->fi_addr_count;
+	nbytes = count * ofi_datatype_size(datatype);
 
-			cur_cnt -= send_cnt;
-		}
-		mask >>= 1;
-	}
+	if (numranks <= 2 || nbytes <= COLL_BCAST_BINOMIAL_MAX)
+		return coll_do_bcast_binomial(coll_op, buf, count, root,
+					      datatype);
 
-	if (!(relative_rank % 2)) {
-		/*
-		 * for the root and all even nodes, we've got to copy
-		 * our local data to the result buffer
-		 */
-		ret = coll_sched_copy(coll_op, send_data, result,
-				      count, datatype, 1);
-		if (ret)
-			return ret;
-	}
+	/* the pipeline needs enough segments to amortize filling the chain */
+	if (nbytes >= COLL_BCAST_PIPELINE_MIN &&
+	    nbytes / COLL_BCAST_SEGMENT_SIZE >= numranks)
+		return coll_do_bcast_pipeline(coll_op, buf, count, root,
+					      datatype);
 
-	return FI_SUCCESS;
+	if (count % numranks == 0)
+		return coll_do_bcast_scatter_allgather(coll_op, buf, count,
+						       root, datatype);
+
+	return coll_do_bcast_binomial(coll_op, buf, count, root, datatype);
 }
 
 static int coll_close(struct fid *fid)
 {
+	struct util_coll_operation *coll_op;
 	struct util_coll_mc *coll_mc;
 
 	coll_mc = container_of(fid, struct util_coll_mc, mc_fid.fid);
 
+	dlist_foreach_container(&coll_mc->sched_cache,
+				struct util_coll_operation, coll_op,
+				cache_entry) {
+		if (coll_sched_cache_busy(coll_op))
+			return -FI_EBUSY;
+	}
+
+	while (!dlist_empty(&coll_mc->sched_cache)) {
+		coll_op = container_of(coll_mc->sched_cache.next,
+				       struct util_coll_operation, cache_entry);
+		coll_sched_cache_evict(coll_op);
+	}
+
 	ofi_atomic_dec32(&coll_mc->av_set->ref);
+	free(coll_mc->topo);
 	free(coll_mc);
 
 	return FI_SUCCESS;
@@ -688,6 +1751,115 @@ static int coll_find_local_rank(struct fid_ep *ep,
 	return FI_SUCCESS;
 }
 
+/* FNV-1a hash of the host name, exchanged at join to find node peers */
+static uint64_t coll_host_id(void)
+{
+	char name[256];
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	char *c;
+
+	if (gethostname(name, sizeof(name)))
+		return 0;
+
+	name[sizeof(name) - 1] = '\0';
+	for (c = name; *c; c++) {
+		hash ^= (uint8_t) *c;
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+static int64_t coll_parent_rank(struct util_coll_mc *parent,
+				fi_addr_t addr, uint64_t hint)
+{
+	uint64_t i;
+
+	if (hint < parent->av_set->fi_addr_count &&
+	    parent->av_set->fi_addr_array[hint] == addr)
+		return hint;
+
+	for (i = 0; i < parent->av_set->fi_addr_count; i++) {
+		if (parent->av_set->fi_addr_array[i] == addr)
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Group the ranks of a new collective group by node, either by the host
+ * ids gathered over the parent group or by the node_size hint.  Returns
+ * NULL if the group does not benefit from node-aware algorithms: when
+ * every rank is on the same node, or on a node of its own.
+ */
+static struct util_coll_topo *
+coll_create_topo(struct util_coll_mc *parent, struct util_coll_mc *coll_mc,
+		 const uint64_t *hosts)
+{
+	struct util_coll_topo *topo;
+	fi_addr_t *addrs = coll_mc->av_set->fi_addr_array;
+	uint64_t *host_of;
+	uint64_t i, k;
+	int64_t parent_rank;
+	size_t numranks;
+
+	numranks = coll_mc->av_set->fi_addr_count;
+	topo = calloc(1, sizeof(*topo) +
+		      (4 * numranks + 1) * sizeof(uint64_t));
+	if (!topo)
+		return NULL;
+
+	topo->node = (uint64_t *) (topo + 1);
+	topo->node_start = topo->node + numranks;
+	topo->members = topo->node_start + numranks + 1;
+	topo->leaders = topo->members + numranks;
+
+	/* members is used to hold the host of each leader until sorted */
+	host_of = topo->members;
+	for (i = 0; i < numranks; i++) {
+		if (coll_env.node_size) {
+			topo->node[i] = i / coll_env.node_size;
+			topo->num_nodes = topo->node[i] + 1;
+			continue;
+		}
+
+		parent_rank = coll_parent_rank(parent, addrs[i], i);
+		if (parent_rank < 0)
+			goto flat;
+
+		for (k = 0; k < topo->num_nodes; k++) {
+			if (host_of[k] == hosts[parent_rank])
+				break;
+		}
+
+		if (k == topo->num_nodes)
+			host_of[topo->num_nodes++] = hosts[parent_rank];
+		topo->node[i] = k;
+	}
+
+	if (topo->num_nodes <= 1 || topo->num_nodes == numranks)
+		goto flat;
+
+	for (i = 0; i < numranks; i++)
+		topo->node_start[topo->node[i] + 1]++;
+	for (k = 0; k < topo->num_nodes; k++)
+		topo->node_start[k + 1] += topo->node_start[k];
+
+	/* fill in rank order, so each node's leader is its lowest rank */
+	for (k = 0; k < topo->num_nodes; k++)
+		topo->leaders[k] = topo->node_start[k];
+	for (i = 0; i < numranks; i++)
+		topo->members[topo->leaders[topo->node[i]]++] = i;
+	for (k = 0; k < topo->num_nodes; k++)
+		topo->leaders[k] = topo->members[topo->node_start[k]];
+
+	return topo;
+flat:
+	free(topo);
+	return NULL;
+}
+
 void coll_join_comp(struct util_coll_operation *coll_op)
 {
 	struct fi_eq_entry entry;
@@ -705,6 +1877,11 @@ void coll_join_comp(struct util_coll_operation *coll_op)
 	ofi_bitmask_unset(ep->util_ep.coll_cid_mask,
 			  coll_op->data.join.new_mc->group_id);
 
+	if (coll_env.hierarchical)
+		coll_op->data.join.new_mc->topo =
+			coll_create_topo(coll_op->mc, coll_op->data.join.new_mc,
+					 coll_op->data.join.hosts);
+
 	/* write to the eq */
 	memset(&entry, 0, sizeof(entry));
 	entry.fid = &coll_op->mc->mc_fid.fid;
@@ -717,6 +1894,7 @@ void coll_join_comp(struct util_coll_operation *coll_op)
 
 	ofi_bitmask_free(&coll_op->data.join.data);
 	ofi_bitmask_free(&coll_op->data.join.tmp);
+	free(coll_op->data.join.hosts);
 }
 
 void coll_collective_comp(struct util_coll_operation *coll_op)
@@ -732,18 +1910,29 @@ void coll_collective_comp(struct util_coll_operation *coll_op)
 		FI_WARN(ep->util_ep.domain->fabric->prov, FI_LOG_DOMAIN,
 			"collective - cq write failed\n");
 
+	/* persistent schedules keep their scratch buffers for replay */
+	if (coll_op->persistent)
+		return;
+
 	switch (coll_op->type) {
 	case UTIL_COLL_ALLREDUCE_OP:
-		free(coll_op->data.allreduce.data);
+		coll_buf_free(coll_op->data.allreduce.data);
 		break;
 
 	case UTIL_COLL_SCATTER_OP:
-		free(coll_op->data.scatter);
+		coll_buf_free(coll_op->data.scatter);
 		break;
 
 	case UTIL_COLL_BROADCAST_OP:
-		free(coll_op->data.broadcast.chunk);
-		free(coll_op->data.broadcast.scatter);
+		coll_buf_free(coll_op->data.broadcast.chunk);
+		coll_buf_free(coll_op->data.broadcast.scatter);
+		break;
+
+	case UTIL_COLL_ALLTOALL_OP:
+	case UTIL_COLL_REDUCE_SCATTER_OP:
+	case UTIL_COLL_REDUCE_OP:
+	case UTIL_COLL_GATHER_OP:
+		coll_buf_free(coll_op->data.scratch);
 		break;
 
 	case UTIL_COLL_JOIN_OP:
@@ -902,6 +2091,7 @@ static struct util_coll_mc *coll_create_mc(struct util_av_set *av_set,
 	coll_mc->mc_fid.fid.context = context;
 	coll_mc->mc_fid.fid.ops = &util_coll_fi_ops;
 	coll_mc->mc_fid.fi_addr = (uintptr_t) coll_mc;
+	dlist_init(&coll_mc->sched_cache);
 
 	ofi_atomic_inc32(&av_set->ref);
 	coll_mc->av_set = av_set;
@@ -974,6 +2164,24 @@ int coll_join_collective(struct fid_ep *ep, const void *addr,
 	if (ret)
 		goto err4;
 
+	/* exchange host ids for node-aware collectives on the new group */
+	if (coll_env.hierarchical && !coll_env.node_size) {
+		join_op->data.join.host_id = coll_host_id();
+		join_op->data.join.hosts =
+			calloc(coll_mc->av_set->fi_addr_count,
+			       sizeof(*join_op->data.join.hosts));
+		if (!join_op->data.join.hosts) {
+			ret = -FI_ENOMEM;
+			goto err4;
+		}
+
+		ret = coll_do_allgather(join_op, &join_op->data.join.host_id,
+					join_op->data.join.hosts, 1,
+					FI_UINT64);
+		if (ret)
+			goto err4;
+	}
+
 	ret = coll_sched_comp(join_op);
 	if (ret)
 		goto err4;
@@ -984,11 +2192,12 @@ int coll_join_collective(struct fid_ep *ep, const void *addr,
 	return FI_SUCCESS;
 
 err4:
+	free(join_op->data.join.hosts);
 	ofi_bitmask_free(&join_op->data.join.tmp);
 err3:
 	ofi_bitmask_free(&join_op->data.join.data);
 err2:
-	free(join_op);
+	coll_free_op(join_op);
 err1:
 	fi_close(&new_coll_mc->mc_fid.fid);
 	return ret;
@@ -1004,10 +2213,20 @@ ssize_t coll_ep_barrier2(struct fid_ep *ep, fi_addr_t coll_addr, uint64_t flags,
 	int ret;
 
 	coll_mc = (struct util_coll_mc*) ((uintptr_t) coll_addr);
+	util_ep = container_of(ep, struct util_ep, ep_fid);
 
-	barrier_op = coll_create_op(ep, coll_mc, UTIL_COLL_BARRIER_OP,
-				    flags, context,
-				    coll_collective_comp);
+	barrier_op = coll_sched_cache_get(ep, coll_mc, UTIL_COLL_BARRIER_OP,
+					  1, FI_UINT64, FI_BAND, NULL, NULL);
+	if (barrier_op) {
+		coll_sched_replay(barrier_op, flags, context, NULL, NULL);
+		barrier_op->data.barrier.data = ~barrier_op->mc->local_rank;
+		coll_progress_work(util_ep, barrier_op);
+		return FI_SUCCESS;
+	}
+
+	barrier_op = coll_create_sched(ep, coll_mc, UTIL_COLL_BARRIER_OP,
+				       flags, context, 1, FI_UINT64, FI_BAND,
+				       NULL, 0, NULL, 0);
 	if (!barrier_op)
 		return -FI_ENOMEM;
 
@@ -1023,12 +2242,13 @@ ssize_t coll_ep_barrier2(struct fid_ep *ep, fi_addr_t coll_addr, uint64_t flags,
 	if (ret)
 		goto err1;
 
-	util_ep = container_of(ep, struct util_ep, ep_fid);
+	if (barrier_op->persistent)
+		coll_sched_cache_add(barrier_op);
 	coll_progress_work(util_ep, barrier_op);
 
 	return FI_SUCCESS;
 err1:
-	free(barrier_op);
+	coll_free_op(barrier_op);
 	return ret;
 }
 
@@ -1045,18 +2265,38 @@ ssize_t coll_ep_allreduce(struct fid_ep *ep, const void *buf, size_t count,
 	struct util_coll_mc *coll_mc;
 	struct util_coll_operation *allreduce_op;
 	struct util_ep *util_ep;
+	size_t size;
 	int ret;
 
 	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
-	allreduce_op = coll_create_op(ep, coll_mc, UTIL_COLL_ALLREDUCE_OP,
-				      flags, context,
-				      coll_collective_comp);
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	size = count * ofi_datatype_size(datatype);
+
+	if (coll_sched_cacheable(coll_mc, buf, size, result, size)) {
+		allreduce_op = coll_sched_cache_get(ep, coll_mc,
+						    UTIL_COLL_ALLREDUCE_OP,
+						    count, datatype, op,
+						    buf, result);
+		if (allreduce_op) {
+			coll_sched_replay(allreduce_op, flags, context, buf,
+					  result);
+			if (buf != result)
+				memcpy(result, buf, size);
+			coll_progress_work(util_ep, allreduce_op);
+			return FI_SUCCESS;
+		}
+	}
+
+	allreduce_op = coll_create_sched(ep, coll_mc, UTIL_COLL_ALLREDUCE_OP,
+					 flags, context, count, datatype, op,
+					 buf, size, result, size);
 	if (!allreduce_op)
 		return -FI_ENOMEM;
 
-	allreduce_op->data.allreduce.size = count * ofi_datatype_size(datatype);
-	allreduce_op->data.allreduce.data = calloc(count,
-						   ofi_datatype_size(datatype));
+	allreduce_op->data.allreduce.size = size;
+	allreduce_op->data.allreduce.data =
+		coll_buf_alloc(allreduce_op,
+			       allreduce_op->data.allreduce.size);
 	if (!allreduce_op->data.allreduce.data) {
 		ret = -FI_ENOMEM;
 		goto err1;
@@ -1072,15 +2312,16 @@ ssize_t coll_ep_allreduce(struct fid_ep *ep, const void *buf, size_t count,
 	if (ret)
 		goto err2;
 
-	util_ep = container_of(ep, struct util_ep, ep_fid);
+	if (allreduce_op->persistent)
+		coll_sched_cache_add(allreduce_op);
 	coll_progress_work(util_ep, allreduce_op);
 
 	return FI_SUCCESS;
 
 err2:
-	free(allreduce_op->data.allreduce.data);
+	coll_buf_free(allreduce_op->data.allreduce.data);
 err1:
-	free(allreduce_op);
+	coll_free_op(allreduce_op);
 	return ret;
 }
 
@@ -1092,12 +2333,31 @@ ssize_t coll_ep_allgather(struct fid_ep *ep, const void *buf, size_t count,
 	struct util_coll_mc *coll_mc;
 	struct util_coll_operation *allgather_op;
 	struct util_ep *util_ep;
+	size_t size;
 	int ret;
 
 	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
-	allgather_op = coll_create_op(ep, coll_mc, UTIL_COLL_ALLGATHER_OP,
-				      flags, context,
-				      coll_collective_comp);
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	size = count * ofi_datatype_size(datatype);
+
+	if (coll_sched_cacheable(coll_mc, buf, size, result,
+				 size * coll_mc->av_set->fi_addr_count)) {
+		allgather_op = coll_sched_cache_get(ep, coll_mc,
+						    UTIL_COLL_ALLGATHER_OP,
+						    count, datatype, FI_NOOP,
+						    buf, result);
+		if (allgather_op) {
+			coll_sched_replay(allgather_op, flags, context, buf,
+					  result);
+			coll_progress_work(util_ep, allgather_op);
+			return FI_SUCCESS;
+		}
+	}
+
+	allgather_op = coll_create_sched(ep, coll_mc, UTIL_COLL_ALLGATHER_OP,
+					 flags, context, count, datatype,
+					 FI_NOOP, buf, size, result,
+					 size * coll_mc->av_set->fi_addr_count);
 	if (!allgather_op)
 		return -FI_ENOMEM;
 
@@ -1109,12 +2369,13 @@ ssize_t coll_ep_allgather(struct fid_ep *ep, const void *buf, size_t count,
 	if (ret)
 		goto err;
 
-	util_ep = container_of(ep, struct util_ep, ep_fid);
+	if (allgather_op->persistent)
+		coll_sched_cache_add(allgather_op);
 	coll_progress_work(util_ep, allgather_op);
 
 	return FI_SUCCESS;
 err:
-	free(allgather_op);
+	coll_free_op(allgather_op);
 	return ret;
 }
 
@@ -1151,7 +2412,8 @@ ssize_t coll_ep_scatter(struct fid_ep *ep, const void *buf, size_t count,
 
 	return FI_SUCCESS;
 err:
-	free(scatter_op);
+	coll_buf_free(scatter_op->data.scatter);
+	coll_free_op(scatter_op);
 	return ret;
 }
 
@@ -1163,7 +2425,6 @@ ssize_t coll_ep_broadcast(struct fid_ep *ep, void *buf, size_t count,
 	struct util_coll_mc *coll_mc;
 	struct util_coll_operation *broadcast_op;
 	struct util_ep *util_ep;
-	uint64_t chunk_cnt, numranks, local;
 	int ret;
 
 	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
@@ -1173,45 +2434,171 @@ ssize_t coll_ep_broadcast(struct fid_ep *ep, void *buf, size_t count,
 	if (!broadcast_op)
 		return -FI_ENOMEM;
 
-	local = broadcast_op->mc->local_rank;
-	numranks = broadcast_op->mc->av_set->fi_addr_count;
-	chunk_cnt = (count + numranks - 1) / numranks;
-	if (chunk_cnt * local > count &&
-	    chunk_cnt * local - (int) count > chunk_cnt)
-		chunk_cnt = 0;
+	ret = coll_do_broadcast(broadcast_op, buf, count, root_addr, datatype);
+	if (ret)
+		goto err;
+
+	ret = coll_sched_comp(broadcast_op);
+	if (ret)
+		goto err;
 
-	broadcast_op->data.broadcast.chunk =
-		malloc(chunk_cnt * ofi_datatype_size(datatype));
-	if (!broadcast_op->data.broadcast.chunk) {
-		ret = -FI_ENOMEM;
-		goto err1;
-	}
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	coll_progress_work(util_ep, broadcast_op);
+
+	return FI_SUCCESS;
+err:
+	coll_buf_free(broadcast_op->data.broadcast.chunk);
+	coll_buf_free(broadcast_op->data.broadcast.scatter);
+	coll_free_op(broadcast_op);
+	return ret;
+}
+
+ssize_t coll_ep_alltoall(struct fid_ep *ep, const void *buf, size_t count,
+			 void *desc, void *result, void *result_desc,
+			 fi_addr_t coll_addr, enum fi_datatype datatype,
+			 uint64_t flags, void *context)
+{
+	struct util_coll_mc *coll_mc;
+	struct util_coll_operation *alltoall_op;
+	struct util_ep *util_ep;
+	int ret;
 
-	ret = coll_do_scatter(broadcast_op, buf,
-			      broadcast_op->data.broadcast.chunk,
-			      &broadcast_op->data.broadcast.scatter,
-			      chunk_cnt, root_addr, datatype);
+	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	alltoall_op = coll_create_op(ep, coll_mc, UTIL_COLL_ALLTOALL_OP,
+				     flags, context,
+				     coll_collective_comp);
+	if (!alltoall_op)
+		return -FI_ENOMEM;
+
+	ret = coll_do_alltoall(alltoall_op, buf, result,
+			       &alltoall_op->data.scratch, count, datatype);
 	if (ret)
-		goto err2;
+		goto err;
 
-	ret = coll_do_allgather(broadcast_op,
-				broadcast_op->data.broadcast.chunk, buf,
-				chunk_cnt, datatype);
+	ret = coll_sched_comp(alltoall_op);
 	if (ret)
-		goto err2;
+		goto err;
 
-	ret = coll_sched_comp(broadcast_op);
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	coll_progress_work(util_ep, alltoall_op);
+
+	return FI_SUCCESS;
+err:
+	coll_buf_free(alltoall_op->data.scratch);
+	coll_free_op(alltoall_op);
+	return ret;
+}
+
+ssize_t coll_ep_reduce_scatter(struct fid_ep *ep, const void *buf,
+			       size_t count, void *desc, void *result,
+			       void *result_desc, fi_addr_t coll_addr,
+			       enum fi_datatype datatype, enum fi_op op,
+			       uint64_t flags, void *context)
+{
+	struct util_coll_mc *coll_mc;
+	struct util_coll_operation *reduce_scatter_op;
+	struct util_ep *util_ep;
+	int ret;
+
+	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	reduce_scatter_op = coll_create_op(ep, coll_mc,
+					   UTIL_COLL_REDUCE_SCATTER_OP,
+					   flags, context,
+					   coll_collective_comp);
+	if (!reduce_scatter_op)
+		return -FI_ENOMEM;
+
+	ret = coll_do_reduce_scatter(reduce_scatter_op, buf, result,
+				     &reduce_scatter_op->data.scratch, count,
+				     datatype, op);
 	if (ret)
-		goto err2;
+		goto err;
+
+	ret = coll_sched_comp(reduce_scatter_op);
+	if (ret)
+		goto err;
 
 	util_ep = container_of(ep, struct util_ep, ep_fid);
-	coll_progress_work(util_ep, broadcast_op);
+	coll_progress_work(util_ep, reduce_scatter_op);
 
 	return FI_SUCCESS;
-err2:
-	free(broadcast_op->data.broadcast.chunk);
-err1:
-	free(broadcast_op);
+err:
+	coll_buf_free(reduce_scatter_op->data.scratch);
+	coll_free_op(reduce_scatter_op);
+	return ret;
+}
+
+ssize_t coll_ep_reduce(struct fid_ep *ep, const void *buf, size_t count,
+		       void *desc, void *result, void *result_desc,
+		       fi_addr_t coll_addr, fi_addr_t root_addr,
+		       enum fi_datatype datatype, enum fi_op op,
+		       uint64_t flags, void *context)
+{
+	struct util_coll_mc *coll_mc;
+	struct util_coll_operation *reduce_op;
+	struct util_ep *util_ep;
+	int ret;
+
+	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	reduce_op = coll_create_op(ep, coll_mc, UTIL_COLL_REDUCE_OP,
+				   flags, context,
+				   coll_collective_comp);
+	if (!reduce_op)
+		return -FI_ENOMEM;
+
+	ret = coll_do_reduce(reduce_op, buf, result, &reduce_op->data.scratch,
+			     count, root_addr, datatype, op);
+	if (ret)
+		goto err;
+
+	ret = coll_sched_comp(reduce_op);
+	if (ret)
+		goto err;
+
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	coll_progress_work(util_ep, reduce_op);
+
+	return FI_SUCCESS;
+err:
+	coll_buf_free(reduce_op->data.scratch);
+	coll_free_op(reduce_op);
+	return ret;
+}
+
+ssize_t coll_ep_gather(struct fid_ep *ep, const void *buf, size_t count,
+		       void *desc, void *result, void *result_desc,
+		       fi_addr_t coll_addr, fi_addr_t root_addr,
+		       enum fi_datatype datatype, uint64_t flags,
+		       void *context)
+{
+	struct util_coll_mc *coll_mc;
+	struct util_coll_operation *gather_op;
+	struct util_ep *util_ep;
+	int ret;
+
+	coll_mc = (struct util_coll_mc *) ((uintptr_t) coll_addr);
+	gather_op = coll_create_op(ep, coll_mc, UTIL_COLL_GATHER_OP,
+				   flags, context,
+				   coll_collective_comp);
+	if (!gather_op)
+		return -FI_ENOMEM;
+
+	ret = coll_do_gather(gather_op, buf, result, &gather_op->data.scratch,
+			     count, root_addr, datatype);
+	if (ret)
+		goto err;
+
+	ret = coll_sched_comp(gather_op);
+	if (ret)
+		goto err;
+
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	coll_progress_work(util_ep, gather_op);
+
+	return FI_SUCCESS;
+err:
+	coll_buf_free(gather_op->data.scratch);
+	coll_free_op(gather_op);
 	return ret;
 }
 
@@ -1283,7 +2670,13 @@ int coll_query_collective(struct fid_domain *dom_fid,
 	case FI_BROADCAST:
 		ret = FI_SUCCESS;
 		break;
+	case FI_ALLTOALL:
+	case FI_GATHER:
+		ret = FI_SUCCESS;
+		break;
 	case FI_ALLREDUCE:
+	case FI_REDUCE_SCATTER:
+	case FI_REDUCE:
 		if (FI_MIN <= attr->op && FI_BXOR >= attr->op)
 			ret = fi_query_atomic(peer_domain, attr->datatype,
 					      attr->op, &attr->datatype_attr,
@@ -1291,10 +2684,6 @@ int coll_query_collective(struct fid_domain *dom_fid,
 		else
 			return -FI_ENOSYS;
 		break;
-	case FI_ALLTOALL:
-	case FI_REDUCE_SCATTER:
-	case FI_REDUCE:
-	case FI_GATHER:
 	default:
 		return -FI_ENOSYS;
 	}
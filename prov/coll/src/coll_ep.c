@@ -69,23 +69,31 @@ static struct fi_ops_collective coll_ops_collective = {
 	.barrier = coll_ep_barrier,
 	.barrier2 = coll_ep_barrier2,
 	.broadcast = coll_ep_broadcast,
-	.alltoall = fi_coll_no_alltoall,
+	.alltoall = coll_ep_alltoall,
 	.allreduce = coll_ep_allreduce,
 	.allgather = coll_ep_allgather,
-	.reduce_scatter = fi_coll_no_reduce_scatter,
-	.reduce = fi_coll_no_reduce,
+	.reduce_scatter = coll_ep_reduce_scatter,
+	.reduce = coll_ep_reduce,
 	.scatter = coll_ep_scatter,
-	.gather = fi_coll_no_gather,
+	.gather = coll_ep_gather,
 	.msg = fi_coll_no_msg,
 };
 
 static int coll_ep_close(struct fid *fid)
 {
 	struct coll_ep *ep;
+	int ret;
 
 	ep = container_of(fid, struct coll_ep, util_ep.ep_fid.fid);
 
+	ret = coll_sched_cache_cleanup(ep);
+	if (ret)
+		return ret;
+
 	ofi_endpoint_close(&ep->util_ep);
+	ofi_bufpool_destroy(ep->item_pool);
+	ofi_bufpool_destroy(ep->buf_pool);
+	ofi_mutex_destroy(&ep->pool_lock);
 	fi_freeinfo(ep->peer_info);
 	fi_freeinfo(ep->coll_info);
 	free(ep);
@@ -151,12 +159,26 @@ int coll_endpoint(struct fid_domain *domain, struct fi_info *info,
 
 	ep->peer_ep = peer_context->ep;
 
+	ret = ofi_bufpool_create(&ep->buf_pool,
+				 sizeof(struct coll_buf) + COLL_BUF_SIZE,
+				 16, 0, 4, 0);
+	if (ret)
+		goto err;
+
+	ret = ofi_bufpool_create(&ep->item_pool, sizeof(union coll_work_item),
+				 16, 0, 64, 0);
+	if (ret)
+		goto err_pool;
+
 	ret = ofi_endpoint_init(domain, &coll_util_prov, info,
 				&ep->util_ep, context,
 				&coll_ep_progress);
 
 	if (ret)
-		goto err;
+		goto err_items;
+
+	ofi_mutex_init(&ep->pool_lock);
+	dlist_init(&ep->sched_cache);
 
 	peer_context->peer_ops = &coll_ep_peer_xfer_ops;
 
@@ -168,6 +190,10 @@ int coll_endpoint(struct fid_domain *domain, struct fi_info *info,
 
 	return 0;
 
+err_items:
+	ofi_bufpool_destroy(ep->item_pool);
+err_pool:
+	ofi_bufpool_destroy(ep->buf_pool);
 err:
 	fi_freeinfo(ep->peer_info);
 	fi_freeinfo(ep->coll_info);
@@ -45,6 +45,20 @@ static int coll_getinfo(uint32_t version, const char *node, const char *service,
 	return 0;
 }
 
+struct coll_env coll_env = {
+	.hierarchical = 0,
+	.node_size = 0,
+	.sched_cache_size = 16,
+};
+
+static void coll_init_env(void)
+{
+	fi_param_get_bool(&coll_prov, "hierarchical", &coll_env.hierarchical);
+	fi_param_get_size_t(&coll_prov, "node_size", &coll_env.node_size);
+	fi_param_get_size_t(&coll_prov, "sched_cache_size",
+			    &coll_env.sched_cache_size);
+}
+
 static void coll_fini(void)
 {
 }
@@ -60,5 +74,26 @@ struct fi_provider coll_prov = {
 
 COLL_INI
 {
+	fi_param_define(&coll_prov, "hierarchical", FI_PARAM_BOOL,
+			"Run allreduce in node-aware stages when the members "
+			"of a collective group span several nodes: reduce to "
+			"a leader per node, allreduce among the leaders, then "
+			"broadcast within each node.  Unless node_size is "
+			"set, every join then also exchanges host ids over "
+			"the parent group (default: %s)",
+			coll_env.hierarchical ? "true" : "false");
+	fi_param_define(&coll_prov, "node_size", FI_PARAM_SIZE_T,
+			"Treat every node_size consecutive ranks of a "
+			"collective group as one node, instead of grouping "
+			"ranks by host name (default: %zu)",
+			coll_env.node_size);
+	fi_param_define(&coll_prov, "sched_cache_size", FI_PARAM_SIZE_T,
+			"Number of allreduce, allgather and barrier schedules "
+			"that each collective group keeps for replay by later "
+			"calls with the same parameters.  0 builds a new "
+			"schedule for every call (default: %zu)",
+			coll_env.sched_cache_size);
+
+	coll_init_env();
 	return &coll_prov;
 }
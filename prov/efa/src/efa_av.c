@@ -209,7 +209,7 @@ void efa_av_implicit_av_lru_conn_move(struct efa_av *av,
 {
 	assert(EFA_GENLOCK_HELD(&av->util_av_implicit.lock, efa_implicit_av_lock_sym));
 	assert(av->implicit_av_size == 0 ||
-	       HASH_CNT(hh, av->util_av_implicit.hash) <= av->implicit_av_size);
+	       av->util_av_implicit.slot_used <= av->implicit_av_size);
 	assert(dlist_entry_in_list(&av->implicit_av_lru_list,
 				   &conn->implicit_av_lru_entry));
 
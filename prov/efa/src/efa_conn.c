@@ -57,7 +57,7 @@ static inline int efa_av_implicit_av_lru_insert(struct efa_av *av,
 	if (av->implicit_av_size == 0)
 		goto out;
 
-	cur_size = HASH_CNT(hh, av->util_av_implicit.hash);
+	cur_size = av->util_av_implicit.slot_used;
 	if (cur_size <= av->implicit_av_size)
 		goto out;
 
@@ -83,7 +83,7 @@ static inline int efa_av_implicit_av_lru_insert(struct efa_av *av,
 
 	efa_conn_release_implicit(av, conn_to_release);
 
-	assert(HASH_CNT(hh, av->util_av_implicit.hash) == av->implicit_av_size);
+	assert(av->util_av_implicit.slot_used == av->implicit_av_size);
 
 out:
 	dlist_insert_tail(&conn->implicit_av_lru_entry,
@@ -252,14 +252,14 @@ static void test_av_verify_av_hash_cnt(struct efa_av *av,
 				       int implicit_cur_av_count,
 				       int implicit_prv_av_count)
 {
-	assert_int_equal(HASH_CNT(hh, av->util_av.hash),
+	assert_int_equal(av->util_av.slot_used,
 			 explicit_cur_av_count + explicit_prv_av_count);
 	assert_int_equal(HASH_CNT(hh, av->cur_reverse_av),
 			 explicit_cur_av_count);
 	assert_int_equal(HASH_CNT(hh, av->prv_reverse_av),
 			 explicit_prv_av_count);
 
-	assert_int_equal(HASH_CNT(hh, av->util_av_implicit.hash),
+	assert_int_equal(av->util_av_implicit.slot_used,
 			 implicit_cur_av_count + implicit_prv_av_count);
 	assert_int_equal(HASH_CNT(hh, av->cur_reverse_av_implicit),
 			 implicit_cur_av_count);
@@ -55,30 +55,142 @@ struct lnx_env {
 	char *prov_links;
 	int disable_shm;
 	int dump_stats;
+	size_t stripe_threshold;
 };
 
 extern struct lnx_env lnx_env;
 
+/*
+ * Striped messages are split into up to LNX_MAX_LOCAL_EPS fragments, one
+ * per core endpoint which can reach the peer. When striping is enabled the
+ * upper LNX_STRIPE_TAG_BITS of the tag are reserved to describe the
+ * fragment:
+ *   bit 63	fragment flag
+ *   bits 59-62	fragment index
+ *   bits 55-58	number of fragments - 1
+ *   bits 49-54	log2 of the fragment size
+ *   bit 48	empty fragment sent in place of one the sender failed to post
+ * All fragments but the last one are of the same power of two size, which
+ * lets the receiver place a fragment without knowing the total size.
+ */
+#define LNX_STRIPE_TAG_BITS	16
+#define LNX_STRIPE_TAG_MASK	(~0ULL << (64 - LNX_STRIPE_TAG_BITS))
+#define LNX_STRIPE_FLAG		(1ULL << 63)
+#define LNX_STRIPE_IDX_SHIFT	59
+#define LNX_STRIPE_CNT_SHIFT	55
+#define LNX_STRIPE_ORDER_SHIFT	49
+#define LNX_STRIPE_ABORT	(1ULL << 48)
+#define LNX_STRIPE_MAX_PENDING	1024
+
+static inline uint64_t lnx_stripe_tag(uint64_t tag, int idx, int nfrags,
+				      int order)
+{
+	return (tag & ~LNX_STRIPE_TAG_MASK) | LNX_STRIPE_FLAG |
+	       ((uint64_t) idx << LNX_STRIPE_IDX_SHIFT) |
+	       ((uint64_t) (nfrags - 1) << LNX_STRIPE_CNT_SHIFT) |
+	       ((uint64_t) order << LNX_STRIPE_ORDER_SHIFT);
+}
+
+/*
+ * Split a message of len bytes over neps core endpoints. Returns the number
+ * of fragments, all but the last one of 1 << *order bytes.
+ */
+static inline int lnx_stripe_layout(size_t len, int neps, int *order)
+{
+	size_t chunk = (len + neps - 1) / neps;
+
+	*order = chunk > 1 ? 64 - __builtin_clzll(chunk - 1) : 0;
+	return (len + ((size_t) 1 << *order) - 1) >> *order;
+}
+
+static inline bool lnx_is_stripe_tag(uint64_t tag)
+{
+	return lnx_env.stripe_threshold && (tag & LNX_STRIPE_FLAG);
+}
+
+static inline int lnx_stripe_idx(uint64_t tag)
+{
+	return (tag >> LNX_STRIPE_IDX_SHIFT) & 0xf;
+}
+
+static inline int lnx_stripe_nfrags(uint64_t tag)
+{
+	return ((tag >> LNX_STRIPE_CNT_SHIFT) & 0xf) + 1;
+}
+
+static inline int lnx_stripe_order(uint64_t tag)
+{
+	return (tag >> LNX_STRIPE_ORDER_SHIFT) & 0x3f;
+}
+
+static inline uint64_t lnx_app_tag(uint64_t tag)
+{
+	return lnx_env.stripe_threshold ? tag & ~LNX_STRIPE_TAG_MASK : tag;
+}
+
 struct lnx_match_attr {
 	fi_addr_t lm_addr;
 	uint64_t lm_tag;
 	uint64_t lm_ignore;
 };
 
+/* number of per source address buckets in each lnx_qpair */
+#define LNX_SRQ_BUCKETS 16
+
+struct lnx_queue_stats {
+	uint64_t lqs_max;
+	uint64_t lqs_count;
+	uint64_t lqs_rolling_sum;
+};
+
+/*
+ * The posted and unexpected entries of the peers hashed to a bucket.
+ * Entries are kept in sequence order, and all of them, as well as the
+ * fragmented receives waiting on the bucket's peers, are protected by
+ * lqb_lock.
+ */
+struct lnx_queue_bucket {
+	ofi_spin_t lqb_lock;
+	struct dlist_entry lqb_recvq;
+	struct dlist_entry lqb_unexq;
+	struct dlist_entry lqb_stripe_list;
+	struct lnx_queue_stats lqb_recv_stats;
+	struct lnx_queue_stats lqb_unex_stats;
+} __attribute__((aligned(64)));
+
+/*
+ * lq_max and lq_rolling_avg are aggregated from the per bucket statistics
+ * by lnx_aggregate_queue_stats().
+ */
 struct lnx_queue {
-	struct dlist_entry lq_queue;
 	dlist_func_t *lq_match_func;
-	ofi_spin_t lq_qlock;
+	ofi_atomic64_t lq_size;
 	uint64_t lq_max;
-	uint64_t lq_size;
 	uint64_t lq_count;
 	uint64_t lq_rolling_avg;
 	uint64_t lq_rolling_sum;
 };
 
+/*
+ * Receives posted for a specific source go on the bucket of that source,
+ * receives from FI_ADDR_UNSPEC go on the wildcard list. Every entry gets a
+ * sequence number when queued so that the oldest of the bucket and
+ * wildcard matches wins.
+ *
+ * Lock order is bucket locks in ascending index, then lqp_wc_lock. New
+ * wildcard receives are only queued with all the bucket locks held, which
+ * lets a lookup holding just its bucket lock skip the wildcard list when
+ * lqp_wc_count is zero.
+ */
 struct lnx_qpair {
 	struct lnx_queue lqp_recvq;
 	struct lnx_queue lqp_unexq;
+	struct lnx_queue_bucket lqp_buckets[LNX_SRQ_BUCKETS];
+	ofi_spin_t lqp_wc_lock;
+	struct dlist_entry lqp_wc_recvq;
+	struct lnx_queue_stats lqp_wc_stats;
+	ofi_atomic32_t lqp_wc_count;
+	ofi_atomic64_t lqp_seq;
 };
 
 struct lnx_peer_srq {
@@ -114,8 +226,9 @@ struct lnx_t_traffic_stats {
 	uint64_t st_num_tsenddata;
 	uint64_t st_num_tinject;
 	uint64_t st_num_tinjectdata;
-	uint64_t st_num_posted_recvs;
-	uint64_t st_num_unexp_msgs;
+	/* counted by lnx_get_tag(), which only holds the bucket lock */
+	ofi_atomic64_t st_num_posted_recvs;
+	ofi_atomic64_t st_num_unexp_msgs;
 };
 
 struct lnx_core_ep {
@@ -173,9 +286,32 @@ struct lnx_mr {
 	struct iovec lm_iov[LNX_IOV_LIMIT];
 };
 
+/* Tracks a striped send or receive until all of its fragments complete */
+struct lnx_stripe {
+	struct dlist_entry ls_entry;
+	struct lnx_ep *ls_lep;
+	void *ls_context;
+	uint64_t ls_flags;
+	uint64_t ls_tag;
+	uint64_t ls_data;
+	fi_addr_t ls_addr;
+	size_t ls_len;
+	struct iovec ls_iov[LNX_IOV_LIMIT];
+	void *ls_desc[LNX_IOV_LIMIT];
+	size_t ls_iov_count;
+	uint32_t ls_frag_mask;
+	int ls_nfrags;
+	int ls_order;
+	int ls_pending;
+	int ls_err;
+};
+OFI_DECLARE_FREESTACK(struct lnx_stripe, lnx_stripe_fs);
+
 struct lnx_domain {
 	struct util_domain ld_domain;
 	struct ofi_bufpool *ld_mem_reg_bp;
+	struct lnx_stripe_fs *ld_stripe_fs;
+	ofi_spin_t ld_stripe_lock;
 	struct lnx_core_domain *ld_core_domains;
 	size_t ld_iov_limit;
 	int ld_num_doms;
@@ -201,6 +337,8 @@ struct lnx_cq {
 	struct util_cq lcq_util_cq;
 	struct lnx_core_cq *lcq_core_cqs;
 	struct lnx_domain *lcq_lnx_domain;
+	struct fi_ops_cq_owner *lcq_util_owner_ops;
+	struct fi_ops_cq_owner lcq_owner_ops;
 };
 
 struct lnx_fabric {
@@ -230,6 +368,7 @@ struct lnx_rx_entry {
 	struct lnx_ep *rx_lep;
 	struct lnx_core_ep *rx_cep;
 	uint64_t rx_ignore;
+	uint64_t rx_seq;
 	bool rx_global;
 };
 
@@ -270,6 +409,25 @@ int lnx_process_recv(struct lnx_ep *lep, const struct iovec *iov, void *desc,
 		     uint64_t ignore, void *context, uint64_t flags,
 		     bool tagged);
 
+void lnx_aggregate_queue_stats(struct lnx_qpair *qp);
+
+int lnx_stripe_init(struct lnx_domain *domain);
+void lnx_stripe_fini(struct lnx_domain *domain);
+void lnx_stripe_init_cq(struct lnx_cq *lcq);
+ssize_t lnx_stripe_send(struct lnx_ep *lep, const struct iovec *iov,
+			void **desc, size_t count, fi_addr_t dest_addr,
+			uint64_t tag, uint64_t data, void *context,
+			uint64_t flags);
+struct lnx_stripe *lnx_stripe_alloc(struct lnx_domain *domain);
+void lnx_stripe_free(struct lnx_domain *domain, struct lnx_stripe *stripe);
+void lnx_stripe_set_err(struct lnx_domain *domain, struct lnx_stripe *stripe,
+			int err);
+
+static inline bool lnx_stripe_eligible(size_t len)
+{
+	return lnx_env.stripe_threshold && len >= lnx_env.stripe_threshold;
+}
+
 static inline fi_addr_t lnx_encode_fi_addr(uint64_t primary_id, uint8_t sub_id)
 {
 	return (primary_id << 8) | sub_id;
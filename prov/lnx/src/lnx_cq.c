@@ -142,6 +142,7 @@ int lnx_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
 
 	lnx_cq->lcq_lnx_domain = lnx_dom;
 	lnx_cq->lcq_util_cq.cq_fid.fid.ops = &lnx_cq_fi_ops;
+	lnx_stripe_init_cq(lnx_cq);
 	(*cq_fid) = &lnx_cq->lcq_util_cq.cq_fid;
 
 	rc = lnx_open_core_cqs(lnx_cq, attr);
@@ -65,6 +65,7 @@ static int lnx_domain_close(struct fid *fid)
 	}
 
 	ofi_bufpool_destroy(domain->ld_mem_reg_bp);
+	lnx_stripe_fini(domain);
 
 	rc = ofi_domain_close(&domain->ld_domain);
 	if (rc)
@@ -193,6 +194,10 @@ int lnx_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 	if (rc)
 		goto fail;
 
+	rc = lnx_stripe_init(lnx_domain);
+	if (rc)
+		goto close_domain;
+
 	rc = lnx_open_core_domains(lnx_fab, context, lnx_domain);
 	if (rc) {
 		FI_INFO(&lnx_prov, FI_LOG_CORE,
@@ -188,7 +188,8 @@ static inline void lnx_dump_core_ep_stats(struct lnx_core_ep *cep)
 		 tstats->st_num_tsend, tstats->st_num_tsendv,
 		 tstats->st_num_tsendmsg, tstats->st_num_tsenddata,
 		 tstats->st_num_tinject, tstats->st_num_tinjectdata,
-		 tstats->st_num_posted_recvs, tstats->st_num_unexp_msgs);
+		 ofi_atomic_get64(&tstats->st_num_posted_recvs),
+		 ofi_atomic_get64(&tstats->st_num_unexp_msgs));
 }
 
 static inline void lnx_dump_srx_queue_stats(struct lnx_ep *lep)
@@ -203,6 +204,8 @@ static inline void lnx_dump_srx_queue_stats(struct lnx_ep *lep)
 		header = true;
 	}
 
+	lnx_aggregate_queue_stats(&lep->le_srq.lps_trecv);
+
 	FI_TRACE(&lnx_prov, FI_LOG_DOMAIN,
 		 "RECVQ,-,-,-,-,-,-,-,-,%" PRIu64 ",%" PRIu64 "\n",
 		 lep->le_srq.lps_trecv.lqp_recvq.lq_max,
@@ -213,6 +216,15 @@ static inline void lnx_dump_srx_queue_stats(struct lnx_ep *lep)
 		 lep->le_srq.lps_trecv.lqp_unexq.lq_rolling_avg);
 }
 
+static inline void lnx_fini_qpair(struct lnx_qpair *qp)
+{
+	int i;
+
+	for (i = 0; i < LNX_SRQ_BUCKETS; i++)
+		ofi_spin_destroy(&qp->lqp_buckets[i].lqb_lock);
+	ofi_spin_destroy(&qp->lqp_wc_lock);
+}
+
 static int lnx_ep_close(struct fid *fid)
 {
 	int i, rc, frc = FI_SUCCESS;
@@ -241,6 +253,8 @@ static int lnx_ep_close(struct fid *fid)
 	}
 
 	ofi_endpoint_close(&lep->le_ep);
+	lnx_fini_qpair(&lep->le_srq.lps_trecv);
+	lnx_fini_qpair(&lep->le_srq.lps_recv);
 	ofi_bufpool_destroy(lep->le_recv_bp);
 	free(lep->le_core_eps);
 	free(lep);
@@ -599,6 +613,10 @@ static int lnx_open_core_eps(struct lnx_ep *lep, void *context)
 		dlist_init(&cep->cep_av_entry);
 		cep->cep_domain = cd;
 		cep->cep_parent = lep;
+		ofi_atomic_initialize64(&cep->cep_t_stats.st_num_posted_recvs,
+					0);
+		ofi_atomic_initialize64(&cep->cep_t_stats.st_num_unexp_msgs,
+					0);
 
 		rc = fi_endpoint(cd->cd_domain, cd->cd_info, &cep->cep_ep,
 				 context);
@@ -629,7 +647,8 @@ static int lnx_common_match(uint64_t tag, uint64_t match_tag,
 	fi_addr_t addr1 = lnx_decode_primary_id(recv_addr);
 	fi_addr_t addr2 = lnx_decode_primary_id(addr);
 
-	bool tmatch = ((tag | ignore) == (match_tag | ignore));
+	bool tmatch = ((lnx_app_tag(tag) | ignore) ==
+		       (lnx_app_tag(match_tag) | ignore));
 
 	if (recv_addr == FI_ADDR_UNSPEC)
 		return tmatch;
@@ -661,8 +680,22 @@ static inline void lnx_init_qpair(struct lnx_qpair *qp,
 				  dlist_func_t *recvq_match_func,
 				  dlist_func_t *unexq_match_func)
 {
-	dlist_init(&qp->lqp_recvq.lq_queue);
-	dlist_init(&qp->lqp_unexq.lq_queue);
+	struct lnx_queue_bucket *bucket;
+	int i;
+
+	for (i = 0; i < LNX_SRQ_BUCKETS; i++) {
+		bucket = &qp->lqp_buckets[i];
+		ofi_spin_init(&bucket->lqb_lock);
+		dlist_init(&bucket->lqb_recvq);
+		dlist_init(&bucket->lqb_unexq);
+		dlist_init(&bucket->lqb_stripe_list);
+	}
+	ofi_spin_init(&qp->lqp_wc_lock);
+	dlist_init(&qp->lqp_wc_recvq);
+	ofi_atomic_initialize32(&qp->lqp_wc_count, 0);
+	ofi_atomic_initialize64(&qp->lqp_seq, 0);
+	ofi_atomic_initialize64(&qp->lqp_recvq.lq_size, 0);
+	ofi_atomic_initialize64(&qp->lqp_unexq.lq_size, 0);
 	qp->lqp_recvq.lq_match_func = recvq_match_func;
 	qp->lqp_unexq.lq_match_func = unexq_match_func;
 }
@@ -56,6 +56,7 @@ struct lnx_env lnx_env = {
 	.prov_links = NULL,
 	.disable_shm = false,
 	.dump_stats = false,
+	.stripe_threshold = 0,
 };
 
 struct fi_tx_attr lnx_tx_attr = {
@@ -575,6 +576,8 @@ static int lnx_init_env(void)
 	}
 
 	fi_param_get_bool(&lnx_prov, "dump_stats", &lnx_env.dump_stats);
+	fi_param_get_size_t(&lnx_prov, "stripe_threshold",
+			    &lnx_env.stripe_threshold);
 
 	return 0;
 }
@@ -823,6 +826,12 @@ LNX_INI
 	fi_param_define(&lnx_prov, "dump_stats", FI_PARAM_BOOL,
 			"Dump LNX stats on shutdown. Defaults to 0");
 
+	fi_param_define(&lnx_prov, "stripe_threshold", FI_PARAM_SIZE_T,
+			"Tagged messages of at least this size are striped "
+			"across all the core endpoints which can reach the "
+			"peer. Reserves the upper 16 bits of the tag. "
+			"Defaults to 0 (disabled)");
+
 	dlist_init(&lnx_links);
 
 	if (!global_recv_bp) {
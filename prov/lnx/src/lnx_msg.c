@@ -32,6 +32,7 @@
  */
 
 #include "lnx.h"
+#include "ofi_iov.h"
 
 ssize_t lnx_trecv(struct fid_ep *ep, void *buf, size_t len, void *desc,
 		  fi_addr_t src_addr, uint64_t tag, uint64_t ignore,
@@ -108,11 +109,21 @@ ssize_t lnx_tsend(struct fid_ep *ep, const void *buf, size_t len, void *desc,
 	void *core_desc = NULL;
 	struct lnx_core_ep *cep;
 	fi_addr_t core_addr;
+	struct iovec iov;
 
 	lep = container_of(ep, struct lnx_ep, le_ep.ep_fid.fid);
 	if (!lep)
 		return -FI_ENOSYS;
 
+	if (lnx_stripe_eligible(len)) {
+		iov.iov_base = (void *) buf;
+		iov.iov_len = len;
+		rc = lnx_stripe_send(lep, &iov, &desc, 1, dest_addr, tag, 0,
+				     context, lep->le_ep.tx_op_flags);
+		if (rc != -FI_ENOSYS)
+			return rc;
+	}
+
 	rc = lnx_select_send_endpoints[lep->le_mr](lep, dest_addr, &cep,
 						   &core_addr);
 	if (rc)
@@ -151,6 +162,13 @@ ssize_t lnx_tsendv(struct fid_ep *ep, const struct iovec *iov, void **desc,
 	if (!lep)
 		return -FI_ENOSYS;
 
+	if (lnx_stripe_eligible(ofi_total_iov_len(iov, count))) {
+		rc = lnx_stripe_send(lep, iov, desc, count, dest_addr, tag, 0,
+				     context, lep->le_ep.tx_op_flags);
+		if (rc != -FI_ENOSYS)
+			return rc;
+	}
+
 	rc = lnx_select_send_endpoints[lep->le_mr](lep, dest_addr, &cep,
 						   &core_addr);
 	if (rc)
@@ -190,6 +208,16 @@ ssize_t lnx_tsendmsg(struct fid_ep *ep, const struct fi_msg_tagged *msg,
 	if (!lep)
 		return -FI_ENOSYS;
 
+	if (!(flags & FI_INJECT) &&
+	    lnx_stripe_eligible(ofi_total_iov_len(msg->msg_iov,
+						   msg->iov_count))) {
+		rc = lnx_stripe_send(lep, msg->msg_iov, msg->desc,
+				     msg->iov_count, msg->addr, msg->tag,
+				     msg->data, msg->context, flags);
+		if (rc != -FI_ENOSYS)
+			return rc;
+	}
+
 	rc = lnx_select_send_endpoints[lep->le_mr](lep, core_msg.addr, &cep,
 						   &core_msg.addr);
 	if (rc)
@@ -253,11 +281,22 @@ ssize_t lnx_tsenddata(struct fid_ep *ep, const void *buf, size_t len,
 	struct lnx_core_ep *cep;
 	fi_addr_t core_addr;
 	void *core_desc = desc;
+	struct iovec iov;
 
 	lep = container_of(ep, struct lnx_ep, le_ep.ep_fid.fid);
 	if (!lep)
 		return -FI_ENOSYS;
 
+	if (lnx_stripe_eligible(len)) {
+		iov.iov_base = (void *) buf;
+		iov.iov_len = len;
+		rc = lnx_stripe_send(lep, &iov, &desc, 1, dest_addr, tag, data,
+				     context, lep->le_ep.tx_op_flags |
+				     FI_REMOTE_CQ_DATA);
+		if (rc != -FI_ENOSYS)
+			return rc;
+	}
+
 	rc = lnx_select_send_endpoints[lep->le_mr](lep, dest_addr, &cep,
 						   &core_addr);
 	if (rc)
@@ -120,50 +120,492 @@ static struct lnx_rx_entry *get_rx_entry(struct lnx_ep *lep,
 	return rx_entry;
 }
 
-static inline struct lnx_rx_entry *lnx_find_first_match(
-			struct lnx_queue *q, struct lnx_match_attr *match)
+static inline struct lnx_queue_bucket *lnx_get_bucket(struct lnx_qpair *qp,
+						      fi_addr_t addr)
 {
-	struct lnx_rx_entry *rx_entry;
+	return &qp->lqp_buckets[lnx_decode_primary_id(addr) % LNX_SRQ_BUCKETS];
+}
 
-	rx_entry = (struct lnx_rx_entry *) dlist_find_first_match(
-			&q->lq_queue, q->lq_match_func, match);
+static void lnx_lock_buckets(struct lnx_qpair *qp)
+{
+	int i;
 
-	return rx_entry;
+	for (i = 0; i < LNX_SRQ_BUCKETS; i++)
+		ofi_spin_lock(&qp->lqp_buckets[i].lqb_lock);
 }
 
-static inline void lnx_update_queue_stats(struct lnx_queue *q, bool dq)
+static void lnx_unlock_buckets(struct lnx_qpair *qp)
 {
+	int i;
+
+	for (i = LNX_SRQ_BUCKETS - 1; i >= 0; i--)
+		ofi_spin_unlock(&qp->lqp_buckets[i].lqb_lock);
+}
+
+/* A receive from a specific peer only needs the bucket of that peer */
+static inline void lnx_srq_lock(struct lnx_qpair *qp, fi_addr_t addr)
+{
+	if (addr == FI_ADDR_UNSPEC)
+		lnx_lock_buckets(qp);
+	else
+		ofi_spin_lock(&lnx_get_bucket(qp, addr)->lqb_lock);
+}
+
+static inline void lnx_srq_unlock(struct lnx_qpair *qp, fi_addr_t addr)
+{
+	if (addr == FI_ADDR_UNSPEC)
+		lnx_unlock_buckets(qp);
+	else
+		ofi_spin_unlock(&lnx_get_bucket(qp, addr)->lqb_lock);
+}
+
+static inline uint64_t lnx_next_seq(struct lnx_qpair *qp)
+{
+	return ofi_atomic_inc64(&qp->lqp_seq);
+}
+
+static inline void lnx_update_queue_stats(struct lnx_queue *q,
+					  struct lnx_queue_stats *stats,
+					  bool dq)
+{
+	uint64_t size;
+
 	if (dq)
-		q->lq_size--;
+		size = ofi_atomic_dec64(&q->lq_size);
 	else
-		q->lq_size++;
+		size = ofi_atomic_inc64(&q->lq_size);
 
-	if (q->lq_size > q->lq_max)
-		q->lq_max = q->lq_size;
+	if (size > stats->lqs_max)
+		stats->lqs_max = size;
 
-	q->lq_rolling_sum += q->lq_size;
-	q->lq_count++;
-	q->lq_rolling_avg = q->lq_rolling_sum / q->lq_count;
+	stats->lqs_rolling_sum += size;
+	stats->lqs_count++;
 }
 
-static inline struct lnx_rx_entry *lnx_remove_first_match(
-			struct lnx_queue *q, struct lnx_match_attr *match)
+static void lnx_add_queue_stats(struct lnx_queue *q,
+				struct lnx_queue_stats *stats)
 {
-	struct lnx_rx_entry *rx_entry;
+	if (stats->lqs_max > q->lq_max)
+		q->lq_max = stats->lqs_max;
+	q->lq_rolling_sum += stats->lqs_rolling_sum;
+	q->lq_count += stats->lqs_count;
+}
+
+void lnx_aggregate_queue_stats(struct lnx_qpair *qp)
+{
+	struct lnx_queue_bucket *bucket;
+	int i;
+
+	qp->lqp_recvq.lq_max = qp->lqp_unexq.lq_max = 0;
+	qp->lqp_recvq.lq_count = qp->lqp_unexq.lq_count = 0;
+	qp->lqp_recvq.lq_rolling_sum = qp->lqp_unexq.lq_rolling_sum = 0;
+
+	for (i = 0; i < LNX_SRQ_BUCKETS; i++) {
+		bucket = &qp->lqp_buckets[i];
+		ofi_spin_lock(&bucket->lqb_lock);
+		lnx_add_queue_stats(&qp->lqp_recvq, &bucket->lqb_recv_stats);
+		lnx_add_queue_stats(&qp->lqp_unexq, &bucket->lqb_unex_stats);
+		ofi_spin_unlock(&bucket->lqb_lock);
+	}
 
-	rx_entry = (struct lnx_rx_entry *) dlist_remove_first_match(
-			&q->lq_queue, q->lq_match_func, match);
-	if (rx_entry)
-		lnx_update_queue_stats(q, true);
+	ofi_spin_lock(&qp->lqp_wc_lock);
+	lnx_add_queue_stats(&qp->lqp_recvq, &qp->lqp_wc_stats);
+	ofi_spin_unlock(&qp->lqp_wc_lock);
+
+	qp->lqp_recvq.lq_rolling_avg = qp->lqp_recvq.lq_count ?
+		qp->lqp_recvq.lq_rolling_sum / qp->lqp_recvq.lq_count : 0;
+	qp->lqp_unexq.lq_rolling_avg = qp->lqp_unexq.lq_count ?
+		qp->lqp_unexq.lq_rolling_sum / qp->lqp_unexq.lq_count : 0;
+}
+
+/* Insert by sequence number. New entries carry the highest sequence number
+ * and end up at the tail right away. */
+static void lnx_insert_ordered(struct dlist_entry *list,
+			       struct lnx_rx_entry *rx_entry)
+{
+	struct dlist_entry *item;
+
+	for (item = list->prev; item != list; item = item->prev) {
+		if (((struct lnx_rx_entry *) item)->rx_seq < rx_entry->rx_seq)
+			break;
+	}
+
+	dlist_insert_after(&rx_entry->entry, item);
+}
+
+/* Called with the bucket of addr locked, or all buckets for FI_ADDR_UNSPEC */
+static void lnx_queue_recv(struct lnx_qpair *qp, fi_addr_t addr,
+			   struct lnx_rx_entry *rx_entry)
+{
+	struct lnx_queue_bucket *bucket;
+
+	if (addr == FI_ADDR_UNSPEC) {
+		ofi_spin_lock(&qp->lqp_wc_lock);
+		lnx_insert_ordered(&qp->lqp_wc_recvq, rx_entry);
+		ofi_atomic_inc32(&qp->lqp_wc_count);
+		lnx_update_queue_stats(&qp->lqp_recvq, &qp->lqp_wc_stats,
+				       false);
+		ofi_spin_unlock(&qp->lqp_wc_lock);
+		return;
+	}
+
+	bucket = lnx_get_bucket(qp, addr);
+	lnx_insert_ordered(&bucket->lqb_recvq, rx_entry);
+	lnx_update_queue_stats(&qp->lqp_recvq, &bucket->lqb_recv_stats, false);
+}
+
+/*
+ * Remove the oldest posted receive matching a message from the peers of
+ * the bucket, which is locked by the caller. The wildcard list is only
+ * looked at when it holds entries.
+ */
+static struct lnx_rx_entry *lnx_remove_recv(struct lnx_qpair *qp,
+					    struct lnx_queue_bucket *bucket,
+					    struct lnx_match_attr *match)
+{
+	struct lnx_rx_entry *rx_entry, *wc_entry;
+
+	rx_entry = (struct lnx_rx_entry *) dlist_find_first_match(
+			&bucket->lqb_recvq, qp->lqp_recvq.lq_match_func, match);
+
+	if (ofi_atomic_get32(&qp->lqp_wc_count)) {
+		ofi_spin_lock(&qp->lqp_wc_lock);
+		wc_entry = (struct lnx_rx_entry *) dlist_find_first_match(
+				&qp->lqp_wc_recvq, qp->lqp_recvq.lq_match_func,
+				match);
+		if (wc_entry &&
+		    (!rx_entry || wc_entry->rx_seq < rx_entry->rx_seq)) {
+			dlist_remove(&wc_entry->entry);
+			ofi_atomic_dec32(&qp->lqp_wc_count);
+			lnx_update_queue_stats(&qp->lqp_recvq,
+					       &qp->lqp_wc_stats, true);
+			ofi_spin_unlock(&qp->lqp_wc_lock);
+			return wc_entry;
+		}
+		ofi_spin_unlock(&qp->lqp_wc_lock);
+	}
+
+	if (rx_entry) {
+		dlist_remove(&rx_entry->entry);
+		lnx_update_queue_stats(&qp->lqp_recvq, &bucket->lqb_recv_stats,
+				       true);
+	}
 
 	return rx_entry;
 }
 
-static inline void lnx_insert_rx_entry(struct lnx_queue *q,
-				       struct lnx_rx_entry *entry)
+/* Called with the bucket of the entry's source address locked */
+static void lnx_queue_unexp(struct lnx_qpair *qp,
+			    struct lnx_rx_entry *rx_entry)
 {
-	dlist_insert_tail(&entry->entry, &q->lq_queue);
-	lnx_update_queue_stats(q, false);
+	struct lnx_queue_bucket *bucket;
+
+	bucket = lnx_get_bucket(qp, rx_entry->rx_entry.addr);
+	lnx_insert_ordered(&bucket->lqb_unexq, rx_entry);
+	lnx_update_queue_stats(&qp->lqp_unexq, &bucket->lqb_unex_stats, false);
+}
+
+/*
+ * Find the oldest unexpected message matching a receive. A receive from
+ * FI_ADDR_UNSPEC has to look at every bucket and must hold all of their
+ * locks.
+ */
+static struct lnx_rx_entry *lnx_find_unexp(struct lnx_qpair *qp,
+					   struct lnx_match_attr *match)
+{
+	struct lnx_rx_entry *rx_entry = NULL, *entry;
+	struct lnx_queue_bucket *bucket;
+	int i;
+
+	if (match->lm_addr != FI_ADDR_UNSPEC) {
+		bucket = lnx_get_bucket(qp, match->lm_addr);
+		return (struct lnx_rx_entry *) dlist_find_first_match(
+				&bucket->lqb_unexq, qp->lqp_unexq.lq_match_func,
+				match);
+	}
+
+	for (i = 0; i < LNX_SRQ_BUCKETS; i++) {
+		entry = (struct lnx_rx_entry *) dlist_find_first_match(
+				&qp->lqp_buckets[i].lqb_unexq,
+				qp->lqp_unexq.lq_match_func, match);
+		if (entry && (!rx_entry || entry->rx_seq < rx_entry->rx_seq))
+			rx_entry = entry;
+	}
+
+	return rx_entry;
+}
+
+static void lnx_remove_unexp(struct lnx_qpair *qp,
+			     struct lnx_rx_entry *rx_entry)
+{
+	struct lnx_queue_bucket *bucket;
+
+	bucket = lnx_get_bucket(qp, rx_entry->rx_entry.addr);
+	dlist_remove(&rx_entry->entry);
+	lnx_update_queue_stats(&qp->lqp_unexq, &bucket->lqb_unex_stats, true);
+}
+
+static inline uint32_t lnx_stripe_full_mask(struct lnx_stripe *stripe)
+{
+	return (1U << stripe->ls_nfrags) - 1;
+}
+
+static bool lnx_stripe_match(struct lnx_stripe *stripe, fi_addr_t addr,
+			     uint64_t tag)
+{
+	return lnx_decode_primary_id(stripe->ls_addr) ==
+	       lnx_decode_primary_id(addr) &&
+	       stripe->ls_tag == lnx_app_tag(tag) &&
+	       stripe->ls_nfrags == lnx_stripe_nfrags(tag) &&
+	       stripe->ls_order == lnx_stripe_order(tag) &&
+	       !(stripe->ls_frag_mask & (1U << lnx_stripe_idx(tag)));
+}
+
+/*
+ * Fragments of the same index travel over the same core endpoint, so the
+ * oldest stripe still missing that index is the one the fragment belongs
+ * to. Striped receives wait on the bucket of their source.
+ */
+static struct lnx_stripe *lnx_stripe_find(struct lnx_queue_bucket *bucket,
+					  fi_addr_t addr, uint64_t tag)
+{
+	struct lnx_stripe *stripe;
+
+	dlist_foreach_container(&bucket->lqb_stripe_list, struct lnx_stripe,
+				stripe, ls_entry) {
+		if (lnx_stripe_match(stripe, addr, tag))
+			return stripe;
+	}
+
+	return NULL;
+}
+
+static void lnx_stripe_init_recv(struct lnx_ep *lep,
+				 struct lnx_queue_bucket *bucket,
+				 struct lnx_stripe *stripe,
+				 const struct iovec *iov, void **desc,
+				 size_t count, void *context, uint64_t flags,
+				 fi_addr_t addr, uint64_t tag)
+{
+	memcpy(stripe->ls_iov, iov, sizeof(*iov) * count);
+	if (desc)
+		memcpy(stripe->ls_desc, desc, sizeof(*desc) * count);
+
+	stripe->ls_lep = lep;
+	stripe->ls_iov_count = count;
+	stripe->ls_context = context;
+	stripe->ls_flags = flags | FI_TAGGED | FI_RECV;
+	stripe->ls_tag = lnx_app_tag(tag);
+	stripe->ls_addr = addr;
+	stripe->ls_nfrags = lnx_stripe_nfrags(tag);
+	stripe->ls_order = lnx_stripe_order(tag);
+	stripe->ls_pending = stripe->ls_nfrags;
+
+	dlist_insert_tail(&stripe->ls_entry, &bucket->lqb_stripe_list);
+}
+
+/*
+ * Point the fragment receive at its slice of the striped receive buffer.
+ * A fragment which cannot be placed is still received, into no buffer, so
+ * that the core provider consumes it and the stripe completes with the
+ * error.
+ */
+static void lnx_stripe_init_frag(struct lnx_stripe *stripe,
+				 struct lnx_rx_entry *rx_entry,
+				 struct lnx_core_ep *cep, fi_addr_t addr,
+				 uint64_t tag, size_t msg_size)
+{
+	struct lnx_domain *domain = stripe->ls_lep->le_domain;
+	size_t offset, len, count = 0, index, iov_offset;
+	int iov_idx, rc = 0;
+
+	offset = (size_t) lnx_stripe_idx(tag) << stripe->ls_order;
+	len = ofi_total_iov_len(stripe->ls_iov, stripe->ls_iov_count);
+
+	/* a fragment past the end of the buffer gets truncated by the
+	 * core provider */
+	if (offset < len) {
+		rc = ofi_iov_locate(stripe->ls_iov, stripe->ls_iov_count,
+				    offset, &iov_idx, &iov_offset);
+		if (!rc) {
+			index = iov_idx;
+			rc = ofi_copy_iov_desc(rx_entry->rx_iov,
+					       rx_entry->rx_desc, &count,
+					       stripe->ls_iov, stripe->ls_desc,
+					       stripe->ls_iov_count, &index,
+					       &iov_offset,
+					       MIN(len - offset, msg_size));
+		}
+		if (rc) {
+			FI_WARN(&lnx_prov, FI_LOG_CORE,
+				"Failed to set up fragment receive: %d\n", rc);
+			lnx_stripe_set_err(domain, stripe, -rc);
+			count = 0;
+		}
+	}
+
+	if (tag & LNX_STRIPE_ABORT)
+		lnx_stripe_set_err(domain, stripe, FI_EIO);
+
+	lnx_init_rx_entry(rx_entry, NULL, NULL, count,
+			  lnx_get_core_addr(cep, addr), tag, 0, stripe,
+			  stripe->ls_flags | FI_COMPLETION);
+	rx_entry->rx_entry.msg_size = msg_size;
+	rx_entry->rx_cep = cep;
+
+	stripe->ls_frag_mask |= 1U << lnx_stripe_idx(tag);
+	if (stripe->ls_frag_mask == lnx_stripe_full_mask(stripe))
+		dlist_remove_init(&stripe->ls_entry);
+}
+
+/*
+ * Translate the descriptors of a fragment receive for its core provider.
+ * Registration may call into the core domain, so this runs once the bucket
+ * lock has been dropped.
+ */
+static void lnx_stripe_reg_frag(struct lnx_rx_entry *rx_entry)
+{
+	struct lnx_stripe *stripe = rx_entry->rx_entry.context;
+	size_t i;
+	int rc;
+
+	for (i = 0; i < rx_entry->rx_entry.count; i++) {
+		if (!rx_entry->rx_desc[i])
+			continue;
+		rc = lnx_mr_regattr_core(rx_entry->rx_cep->cep_domain,
+					 rx_entry->rx_desc[i],
+					 &rx_entry->rx_desc[i]);
+		if (rc) {
+			FI_WARN(&lnx_prov, FI_LOG_CORE,
+				"Failed to register fragment receive: %d\n",
+				rc);
+			lnx_stripe_set_err(stripe->ls_lep->le_domain, stripe,
+					   -rc);
+			rx_entry->rx_entry.count = 0;
+			return;
+		}
+	}
+}
+
+/* Called with the bucket of the fragment's source locked */
+static int lnx_stripe_get_tag(struct lnx_ep *lep, struct lnx_core_ep *cep,
+			      struct lnx_queue_bucket *bucket,
+			      struct lnx_rx_entry *rx_entry,
+			      struct fi_peer_match_attr *match,
+			      struct fi_peer_rx_entry **entry)
+{
+	struct lnx_qpair *qp = &lep->le_srq.lps_trecv;
+	struct lnx_stripe *stripe;
+
+	if (rx_entry) {
+		/* first fragment matching a posted receive */
+		stripe = lnx_stripe_alloc(lep->le_domain);
+		if (!stripe) {
+			lnx_queue_recv(qp, rx_entry->rx_entry.addr, rx_entry);
+			return -FI_ENOMEM;
+		}
+		lnx_stripe_init_recv(lep, bucket, stripe,
+				     rx_entry->rx_entry.iov,
+				     rx_entry->rx_entry.desc,
+				     rx_entry->rx_entry.count,
+				     rx_entry->rx_entry.context,
+				     rx_entry->rx_entry.flags, match->addr,
+				     match->tag);
+	} else {
+		stripe = lnx_stripe_find(bucket, match->addr, match->tag);
+		if (!stripe)
+			return -FI_ENOENT;
+
+		rx_entry = get_rx_entry(lep, NULL, NULL, 0, match->addr,
+					match->tag, 0, stripe,
+					FI_TAGGED | FI_RECV);
+		if (!rx_entry)
+			return -FI_ENOMEM;
+	}
+
+	lnx_stripe_init_frag(stripe, rx_entry, cep, match->addr, match->tag,
+			     match->msg_size);
+
+	lnx_set_send_pair[lep->le_mr](lep, cep, match->addr);
+	ofi_atomic_inc64(&cep->cep_t_stats.st_num_posted_recvs);
+	*entry = &rx_entry->rx_entry;
+
+	return 0;
+}
+
+/*
+ * A receive matched an unexpected fragment. Claim all the fragments of the
+ * same message already on the unexpected queue onto frag_list; the others
+ * are picked up by lnx_get_tag() as they arrive. Called with the bucket of
+ * the fragment's source locked.
+ */
+static int lnx_stripe_claim_unexp(struct lnx_ep *lep,
+				  struct lnx_rx_entry *rx_entry,
+				  const struct iovec *iov, void *desc,
+				  size_t count, void *context, uint64_t flags,
+				  struct dlist_entry *frag_list)
+{
+	struct lnx_qpair *qp = &lep->le_srq.lps_trecv;
+	struct lnx_queue_bucket *bucket;
+	struct lnx_rx_entry *frag;
+	struct lnx_stripe *stripe;
+	struct dlist_entry *tmp;
+
+	stripe = lnx_stripe_alloc(lep->le_domain);
+	if (!stripe) {
+		lnx_queue_unexp(qp, rx_entry);
+		return -FI_EAGAIN;
+	}
+
+	bucket = lnx_get_bucket(qp, rx_entry->rx_entry.addr);
+	lnx_stripe_init_recv(lep, bucket, stripe, iov, desc ? &desc : NULL,
+			     count, context, flags, rx_entry->rx_entry.addr,
+			     rx_entry->rx_entry.tag);
+
+	lnx_stripe_init_frag(stripe, rx_entry, rx_entry->rx_cep,
+			     rx_entry->rx_entry.addr, rx_entry->rx_entry.tag,
+			     rx_entry->rx_entry.msg_size);
+	dlist_insert_tail(&rx_entry->entry, frag_list);
+
+	dlist_foreach_container_safe(&bucket->lqb_unexq, struct lnx_rx_entry,
+				     frag, entry, tmp) {
+		if (stripe->ls_frag_mask == lnx_stripe_full_mask(stripe))
+			break;
+		if (!lnx_is_stripe_tag(frag->rx_entry.tag) ||
+		    !lnx_stripe_match(stripe, frag->rx_entry.addr,
+				      frag->rx_entry.tag))
+			continue;
+
+		lnx_remove_unexp(qp, frag);
+		lnx_stripe_init_frag(stripe, frag, frag->rx_cep,
+				     frag->rx_entry.addr, frag->rx_entry.tag,
+				     frag->rx_entry.msg_size);
+		dlist_insert_tail(&frag->entry, frag_list);
+	}
+
+	return 0;
+}
+
+static void lnx_stripe_start_frags(struct lnx_ep *lep,
+				   struct dlist_entry *frag_list)
+{
+	struct lnx_rx_entry *frag;
+	struct lnx_stripe *stripe;
+	struct lnx_core_ep *cep;
+	int rc;
+
+	while (!dlist_empty(frag_list)) {
+		dlist_pop_front(frag_list, struct lnx_rx_entry, frag, entry);
+		stripe = frag->rx_entry.context;
+		cep = frag->rx_cep;
+
+		lnx_stripe_reg_frag(frag);
+		lnx_set_send_pair[lep->le_mr](lep, cep, stripe->ls_addr);
+		rc = cep->cep_srx.peer_ops->start_tag(&frag->rx_entry);
+		if (rc)
+			FI_WARN(&lnx_prov, FI_LOG_CORE,
+				"start tag failed with %d\n", rc);
+	}
 }
 
 static int lnx_queue_tag(struct fi_peer_rx_entry *entry)
@@ -171,24 +613,36 @@ static int lnx_queue_tag(struct fi_peer_rx_entry *entry)
 	struct lnx_rx_entry *rx_entry;
 	struct lnx_peer_srq *lnx_srq =
 				(struct lnx_peer_srq*)entry->owner_context;
+	struct lnx_qpair *qp = &lnx_srq->lps_trecv;
+	struct lnx_queue_bucket *bucket;
 
 	rx_entry = container_of(entry, struct lnx_rx_entry, rx_entry);
 	FI_DBG(&lnx_prov, FI_LOG_CORE,
 	       "addr = %" PRIx64 " tag = %" PRIx64 " ignore = 0 found\n",
 	       entry->addr, entry->tag);
 
-	lnx_insert_rx_entry(&lnx_srq->lps_trecv.lqp_unexq, rx_entry);
+	bucket = lnx_get_bucket(qp, entry->addr);
+	ofi_spin_lock(&bucket->lqb_lock);
+	rx_entry->rx_seq = lnx_next_seq(qp);
+	lnx_queue_unexp(qp, rx_entry);
+	ofi_spin_unlock(&bucket->lqb_lock);
 
 	return 0;
 }
 
+/*
+ * Only the bucket of the sender is locked here, so core providers looking
+ * up messages from different peers do not serialize on each other.
+ */
 static int lnx_get_tag(struct fid_peer_srx *srx,
 		       struct fi_peer_match_attr *match,
 		       struct fi_peer_rx_entry **entry)
 {
 	struct lnx_match_attr match_attr = {0};
+	struct lnx_queue_bucket *bucket;
 	struct lnx_peer_srq *lnx_srq;
 	struct lnx_core_ep *cep;
+	struct lnx_qpair *qp;
 	struct lnx_ep *lep;
 	struct lnx_rx_entry *rx_entry;
 	fi_addr_t addr = match->addr;
@@ -198,12 +652,29 @@ static int lnx_get_tag(struct fid_peer_srx *srx,
 	cep = srx->ep_fid.fid.context;
 	lep = cep->cep_parent;
 	lnx_srq = &lep->le_srq;
+	qp = &lnx_srq->lps_trecv;
 
 	match_attr.lm_addr = addr;
 	match_attr.lm_tag = tag;
 
-	rx_entry = lnx_remove_first_match(&lnx_srq->lps_trecv.lqp_recvq,
-					  &match_attr);
+	bucket = lnx_get_bucket(qp, addr);
+	ofi_spin_lock(&bucket->lqb_lock);
+
+	if (lnx_is_stripe_tag(tag)) {
+		rc = lnx_stripe_get_tag(lep, cep, bucket, NULL, match, entry);
+		if (rc != -FI_ENOENT)
+			goto unlock;
+		rc = 0;
+	}
+
+	rx_entry = lnx_remove_recv(qp, bucket, &match_attr);
+	if (rx_entry && lnx_is_stripe_tag(tag)) {
+		rc = lnx_stripe_get_tag(lep, cep, bucket, rx_entry, match,
+					entry);
+		goto unlock;
+	}
+	ofi_spin_unlock(&bucket->lqb_lock);
+
 	if (rx_entry) {
 		FI_DBG(&lnx_prov, FI_LOG_CORE,
 		       "addr = %" PRIx64 " tag = %" PRIx64
@@ -228,14 +699,14 @@ static int lnx_get_tag(struct fid_peer_srx *srx,
 
 	rc = -FI_ENOENT;
 
-	cep->cep_t_stats.st_num_unexp_msgs++;
+	ofi_atomic_inc64(&cep->cep_t_stats.st_num_unexp_msgs);
 
 	goto finalize;
 
 assign:
 	lnx_set_send_pair[lep->le_mr](lep, cep, addr);
 
-	cep->cep_t_stats.st_num_posted_recvs++;
+	ofi_atomic_inc64(&cep->cep_t_stats.st_num_posted_recvs);
 
 	rx_entry->rx_entry.addr = lnx_get_core_addr(cep, addr);
 	if (rx_entry->rx_entry.desc && *rx_entry->rx_entry.desc) {
@@ -251,21 +722,45 @@ finalize:
 
 out:
 	return rc;
+
+unlock:
+	ofi_spin_unlock(&bucket->lqb_lock);
+	if (!rc)
+		lnx_stripe_reg_frag(container_of(*entry, struct lnx_rx_entry,
+						 rx_entry));
+	return rc;
 }
 
+/*
+ * Messages from addresses the core provider could not resolve yet sit on
+ * the FI_ADDR_UNSPEC bucket. Move them to the bucket of their peer once the
+ * address is known.
+ */
 static void lnx_update_msg_entries(
 			struct lnx_qpair *qp,
 			fi_addr_t (*get_addr)(struct fi_peer_rx_entry *))
 {
-	struct lnx_queue *q = &qp->lqp_unexq;
+	struct lnx_queue_bucket *bucket, *unspec;
 	struct lnx_rx_entry *rx_entry;
-	struct dlist_entry *item;
+	struct dlist_entry *tmp;
+
+	unspec = lnx_get_bucket(qp, FI_ADDR_UNSPEC);
+
+	lnx_lock_buckets(qp);
+	dlist_foreach_container_safe(&unspec->lqb_unexq, struct lnx_rx_entry,
+				     rx_entry, entry, tmp) {
+		if (rx_entry->rx_entry.addr != FI_ADDR_UNSPEC)
+			continue;
 
-	dlist_foreach(&q->lq_queue, item) {
-		rx_entry = (struct lnx_rx_entry *) item;
-		if (rx_entry->rx_entry.addr == FI_ADDR_UNSPEC)
-			rx_entry->rx_entry.addr = get_addr(&rx_entry->rx_entry);
+		rx_entry->rx_entry.addr = get_addr(&rx_entry->rx_entry);
+		bucket = lnx_get_bucket(qp, rx_entry->rx_entry.addr);
+		if (bucket == unspec)
+			continue;
+
+		dlist_remove(&rx_entry->entry);
+		lnx_insert_ordered(&bucket->lqb_unexq, rx_entry);
 	}
+	lnx_unlock_buckets(qp);
 }
 
 static void lnx_foreach_unspec_addr(
@@ -292,6 +787,7 @@ struct fi_ops_srx_owner lnx_srx_ops = {
 	.foreach_unspec_addr = lnx_foreach_unspec_addr,
 };
 
+/* The entry was claimed by lnx_peek() and is no longer queued */
 static int lnx_discard(struct lnx_ep *lep, struct lnx_rx_entry *rx_entry,
 		       void *context)
 {
@@ -309,7 +805,6 @@ static int lnx_discard(struct lnx_ep *lep, struct lnx_rx_entry *rx_entry,
 			  rx_entry->rx_entry.msg_size, NULL,
 			  rx_entry->rx_entry.cq_data, rx_entry->rx_entry.tag);
 
-	dlist_remove(&rx_entry->entry);
 	lnx_free_entry(&rx_entry->rx_entry);
 
 	return rc;
@@ -320,11 +815,12 @@ static int lnx_peek(struct lnx_ep *lep, struct lnx_match_attr *match_attr,
 {
 	int rc;
 	struct lnx_rx_entry *rx_entry;
-	struct lnx_peer_srq *lnx_srq = &lep->le_srq;
+	struct lnx_qpair *qp = &lep->le_srq.lps_trecv;
 
-	rx_entry = lnx_find_first_match(&lnx_srq->lps_trecv.lqp_unexq,
-					match_attr);
+	lnx_srq_lock(qp, match_attr->lm_addr);
+	rx_entry = lnx_find_unexp(qp, match_attr);
 	if (!rx_entry) {
+		lnx_srq_unlock(qp, match_attr->lm_addr);
 		FI_DBG(&lnx_prov, FI_LOG_CORE,
 			"PEEK addr=%" PRIx64 " tag=%" PRIx64 " ignore=%"
 			PRIx64 "\n", match_attr->lm_addr, match_attr->lm_tag,
@@ -333,6 +829,10 @@ static int lnx_peek(struct lnx_ep *lep, struct lnx_match_attr *match_attr,
 					       match_attr->lm_tag, context);
 	}
 
+	if (flags & (FI_DISCARD | FI_CLAIM))
+		lnx_remove_unexp(qp, rx_entry);
+	lnx_srq_unlock(qp, match_attr->lm_addr);
+
 	rc = ofi_cq_write(lep->le_ep.rx_cq, context,
 			  rx_entry->rx_entry.flags,
 			  rx_entry->rx_entry.msg_size, NULL,
@@ -342,15 +842,12 @@ static int lnx_peek(struct lnx_ep *lep, struct lnx_match_attr *match_attr,
 	if (flags & FI_DISCARD) {
 		rc = rx_entry->rx_cep->cep_srx.peer_ops->discard_tag(
 							&rx_entry->rx_entry);
-		dlist_remove(&rx_entry->entry);
 		lnx_free_entry(&rx_entry->rx_entry);
 		goto out;
 	}
 
-	if (flags & FI_CLAIM) {
-		dlist_remove(&rx_entry->entry);
+	if (flags & FI_CLAIM)
 		((struct fi_context *)context)->internal[0] = rx_entry;
-	}
 
 out:
 	return rc;
@@ -371,16 +868,21 @@ out:
  *
  * If nothing is found on the unexpected messages, then add a receive
  * request on the SRQ; happens in the lnx_process_recv()
+ *
+ * A receive from a specific peer only locks the bucket of that peer, a
+ * receive from any peer locks all of them. The locks are dropped before
+ * calling into the core provider.
  */
 int lnx_process_recv(struct lnx_ep *lep, const struct iovec *iov, void *desc,
 		     fi_addr_t addr, size_t count, uint64_t tag,
 		     uint64_t ignore, void *context, uint64_t flags,
 		     bool tagged)
 {
-	struct lnx_peer_srq *lnx_srq = &lep->le_srq;
+	struct lnx_qpair *qp = &lep->le_srq.lps_trecv;
 	struct lnx_rx_entry *rx_entry;
 	struct lnx_match_attr match_attr;
 	struct lnx_core_ep *cep;
+	struct dlist_entry frag_list;
 	int rc = 0;
 	fi_addr_t sub_addr, encoded_addr = lnx_encode_fi_addr(addr, 0);
 
@@ -400,12 +902,13 @@ int lnx_process_recv(struct lnx_ep *lep, const struct iovec *iov, void *desc,
 		return lnx_discard(lep, rx_entry, context);
 	}
 
+	lnx_srq_lock(qp, match_attr.lm_addr);
+
 	if (flags & FI_CLAIM) {
 		rx_entry = (struct lnx_rx_entry *)
 			   (((struct fi_context *)context)->internal[0]);
 	} else {
-		rx_entry = lnx_remove_first_match(&lnx_srq->lps_trecv.lqp_unexq,
-						&match_attr);
+		rx_entry = lnx_find_unexp(qp, &match_attr);
 		if (!rx_entry) {
 			FI_DBG(&lnx_prov, FI_LOG_CORE,
 			       "addr=%" PRIx64 " tag=%" PRIx64 " ignore=%"
@@ -413,6 +916,7 @@ int lnx_process_recv(struct lnx_ep *lep, const struct iovec *iov, void *desc,
 			       addr, tag, ignore, iov->iov_base, iov->iov_len);
 			goto nomatch;
 		}
+		lnx_remove_unexp(qp, rx_entry);
 	}
 
 	FI_DBG(&lnx_prov, FI_LOG_CORE,
@@ -420,6 +924,16 @@ int lnx_process_recv(struct lnx_ep *lep, const struct iovec *iov, void *desc,
 	       " buf=%p len=%zu found\n",
 	       addr, tag, ignore, iov->iov_base, iov->iov_len);
 
+	if (lnx_is_stripe_tag(rx_entry->rx_entry.tag)) {
+		dlist_init(&frag_list);
+		rc = lnx_stripe_claim_unexp(lep, rx_entry, iov, desc, count,
+					    context, flags, &frag_list);
+		lnx_srq_unlock(qp, match_attr.lm_addr);
+		lnx_stripe_start_frags(lep, &frag_list);
+		return rc;
+	}
+	lnx_srq_unlock(qp, match_attr.lm_addr);
+
 	/* match is found in the unexpected queue. call into the core
 	 * provider to complete this message
 	 */
@@ -453,6 +967,7 @@ int lnx_process_recv(struct lnx_ep *lep, const struct iovec *iov, void *desc,
 		       " start_tag() in progress\n",
 		       addr, tag, ignore);
 
+		lnx_srq_lock(qp, match_attr.lm_addr);
 		goto insert_recvq;
 	}
 	if (rc)
@@ -479,8 +994,10 @@ nomatch:
 	}
 
 insert_recvq:
-	lnx_insert_rx_entry(&lnx_srq->lps_trecv.lqp_recvq, rx_entry);
+	rx_entry->rx_seq = lnx_next_seq(qp);
+	lnx_queue_recv(qp, match_attr.lm_addr, rx_entry);
 
 out:
+	lnx_srq_unlock(qp, match_attr.lm_addr);
 	return rc;
 }
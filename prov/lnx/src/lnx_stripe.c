@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2022 ORNL. All rights reserved.
+ * Copyright (c) Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "lnx.h"
+#include "ofi_iov.h"
+
+int lnx_stripe_init(struct lnx_domain *domain)
+{
+	int rc;
+
+	if (!lnx_env.stripe_threshold)
+		return 0;
+
+	rc = ofi_spin_init(&domain->ld_stripe_lock);
+	if (rc)
+		return rc;
+
+	domain->ld_stripe_fs = lnx_stripe_fs_create(LNX_STRIPE_MAX_PENDING,
+						    NULL, NULL);
+	if (!domain->ld_stripe_fs) {
+		ofi_spin_destroy(&domain->ld_stripe_lock);
+		return -FI_ENOMEM;
+	}
+
+	return 0;
+}
+
+void lnx_stripe_fini(struct lnx_domain *domain)
+{
+	if (!domain->ld_stripe_fs)
+		return;
+
+	lnx_stripe_fs_free(domain->ld_stripe_fs);
+	ofi_spin_destroy(&domain->ld_stripe_lock);
+}
+
+struct lnx_stripe *lnx_stripe_alloc(struct lnx_domain *domain)
+{
+	struct lnx_stripe *stripe = NULL;
+
+	ofi_spin_lock(&domain->ld_stripe_lock);
+	if (!ofi_freestack_isempty(domain->ld_stripe_fs))
+		stripe = ofi_freestack_pop(domain->ld_stripe_fs);
+	ofi_spin_unlock(&domain->ld_stripe_lock);
+
+	if (stripe) {
+		memset(stripe, 0, sizeof(*stripe));
+		dlist_init(&stripe->ls_entry);
+	}
+
+	return stripe;
+}
+
+void lnx_stripe_free(struct lnx_domain *domain, struct lnx_stripe *stripe)
+{
+	ofi_spin_lock(&domain->ld_stripe_lock);
+	ofi_freestack_push(domain->ld_stripe_fs, stripe);
+	ofi_spin_unlock(&domain->ld_stripe_lock);
+}
+
+/* The first error seen by any fragment is the one reported */
+void lnx_stripe_set_err(struct lnx_domain *domain, struct lnx_stripe *stripe,
+			int err)
+{
+	ofi_spin_lock(&domain->ld_stripe_lock);
+	if (!stripe->ls_err)
+		stripe->ls_err = err;
+	ofi_spin_unlock(&domain->ld_stripe_lock);
+}
+
+/* Fragments are posted with the stripe as their context. Since the stripes
+ * live in a single array, checking whether a completion belongs to a
+ * fragment is a range check.
+ */
+static inline bool lnx_stripe_owns(struct lnx_domain *domain, void *context)
+{
+	struct lnx_stripe_fs *fs = domain->ld_stripe_fs;
+
+	return (char *) context >= (char *) fs->entry &&
+	       (char *) context < (char *) &fs->entry[fs->size];
+}
+
+static void lnx_stripe_complete(struct lnx_cq *lcq, struct lnx_stripe *stripe,
+				fi_addr_t src)
+{
+	struct fid_peer_cq *peer_cq = lcq->lcq_util_cq.peer_cq;
+	struct fi_cq_err_entry err_entry = {0};
+	uint64_t comp_flags;
+	ssize_t rc = 0;
+
+	comp_flags = stripe->ls_flags & (FI_SEND | FI_RECV | FI_TAGGED |
+					 FI_REMOTE_CQ_DATA);
+	if (comp_flags & FI_SEND)
+		comp_flags &= ~FI_REMOTE_CQ_DATA;
+
+	if (stripe->ls_err) {
+		err_entry.op_context = stripe->ls_context;
+		err_entry.flags = comp_flags;
+		err_entry.len = stripe->ls_len;
+		err_entry.data = stripe->ls_data;
+		err_entry.tag = stripe->ls_tag;
+		err_entry.err = stripe->ls_err;
+		rc = lcq->lcq_util_owner_ops->writeerr(peer_cq, &err_entry);
+	} else if (stripe->ls_flags & FI_COMPLETION) {
+		rc = lcq->lcq_util_owner_ops->write(peer_cq,
+				stripe->ls_context, comp_flags, stripe->ls_len,
+				NULL, stripe->ls_data, stripe->ls_tag, src);
+	}
+
+	if (rc)
+		FI_WARN(&lnx_prov, FI_LOG_CQ,
+			"Failed to write striped completion: %zd\n", rc);
+
+	lnx_stripe_free(lcq->lcq_lnx_domain, stripe);
+}
+
+static bool lnx_stripe_frag_done(struct lnx_domain *domain,
+				 struct lnx_stripe *stripe, size_t len,
+				 uint64_t flags, uint64_t data, int err)
+{
+	bool done;
+
+	ofi_spin_lock(&domain->ld_stripe_lock);
+	stripe->ls_len += len;
+	if (flags & FI_REMOTE_CQ_DATA) {
+		stripe->ls_flags |= FI_REMOTE_CQ_DATA;
+		stripe->ls_data = data;
+	}
+	if (err && !stripe->ls_err)
+		stripe->ls_err = err;
+	done = --stripe->ls_pending == 0;
+	ofi_spin_unlock(&domain->ld_stripe_lock);
+
+	return done;
+}
+
+static ssize_t lnx_stripe_cq_write(struct fid_peer_cq *cq, void *context,
+				   uint64_t flags, size_t len, void *buf,
+				   uint64_t data, uint64_t tag, fi_addr_t src)
+{
+	struct util_cq *util_cq = cq->fid.context;
+	struct lnx_cq *lcq;
+
+	lcq = container_of(util_cq, struct lnx_cq, lcq_util_cq);
+	if (!lnx_stripe_owns(lcq->lcq_lnx_domain, context))
+		return lcq->lcq_util_owner_ops->write(cq, context, flags, len,
+						      buf, data, tag, src);
+
+	if (lnx_stripe_frag_done(lcq->lcq_lnx_domain, context, len, flags,
+				 data, 0))
+		lnx_stripe_complete(lcq, context, src);
+
+	return 0;
+}
+
+static ssize_t lnx_stripe_cq_writeerr(struct fid_peer_cq *cq,
+				      const struct fi_cq_err_entry *err_entry)
+{
+	struct util_cq *util_cq = cq->fid.context;
+	struct lnx_cq *lcq;
+
+	lcq = container_of(util_cq, struct lnx_cq, lcq_util_cq);
+	if (!lnx_stripe_owns(lcq->lcq_lnx_domain, err_entry->op_context))
+		return lcq->lcq_util_owner_ops->writeerr(cq, err_entry);
+
+	if (lnx_stripe_frag_done(lcq->lcq_lnx_domain, err_entry->op_context,
+				 err_entry->len, err_entry->flags,
+				 err_entry->data, err_entry->err))
+		lnx_stripe_complete(lcq, err_entry->op_context,
+				    FI_ADDR_NOTAVAIL);
+
+	return 0;
+}
+
+/* Interpose on the completions written by the core providers so that the
+ * fragments of a striped message are reported as a single completion.
+ */
+void lnx_stripe_init_cq(struct lnx_cq *lcq)
+{
+	struct fid_peer_cq *peer_cq = lcq->lcq_util_cq.peer_cq;
+
+	if (!lnx_env.stripe_threshold)
+		return;
+
+	lcq->lcq_util_owner_ops = peer_cq->owner_ops;
+	lcq->lcq_owner_ops.size = sizeof(lcq->lcq_owner_ops);
+	lcq->lcq_owner_ops.write = lnx_stripe_cq_write;
+	lcq->lcq_owner_ops.writeerr = lnx_stripe_cq_writeerr;
+	peer_cq->owner_ops = &lcq->lcq_owner_ops;
+}
+
+/* Collect the core endpoints which can reach the peer. Fragment i of every
+ * striped message always goes over the i-th endpoint and address, so the
+ * fragments of consecutive messages stay ordered on each path.
+ */
+static int lnx_stripe_select(struct lnx_ep *lep, fi_addr_t lnx_addr,
+			     struct lnx_core_ep **ceps, fi_addr_t *core_addrs)
+{
+	struct lnx_peer *lp;
+	struct lnx_peer_map *map_addr;
+	struct lnx_peer_ep_map *ep_map;
+	int i;
+
+	lp = lnx_av_lookup_addr(lep->le_lav, lnx_addr);
+	if (!lp)
+		return -FI_ENOSYS;
+
+	ep_map = &lp->lp_src_eps[lep->le_idx];
+	for (i = 0; i < ep_map->pem_num_eps; i++) {
+		ceps[i] = ep_map->pem_eps[i];
+		map_addr = ofi_bufpool_get_ibuf(ceps[i]->cep_cav->cav_map,
+						lp->lp_addr);
+		core_addrs[i] = map_addr->map_addrs[0];
+	}
+
+	return ep_map->pem_num_eps;
+}
+
+static ssize_t lnx_stripe_post_frag(struct lnx_ep *lep, struct lnx_core_ep *cep,
+				    struct fi_msg_tagged *msg, uint64_t flags,
+				    bool retry)
+{
+	struct util_cq *cq = lep->le_ep.tx_cq;
+	ssize_t rc;
+
+	for (;;) {
+		rc = fi_tsendmsg(cep->cep_ep, msg, flags);
+		/* once the first fragment is out, the rest must follow */
+		if (rc != -FI_EAGAIN || !retry)
+			break;
+		cq->progress(cq);
+	}
+
+	return rc;
+}
+
+/*
+ * Split the message across all the core endpoints which can reach the
+ * peer. Returns -FI_ENOSYS if the peer is only reachable over a single core
+ * endpoint, in which case the caller sends the message as usual.
+ */
+ssize_t lnx_stripe_send(struct lnx_ep *lep, const struct iovec *iov,
+			void **desc, size_t count, fi_addr_t dest_addr,
+			uint64_t tag, uint64_t data, void *context,
+			uint64_t flags)
+{
+	struct lnx_core_ep *ceps[LNX_MAX_LOCAL_EPS];
+	fi_addr_t core_addrs[LNX_MAX_LOCAL_EPS];
+	struct iovec frag_iov[LNX_IOV_LIMIT];
+	void *frag_desc[LNX_IOV_LIMIT] = {0};
+	void *core_desc[LNX_IOV_LIMIT];
+	struct lnx_domain *domain = lep->le_domain;
+	struct lnx_stripe *stripe;
+	struct fi_msg_tagged msg;
+	size_t total_len, frag_len, frag_count, i;
+	size_t iov_index = 0, iov_offset = 0;
+	int neps, nfrags, order, idx, unposted;
+	bool done;
+	ssize_t rc;
+
+	neps = lnx_stripe_select(lep, dest_addr, ceps, core_addrs);
+	if (neps < 2)
+		return -FI_ENOSYS;
+
+	total_len = ofi_total_iov_len(iov, count);
+	nfrags = lnx_stripe_layout(total_len, neps, &order);
+	if (nfrags < 2)
+		return -FI_ENOSYS;
+
+	/* out of stripes, send the message over a single endpoint */
+	stripe = lnx_stripe_alloc(domain);
+	if (!stripe)
+		return -FI_ENOSYS;
+
+	stripe->ls_lep = lep;
+	stripe->ls_context = context;
+	stripe->ls_flags = flags | FI_SEND | FI_TAGGED;
+	stripe->ls_tag = tag;
+	stripe->ls_nfrags = nfrags;
+	stripe->ls_order = order;
+	stripe->ls_pending = nfrags;
+
+	msg.ignore = 0;
+	msg.context = stripe;
+	msg.data = data;
+
+	for (idx = 0; idx < nfrags; idx++) {
+		frag_len = MIN((size_t) 1 << order,
+			       total_len - ((size_t) idx << order));
+		rc = ofi_copy_iov_desc(frag_iov, frag_desc, &frag_count,
+				       (struct iovec *) iov, desc, count,
+				       &iov_index, &iov_offset, frag_len);
+		if (rc)
+			goto err;
+
+		for (i = 0; i < frag_count; i++) {
+			core_desc[i] = NULL;
+			if (!desc || !frag_desc[i])
+				continue;
+			rc = lnx_mr_regattr_core(ceps[idx]->cep_domain,
+						 frag_desc[i], &core_desc[i]);
+			if (rc)
+				goto err;
+		}
+
+		msg.msg_iov = frag_iov;
+		msg.desc = core_desc;
+		msg.iov_count = frag_count;
+		msg.addr = core_addrs[idx];
+		msg.tag = lnx_stripe_tag(tag, idx, nfrags, order);
+
+		rc = lnx_stripe_post_frag(lep, ceps[idx], &msg,
+					  flags | FI_COMPLETION, idx > 0);
+		if (rc)
+			goto err;
+
+		ceps[idx]->cep_t_stats.st_num_tsendmsg++;
+	}
+
+	return 0;
+
+err:
+	if (!idx) {
+		lnx_stripe_free(domain, stripe);
+		return rc;
+	}
+
+	/* The receiver is already waiting for every fragment. Send the
+	 * remaining ones empty and flagged as aborted so that it finishes
+	 * its stripe with an error. The send reports the error once these
+	 * have completed.
+	 */
+	FI_WARN(&lnx_prov, FI_LOG_CORE,
+		"Failed to post fragment %d of %d: %zd\n", idx, nfrags, rc);
+	lnx_stripe_set_err(domain, stripe, (int) -rc);
+
+	unposted = 0;
+	msg.msg_iov = NULL;
+	msg.desc = NULL;
+	msg.iov_count = 0;
+	for (; idx < nfrags; idx++) {
+		msg.addr = core_addrs[idx];
+		msg.tag = lnx_stripe_tag(tag, idx, nfrags, order) |
+			  LNX_STRIPE_ABORT;
+		rc = lnx_stripe_post_frag(lep, ceps[idx], &msg,
+					  flags | FI_COMPLETION, true);
+		if (rc) {
+			FI_WARN(&lnx_prov, FI_LOG_CORE,
+				"Failed to abort fragment %d of %d: %zd\n",
+				idx, nfrags, rc);
+			unposted++;
+		}
+	}
+
+	if (!unposted)
+		return 0;
+
+	ofi_spin_lock(&domain->ld_stripe_lock);
+	stripe->ls_pending -= unposted;
+	done = stripe->ls_pending == 0;
+	ofi_spin_unlock(&domain->ld_stripe_lock);
+
+	if (done)
+		lnx_stripe_complete(container_of(lep->le_ep.tx_cq,
+						 struct lnx_cq, lcq_util_cq),
+				    stripe, FI_ADDR_NOTAVAIL);
+	return 0;
+}
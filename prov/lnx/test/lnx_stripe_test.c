@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2026 The Libfabric Contributors. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lnx.h"
+
+/* The tag helpers read the provider settings, which are not linked in */
+struct lnx_env lnx_env = {
+	.stripe_threshold = 1,
+};
+
+static int failed;
+
+static void check_layout(size_t len, int neps, int exp_nfrags)
+{
+	size_t frag_len, sum = 0;
+	int nfrags, order, i;
+
+	nfrags = lnx_stripe_layout(len, neps, &order);
+	if (nfrags != exp_nfrags) {
+		printf("layout %zu/%d: %d fragments, expected %d\n",
+		       len, neps, nfrags, exp_nfrags);
+		failed++;
+		return;
+	}
+
+	for (i = 0; i < nfrags; i++) {
+		frag_len = MIN((size_t) 1 << order, len - ((size_t) i << order));
+		if (!frag_len) {
+			printf("layout %zu/%d: fragment %d is empty\n",
+			       len, neps, i);
+			failed++;
+			return;
+		}
+		sum += frag_len;
+	}
+
+	if (sum != len) {
+		printf("layout %zu/%d: fragments add up to %zu\n",
+		       len, neps, sum);
+		failed++;
+		return;
+	}
+	printf("layout %zu/%d: ok\n", len, neps);
+}
+
+static void check_tag(uint64_t app_tag, int idx, int nfrags, int order,
+		      bool abort)
+{
+	uint64_t tag;
+
+	tag = lnx_stripe_tag(app_tag, idx, nfrags, order);
+	if (abort)
+		tag |= LNX_STRIPE_ABORT;
+
+	if (!lnx_is_stripe_tag(tag) || lnx_stripe_idx(tag) != idx ||
+	    lnx_stripe_nfrags(tag) != nfrags ||
+	    lnx_stripe_order(tag) != order ||
+	    lnx_app_tag(tag) != (app_tag & ~LNX_STRIPE_TAG_MASK) ||
+	    !!(tag & LNX_STRIPE_ABORT) != abort) {
+		printf("tag %" PRIx64 " %d/%d order %d%s: decoded as "
+		       "%d/%d order %d app tag %" PRIx64 "\n", app_tag, idx,
+		       nfrags, order, abort ? " aborted" : "",
+		       lnx_stripe_idx(tag), lnx_stripe_nfrags(tag),
+		       lnx_stripe_order(tag), lnx_app_tag(tag));
+		failed++;
+		return;
+	}
+	printf("tag %" PRIx64 " %d/%d order %d%s: ok\n", app_tag, idx,
+	       nfrags, order, abort ? " aborted" : "");
+}
+
+int main(void)
+{
+	check_layout(1 << 20, 2, 2);
+	/* fragments are rounded up to a power of two, leaving a path idle */
+	check_layout(1 << 20, 3, 2);
+	check_layout(1 << 20, LNX_MAX_LOCAL_EPS, LNX_MAX_LOCAL_EPS);
+	check_layout(1000003, 4, 4);
+	check_layout(10, 2, 2);
+	check_layout(9, 4, 3);
+	check_layout(1, 2, 1);
+
+	check_tag(0x1234, 0, 2, 19, false);
+	check_tag(0x1234, 1, 2, 19, true);
+	check_tag(~0ULL, LNX_MAX_LOCAL_EPS - 1, LNX_MAX_LOCAL_EPS, 63, true);
+	check_tag(0, 3, 4, 0, false);
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -79,7 +79,8 @@ extern size_t mrail_num_info;
 enum {
 	MRAIL_POLICY_FIXED,
 	MRAIL_POLICY_ROUND_ROBIN,
-	MRAIL_POLICY_STRIPING
+	MRAIL_POLICY_STRIPING,
+	MRAIL_POLICY_WEIGHTED
 };
 
 #define MRAIL_MAX_CONFIG		8
@@ -264,12 +265,27 @@ struct mrail_cq {
 	mrail_cq_process_comp_func_t	process_comp;
 };
 
+/*
+ * Per-rail statistics used by the weighted policy.  Throughput and latency
+ * are exponentially weighted moving averages over RMA subrequest
+ * completions.  The latency is tracked with a fast and a slow decay rate so
+ * that a rail whose latency is rising can be deprioritized before its
+ * throughput estimate catches up.
+ */
+struct mrail_rail_stats {
+	ofi_atomic32_t	inflight;
+	double		bw;		/* bytes per ns */
+	double		lat_short;	/* ns */
+	double		lat_long;	/* ns */
+};
+
 struct mrail_ep {
 	struct util_ep		util_ep;
 	struct fi_info		*info;
 	struct {
 		struct fid_ep 		*ep;
 		struct fi_info		*info;
+		struct mrail_rail_stats	stats;
 	}			*rails;
 	size_t			num_eps;
 	ofi_atomic32_t		tx_rail;
@@ -377,14 +393,55 @@ static inline int mrail_get_policy(size_t size)
 	return mrail_config[i].policy;
 }
 
-static inline size_t mrail_get_tx_rail(struct mrail_ep *mrail_ep, int policy)
+size_t mrail_get_tx_rail_weighted(struct mrail_ep *mrail_ep);
+
+/*
+ * Split total_len across rails in proportion to their weights.  Rails whose
+ * share rounds down to zero are skipped, and the rounding leftover goes to
+ * the rail with the largest share.  Returns the number of subrequests, which
+ * is 0 if every share rounded down to zero.
+ */
+static inline size_t
+mrail_split_weighted(const double *weights, size_t num_rails,
+		     double total_weight, size_t total_len,
+		     uint32_t *rails, size_t *lens)
 {
-	return policy == MRAIL_POLICY_FIXED ?
-				mrail_ep->default_tx_rail :
-				mrail_get_tx_rail_rr(mrail_ep);
+	size_t i, len, remaining = total_len;
+	size_t count = 0, largest = 0;
+
+	for (i = 0; i < num_rails; i++) {
+		len = (size_t) (total_len * (weights[i] / total_weight));
+		if (len > remaining)
+			len = remaining;
+		if (!len)
+			continue;
+		if (!count || len > lens[largest])
+			largest = count;
+		rails[count] = (uint32_t) i;
+		lens[count++] = len;
+		remaining -= len;
+	}
 
+	if (count)
+		lens[largest] += remaining;
+	return count;
 }
 
+static inline size_t mrail_get_tx_rail(struct mrail_ep *mrail_ep, int policy)
+{
+	switch (policy) {
+	case MRAIL_POLICY_FIXED:
+		return mrail_ep->default_tx_rail;
+	case MRAIL_POLICY_WEIGHTED:
+		return mrail_get_tx_rail_weighted(mrail_ep);
+	default:
+		return mrail_get_tx_rail_rr(mrail_ep);
+	}
+}
+
+/* The subreq may be posted on any rail */
+#define MRAIL_ANY_RAIL	((uint32_t) -1)
+
 struct mrail_subreq {
 	struct fi_context context;
 	struct mrail_req *parent;
@@ -393,6 +450,11 @@ struct mrail_subreq {
 	struct fi_rma_iov rma_iov[MRAIL_IOV_LIMIT];
 	size_t iov_count;
 	size_t rma_iov_count;
+	size_t len;
+	uint32_t rail;
+	uint32_t busy_cnt;
+	uint32_t post_rail;
+	uint64_t post_time;
 };
 
 struct mrail_req {
@@ -429,6 +491,8 @@ void mrail_free_req(struct mrail_ep *mrail_ep, struct mrail_req *req)
 }
 
 void mrail_progress_deferred_reqs(struct mrail_ep *mrail_ep);
+void mrail_rail_stats_update(struct mrail_ep *mrail_ep,
+			     struct mrail_subreq *subreq);
 
 void mrail_poll_cq(struct util_cq *cq);
 
@@ -518,6 +518,8 @@ static void mrail_handle_rma_completion(struct util_cq *cq,
 	subreq = comp->op_context;
 	req = subreq->parent;
 
+	mrail_rail_stats_update(req->mrail_ep, subreq);
+
 	if (ofi_atomic_dec32(&req->expected_subcomps) == 0) {
 		if (req->comp.flags & MRAIL_RNDV_FLAG) {
 			mrail_finish_rndv_recv(cq, req, comp);
@@ -505,7 +505,8 @@ mrail_send_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 	}
 	tx_buf->hdr.tag = tag;
 
-	if (policy == MRAIL_POLICY_STRIPING) {
+	if (policy == MRAIL_POLICY_STRIPING ||
+	    policy == MRAIL_POLICY_WEIGHTED) {
 		ret = mrail_prepare_rndv_req(mrail_ep, tx_buf, iov, desc,
 					     count, len, iov_dest);
 		if (ret)
@@ -1019,6 +1020,7 @@ int mrail_ep_open(struct fid_domain *domain_fid, struct fi_info *info,
 			goto err;
 		}
 		mrail_ep->rails[i].info = fi;
+		ofi_atomic_initialize32(&mrail_ep->rails[i].stats.inflight, 0);
 	}
 
 	ret = mrail_ep_alloc_bufs(mrail_ep);
@@ -68,7 +68,7 @@ static int mrail_parse_env_vars(void)
 	fi_param_define(&mrail_prov, "config", FI_PARAM_STRING,
 			"Comma separated list of '<max_size>:<policy>' pairs, "
 			"with <max_size> in ascending order and <policy> being "
-			"fixed, round-robin, or striping");
+			"fixed, round-robin, striping, or weighted");
 	ret = fi_param_get_str(&mrail_prov, "config", &str);
 	if (!ret) {
 		for (i = 0; i < MRAIL_MAX_CONFIG; i++) {
@@ -92,6 +92,8 @@ static int mrail_parse_env_vars(void)
 				mrail_config[i].policy = MRAIL_POLICY_ROUND_ROBIN;
 			} else if (!strcasecmp(alg, "striping")) {
 				mrail_config[i].policy = MRAIL_POLICY_STRIPING;
+			} else if (!strcasecmp(alg, "weighted")) {
+				mrail_config[i].policy = MRAIL_POLICY_WEIGHTED;
 			} else {
 				FI_WARN(&mrail_prov, FI_LOG_CORE, "Invalid policy "
 					"specification %s\n", alg);
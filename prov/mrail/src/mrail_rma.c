@@ -32,6 +32,104 @@
 
 #include "mrail.h"
 
+/* Decay rates of the per-rail moving averages, as a power of two */
+#define MRAIL_STATS_SHIFT_SHORT	2
+#define MRAIL_STATS_SHIFT_LONG	5
+
+/* Rails never get less than 1/MRAIL_WEIGHT_MIN_DIV of the best rail's share
+ * so that their statistics keep being refreshed.
+ */
+#define MRAIL_WEIGHT_MIN_DIV	16
+
+/* A weighted subreq moves to any rail once its own rail has been busy
+ * this many times.
+ */
+#define MRAIL_RAIL_BUSY_MAX	4
+
+static inline double mrail_ewma(double avg, double sample, int shift)
+{
+	if (avg == 0)
+		return sample;
+	return avg + (sample - avg) / (1 << shift);
+}
+
+void mrail_rail_stats_update(struct mrail_ep *mrail_ep,
+			     struct mrail_subreq *subreq)
+{
+	struct mrail_rail_stats *stats;
+	uint64_t elapsed;
+
+	stats = &mrail_ep->rails[subreq->post_rail].stats;
+	ofi_atomic_dec32(&stats->inflight);
+
+	elapsed = ofi_gettime_ns() - subreq->post_time;
+	if (!elapsed)
+		elapsed = 1;
+
+	ofi_genlock_lock(&mrail_ep->util_ep.lock);
+	stats->lat_short = mrail_ewma(stats->lat_short, (double) elapsed,
+				      MRAIL_STATS_SHIFT_SHORT);
+	stats->lat_long = mrail_ewma(stats->lat_long, (double) elapsed,
+				     MRAIL_STATS_SHIFT_LONG);
+	if (subreq->len)
+		stats->bw = mrail_ewma(stats->bw,
+				       (double) subreq->len / elapsed,
+				       MRAIL_STATS_SHIFT_SHORT);
+	ofi_genlock_unlock(&mrail_ep->util_ep.lock);
+}
+
+/*
+ * Compute the relative weight of each rail from its measured throughput,
+ * discounted by the number of outstanding subreqs and by how much its
+ * short-term latency exceeds its long-term latency.  Rails without any
+ * measurement yet get the best weight so that they are probed.
+ * Caller must hold the ep lock.
+ */
+static double mrail_get_rail_weights(struct mrail_ep *mrail_ep, double *weights)
+{
+	struct mrail_rail_stats *stats;
+	double max_weight = 0, total = 0;
+	size_t i;
+
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		stats = &mrail_ep->rails[i].stats;
+		weights[i] = stats->bw;
+		if (stats->lat_short > stats->lat_long)
+			weights[i] *= stats->lat_long / stats->lat_short;
+		weights[i] /= 1 + ofi_atomic_get32(&stats->inflight);
+		if (weights[i] > max_weight)
+			max_weight = weights[i];
+	}
+
+	if (max_weight == 0)
+		max_weight = 1;
+
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		if (mrail_ep->rails[i].stats.bw == 0)
+			weights[i] = max_weight;
+		else if (weights[i] < max_weight / MRAIL_WEIGHT_MIN_DIV)
+			weights[i] = max_weight / MRAIL_WEIGHT_MIN_DIV;
+		total += weights[i];
+	}
+	return total;
+}
+
+size_t mrail_get_tx_rail_weighted(struct mrail_ep *mrail_ep)
+{
+	double *weights = alloca(sizeof(*weights) * mrail_ep->num_eps);
+	size_t i, rail = 0;
+
+	ofi_genlock_lock(&mrail_ep->util_ep.lock);
+	(void) mrail_get_rail_weights(mrail_ep, weights);
+	ofi_genlock_unlock(&mrail_ep->util_ep.lock);
+
+	for (i = 1; i < mrail_ep->num_eps; i++) {
+		if (weights[i] > weights[rail])
+			rail = i;
+	}
+	return rail;
+}
+
 static void mrail_subreq_to_rail(struct mrail_subreq *subreq, uint32_t rail,
 		struct iovec *out_iovs, void **out_descs,
 		struct fi_rma_iov *out_rma_iovs)
@@ -84,6 +182,10 @@ static ssize_t mrail_post_subreq(uint32_t rail,
 	msg.rma_iov_count	= subreq->rma_iov_count;
 	msg.context		= &subreq->context;
 
+	subreq->post_rail	= rail;
+	subreq->post_time	= ofi_gettime_ns();
+	ofi_atomic_inc32(&mrail_ep->rails[rail].stats.inflight);
+
 	if (req->op_type == FI_READ) {
 		ret = fi_readmsg(mrail_ep->rails[rail].ep, &msg, flags);
 	} else {
@@ -98,27 +200,46 @@ static ssize_t mrail_post_subreq(uint32_t rail,
 		ret = fi_writemsg(mrail_ep->rails[rail].ep, &msg, flags);
 	}
 
+	if (ret)
+		ofi_atomic_dec32(&mrail_ep->rails[rail].stats.inflight);
+
 	return ret;
 }
 
 static ssize_t mrail_post_req(struct mrail_req *req)
 {
+	struct mrail_subreq *subreq;
 	size_t i;
 	uint32_t rail;
 	ssize_t ret = 0;
 
 	while (req->pending_subreq >= 0) {
-		/* Try all rails before giving up */
-		for (i = 0; i < req->mrail_ep->num_eps; ++i) {
-			rail = mrail_get_tx_rail_rr(req->mrail_ep);
+		subreq = &req->subreqs[req->pending_subreq];
 
-			ret = mrail_post_subreq(rail,
-					&req->subreqs[req->pending_subreq]);
-			if (ret != -FI_EAGAIN) {
-				break;
-			} else {
-				/* One of the rails is busy. Try progressing. */
+		ret = -FI_EAGAIN;
+		if (subreq->rail != MRAIL_ANY_RAIL) {
+			/* Weighted subreqs are sized for their rail */
+			ret = mrail_post_subreq(subreq->rail, subreq);
+			if (ret == -FI_EAGAIN) {
 				mrail_poll_cq(req->mrail_ep->util_ep.tx_cq);
+				if (++subreq->busy_cnt >= MRAIL_RAIL_BUSY_MAX)
+					subreq->rail = MRAIL_ANY_RAIL;
+			}
+		}
+
+		if (ret == -FI_EAGAIN && subreq->rail == MRAIL_ANY_RAIL) {
+			/* Try all rails before giving up */
+			for (i = 0; i < req->mrail_ep->num_eps; ++i) {
+				rail = mrail_get_tx_rail_rr(req->mrail_ep);
+
+				ret = mrail_post_subreq(rail, subreq);
+				if (ret != -FI_EAGAIN) {
+					break;
+				} else {
+					/* One of the rails is busy. Try
+					 * progressing. */
+					mrail_poll_cq(req->mrail_ep->util_ep.tx_cq);
+				}
 			}
 		}
 
@@ -180,31 +301,75 @@ void mrail_progress_deferred_reqs(struct mrail_ep *mrail_ep)
 	}
 }
 
+/*
+ * Split total_len across the rails in proportion to their weights.  Rails
+ * that end up with nothing to transfer get no subreq.  Returns the number
+ * of subreqs.
+ */
+static size_t mrail_get_weighted_subreqs(struct mrail_ep *mrail_ep,
+		size_t total_len, uint32_t *rails, size_t *lens)
+{
+	double *weights = alloca(sizeof(*weights) * mrail_ep->num_eps);
+	double total_weight;
+	size_t i, count;
+
+	ofi_genlock_lock(&mrail_ep->util_ep.lock);
+	total_weight = mrail_get_rail_weights(mrail_ep, weights);
+	ofi_genlock_unlock(&mrail_ep->util_ep.lock);
+
+	count = mrail_split_weighted(weights, mrail_ep->num_eps, total_weight,
+				     total_len, rails, lens);
+	if (count)
+		return count;
+
+	/* Too short to split: send it all on the rail with the best weight */
+	rails[0] = 0;
+	for (i = 1; i < mrail_ep->num_eps; i++) {
+		if (weights[i] > weights[rails[0]])
+			rails[0] = (uint32_t) i;
+	}
+	lens[0] = total_len;
+	return 1;
+}
+
 static ssize_t mrail_prepare_rma_subreqs(struct mrail_ep *mrail_ep,
 		const struct fi_msg_rma *msg, struct mrail_req *req)
 {
-	ssize_t ret;
+	ssize_t ret = 0;
 	struct mrail_subreq *subreq;
 	size_t subreq_count;
 	size_t total_len;
 	size_t chunk_len;
-	size_t subreq_len;
 	size_t iov_index;
 	size_t iov_offset;
 	size_t rma_iov_index;
 	size_t rma_iov_offset;
+	size_t *subreq_lens;
+	uint32_t *subreq_rails;
 	int i;
 
-	/* For now, stripe across all rails.
-	 * This could be determined by a dynamic scheduler instead.
-	 */
-	subreq_count = mrail_ep->num_eps;
+	subreq_lens = alloca(sizeof(*subreq_lens) * mrail_ep->num_eps);
+	subreq_rails = alloca(sizeof(*subreq_rails) * mrail_ep->num_eps);
 
-	total_len = ofi_total_iov_len(msg->msg_iov, msg->iov_count); 
-	chunk_len = total_len / subreq_count;
+	total_len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
+
+	if (mrail_get_policy(total_len) == MRAIL_POLICY_WEIGHTED) {
+		subreq_count = mrail_get_weighted_subreqs(mrail_ep, total_len,
+							  subreq_rails,
+							  subreq_lens);
+	} else {
+		/* Stripe equally across all rails, the first chunk is the
+		 * longest.
+		 */
+		subreq_count = mrail_ep->num_eps;
+		chunk_len = total_len / subreq_count;
+		for (i = 0; i < subreq_count; i++) {
+			subreq_rails[i] = MRAIL_ANY_RAIL;
+			subreq_lens[i] = chunk_len;
+		}
+		subreq_lens[0] += total_len % subreq_count;
+	}
 
-	/* The first chunk is the longest */
-	subreq_len =  chunk_len + (total_len % subreq_count);
 	iov_index = 0;
 	iov_offset = 0;
 	rma_iov_index = 0;
@@ -222,12 +387,15 @@ static ssize_t mrail_prepare_rma_subreqs(struct mrail_ep *mrail_ep,
 		subreq = &req->subreqs[i];
 
 		subreq->parent = req;
+		subreq->rail = subreq_rails[subreq_count - 1 - i];
+		subreq->busy_cnt = 0;
+		subreq->len = subreq_lens[subreq_count - 1 - i];
 
 		ret = ofi_copy_iov_desc(subreq->iov, subreq->descs,
 				&subreq->iov_count,
 				(struct iovec *)msg->msg_iov, msg->desc,
 				msg->iov_count, &iov_index, &iov_offset,
-				subreq_len);
+				subreq->len);
 		if (ret) {
 			goto out;
 		}
@@ -235,13 +403,10 @@ static ssize_t mrail_prepare_rma_subreqs(struct mrail_ep *mrail_ep,
 		ret = ofi_copy_rma_iov(subreq->rma_iov, &subreq->rma_iov_count,
 				(struct fi_rma_iov *)msg->rma_iov,
 				msg->rma_iov_count, &rma_iov_index,
-				&rma_iov_offset, subreq_len);
+				&rma_iov_offset, subreq->len);
 		if (ret) {
 			goto out;
 		}
-
-		/* All the other chunks have the same length */
-		subreq_len = chunk_len;
 	}
 
 	ofi_atomic_initialize32(&req->expected_subcomps, subreq_count);
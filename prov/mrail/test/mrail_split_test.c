@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2026 The Libfabric Contributors. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mrail.h"
+
+#define MAX_RAILS 8
+
+static int failed;
+
+static void check_split(const char *name, const double *weights,
+			size_t num_rails, size_t total_len, size_t exp_count)
+{
+	uint32_t rails[MAX_RAILS];
+	size_t lens[MAX_RAILS];
+	double total_weight = 0;
+	size_t i, count, sum = 0;
+
+	for (i = 0; i < num_rails; i++)
+		total_weight += weights[i];
+
+	count = mrail_split_weighted(weights, num_rails, total_weight,
+				     total_len, rails, lens);
+	if (count != exp_count) {
+		printf("%s: count %zu, expected %zu\n", name, count, exp_count);
+		failed++;
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!lens[i] || rails[i] >= num_rails ||
+		    (i && rails[i] <= rails[i - 1])) {
+			printf("%s: bad subreq %zu: rail %u len %zu\n",
+			       name, i, rails[i], lens[i]);
+			failed++;
+			return;
+		}
+		sum += lens[i];
+	}
+
+	if (count && sum != total_len) {
+		printf("%s: lengths add up to %zu, expected %zu\n",
+		       name, sum, total_len);
+		failed++;
+		return;
+	}
+	printf("%s: ok\n", name);
+}
+
+static void check_leftover(void)
+{
+	double weights[] = { 1, 2, 1 };
+	uint32_t rails[3];
+	size_t lens[3];
+	size_t count;
+
+	/* 10 splits as 2 + 5 + 2; the leftover byte goes to rail 1 */
+	count = mrail_split_weighted(weights, 3, 4, 10, rails, lens);
+	if (count != 3 || lens[0] != 2 || lens[1] != 6 || lens[2] != 2) {
+		printf("leftover: got %zu subreqs, %zu/%zu/%zu\n", count,
+		       lens[0], lens[1], lens[2]);
+		failed++;
+		return;
+	}
+	printf("leftover: ok\n");
+}
+
+int main(void)
+{
+	double equal[] = { 1, 1, 1, 1 };
+	double skewed[] = { 100, 1, 10, 0.5 };
+	double single[] = { 3 };
+
+	check_split("equal", equal, 4, 1 << 20, 4);
+	check_split("equal odd", equal, 4, 1000003, 4);
+	check_split("skewed", skewed, 4, 1 << 20, 4);
+	check_split("skewed short", skewed, 4, 100, 2);
+	check_split("single", single, 1, 12345, 1);
+	check_split("too short", equal, 4, 3, 0);
+	check_split("empty", equal, 4, 0, 0);
+	check_leftover();
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
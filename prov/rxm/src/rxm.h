@@ -79,6 +79,12 @@ enum {
 	RXM_CM_FLOW_CTRL_PEER_OFF,
 };
 
+/* rx_size in the connect and accept data is informational only.  Its top
+ * bit advertises support for the rxm_ctrl_close handshake, which older
+ * versions leave clear.
+ */
+#define RXM_CM_CONN_CLOSE	(1U << 31)
+
 union rxm_cm_data {
 	struct _connect {
 		uint8_t version;
@@ -217,6 +223,9 @@ extern int force_auto_progress;
 extern int rxm_use_write_rndv;
 extern int rxm_detect_hmem_iface;
 extern size_t rxm_num_msg_eps;
+extern size_t rxm_eager_connect;
+extern size_t rxm_max_conns;
+extern size_t rxm_conn_idle_timeout;
 extern enum fi_wait_obj def_wait_obj, def_tcp_wait_obj;
 
 struct rxm_ep;
@@ -228,10 +237,25 @@ enum rxm_cm_state {
 	RXM_CM_CONNECTING,
 	RXM_CM_ACCEPTING,
 	RXM_CM_CONNECTED,
+	RXM_CM_CLOSING,
 };
 
 enum {
 	RXM_CONN_INDEXED = BIT(0),
+	RXM_CONN_EAGER = BIT(1),
+	RXM_CONN_EAGER_ACTIVE = BIT(2),
+	RXM_CONN_CLOSE_OK = BIT(3),	/* peer supports rxm_ctrl_close */
+	RXM_CONN_CLOSE_REQ = BIT(4),	/* we asked the peer to close */
+	RXM_CONN_CLOSE_IDLE = BIT(5),	/* ... because it was idle */
+	RXM_CONN_CLOSE_READY = BIT(6),	/* peer agreed, close on progress */
+	RXM_CONN_EVICTED = BIT(7),
+};
+
+/* ctrl_data of rxm_ctrl_close */
+enum {
+	RXM_CLOSE_REQ,
+	RXM_CLOSE_ACK,
+	RXM_CLOSE_NACK,
 };
 
 /* Each local rxm ep will have at most 1 connection to a single
@@ -262,6 +286,11 @@ struct rxm_conn {
 	struct dlist_entry deferred_sar_msgs;
 	struct dlist_entry deferred_sar_segments;
 	struct dlist_entry loopback_entry;
+	struct dlist_entry eager_entry;
+
+	/* ep->conn_lru while connected, ep->conn_close_list while closing */
+	struct dlist_entry lru_entry;
+	uint64_t last_used;
 };
 
 void rxm_freeall_conns(struct rxm_ep *ep);
@@ -270,6 +299,9 @@ static inline int rxm_get_ep_idx(struct rxm_conn *conn, struct fid *fid)
 {
 	uint8_t i;
 
+	if (!conn->msg_eps)
+		return -1;
+
 	for (i = 0; i < conn->num_msg_eps; i++)
 		if (conn->msg_eps[i] && &conn->msg_eps[i]->fid == fid)
 			return i;
@@ -419,7 +451,8 @@ struct rxm_atomic_resp_hdr {
 	FUNC(RXM_RNDV_FINISH), /* not needed */	\
 	FUNC(RXM_ATOMIC_RESP_WAIT),	\
 	FUNC(RXM_ATOMIC_RESP_SENT),	\
-	FUNC(RXM_RNDV_WRITE_TX_WAIT)
+	FUNC(RXM_RNDV_WRITE_TX_WAIT),	\
+	FUNC(RXM_CONN_CLOSE_TX)
 
 enum rxm_proto_state {
 	RXM_PROTO_STATES(OFI_ENUM_VAL)
@@ -436,7 +469,8 @@ enum {
 	rxm_ctrl_atomic_resp,
 	rxm_ctrl_credit,
 	rxm_ctrl_rndv_wr_data,
-	rxm_ctrl_rndv_wr_done
+	rxm_ctrl_rndv_wr_done,
+	rxm_ctrl_close
 };
 
 struct rxm_pkt {
@@ -605,6 +639,7 @@ enum rxm_deferred_tx_entry_type {
 	RXM_DEFERRED_TX_SAR_SEG,
 	RXM_DEFERRED_TX_ATOMIC_RESP,
 	RXM_DEFERRED_TX_CREDIT_SEND,
+	RXM_DEFERRED_TX_CONN_CLOSE,
 };
 
 struct rxm_deferred_tx_entry {
@@ -658,6 +693,9 @@ struct rxm_deferred_tx_entry {
 		struct {
 			struct rxm_tx_buf *tx_buf;
 		} credit_msg;
+		struct {
+			struct rxm_tx_buf *tx_buf;
+		} close_msg;
 	};
 };
 
@@ -687,6 +725,33 @@ struct rxm_ep {
 
 	int			connecting_cnt;
 	struct index_map	conn_idx_map;
+
+	/* Connections queued by the AV insert handler when eager
+	 * connect is enabled, and the number of those in progress.
+	 */
+	struct dlist_entry	eager_queue;
+	size_t			eager_active;
+	size_t			eager_total;
+	size_t			eager_connected;
+	size_t			eager_failed;
+
+	/* Connected peers, most recently used first, when the number of
+	 * connections is capped or idle connections are closed.  The
+	 * clock is refreshed by rxm_conn_progress, in milliseconds.
+	 */
+	struct dlist_entry	conn_lru;
+	struct dlist_entry	conn_close_list;
+	size_t			conn_cnt;
+	uint64_t		conn_clock;
+	size_t			rx_held;
+	struct {
+		size_t		peak;
+		size_t		evicted;
+		size_t		idle_closed;
+		size_t		peer_closed;
+		size_t		refused;
+		size_t		reconnected;
+	} conn_stats;
 	struct dlist_entry	loopback_list;
 	union ofi_sock_ip	addr;
 
@@ -714,6 +779,8 @@ struct rxm_ep {
 	bool			rdm_mr_local;
 	bool			do_progress;
 	bool			enable_direct_send;
+	bool			listening;
+	bool			conn_lru_enabled;
 
 	size_t			buffered_min;
 	size_t			buffered_limit;
@@ -742,6 +809,9 @@ struct rxm_ep {
 int rxm_start_listen(struct rxm_ep *ep);
 void rxm_stop_listen(struct rxm_ep *ep);
 void rxm_conn_progress(struct rxm_ep *ep);
+void rxm_eager_connect_progress(struct rxm_ep *ep);
+ssize_t rxm_handle_conn_close(struct rxm_ep *ep, struct rxm_rx_buf *rx_buf);
+void rxm_conn_close_failed(struct rxm_conn *conn);
 
 
 extern struct fi_provider rxm_prov;
@@ -831,6 +901,22 @@ static inline size_t rxm_ep_max_atomic_size(struct fi_info *info)
 	return rxm_buffer_size - sizeof(struct rxm_atomic_hdr);
 }
 
+/* Move a connection to the head of the LRU list, if it is on it. */
+static inline void rxm_conn_touch(struct rxm_conn *conn)
+{
+	struct rxm_ep *ep = conn->ep;
+
+	if (dlist_empty(&conn->lru_entry) ||
+	    conn->states[0] != RXM_CM_CONNECTED)
+		return;
+
+	conn->last_used = ep->conn_clock;
+	if (ep->conn_lru.next != &conn->lru_entry) {
+		dlist_remove(&conn->lru_entry);
+		dlist_insert_head(&conn->lru_entry, &ep->conn_lru);
+	}
+}
+
 static inline struct fid_ep *
 rxm_conn_msg_ep(struct rxm_conn *conn, const struct rxm_pkt *pkt)
 {
@@ -950,6 +1036,8 @@ int rxm_srx_context(struct fid_domain *domain, struct fi_rx_attr *attr,
 int rxm_post_recv(struct rxm_rx_buf *rx_buf);
 void rxm_av_remove_handler(struct util_ep *util_ep,
 			   struct util_peer_addr *peer);
+void rxm_av_insert_handler(struct util_ep *util_ep,
+			   struct util_peer_addr *peer);
 
 static inline void
 rxm_free_rx_buf(struct rxm_rx_buf *rx_buf)
@@ -964,6 +1052,8 @@ rxm_free_rx_buf(struct rxm_rx_buf *rx_buf)
 	     (rx_buf->conn->msg_eps && rx_buf->conn->msg_eps[0]))) {
 		rxm_post_recv(rx_buf);
 	} else {
+		if (!rx_buf->repost)
+			rx_buf->ep->rx_held--;
 		ofi_buf_free(rx_buf);
 	}
 }
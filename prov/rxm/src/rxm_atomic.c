@@ -220,6 +220,11 @@ rxm_ep_atomic_writemsg(struct fid_ep *ep_fid, const struct fi_msg_atomic *msg,
 	struct rxm_ep *rxm_ep = container_of(ep_fid, struct rxm_ep,
 					     util_ep.ep_fid.fid);
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_atomic(ep_fid, msg, NULL, NULL, 0,
+						NULL, NULL, 0, flags,
+						FI_OP_ATOMIC);
+
 	return rxm_ep_generic_atomic_writemsg(rxm_ep, msg,
 				flags | rxm_ep->util_ep.tx_msg_flags);
 }
@@ -334,6 +339,12 @@ rxm_ep_atomic_readwritemsg(struct fid_ep *ep_fid,
 	struct rxm_ep *rxm_ep = container_of(ep_fid, struct rxm_ep,
 					     util_ep.ep_fid.fid);
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_atomic(ep_fid, msg, NULL, NULL, 0,
+						resultv, result_desc,
+						result_count, flags,
+						FI_OP_FETCH_ATOMIC);
+
 	return rxm_ep_generic_atomic_readwritemsg(rxm_ep, msg,
 			resultv, result_desc, result_count,
 			flags | rxm_ep->util_ep.tx_msg_flags);
@@ -429,6 +440,13 @@ rxm_ep_atomic_compwritemsg(struct fid_ep *ep_fid,
 	struct rxm_ep *rxm_ep = container_of(ep_fid, struct rxm_ep,
 					     util_ep.ep_fid.fid);
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_atomic(ep_fid, msg, comparev,
+						compare_desc, compare_count,
+						resultv, result_desc,
+						result_count, flags,
+						FI_OP_COMPARE_ATOMIC);
+
 	return rxm_ep_generic_atomic_compwritemsg(rxm_ep, msg, comparev,
 				    compare_desc, compare_count, resultv,
 				    result_desc, result_count,
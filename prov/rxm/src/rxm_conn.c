@@ -39,7 +39,15 @@
 #include <ofi_util.h>
 #include "rxm.h"
 
+/* Connections used within this many milliseconds are not closed to
+ * enforce rxm_max_conns, so that a new connection carries at least the
+ * transfer that it was opened for.
+ */
+#define RXM_CONN_MIN_IDLE	100
+
 static void rxm_flush_msg_cq(struct rxm_ep *rxm_ep);
+static struct rxm_conn *
+rxm_add_conn(struct rxm_ep *ep, struct util_peer_addr *peer);
 
 
 /* castable to fi_eq_cm_entry - we can't use fi_eq_cm_entry directly
@@ -95,10 +103,22 @@ static void rxm_close_conn(struct rxm_conn *conn)
 		if (rx_entry && rx_entry->peer_context)
 			rx_entry->srx->owner_ops->free_entry(rx_entry);
 	}
+
+	if (!dlist_empty(&conn->lru_entry)) {
+		if (conn->states[0] == RXM_CM_CONNECTED)
+			conn->ep->conn_cnt--;
+		dlist_remove_init(&conn->lru_entry);
+	}
+	conn->flags &= ~(RXM_CONN_CLOSE_OK | RXM_CONN_CLOSE_REQ |
+			 RXM_CONN_CLOSE_IDLE | RXM_CONN_CLOSE_READY);
+
+	/* Completions flushed below must not reuse the closed msg eps */
 	if (conn->msg_eps) {
 		for (uint8_t i = 0; i < conn->num_msg_eps; i++) {
-			if (conn->msg_eps[i])
+			if (conn->msg_eps[i]) {
 				fi_close(&conn->msg_eps[i]->fid);
+				conn->msg_eps[i] = NULL;
+			}
 		}
 	}
 	rxm_flush_msg_cq(conn->ep);
@@ -294,6 +314,8 @@ static int rxm_init_connect_data(struct rxm_conn *conn,
 	cm_data->connect.endianness = ofi_detect_endianness();
 	cm_data->connect.eager_limit = (uint32_t) conn->ep->eager_limit;
 	cm_data->connect.rx_size = (uint32_t) conn->ep->msg_info->rx_attr->size;
+	if (!rxm_passthru_info(conn->ep->rxm_info))
+		cm_data->connect.rx_size |= RXM_CM_CONN_CLOSE;
 	cm_data->connect.flow_ctrl = conn->flow_ctrl ?
 						RXM_CM_FLOW_CTRL_PEER_ON :
 						RXM_CM_FLOW_CTRL_PEER_OFF;
@@ -388,6 +410,7 @@ static int rxm_connect(struct rxm_conn *conn)
 		break;
 	case RXM_CM_CONNECTING:
 	case RXM_CM_ACCEPTING:
+	case RXM_CM_CLOSING:
 		break;
 	case RXM_CM_CONNECTED:
 		return 0;
@@ -400,6 +423,97 @@ static int rxm_connect(struct rxm_conn *conn)
 	return -FI_EAGAIN;
 }
 
+static void rxm_eager_conn_done(struct rxm_conn *conn, bool connected)
+{
+	struct rxm_ep *ep = conn->ep;
+	size_t done;
+
+	if (!(conn->flags & (RXM_CONN_EAGER | RXM_CONN_EAGER_ACTIVE)))
+		return;
+
+	dlist_remove_init(&conn->eager_entry);
+	if (conn->flags & RXM_CONN_EAGER_ACTIVE)
+		ep->eager_active--;
+	conn->flags &= ~(RXM_CONN_EAGER | RXM_CONN_EAGER_ACTIVE);
+
+	if (connected)
+		ep->eager_connected++;
+	else
+		ep->eager_failed++;
+
+	done = ep->eager_connected + ep->eager_failed;
+	if (done == ep->eager_total) {
+		FI_INFO(&rxm_prov, FI_LOG_EP_CTRL,
+			"eager connect done: %zu connected, %zu failed\n",
+			ep->eager_connected, ep->eager_failed);
+	} else if (!(done % 1024)) {
+		FI_INFO(&rxm_prov, FI_LOG_EP_CTRL,
+			"eager connect: %zu of %zu done\n",
+			done, ep->eager_total);
+	}
+}
+
+/* Start queued connections until rxm_eager_connect are in progress. */
+void rxm_eager_connect_progress(struct rxm_ep *ep)
+{
+	struct rxm_conn *conn;
+	int ret;
+
+	assert(ofi_genlock_held(&ep->util_ep.lock));
+	while (ep->listening && ep->eager_active < rxm_eager_connect &&
+	       !dlist_empty(&ep->eager_queue)) {
+		dlist_pop_front(&ep->eager_queue, struct rxm_conn, conn,
+				eager_entry);
+		dlist_init(&conn->eager_entry);
+		conn->flags |= RXM_CONN_EAGER_ACTIVE;
+		ep->eager_active++;
+
+		switch (conn->states[0]) {
+		case RXM_CM_IDLE:
+			if (conn->peer->firewall_addr) {
+				rxm_eager_conn_done(conn, false);
+				break;
+			}
+			ret = rxm_send_connect(conn, 0);
+			if (ret) {
+				/* A later transfer retries the connection */
+				RXM_WARN_ERR(FI_LOG_EP_CTRL,
+					     "rxm_send_connect", ret);
+				rxm_eager_conn_done(conn, false);
+			}
+			break;
+		case RXM_CM_CONNECTED:
+		case RXM_CM_CLOSING:
+			rxm_eager_conn_done(conn, true);
+			break;
+		default:
+			/* completed by rxm_process_connect */
+			break;
+		}
+	}
+}
+
+void rxm_av_insert_handler(struct util_ep *util_ep,
+			   struct util_peer_addr *peer)
+{
+	struct rxm_conn *conn;
+	struct rxm_ep *ep;
+
+	ep = container_of(util_ep, struct rxm_ep, util_ep);
+	ofi_genlock_lock(&ep->util_ep.lock);
+	conn = rxm_add_conn(ep, peer);
+	if (!conn || conn->states[0] == RXM_CM_CONNECTED ||
+	    (conn->flags & (RXM_CONN_EAGER | RXM_CONN_EAGER_ACTIVE)))
+		goto unlock;
+
+	conn->flags |= RXM_CONN_EAGER;
+	dlist_insert_tail(&conn->eager_entry, &ep->eager_queue);
+	ep->eager_total++;
+	rxm_eager_connect_progress(ep);
+unlock:
+	ofi_genlock_unlock(&ep->util_ep.lock);
+}
+
 static void rxm_free_conn(struct rxm_conn *conn)
 {
 	struct rxm_av *av;
@@ -407,6 +521,8 @@ static void rxm_free_conn(struct rxm_conn *conn)
 	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "free conn %p\n", conn);
 	assert(ofi_genlock_held(&conn->ep->util_ep.lock));
 
+	rxm_eager_conn_done(conn, false);
+
 	if (conn->flags & RXM_CONN_INDEXED)
 		ofi_idm_clear(&conn->ep->conn_idx_map, conn->peer->index);
 
@@ -435,6 +551,16 @@ void rxm_freeall_conns(struct rxm_ep *ep)
 	av = container_of(ep->util_ep.av, struct rxm_av, util_av);
 	ofi_genlock_lock(&ep->util_ep.lock);
 
+	if (ep->conn_lru_enabled || ep->conn_stats.peer_closed) {
+		FI_INFO(&rxm_prov, FI_LOG_EP_CTRL,
+			"connections: peak %zu, evicted %zu, idle closed %zu, "
+			"closed by peer %zu, close refused %zu, "
+			"reconnected %zu\n", ep->conn_stats.peak,
+			ep->conn_stats.evicted, ep->conn_stats.idle_closed,
+			ep->conn_stats.peer_closed, ep->conn_stats.refused,
+			ep->conn_stats.reconnected);
+	}
+
 	/* We can't have more connections than the current number of
 	 * possible peers.
 	 */
@@ -482,6 +608,8 @@ rxm_alloc_conn(struct rxm_ep *ep, struct util_peer_addr *peer)
 	dlist_init(&conn->deferred_sar_msgs);
 	dlist_init(&conn->deferred_sar_segments);
 	dlist_init(&conn->loopback_entry);
+	dlist_init(&conn->eager_entry);
+	dlist_init(&conn->lru_entry);
 
 	conn->peer = peer;
 	rxm_ref_peer(peer);
@@ -547,12 +675,16 @@ ssize_t rxm_get_conn(struct rxm_ep *ep, fi_addr_t addr, struct rxm_conn **conn)
 	ssize_t ret;
 
 	assert(ofi_genlock_held(&ep->util_ep.lock));
-	peer = ofi_av_addr_context(ep->util_ep.av, addr);
+	peer = rxm_av_peer_ctx(ep->util_ep.av, addr);
+	if (!*peer)
+		return -FI_ENOMEM;
+
 	*conn = rxm_add_conn(ep, *peer);
 	if (!*conn)
 		return -FI_ENOMEM;
 
 	if ((*conn)->states[0] == RXM_CM_CONNECTED) {
+		rxm_conn_touch(*conn);
 		if (!dlist_empty(&(*conn)->deferred_tx_queue)) {
 			rxm_ep_do_progress(&ep->util_ep);
 			if (!dlist_empty(&(*conn)->deferred_tx_queue))
@@ -575,6 +707,300 @@ ssize_t rxm_get_conn(struct rxm_ep *ep, fi_addr_t addr, struct rxm_conn **conn)
 	return ret;
 }
 
+static void rxm_conn_lru_add(struct rxm_conn *conn)
+{
+	struct rxm_ep *ep = conn->ep;
+
+	if (!ep->conn_lru_enabled || !(conn->flags & RXM_CONN_INDEXED))
+		return;
+
+	assert(dlist_empty(&conn->lru_entry));
+	conn->last_used = ep->conn_clock;
+	dlist_insert_head(&conn->lru_entry, &ep->conn_lru);
+	if (++ep->conn_cnt > ep->conn_stats.peak)
+		ep->conn_stats.peak = ep->conn_cnt;
+
+	if (conn->flags & RXM_CONN_EVICTED) {
+		conn->flags &= ~RXM_CONN_EVICTED;
+		ep->conn_stats.reconnected++;
+	}
+}
+
+/* A connection may only be closed while nothing is in flight over it.
+ * Transfers and held receive buffers are tracked per endpoint, so we
+ * require the whole endpoint to be quiescent.
+ */
+static bool rxm_conn_quiescent(struct rxm_conn *conn)
+{
+	struct rxm_ep *ep = conn->ep;
+
+	return dlist_empty(&conn->deferred_tx_queue) &&
+	       dlist_empty(&conn->deferred_sar_msgs) &&
+	       dlist_empty(&conn->deferred_sar_segments) &&
+	       !ep->rx_held && ep->tx_credit == ep->rxm_info->tx_attr->size;
+}
+
+static bool rxm_conn_can_close(struct rxm_conn *conn)
+{
+	return conn->states[0] == RXM_CM_CONNECTED &&
+	       (conn->flags & RXM_CONN_INDEXED) &&
+	       (conn->flags & RXM_CONN_CLOSE_OK) &&
+	       conn->num_msg_eps == 1 &&
+	       ofi_addr_cmp(&rxm_prov, &conn->peer->addr.sa,
+			    &conn->ep->addr.sa) &&
+	       rxm_conn_quiescent(conn);
+}
+
+static int rxm_send_conn_close(struct rxm_conn *conn, uint64_t type)
+{
+	struct rxm_deferred_tx_entry *def_tx_entry;
+	struct rxm_tx_buf *tx_buf;
+	struct iovec iov;
+	struct fi_msg msg;
+	ssize_t ret;
+
+	tx_buf = ofi_buf_alloc(conn->ep->tx_pool);
+	if (!tx_buf)
+		return -FI_ENOMEM;
+
+	tx_buf->hdr.state = RXM_CONN_CLOSE_TX;
+	rxm_ep_format_tx_buf_pkt(conn, 0, rxm_ctrl_close, 0, 0, FI_SEND,
+				 &tx_buf->pkt);
+	tx_buf->pkt.ctrl_hdr.type = rxm_ctrl_close;
+	tx_buf->pkt.ctrl_hdr.msg_id = ofi_buf_index(tx_buf);
+	tx_buf->pkt.ctrl_hdr.ctrl_data = type;
+
+	if (conn->states[0] != RXM_CM_CONNECTED &&
+	    conn->states[0] != RXM_CM_CLOSING)
+		goto defer;
+
+	iov.iov_base = &tx_buf->pkt;
+	iov.iov_len = sizeof(struct rxm_pkt);
+	msg.msg_iov = &iov;
+	msg.iov_count = 1;
+	msg.desc = &tx_buf->hdr.desc;
+	msg.addr = 0;
+	msg.context = tx_buf;
+	msg.data = 0;
+
+	ret = fi_sendmsg(conn->msg_eps[0], &msg, OFI_PRIORITY);
+	if (!ret)
+		return 0;
+
+	if (ret != -FI_EAGAIN) {
+		RXM_WARN_ERR(FI_LOG_EP_CTRL, "fi_sendmsg", ret);
+		ofi_buf_free(tx_buf);
+		return (int) ret;
+	}
+
+defer:
+	def_tx_entry = rxm_ep_alloc_deferred_tx_entry(conn->ep, conn,
+						RXM_DEFERRED_TX_CONN_CLOSE);
+	if (!def_tx_entry) {
+		ofi_buf_free(tx_buf);
+		return -FI_ENOMEM;
+	}
+
+	def_tx_entry->close_msg.tx_buf = tx_buf;
+	rxm_queue_deferred_tx(def_tx_entry, OFI_LIST_TAIL);
+	return 0;
+}
+
+/* New transfers to a closing peer return -FI_EAGAIN from rxm_connect. */
+static void rxm_set_conn_closing(struct rxm_conn *conn)
+{
+	struct rxm_ep *ep = conn->ep;
+
+	assert(conn->states[0] == RXM_CM_CONNECTED);
+	conn->states[0] = RXM_CM_CLOSING;
+	dlist_remove(&conn->lru_entry);
+	dlist_insert_tail(&conn->lru_entry, &ep->conn_close_list);
+	ep->conn_cnt--;
+}
+
+static void rxm_cancel_conn_close(struct rxm_conn *conn)
+{
+	struct rxm_ep *ep = conn->ep;
+
+	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "close of conn %p refused\n", conn);
+	assert(conn->states[0] == RXM_CM_CLOSING);
+	if (conn->flags & RXM_CONN_CLOSE_REQ)
+		ep->conn_stats.refused++;
+	conn->flags &= ~(RXM_CONN_CLOSE_REQ | RXM_CONN_CLOSE_IDLE |
+			 RXM_CONN_CLOSE_READY);
+
+	/* Retry no sooner than if the connection had just been used */
+	conn->states[0] = RXM_CM_CONNECTED;
+	conn->last_used = ep->conn_clock;
+	dlist_remove(&conn->lru_entry);
+	dlist_insert_head(&conn->lru_entry, &ep->conn_lru);
+	ep->conn_cnt++;
+}
+
+static int rxm_start_conn_close(struct rxm_conn *conn, bool idle)
+{
+	int ret;
+
+	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "closing %s conn %p\n",
+	       idle ? "idle" : "lru", conn);
+	ret = rxm_send_conn_close(conn, RXM_CLOSE_REQ);
+	if (ret)
+		return ret;
+
+	rxm_set_conn_closing(conn);
+	conn->flags |= RXM_CONN_CLOSE_REQ;
+	if (idle)
+		conn->flags |= RXM_CONN_CLOSE_IDLE;
+	return 0;
+}
+
+/* The conn is kept, so that the peer reconnects through it on next use. */
+static void rxm_finish_conn_close(struct rxm_conn *conn)
+{
+	struct rxm_ep *ep = conn->ep;
+
+	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "closed conn %p\n", conn);
+	if (!(conn->flags & RXM_CONN_CLOSE_REQ))
+		ep->conn_stats.peer_closed++;
+	else if (conn->flags & RXM_CONN_CLOSE_IDLE)
+		ep->conn_stats.idle_closed++;
+	else
+		ep->conn_stats.evicted++;
+
+	rxm_close_conn(conn);
+	conn->flags |= RXM_CONN_EVICTED;
+}
+
+/* A deferred close message could not be sent, so the peer may wait for it
+ * forever.  Close the conn, which the peer sees as a shutdown.
+ */
+void rxm_conn_close_failed(struct rxm_conn *conn)
+{
+	assert(ofi_genlock_held(&conn->ep->util_ep.lock));
+	rxm_finish_conn_close(conn);
+}
+
+/* Close handshake: the side that wants to close sends REQ and stops
+ * issuing transfers.  A quiescent peer answers ACK and stops as well,
+ * otherwise NACK.  Once the ACK arrives, the requester closes its msg
+ * ep, which the peer sees as a shutdown.  Of crossing REQs, the one from
+ * the higher address goes ahead and the other side answers it.
+ */
+ssize_t rxm_handle_conn_close(struct rxm_ep *ep, struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_conn *conn;
+	uint64_t type;
+
+	conn = ep->msg_srx ?
+	       ofi_idm_lookup(&ep->conn_idx_map,
+			      (int) rx_buf->pkt.ctrl_hdr.conn_id) :
+	       rx_buf->conn;
+	type = rx_buf->pkt.ctrl_hdr.ctrl_data;
+	rxm_free_rx_buf(rx_buf);
+
+	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "close %" PRIu64 " for conn %p\n",
+	       type, conn);
+	/* Data may arrive before the connected event is processed, so a
+	 * request must be answered even if the conn is not yet connected.
+	 */
+	if (!conn || !conn->msg_eps || !conn->msg_eps[0])
+		return FI_SUCCESS;
+
+	switch (type) {
+	case RXM_CLOSE_REQ:
+		if (conn->states[0] == RXM_CM_CLOSING) {
+			if (!(conn->flags & RXM_CONN_CLOSE_REQ))
+				break;
+
+			/* crossing requests, as with simultaneous connects */
+			if (ofi_addr_cmp(&rxm_prov, &conn->peer->addr.sa,
+					 &ep->addr.sa) < 0)
+				break;
+
+			/* not counted as refused, the peer answers ours */
+			conn->flags &= ~(RXM_CONN_CLOSE_REQ |
+					 RXM_CONN_CLOSE_IDLE);
+			if (!rxm_conn_quiescent(conn) ||
+			    rxm_send_conn_close(conn, RXM_CLOSE_ACK)) {
+				(void) rxm_send_conn_close(conn,
+							   RXM_CLOSE_NACK);
+				rxm_cancel_conn_close(conn);
+			}
+			break;
+		}
+
+		if (rxm_conn_can_close(conn) &&
+		    !rxm_send_conn_close(conn, RXM_CLOSE_ACK))
+			rxm_set_conn_closing(conn);
+		else
+			(void) rxm_send_conn_close(conn, RXM_CLOSE_NACK);
+		break;
+	case RXM_CLOSE_ACK:
+		if (conn->states[0] != RXM_CM_CLOSING ||
+		    !(conn->flags & RXM_CONN_CLOSE_REQ))
+			break;
+
+		if (rxm_conn_quiescent(conn)) {
+			conn->flags |= RXM_CONN_CLOSE_READY;
+		} else {
+			(void) rxm_send_conn_close(conn, RXM_CLOSE_NACK);
+			rxm_cancel_conn_close(conn);
+		}
+		break;
+	case RXM_CLOSE_NACK:
+		if (conn->states[0] == RXM_CM_CLOSING)
+			rxm_cancel_conn_close(conn);
+		break;
+	default:
+		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL,
+			"unknown close type %" PRIu64 "\n", type);
+		break;
+	}
+	return FI_SUCCESS;
+}
+
+/* Close connections above rxm_max_conns and those idle for longer than
+ * rxm_conn_idle_timeout, starting with the least recently used.
+ */
+static void rxm_reap_conns(struct rxm_ep *ep)
+{
+	struct dlist_entry *entry, *prev;
+	struct rxm_conn *conn;
+	size_t excess;
+	bool idle;
+
+	assert(ofi_genlock_held(&ep->util_ep.lock));
+	dlist_foreach_container_safe(&ep->conn_close_list, struct rxm_conn,
+				     conn, lru_entry, entry) {
+		if (conn->flags & RXM_CONN_CLOSE_READY)
+			rxm_finish_conn_close(conn);
+	}
+
+	if (ep->rx_held || ep->tx_credit != ep->rxm_info->tx_attr->size)
+		return;
+
+	excess = (rxm_max_conns && ep->conn_cnt > rxm_max_conns) ?
+		 ep->conn_cnt - rxm_max_conns : 0;
+
+	for (entry = ep->conn_lru.prev; entry != &ep->conn_lru; entry = prev) {
+		prev = entry->prev;
+		conn = container_of(entry, struct rxm_conn, lru_entry);
+		idle = rxm_conn_idle_timeout &&
+		       ep->conn_clock - conn->last_used >=
+		       rxm_conn_idle_timeout;
+		if (!idle && (!excess || ep->conn_clock - conn->last_used <
+					 RXM_CONN_MIN_IDLE))
+			break;
+
+		if (!rxm_conn_can_close(conn) ||
+		    rxm_start_conn_close(conn, idle))
+			continue;
+
+		if (excess)
+			excess--;
+	}
+}
+
 static void rxm_set_peer_flow_ctrl(struct rxm_conn *conn, int cm_flow_ctrl_flag)
 {
 	switch (cm_flow_ctrl_flag) {
@@ -616,6 +1042,8 @@ void rxm_process_connect(struct rxm_eq_cm_entry *cm_entry)
 		conn->remote_pid = rxm_peer_pid(cm_entry->data.accept.
 						server_conn_id);
 		rxm_set_peer_flow_ctrl(conn, cm_entry->data.accept.flow_ctrl);
+		if (cm_entry->data.accept.rx_size & RXM_CM_CONN_CLOSE)
+			conn->flags |= RXM_CONN_CLOSE_OK;
 	}
 
 	if (conn->flow_ctrl && conn->peer_flow_ctrl) {
@@ -628,6 +1056,10 @@ void rxm_process_connect(struct rxm_eq_cm_entry *cm_entry)
 	conn->ep->connecting_cnt--;
 	assert(conn->ep->connecting_cnt >= 0);
 	conn->states[idx] = RXM_CM_CONNECTED;
+	if (idx == 0) {
+		rxm_eager_conn_done(conn, true);
+		rxm_conn_lru_add(conn);
+	}
 }
 
 static void
@@ -692,6 +1124,7 @@ rxm_process_reject(struct rxm_conn *conn, uint8_t idx,
 		break;
 	case RXM_CM_ACCEPTING:
 	case RXM_CM_CONNECTED:
+	case RXM_CM_CLOSING:
 		/* Our request was rejected, but we accepted the peer's. */
 		break;
 	default:
@@ -756,6 +1189,8 @@ rxm_accept_connreq(struct rxm_conn *conn, uint8_t idx,
 
 	cm_data.accept.server_conn_id = rxm_conn_id(conn->peer->index);
 	cm_data.accept.rx_size = (uint32_t) cm_entry->info->rx_attr->size;
+	if (!rxm_passthru_info(conn->ep->rxm_info))
+		cm_data.accept.rx_size |= RXM_CM_CONN_CLOSE;
 	cm_data.accept.flow_ctrl = conn->flow_ctrl ? RXM_CM_FLOW_CTRL_PEER_ON :
 						     RXM_CM_FLOW_CTRL_PEER_OFF;
 	cm_data.accept.align_pad[0] = 0;
@@ -870,6 +1305,10 @@ rxm_process_connreq(struct rxm_ep *ep, struct rxm_eq_cm_entry *cm_entry)
 			rxm_close_conn(conn);
 		}
 		break;
+	case RXM_CM_CLOSING:
+		/* The peer saw our close before we processed its shutdown */
+		rxm_finish_conn_close(conn);
+		break;
 	default:
 		assert(0);
 		break;
@@ -887,8 +1326,11 @@ rxm_process_connreq(struct rxm_ep *ep, struct rxm_eq_cm_entry *cm_entry)
 	if (ret)
 		goto free;
 
-	if (idx == 0)
+	if (idx == 0) {
 		rxm_set_peer_flow_ctrl(conn, cm_entry->data.connect.flow_ctrl);
+		if (cm_entry->data.connect.rx_size & RXM_CM_CONN_CLOSE)
+			conn->flags |= RXM_CONN_CLOSE_OK;
+	}
 
 	ret = rxm_accept_connreq(conn, idx, cm_entry);
 	if (ret)
@@ -942,6 +1384,9 @@ void rxm_process_shutdown(struct rxm_conn *conn, uint8_t idx)
 		rxm_close_conn(conn);
 		rxm_free_conn(conn);
 		break;
+	case RXM_CM_CLOSING:
+		rxm_finish_conn_close(conn);
+		break;
 	default:
 		break;
 	}
@@ -1029,6 +1474,9 @@ void rxm_conn_progress(struct rxm_ep *ep)
 	ssize_t ret;
 
 	assert(ofi_genlock_held(&ep->util_ep.lock));
+	if (ep->conn_lru_enabled)
+		ep->conn_clock = ofi_gettime_ms();
+
 	do {
 		ret = fi_eq_read(ep->msg_eq, &event, &cm_entry,
 				 sizeof(cm_entry), 0);
@@ -1039,6 +1487,12 @@ void rxm_conn_progress(struct rxm_ep *ep)
 			ret = 1;
 		}
 	} while (ret > 0);
+
+	if (!dlist_empty(&ep->eager_queue))
+		rxm_eager_connect_progress(ep);
+
+	if (ep->conn_lru_enabled)
+		rxm_reap_conns(ep);
 }
 
 void rxm_stop_listen(struct rxm_ep *ep)
@@ -1176,6 +1630,11 @@ int rxm_start_listen(struct rxm_ep *ep)
 	ep->msg_info->src_addrlen = addr_len;
 	ofi_addr_set_port(ep->msg_info->src_addr, 0);
 
+	ofi_genlock_lock(&ep->util_ep.lock);
+	ep->listening = true;
+	rxm_eager_connect_progress(ep);
+	ofi_genlock_unlock(&ep->util_ep.lock);
+
 	if (ep->util_ep.domain->data_progress == FI_PROGRESS_AUTO ||
 	    force_auto_progress) {
 		assert(ep->util_ep.domain->threading == FI_THREAD_SAFE);
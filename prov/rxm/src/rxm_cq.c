@@ -96,27 +96,38 @@ static void rxm_replace_rx_buf(struct rxm_rx_buf *rx_buf)
 		return;
 
 	rx_buf->repost = false;
+	rx_buf->ep->rx_held++;
 	ret = rxm_post_recv(new_rx_buf);
 	if (ret)
 		ofi_buf_free(new_rx_buf);
 }
 
+/* Receives posted by the collective peer complete back to it, not the CQ
+ * or counters */
+static bool rxm_peer_xfer_rx_comp(struct rxm_rx_buf *rx_buf)
+{
+	struct fi_cq_tagged_entry cqe = {0};
+
+	if (!rx_buf->ep->util_coll_peer_xfer_ops ||
+	    !(rx_buf->pkt.hdr.tag & RXM_PEER_XFER_TAG_FLAG))
+		return false;
+
+	cqe.tag = rx_buf->pkt.hdr.tag;
+	cqe.op_context = rx_buf->peer_entry->context;
+	rx_buf->ep->util_coll_peer_xfer_ops->complete(rx_buf->ep->util_coll_ep,
+						      &cqe, 0);
+	return true;
+}
+
 static void rxm_cq_write_recv_comp(struct rxm_rx_buf *rx_buf, void *context,
 				   uint64_t flags, size_t len, char *buf)
 {
 	int ret;
 
 	flags &= ~FI_COMPLETION;
-	if (rx_buf->ep->util_coll_peer_xfer_ops &&
-	    rx_buf->pkt.hdr.tag & RXM_PEER_XFER_TAG_FLAG) {
-		struct fi_cq_tagged_entry cqe = {
-			.tag = rx_buf->pkt.hdr.tag,
-			.op_context = rx_buf->peer_entry->context,
-		};
-		rx_buf->ep->util_coll_peer_xfer_ops->
-			complete(rx_buf->ep->util_coll_ep, &cqe, 0);
+	if (rxm_peer_xfer_rx_comp(rx_buf))
 		return;
-	}
+
 	if (rx_buf->ep->rxm_info->caps & FI_SOURCE)
 		ret = ofi_peer_cq_write(rx_buf->ep->util_ep.rx_cq, context,
 					flags, len, buf, rx_buf->pkt.hdr.data,
@@ -193,6 +204,9 @@ static void rxm_finish_recv(struct rxm_rx_buf *rx_buf, size_t done_len)
 		goto release;
 	}
 
+	if (rxm_peer_xfer_rx_comp(rx_buf))
+		goto release;
+
 	if (rx_buf->peer_entry->flags & FI_COMPLETION ||
 	    rx_buf->ep->rxm_info->mode & OFI_BUFFERED_RECV) {
 		rxm_cq_write_recv_comp(rx_buf, rx_buf->peer_entry->context,
@@ -207,6 +221,23 @@ release:
 	rxm_free_rx_buf(rx_buf);
 }
 
+/* Sends issued by the collective peer complete back to it, not the CQ */
+static bool rxm_peer_xfer_tx_comp(struct rxm_ep *rxm_ep, uint64_t tag,
+				  void *app_context)
+{
+	struct fi_cq_tagged_entry cqe = {
+		.tag = tag,
+		.op_context = app_context,
+	};
+
+	if (!rxm_ep->util_coll_ep || !(tag & RXM_PEER_XFER_TAG_FLAG))
+		return false;
+
+	rxm_ep->util_coll_peer_xfer_ops->complete(rxm_ep->util_coll_ep,
+						  &cqe, 0);
+	return true;
+}
+
 static void
 rxm_cq_write_tx_comp(struct rxm_ep *rxm_ep, uint64_t comp_flags,
 		     void *app_context,  uint64_t flags)
@@ -279,15 +310,19 @@ static void rxm_handle_sar_comp(struct rxm_ep *rxm_ep,
 				struct rxm_tx_buf *tx_buf)
 {
 	void *app_context;
-	uint64_t comp_flags, tx_flags;
+	uint64_t comp_flags, tx_flags, tag;
 
 	app_context = tx_buf->app_context;
 	comp_flags = ofi_tx_cq_flags(tx_buf->pkt.hdr.op);
 	tx_flags = tx_buf->flags;
+	tag = tx_buf->pkt.hdr.tag;
 
 	if (!rxm_complete_sar(rxm_ep, tx_buf))
 		return;
 
+	if (rxm_peer_xfer_tx_comp(rxm_ep, tag, app_context))
+		return;
+
 	rxm_cq_write_tx_comp(rxm_ep, comp_flags, app_context, tx_flags);
 	ofi_ep_peer_tx_cntr_inc(&rxm_ep->util_ep, ofi_op_msg);
 }
@@ -319,8 +354,11 @@ static void rxm_rndv_tx_finish(struct rxm_ep *rxm_ep,
 	if (!rxm_ep->rdm_mr_local)
 		rxm_msg_mr_closev(tx_buf->rma.mr, tx_buf->rma.count);
 
-	rxm_cq_write_tx_comp(rxm_ep, ofi_tx_cq_flags(tx_buf->pkt.hdr.op),
-			     tx_buf->app_context, tx_buf->flags);
+	if (!rxm_peer_xfer_tx_comp(rxm_ep, tx_buf->pkt.hdr.tag,
+				   tx_buf->app_context))
+		rxm_cq_write_tx_comp(rxm_ep,
+				     ofi_tx_cq_flags(tx_buf->pkt.hdr.op),
+				     tx_buf->app_context, tx_buf->flags);
 
 	if (rxm_ep->rndv_ops == &rxm_rndv_ops_write &&
 	    tx_buf->write_rndv.done_buf) {
@@ -858,19 +896,7 @@ void rxm_handle_coll_eager(struct rxm_rx_buf *rx_buf)
 					rx_buf->data, rx_buf->pkt.hdr.size);
 	assert((size_t) done_len == rx_buf->pkt.hdr.size);
 
-	if (rx_buf->ep->util_coll_peer_xfer_ops &&
-	    rx_buf->pkt.hdr.tag & RXM_PEER_XFER_TAG_FLAG) {
-		struct fi_cq_tagged_entry cqe = {
-			.tag = rx_buf->pkt.hdr.tag,
-			.op_context = rx_buf->peer_entry->context,
-		};
-		rx_buf->ep->util_coll_peer_xfer_ops->
-			complete(rx_buf->ep->util_coll_ep, &cqe, 0);
-		rx_buf->ep->srx->owner_ops->free_entry(rx_buf->peer_entry);
-		rxm_free_rx_buf(rx_buf);
-	} else {
-		rxm_finish_recv(rx_buf, done_len);
-	}
+	rxm_finish_recv(rx_buf, done_len);
 }
 
 ssize_t rxm_handle_rx_buf(struct rxm_rx_buf *rx_buf)
@@ -1527,20 +1553,23 @@ static ssize_t rxm_handle_credit(struct rxm_ep *rxm_ep, struct rxm_rx_buf *rx_bu
 	return FI_SUCCESS;
 }
 
+static void rxm_touch_rx_conn(struct rxm_ep *rxm_ep, struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_conn *conn;
+
+	conn = rx_buf->conn ? rx_buf->conn :
+	       ofi_idm_lookup(&rxm_ep->conn_idx_map,
+			      (int) rx_buf->pkt.ctrl_hdr.conn_id);
+	if (conn)
+		rxm_conn_touch(conn);
+}
+
 void rxm_finish_coll_eager_send(struct rxm_ep *rxm_ep,
 			        struct rxm_tx_buf *tx_eager_buf)
 {
-	if (rxm_ep->util_coll_ep &&
-	    (tx_eager_buf->pkt.hdr.tag & RXM_PEER_XFER_TAG_FLAG)) {
-		struct fi_cq_tagged_entry cqe = {
-			.tag = tx_eager_buf->pkt.hdr.tag,
-			.op_context = tx_eager_buf->app_context,
-		};
-		rxm_ep->util_coll_peer_xfer_ops->
-			complete(rxm_ep->util_coll_ep, &cqe, 0);
-	} else {
+	if (!rxm_peer_xfer_tx_comp(rxm_ep, tx_eager_buf->pkt.hdr.tag,
+				   tx_eager_buf->app_context))
 		rxm_finish_eager_send(rxm_ep, tx_eager_buf);
-	}
 }
 
 ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
@@ -1563,6 +1592,7 @@ ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 		rxm_free_tx_buf(rxm_ep, tx_buf);
 		return 0;
 	case RXM_CREDIT_TX:
+	case RXM_CONN_CLOSE_TX:
 		tx_buf = comp->op_context;
 		assert(comp->flags & FI_SEND);
 		ofi_buf_free(tx_buf);
@@ -1579,6 +1609,9 @@ ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 		assert((rx_buf->pkt.hdr.version == OFI_OP_VERSION) &&
 		       (rx_buf->pkt.ctrl_hdr.version == RXM_CTRL_VERSION));
 
+		if (!dlist_empty(&rxm_ep->conn_lru))
+			rxm_touch_rx_conn(rxm_ep, rx_buf);
+
 		switch (rx_buf->pkt.ctrl_hdr.type) {
 		case rxm_ctrl_eager:
 		case rxm_ctrl_rndv_req:
@@ -1598,6 +1631,8 @@ ssize_t rxm_handle_comp(struct rxm_ep *rxm_ep, struct fi_cq_data_entry *comp)
 			return rxm_handle_atomic_resp(rxm_ep, rx_buf);
 		case rxm_ctrl_credit:
 			return rxm_handle_credit(rxm_ep, rx_buf);
+		case rxm_ctrl_close:
+			return rxm_handle_conn_close(rxm_ep, rx_buf);
 		default:
 			FI_WARN(&rxm_prov, FI_LOG_CQ, "Unknown message type\n");
 			assert(0);
@@ -1798,6 +1833,7 @@ void rxm_handle_comp_error(struct rxm_ep *rxm_ep)
 			cntr->peer_cntr->owner_ops->incerr(cntr->peer_cntr);
 		return;
 	case RXM_CREDIT_TX:
+	case RXM_CONN_CLOSE_TX:
 	case RXM_ATOMIC_RESP_SENT: /* BUG: should have consumed tx credit */
 		tx_buf = err_entry.op_context;
 		ofi_buf_free(tx_buf);
@@ -260,6 +260,7 @@ rxm_av_open(struct fid_domain *domain_fid, struct fi_av_attr *attr,
 	ret = rxm_util_av_open(domain_fid, attr, &fid_av_new,
 			context, sizeof(struct rxm_conn),
 			ofi_av_remove_cleanup ? rxm_av_remove_handler : NULL,
+			rxm_eager_connect ? rxm_av_insert_handler : NULL,
 			&rxm_foreach_ep);
 	if (ret)
 		return ret;
@@ -308,8 +309,19 @@ rxm_cntr_open(struct fid_domain *fid_domain, struct fi_cntr_attr *attr,
 	if (!cntr)
 		return -FI_ENOMEM;
 
-	ret = ofi_cntr_init(&rxm_prov, fid_domain, attr, &cntr->util_cntr,
-			    &ofi_cntr_progress, context);
+	/* With auto progress, the endpoint progress threads update the
+	 * counter, so waiters do not need to drive progress.
+	 */
+	if (!domain->passthru &&
+	    (domain->util_domain.data_progress == FI_PROGRESS_AUTO ||
+	     force_auto_progress))
+		ret = ofi_cntr_init_auto_progress(&rxm_prov, fid_domain, attr,
+						  &cntr->util_cntr,
+						  &ofi_cntr_progress, context);
+	else
+		ret = ofi_cntr_init(&rxm_prov, fid_domain, attr,
+				    &cntr->util_cntr, &ofi_cntr_progress,
+				    context);
 	if (ret)
 		goto free;
 
@@ -411,9 +423,9 @@ struct rxm_mr *rxm_mr_get_map_entry(struct rxm_domain *domain, uint64_t key)
 {
 	struct rxm_mr *mr;
 
-	ofi_genlock_lock(&domain->util_domain.lock);
+	ofi_genlock_rdlock(&domain->util_domain.lock);
 	mr = ofi_mr_map_get(&domain->util_domain.mr_map, key);
-	ofi_genlock_unlock(&domain->util_domain.lock);
+	ofi_genlock_rdunlock(&domain->util_domain.lock);
 
 	return mr;
 }
@@ -454,11 +466,20 @@ static int rxm_domain_close(fid_t fid)
 	return 0;
 }
 
+static int rxm_domain_ctrl(struct fid *fid, int command, void *arg)
+{
+	struct rxm_domain *rxm_domain;
+
+	rxm_domain = container_of(fid, struct rxm_domain,
+				  util_domain.domain_fid.fid);
+	return ofi_trigger_control(&rxm_domain->util_domain, command, arg);
+}
+
 static struct fi_ops rxm_domain_fi_ops = {
 	.size = sizeof(struct fi_ops),
 	.close = rxm_domain_close,
 	.bind = fi_no_bind,
-	.control = fi_no_control,
+	.control = rxm_domain_ctrl,
 	.ops_open = fi_no_ops_open,
 };
 
@@ -919,7 +940,7 @@ int rxm_domain_open(struct fid_fabric *fabric, struct fi_info *info,
 		goto err2;
 
 	ret = ofi_domain_init(fabric, info, &rxm_domain->util_domain, context,
-			      OFI_LOCK_MUTEX);
+			      OFI_LOCK_SHARDED);
 	if (ret) {
 		goto err3;
 	}
@@ -126,7 +126,8 @@ static int rxm_ep_create_pools(struct rxm_ep *rxm_ep)
 	attr.free_fn = rxm_buf_close;
 	attr.init_fn = rxm_init_rx_buf;
 	attr.context = rxm_ep;
-	attr.flags = OFI_BUFPOOL_NO_TRACK;
+	attr.flags = OFI_BUFPOOL_NO_TRACK | OFI_BUFPOOL_MAGAZINE;
+	ofi_bufpool_param_get(&rxm_prov, &attr);
 
 	ret = ofi_bufpool_create_attr(&attr, &rxm_ep->rx_pool);
 	if (ret) {
@@ -156,6 +157,8 @@ static int rxm_ep_create_pools(struct rxm_ep *rxm_ep)
 	attr.alloc_fn = NULL;
 	attr.free_fn = NULL;
 	attr.init_fn = NULL;
+	attr.flags = OFI_BUFPOOL_NO_TRACK;
+	attr.page_size = 0;
 	ret = ofi_bufpool_create_attr(&attr, &rxm_ep->proto_info_pool);
 	if (ret) {
 		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL,
@@ -527,7 +530,8 @@ void rxm_ep_progress_deferred_queue(struct rxm_ep *rxm_ep,
 	struct fi_msg msg;
 	ssize_t ret = 0;
 
-	if (rxm_conn->states[0] != RXM_CM_CONNECTED)
+	if (rxm_conn->states[0] != RXM_CM_CONNECTED &&
+	    rxm_conn->states[0] != RXM_CM_CLOSING)
 		return;
 
 	while (!dlist_empty(&rxm_conn->deferred_tx_queue) && !ret) {
@@ -654,6 +658,33 @@ void rxm_ep_progress_deferred_queue(struct rxm_ep *rxm_ep,
 				return;
 			}
 			break;
+		case RXM_DEFERRED_TX_CONN_CLOSE:
+			/* May have been queued before remote_index was known */
+			def_tx_entry->close_msg.tx_buf->pkt.ctrl_hdr.conn_id =
+				rxm_conn->remote_index;
+			iov.iov_base = &def_tx_entry->close_msg.tx_buf->pkt;
+			iov.iov_len = sizeof(struct rxm_pkt);
+
+			msg.addr = 0;
+			msg.context = def_tx_entry->close_msg.tx_buf;
+			msg.data = 0;
+			msg.desc = &def_tx_entry->close_msg.tx_buf->hdr.desc;
+			msg.iov_count = 1;
+			msg.msg_iov = &iov;
+
+			ret = fi_sendmsg(def_tx_entry->rxm_conn->msg_eps[0],
+					 &msg, OFI_PRIORITY);
+			if (ret) {
+				if (ret == -FI_EAGAIN)
+					return;
+				RXM_WARN_ERR(FI_LOG_EP_CTRL, "fi_sendmsg", ret);
+				ofi_buf_free(def_tx_entry->close_msg.tx_buf);
+				rxm_dequeue_deferred_tx(def_tx_entry);
+				free(def_tx_entry);
+				rxm_conn_close_failed(rxm_conn);
+				return;
+			}
+			break;
 		}
 
 		rxm_dequeue_deferred_tx(def_tx_entry);
@@ -832,18 +863,130 @@ ssize_t rxm_ep_broadcast(struct fid_ep *ep, void *buf, size_t count,
 	return ret;
 }
 
+ssize_t rxm_ep_alltoall(struct fid_ep *ep, const void *buf, size_t count,
+			void *desc, void *result, void *result_desc,
+			fi_addr_t coll_addr, enum fi_datatype datatype,
+			uint64_t flags, void *context)
+{
+	struct rxm_ep *rxm_ep;
+	struct fid_ep *coll_ep;
+	struct rxm_coll_buf *req;
+	ssize_t ret;
+
+        rxm_ep = container_of(ep, struct rxm_ep, util_ep.ep_fid.fid);
+
+	ret = rxm_ep_init_coll_req(rxm_ep, FI_ALLTOALL, flags, context,
+				   &req, &coll_ep);
+	if (ret)
+		return ret;
+
+	flags &= ~FI_PEER_TRANSFER;
+
+	ret = fi_alltoall(coll_ep, buf, count, desc, result, result_desc,
+			  coll_addr, datatype, flags, req);
+	if (ret)
+		rxm_ep_free_coll_req(rxm_ep, req);
+
+	return ret;
+}
+
+ssize_t rxm_ep_reduce_scatter(struct fid_ep *ep, const void *buf,
+			      size_t count, void *desc, void *result,
+			      void *result_desc, fi_addr_t coll_addr,
+			      enum fi_datatype datatype, enum fi_op op,
+			      uint64_t flags, void *context)
+{
+	struct rxm_ep *rxm_ep;
+	struct fid_ep *coll_ep;
+	struct rxm_coll_buf *req;
+	ssize_t ret;
+
+        rxm_ep = container_of(ep, struct rxm_ep, util_ep.ep_fid.fid);
+
+	ret = rxm_ep_init_coll_req(rxm_ep, FI_REDUCE_SCATTER, flags, context,
+				   &req, &coll_ep);
+	if (ret)
+		return ret;
+
+	flags &= ~FI_PEER_TRANSFER;
+
+	ret = fi_reduce_scatter(coll_ep, buf, count, desc, result,
+				result_desc, coll_addr, datatype, op, flags,
+				req);
+	if (ret)
+		rxm_ep_free_coll_req(rxm_ep, req);
+
+	return ret;
+}
+
+ssize_t rxm_ep_reduce(struct fid_ep *ep, const void *buf, size_t count,
+		      void *desc, void *result, void *result_desc,
+		      fi_addr_t coll_addr, fi_addr_t root_addr,
+		      enum fi_datatype datatype, enum fi_op op,
+		      uint64_t flags, void *context)
+{
+	struct rxm_ep *rxm_ep;
+	struct fid_ep *coll_ep;
+	struct rxm_coll_buf *req;
+	ssize_t ret;
+
+        rxm_ep = container_of(ep, struct rxm_ep, util_ep.ep_fid.fid);
+
+	ret = rxm_ep_init_coll_req(rxm_ep, FI_REDUCE, flags, context,
+				   &req, &coll_ep);
+	if (ret)
+		return ret;
+
+	flags &= ~FI_PEER_TRANSFER;
+
+	ret = fi_reduce(coll_ep, buf, count, desc, result, result_desc,
+			coll_addr, root_addr, datatype, op, flags, req);
+	if (ret)
+		rxm_ep_free_coll_req(rxm_ep, req);
+
+	return ret;
+}
+
+ssize_t rxm_ep_gather(struct fid_ep *ep, const void *buf, size_t count,
+		      void *desc, void *result, void *result_desc,
+		      fi_addr_t coll_addr, fi_addr_t root_addr,
+		      enum fi_datatype datatype, uint64_t flags,
+		      void *context)
+{
+	struct rxm_ep *rxm_ep;
+	struct fid_ep *coll_ep;
+	struct rxm_coll_buf *req;
+	ssize_t ret;
+
+        rxm_ep = container_of(ep, struct rxm_ep, util_ep.ep_fid.fid);
+
+	ret = rxm_ep_init_coll_req(rxm_ep, FI_GATHER, flags, context,
+				   &req, &coll_ep);
+	if (ret)
+		return ret;
+
+	flags &= ~FI_PEER_TRANSFER;
+
+	ret = fi_gather(coll_ep, buf, count, desc, result, result_desc,
+			coll_addr, root_addr, datatype, flags, req);
+	if (ret)
+		rxm_ep_free_coll_req(rxm_ep, req);
+
+	return ret;
+}
+
 static struct fi_ops_collective rxm_ops_collective = {
 	.size = sizeof(struct fi_ops_collective),
 	.barrier = rxm_ep_barrier,
 	.barrier2 = rxm_ep_barrier2,
 	.broadcast = rxm_ep_broadcast,
-	.alltoall = fi_coll_no_alltoall,
+	.alltoall = rxm_ep_alltoall,
 	.allreduce = rxm_ep_allreduce,
 	.allgather = rxm_ep_allgather,
-	.reduce_scatter = fi_coll_no_reduce_scatter,
-	.reduce = fi_coll_no_reduce,
+	.reduce_scatter = rxm_ep_reduce_scatter,
+	.reduce = rxm_ep_reduce,
 	.scatter = rxm_ep_scatter,
-	.gather = fi_coll_no_gather,
+	.gather = rxm_ep_gather,
 	.msg = fi_coll_no_msg,
 };
 
@@ -894,6 +1037,7 @@ static int rxm_ep_close(struct fid *fid)
 	int ret;
 
 	ep = container_of(fid, struct rxm_ep, util_ep.ep_fid.fid);
+	ofi_trigger_ep_cleanup(&ep->util_ep);
 
 	/* Stop listener thread to halt event processing before closing all
 	 * connections.
@@ -1399,6 +1543,10 @@ static int rxm_ep_ctrl(struct fid *fid, int command, void *arg)
 				goto err;
 		}
 
+		/* queue eager connections to peers inserted before binding */
+		if (ep->util_ep.av)
+			rxm_av_notify_ep(ep->util_ep.av, &ep->util_ep);
+
 		ret = rxm_start_listen(ep);
 		if (ret)
 			goto err;
@@ -1780,6 +1928,12 @@ int rxm_endpoint(struct fid_domain *domain, struct fi_info *info,
 		(*ep_fid)->atomic = &rxm_ops_atomic;
 
 	dlist_init(&rxm_ep->loopback_list);
+	dlist_init(&rxm_ep->eager_queue);
+	dlist_init(&rxm_ep->conn_lru);
+	dlist_init(&rxm_ep->conn_close_list);
+	rxm_ep->conn_lru_enabled = (rxm_max_conns || rxm_conn_idle_timeout) &&
+				   rxm_num_msg_eps == 1 &&
+				   !rxm_passthru_info(rxm_ep->rxm_info);
 
 	return 0;
 err2:
@@ -61,6 +61,9 @@ int rxm_use_write_rndv;
 int rxm_detect_hmem_iface;
 int rxm_rescan = -1;
 size_t rxm_num_msg_eps = 1;
+size_t rxm_eager_connect;
+size_t rxm_max_conns;
+size_t rxm_conn_idle_timeout;
 enum fi_wait_obj def_wait_obj = FI_WAIT_FD, def_tcp_wait_obj = FI_WAIT_UNSPEC;
 
 char *rxm_proto_state_str[] = {
@@ -716,6 +719,25 @@ RXM_INI
 			"Values are clamped to the range [1, 255]. "
 			"(default: 1)");
 
+	fi_param_define(&rxm_prov, "eager_connect", FI_PARAM_SIZE_T,
+			"Connect to peers in the background as they are "
+			"inserted into the AV, rather than on the first "
+			"transfer to each peer.  The value bounds the number "
+			"of connections that are established concurrently. "
+			"(default: 0, connect on first use)");
+
+	fi_param_define(&rxm_prov, "max_conns", FI_PARAM_SIZE_T,
+			"Soft limit on the number of connections kept open "
+			"per endpoint.  Above the limit, the least recently "
+			"used connections are closed while the endpoint is "
+			"idle, and are re-established on next use. "
+			"(default: 0, unlimited)");
+
+	fi_param_define(&rxm_prov, "conn_idle_timeout", FI_PARAM_SIZE_T,
+			"Close connections that have not carried traffic "
+			"for this many milliseconds.  Closed connections are "
+			"re-established on next use. (default: 0, disabled)");
+
 	fi_param_define(&rxm_prov, "rescan", FI_PARAM_BOOL,
 			"Force or disable rescanning for network interface changes. "
 			"Setting this to true will force rescanning on each fi_getinfo() invocation; "
@@ -727,6 +749,8 @@ RXM_INI
 	 */
 	fi_param_get_bool(&rxm_prov, "enable_passthru", &rxm_passthru);
 
+	ofi_bufpool_param_define(&rxm_prov);
+
 	rxm_init_infos();
 	fi_param_get_size_t(&rxm_prov, "msg_tx_size", &rxm_msg_tx_size);
 	fi_param_get_size_t(&rxm_prov, "msg_rx_size", &rxm_msg_rx_size);
@@ -749,6 +773,10 @@ RXM_INI
 	fi_param_get_bool(&rxm_prov, "detect_hmem_iface", &rxm_detect_hmem_iface);
 	fi_param_get_bool(&rxm_prov, "rescan", &rxm_rescan);
 	fi_param_get_size_t(&rxm_prov, "num_msg_eps", &rxm_num_msg_eps);
+	fi_param_get_size_t(&rxm_prov, "eager_connect", &rxm_eager_connect);
+	fi_param_get_size_t(&rxm_prov, "max_conns", &rxm_max_conns);
+	fi_param_get_size_t(&rxm_prov, "conn_idle_timeout",
+			    &rxm_conn_idle_timeout);
 	if (rxm_num_msg_eps < 1)
 		rxm_num_msg_eps = 1;
 	if (rxm_num_msg_eps > UINT8_MAX)
@@ -46,6 +46,9 @@ rxm_recvmsg(struct fid_ep *ep_fid, const struct fi_msg *msg, uint64_t flags)
 	struct rxm_ep *rxm_ep = container_of(ep_fid, struct rxm_ep,
 					     util_ep.ep_fid.fid);
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_msg(ep_fid, msg, flags, FI_OP_RECV);
+
 	return util_srx_generic_recv(&rxm_ep->srx->ep_fid, msg->msg_iov,
 				     msg->desc, msg->iov_count, msg->addr,
 				     msg->context,
@@ -553,6 +556,9 @@ rxm_sendmsg(struct fid_ep *ep_fid, const struct fi_msg *msg, uint64_t flags)
 	struct rxm_ep *rxm_ep;
 	ssize_t ret;
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_msg(ep_fid, msg, flags, FI_OP_SEND);
+
 	rxm_ep = container_of(ep_fid, struct rxm_ep, util_ep.ep_fid.fid);
 	ofi_genlock_lock(&rxm_ep->util_ep.lock);
 	ret = rxm_get_conn(rxm_ep, msg->addr, &rxm_conn);
@@ -755,6 +761,9 @@ rxm_recvmsg_thru(struct fid_ep *ep_fid, const struct fi_msg *msg,
 	struct rxm_ep *ep;
 	ssize_t ret;
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_msg(ep_fid, msg, flags, FI_OP_RECV);
+
 	ep = container_of(ep_fid, struct rxm_ep, util_ep.ep_fid.fid);
 	assert(ep->msg_srx);
 
@@ -814,6 +823,9 @@ rxm_sendmsg_thru(struct fid_ep *ep_fid, const struct fi_msg *msg,
 	struct rxm_ep *ep;
 	ssize_t ret;
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_msg(ep_fid, msg, flags, FI_OP_SEND);
+
 	ep = container_of(ep_fid, struct rxm_ep, util_ep.ep_fid.fid);
 	ofi_genlock_lock(&ep->util_ep.lock);
 
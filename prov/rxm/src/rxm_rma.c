@@ -120,6 +120,9 @@ rxm_ep_readmsg(struct fid_ep *ep_fid, const struct fi_msg_rma *msg,
 {
 	struct rxm_ep *rxm_ep;
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_rma(ep_fid, msg, flags, FI_OP_READ);
+
 	rxm_ep = container_of(ep_fid, struct rxm_ep, util_ep.ep_fid.fid);
 	return rxm_ep_rma_common(rxm_ep, msg, flags | rxm_ep->util_ep.tx_msg_flags,
 				 fi_readmsg, FI_READ);
@@ -337,6 +340,9 @@ rxm_ep_writemsg(struct fid_ep *ep_fid, const struct fi_msg_rma *msg,
 {
 	struct rxm_ep *rxm_ep;
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_rma(ep_fid, msg, flags, FI_OP_WRITE);
+
 	rxm_ep = container_of(ep_fid, struct rxm_ep, util_ep.ep_fid.fid);
 	return rxm_ep_generic_writemsg(ep_fid, msg, flags |
 				       rxm_ep->util_ep.tx_msg_flags);
@@ -51,6 +51,9 @@ rxm_trecvmsg(struct fid_ep *ep_fid, const struct fi_msg_tagged *msg,
 	struct rxm_ep *rxm_ep = container_of(ep_fid, struct rxm_ep,
 					     util_ep.ep_fid.fid);
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_tagged(ep_fid, msg, flags, FI_OP_TRECV);
+
 	if (flags & FI_PEER_TRANSFER)
 		tag |= RXM_PEER_XFER_TAG_FLAG;
 
@@ -98,6 +101,9 @@ rxm_tsendmsg(struct fid_ep *ep_fid, const struct fi_msg_tagged *msg,
 	struct rxm_ep *rxm_ep;
 	ssize_t ret;
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_tagged(ep_fid, msg, flags, FI_OP_TSEND);
+
 	rxm_ep = container_of(ep_fid, struct rxm_ep, util_ep.ep_fid.fid);
 	ofi_genlock_lock(&rxm_ep->util_ep.lock);
 	ret = rxm_get_conn(rxm_ep, msg->addr, &rxm_conn);
@@ -306,6 +312,9 @@ rxm_trecvmsg_thru(struct fid_ep *ep_fid, const struct fi_msg_tagged *msg,
 	struct rxm_ep *ep;
 	ssize_t ret;
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_tagged(ep_fid, msg, flags, FI_OP_TRECV);
+
 	ep = container_of(ep_fid, struct rxm_ep, util_ep.ep_fid.fid);
 	assert(ep->msg_srx);
 
@@ -368,6 +377,9 @@ rxm_tsendmsg_thru(struct fid_ep *ep_fid, const struct fi_msg_tagged *msg,
 	struct rxm_ep *ep;
 	ssize_t ret;
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_tagged(ep_fid, msg, flags, FI_OP_TSEND);
+
 	ep = container_of(ep_fid, struct rxm_ep, util_ep.ep_fid.fid);
 	ofi_genlock_lock(&ep->util_ep.lock);
 
@@ -956,11 +956,16 @@ out:
 
 static int smr_create_pools(struct smr_ep *ep, struct fi_info *info)
 {
+	struct ofi_bufpool_attr attr = {
+		.size		= sizeof(struct smr_cmd_ctx),
+		.alignment	= 16,
+		.chunk_cnt	= info->rx_attr->size,
+		.flags		= OFI_BUFPOOL_NO_TRACK,
+	};
 	int ret;
 
-	ret = ofi_bufpool_create(&ep->cmd_ctx_pool, sizeof(struct smr_cmd_ctx),
-				 16, 0, info->rx_attr->size,
-				 OFI_BUFPOOL_NO_TRACK);
+	ofi_bufpool_param_get(&smr_prov, &attr);
+	ret = ofi_bufpool_create_attr(&attr, &ep->cmd_ctx_pool);
 	if (ret)
 		goto err;
 
@@ -974,9 +979,9 @@ static int smr_create_pools(struct smr_ep *ep, struct fi_info *info)
 	if (ret)
 		goto free2;
 
-	ret = ofi_bufpool_create(&ep->pend_pool,
-				 sizeof(struct smr_pend_entry),
-				 16, 0, ep->tx_size, OFI_BUFPOOL_NO_TRACK);
+	attr.size = sizeof(struct smr_pend_entry);
+	attr.chunk_cnt = ep->tx_size;
+	ret = ofi_bufpool_create_attr(&attr, &ep->pend_pool);
 	if (ret)
 		goto free1;
 
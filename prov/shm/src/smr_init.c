@@ -231,6 +231,7 @@ SHM_INI
 	fi_param_define(&smr_prov, "buffer_threshold", FI_PARAM_SIZE_T,
 			"When to start requesting forced unexpected messaging "
 			"buffering. (default: 1)");
+	ofi_bufpool_param_define(&smr_prov);
 
 	smr_init_env();
 
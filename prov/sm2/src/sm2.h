@@ -75,13 +75,18 @@
 #define SM2_IOV_LIMIT		4
 #define SM2_PREFIX		"fi_sm2://"
 #define SM2_PREFIX_NS		"fi_ns://"
-#define SM2_VERSION		1
+#define SM2_VERSION		2
 #define SM2_IOV_LIMIT		4
 #define SM2_INJECT_SIZE		(SM2_XFER_ENTRY_SIZE - sizeof(struct sm2_xfer_hdr))
 
 #define SM2_ATOMIC_INJECT_SIZE	    (SM2_INJECT_SIZE - sizeof(struct sm2_atomic_hdr))
 #define SM2_ATOMIC_COMP_INJECT_SIZE (SM2_ATOMIC_INJECT_SIZE / 2)
 
+#define SM2_SAR_SEG_SIZE	(SM2_INJECT_SIZE - 2 * sizeof(uint64_t))
+#define SM2_SAR_THRESHOLD	(256 * 1024)
+/* Leave most of the freestack to other peers and protocols */
+#define SM2_SAR_MAX_SIZE	(SM2_SAR_SEG_SIZE * SM2_NUM_XFER_ENTRY_PER_PEER / 4)
+
 extern struct fi_provider sm2_prov;
 extern struct fi_info sm2_info;
 extern struct util_prov sm2_util_prov;
@@ -89,10 +94,17 @@ extern int sm2_global_ep_idx; // protected by the ep_list_lock
 
 extern pthread_mutex_t sm2_ep_list_lock;
 
+struct sm2_env {
+	size_t sar_threshold;
+};
+
+extern struct sm2_env sm2_env;
+
 enum {
 	sm2_proto_inject,
 	sm2_proto_cma,
 	sm2_proto_ipc,
+	sm2_proto_sar,
 	sm2_proto_max,
 };
 
@@ -128,6 +140,9 @@ completions instead of waiting for the application to post the receive buffer.
 #define SM2_CMA_HOST_TO_DEV	(1 << 4)
 #define SM2_CMA_HOST_TO_DEV_ACK (1 << 5)
 
+/* Protocol flags for SM2 SAR protocol */
+#define SM2_SAR_ABORT (1 << 6)
+
 /*
  * 	next - fifo linked list next ptr
  * 		This is volatile for a reason, many things touch this
@@ -144,6 +159,7 @@ completions instead of waiting for the application to post the receive buffer.
  * 	sender_gid - id of msg sender
  * 	user_data - Protocol dependent data. For inject, it's the message.
  * 				For CMA protocol, it's struct sm2_cma_data.
+ * 				For SAR protocol, it's struct sm2_sar_data.
  */
 struct sm2_xfer_hdr {
 	volatile long int next;
@@ -196,6 +212,30 @@ struct sm2_cma_data {
 	struct fi_peer_rx_entry *rx_entry;
 };
 
+/*
+ * SAR (segmentation and reassembly) copies messages that are too large to
+ * inject through a series of xfer_entries taken from the sender's freestack.
+ * Each segment is written to the peer's FIFO as soon as it is filled, so the
+ * receiver drains earlier segments while later ones are still being copied.
+ * hdr.size holds the total message size in every segment.  Segments of one
+ * message are never interleaved with other messages from the same sender.
+ */
+struct sm2_sar_data {
+	uint64_t offset;
+	uint64_t len;
+	uint8_t buf[SM2_SAR_SEG_SIZE];
+};
+
+/* Receive side state of the SAR message in flight from one peer.  Data goes
+ * to rx_entry if the message matched a posted receive, to xfer_ctx->sar_buf
+ * if it is unexpected and is dropped if neither is set (discarded message).
+ */
+struct sm2_sar_rx {
+	struct fi_peer_rx_entry *rx_entry;
+	struct sm2_xfer_ctx *xfer_ctx;
+	int err;
+};
+
 struct sm2_ep_name {
 	char name[OFI_NAME_MAX];
 	struct sm2_region *region;
@@ -248,6 +288,9 @@ static inline void sm2_generic_format(struct sm2_xfer_entry *xfer_entry,
 struct sm2_xfer_ctx {
 	struct dlist_entry entry;
 	struct sm2_ep *ep;
+	/* Unexpected SAR messages are reassembled here */
+	void *sar_buf;
+	size_t sar_bytes;
 	struct sm2_xfer_entry xfer_entry;
 };
 
@@ -268,6 +311,7 @@ struct sm2_ep {
 	struct fid_ep *srx;
 	struct ofi_bufpool *xfer_ctx_pool;
 	int ep_idx;
+	struct sm2_sar_rx sar_rx[SM2_MAX_UNIVERSE_SIZE];
 };
 
 static inline struct fid_peer_srx *sm2_get_peer_srx(struct sm2_ep *ep)
@@ -318,6 +362,8 @@ void sm2_ep_progress(struct util_ep *util_ep);
 
 void sm2_progress_recv(struct sm2_ep *ep);
 
+void sm2_sar_discard(struct sm2_xfer_ctx *xfer_ctx);
+
 int sm2_unexp_start(struct fi_peer_rx_entry *rx_entry);
 
 static inline struct sm2_region *sm2_peer_region(struct sm2_ep *ep, int id)
@@ -34,6 +34,7 @@
 #include "sm2.h"
 #include "sm2_atom.h"
 #include <fcntl.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
@@ -334,190 +335,358 @@ early_exit:
 	return -FI_ENOMEM;
 }
 
+static inline uint32_t sm2_name_hash(const char *name)
+{
+	uint32_t hash = 2166136261U;
+	int i;
+
+	/* FNV-1a */
+	for (i = 0; i < OFI_NAME_MAX && name[i]; i++) {
+		hash ^= (uint8_t) name[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static inline void sm2_slot_set_name(struct sm2_ep_allocation_entry *entry,
+				     const char *name)
+{
+	strncpy(entry->ep_name, name, OFI_NAME_MAX - 1);
+	entry->ep_name[OFI_NAME_MAX - 1] = '\0';
+	entry->name_hash = sm2_name_hash(entry->ep_name);
+}
+
+static inline int sm2_slot_owner(uintptr_t state)
+{
+	return (int) (state >> SM2_SLOT_OWNER_SHIFT);
+}
+
+static inline uintptr_t sm2_slot_busy_state(uintptr_t state)
+{
+	return (state & SM2_SLOT_GEN_MASK) |
+	       ((uintptr_t) getpid() << SM2_SLOT_OWNER_SHIFT) | SM2_SLOT_BUSY;
+}
+
+static inline void sm2_slot_unlock(struct sm2_ep_allocation_entry *entry)
+{
+	uintptr_t state = entry->state;
+
+	assert(state & SM2_SLOT_BUSY);
+	atomic_wmb();
+	entry->state = ((state + SM2_SLOT_GEN) & SM2_SLOT_GEN_MASK) |
+		       SM2_SLOT_NAMED;
+}
+
+/*
+ * Take over a slot whose holder died while updating it.  The update may be
+ * partial, so the slot is renamed to a zombie that no lookup matches.  Its
+ * region is reused once sm2_slot_reusable() allows it.
+ */
+static void sm2_slot_recover(struct sm2_ep_allocation_entry *entry,
+			     uintptr_t state)
+{
+	if (!atomic_compare_exchange(&entry->state, &state,
+				     sm2_slot_busy_state(state)))
+		return;
+
+	FI_WARN(&sm2_prov, FI_LOG_AV,
+		"pid %d died while updating allocation entry %s, marking it "
+		"as a zombie\n", sm2_slot_owner(state), entry->ep_name);
+	sm2_slot_set_name(entry, ZOMBIE_ALLOCATION_NAME);
+	sm2_slot_unlock(entry);
+}
+
 /*
- * Insert the name into the ep_allocation array.  Requires the lock.
+ * Return the state of a slot once no other process is updating it.
+ */
+static inline uintptr_t
+sm2_slot_read(struct sm2_ep_allocation_entry *entry)
+{
+	uintptr_t state;
+
+	while ((state = entry->state) & SM2_SLOT_BUSY) {
+		if (!pid_lives(sm2_slot_owner(state)))
+			sm2_slot_recover(entry, state);
+		else
+			sched_yield();
+	}
+	atomic_rmb();
+	return state;
+}
+
+/*
+ * Take a slot for update if it is still in the given state.
+ */
+static inline bool sm2_slot_trylock(struct sm2_ep_allocation_entry *entry,
+				    uintptr_t state)
+{
+	assert(!(state & SM2_SLOT_BUSY));
+	return atomic_compare_exchange(&entry->state, &state,
+				       sm2_slot_busy_state(state));
+}
+
+static inline void sm2_slot_lock(struct sm2_ep_allocation_entry *entry)
+{
+	while (!sm2_slot_trylock(entry, sm2_slot_read(entry)))
+		;
+}
+
+/*
+ * Check if a slot owned by another name can be given to a new endpoint.
+ * Entries with a negative pid may be in a third peer's AV and are kept until
+ * the file is cleaned up.
+ */
+static bool sm2_slot_reusable(struct sm2_mmap *map, int item)
+{
+	struct sm2_ep_allocation_entry *entry = &sm2_mmap_entries(map)[item];
+	int peer_pid = entry->pid;
+
+	if (peer_pid == 0)
+		return true;
+
+	if (peer_pid < 0 || pid_lives(peer_pid))
+		return false;
+
+	/* a slot with a dead PID can be reused once its freestack is full */
+	return entry->startup_ready &&
+	       smr_freestack_isfull(
+		       sm2_freestack(sm2_mmap_ep_region(map, item)));
+}
+
+static void sm2_slot_take(struct sm2_ep_allocation_entry *entry, bool self)
+{
+	int pid = getpid();
+
+	if (self) {
+		entry->startup_ready = 0;
+		atomic_wmb();
+		entry->pid = pid;
+	}
+
+	if (!self && entry->pid == 0) {
+		entry->startup_ready = 0;
+		atomic_wmb();
+		entry->pid = -pid;
+	}
+}
+
+/*
+ * Claim the existing slot for name.  Must hold the slot.
  *
  * Note: that because of speculative av_insert operations, we may need to
  * assign an index for an endpoint claimed by another peer.
  * When self == true, we will "own" the entry (entry.pid = getpid()).
  * When False, we set pid = -getpid(), allowing owner to claim later.
  */
-ssize_t sm2_entry_allocate(const char *name, struct sm2_mmap *map,
-			   sm2_gid_t *gid, bool self)
+static ssize_t sm2_slot_claim(struct sm2_mmap *map, int item, const char *name,
+			      bool self)
 {
-	struct sm2_ep_allocation_entry *entries;
-	struct sm2_region *peer_region = NULL;
-	int item, pid = getpid(), peer_pid;
+	struct sm2_ep_allocation_entry *entry = &sm2_mmap_entries(map)[item];
+	struct sm2_region *peer_region;
+
+	/* Check if it is dirty */
+	if (entry->pid && !pid_lives(abs(entry->pid))) {
+		peer_region = sm2_mmap_ep_region(map, item);
+		if (!smr_freestack_isfull(sm2_freestack(peer_region))) {
+			/* Region did not shut down properly, but other
+			 * processes might be using it, make it a zombie
+			 * region - never use this region for as long as
+			 * the file exists */
+			FI_WARN(&sm2_prov, FI_LOG_AV,
+				"Found region at allocation[%d] that did not "
+				"shut down correctly, marking it as a zombie "
+				"never to be used again (until all active "
+				"processes die, and file size is reset)!\n",
+				item);
+			sm2_slot_set_name(entry, ZOMBIE_ALLOCATION_NAME);
+			return -FI_EAGAIN;
+		}
+	}
 
-	entries = sm2_mmap_entries(map);
+	if (!self) {
+		if (!pid_lives(abs(entry->pid)))
+			entry->pid = 0;
+		/* Someone else allocated the entry for us */
+		goto found;
+	}
 
-retry_lookup:
-	item = sm2_entry_lookup(name, map);
-	if (item >= 0) {
-		entries = sm2_mmap_entries(map);
-
-		/* Check if it is dirty */
-		if (entries[item].pid && !pid_lives(abs(entries[item].pid))) {
-			peer_region = sm2_mmap_ep_region(map, item);
-			if (!smr_freestack_isfull(sm2_freestack(peer_region))) {
-				/* Region did not shut down properly, but other
-				 * processes might be using it, make it a zombie
-				 * region - never use this region for as long as
-				 * the file exists */
-				FI_WARN(&sm2_prov, FI_LOG_AV,
-					"Found region at allocation[%d] that "
-					"did not  shut down correctly, marking "
-					"it as a zombie never to be used again "
-					"(until all active processes die, and "
-					"file size is reset)!\n",
-					item);
-				strncpy(entries[item].ep_name,
-					ZOMBIE_ALLOCATION_NAME, OFI_NAME_MAX);
-				goto retry_lookup;
-			}
+	if (entry->pid <= 0) {
+		if (!pid_lives(abs(entry->pid))) {
+			FI_WARN(&sm2_prov, FI_LOG_AV,
+				"During sm2 allocation of space for endpoint "
+				"named %s pid %d pre-allocated space at "
+				"allocation entry[%d] and then died!\n",
+				name, -entry->pid, item);
 		}
+		goto found;
+	}
 
-		if (!self) {
-			if (!pid_lives(abs(entries[item].pid))) {
-				entries[item].pid = 0;
-			}
-			/* Someone else allocated the entry for us */
-			goto found;
-		}
+	FI_WARN(&sm2_prov, FI_LOG_AV,
+		"During sm2 allocation of space for endpoint named %s an "
+		"existing conflicting address was found at allocation "
+		"entry[%d]\n",
+		name, item);
+
+	if (!pid_lives(entry->pid)) {
+		FI_WARN(&sm2_prov, FI_LOG_AV,
+			"The pid which allocated the conflicting allocation "
+			"entry is dead. Reclaiming as our own.\n");
+		/* it is possible that EP's referencing this region are
+		 * still alive... don't know how to check (they likely
+		 * died if PID died) */
+		goto found;
+	}
+
+	FI_WARN(&sm2_prov, FI_LOG_AV,
+		"ERROR: The endpoint (pid: %d) with conflicting address %s is "
+		"still alive.\n",
+		entry->pid, name);
+	return -FI_EADDRINUSE;
+
+found:
+	sm2_slot_take(entry, self);
+	return 0;
+}
 
-		if (entries[item].pid <= 0) {
-			if (!pid_lives(abs(entries[item].pid))) {
-				FI_WARN(&sm2_prov, FI_LOG_AV,
-					"During sm2 allocation of space for "
-					"endpoint named %s pid %d "
-					"pre-allocated space at allocation "
-					"entry[%d] and then died!\n",
-					name, -entries[item].pid, item);
+/*
+ * Insert the name into the ep_allocation array.  Does not need the file lock,
+ * concurrent inserts are resolved per slot.
+ */
+ssize_t sm2_entry_allocate(const char *name, struct sm2_mmap *map,
+			   sm2_gid_t *gid, bool self)
+{
+	struct sm2_ep_allocation_entry *entries, *entry;
+	uintptr_t state, target_state = 0;
+	uint32_t hash;
+	int i, item, target;
+	ssize_t ret;
+
+	entries = sm2_mmap_entries(map);
+	hash = sm2_name_hash(name);
+
+retry:
+	target = -1;
+	for (i = 0; i < SM2_MAX_UNIVERSE_SIZE; i++) {
+		item = (hash + i) % SM2_MAX_UNIVERSE_SIZE;
+		entry = &entries[item];
+		state = sm2_slot_read(entry);
+
+		if ((state & SM2_SLOT_KIND) == SM2_SLOT_EMPTY) {
+			if (target < 0) {
+				target = item;
+				target_state = state;
 			}
-			goto found;
+			break;
 		}
 
-		FI_WARN(&sm2_prov, FI_LOG_AV,
-			"During sm2 allocation of space for endpoint named %s "
-			"an existing conflicting address was found at "
-			"allocation entry[%d]\n",
-			name, item);
-
-		if (!pid_lives(entries[item].pid)) {
-			FI_WARN(&sm2_prov, FI_LOG_AV,
-				"The pid which allocated the conflicting "
-				"allocation entry is "
-				"dead. Reclaiming as our own.\n");
-			/* it is possible that EP's referencing this region are
-			 * still alive... don't know how to check (they likely
-			 * died if PID died) */
-			goto found;
+		if (entry->name_hash == hash &&
+		    !strncmp(name, entry->ep_name, OFI_NAME_MAX)) {
+			if (!sm2_slot_trylock(entry, state))
+				goto retry;
+			ret = sm2_slot_claim(map, item, name, self);
+			sm2_slot_unlock(entry);
+			if (ret == -FI_EAGAIN)
+				goto retry;
+			if (ret)
+				return ret;
+			goto out;
 		}
 
-		FI_WARN(&sm2_prov, FI_LOG_AV,
-			"ERROR: The endpoint (pid: %d) with conflicting "
-			"address %s is still alive.\n",
-			entries[item].pid, name);
-		return -FI_EADDRINUSE;
+		if (target < 0 && sm2_slot_reusable(map, item)) {
+			target = item;
+			target_state = state;
+		}
 	}
 
-	/* fine, we could not find the entry, so now look for an empty slot */
-	for (item = 0; item < SM2_MAX_UNIVERSE_SIZE; item++) {
-		peer_pid = entries[item].pid;
-		if (peer_pid == 0)
-			goto found;
-		if (peer_pid < 0)
-			/* A third peer might have entered this address into
-			 * their AV, and there is no current way to check
-			 * this... need to keep this entry in the file until we
-			 * clean up */
-			continue;
-
-		if (!pid_lives(peer_pid)) {
-			entries = sm2_mmap_entries(map);
-			struct sm2_region *peer_region =
-				sm2_mmap_ep_region(map, item);
-
-			if (entries[item].startup_ready &&
-			    smr_freestack_isfull(sm2_freestack(peer_region))) {
-				/* we found a slot with a dead PID and
-				 * the freestack is full */
-				entries[item].pid = 0;
-				goto found;
-			}
-		}
+	if (target < 0) {
+		FI_WARN(&sm2_prov, FI_LOG_AV,
+			"No available entries were found in the coordination "
+			"file, all %d were used\n",
+			SM2_MAX_UNIVERSE_SIZE);
+		return -FI_EAVAIL;
 	}
 
-	FI_WARN(&sm2_prov, FI_LOG_AV,
-		"No available entries were found in the coordination file, all "
-		"%d were used\n",
-		SM2_MAX_UNIVERSE_SIZE);
-	return -FI_EAVAIL;
+	item = target;
+	entry = &entries[item];
+	if (!sm2_slot_trylock(entry, target_state))
+		goto retry;
 
-found:
-	if (self) {
-		entries[item].startup_ready = 0;
-		atomic_wmb();
-		entries[item].pid = pid;
+	if ((target_state & SM2_SLOT_KIND) == SM2_SLOT_NAMED) {
+		if (!sm2_slot_reusable(map, item)) {
+			sm2_slot_unlock(entry);
+			goto retry;
+		}
+		entry->pid = 0;
 	}
-
-	if (!self && entries[item].pid == 0) {
-		entries[item].startup_ready = 0;
-		atomic_wmb();
-		entries[item].pid = -pid;
+	sm2_slot_set_name(entry, name);
+	sm2_slot_take(entry, self);
+	sm2_slot_unlock(entry);
+
+	/* Another process may have inserted the same name into an earlier
+	 * slot at the same time.  The first slot in the probe order wins. */
+	if (sm2_entry_lookup(name, map) != item) {
+		sm2_slot_lock(entry);
+		entry->ep_name[0] = '\0';
+		entry->name_hash = sm2_name_hash(entry->ep_name);
+		entry->pid = 0;
+		sm2_slot_unlock(entry);
+		goto retry;
 	}
 
+out:
 	FI_INFO(&sm2_prov, FI_LOG_AV,
 		"Using sm2 region at allocation entry[%d] for %s\n", item,
 		name);
 
-	strncpy(entries[item].ep_name, name, OFI_NAME_MAX - 1);
-	entries[item].ep_name[OFI_NAME_MAX - 1] = '\0';
-
 	*gid = item;
-
 	return 0;
 }
 
 int sm2_entry_lookup(const char *name, struct sm2_mmap *map)
 {
-	struct sm2_ep_allocation_entry *entries;
-	int item;
+	struct sm2_ep_allocation_entry *entries, *entry;
+	uintptr_t state;
+	uint32_t hash;
+	bool match;
+	int i, item;
 
 	entries = sm2_mmap_entries(map);
-	/* TODO Optimize this lookup*/
-	for (item = 0; item < SM2_MAX_UNIVERSE_SIZE; item++) {
-		if (0 == strncmp(name, entries[item].ep_name, OFI_NAME_MAX)) {
+	hash = sm2_name_hash(name);
+
+	for (i = 0; i < SM2_MAX_UNIVERSE_SIZE; i++) {
+		item = (hash + i) % SM2_MAX_UNIVERSE_SIZE;
+		entry = &entries[item];
+		do {
+			state = sm2_slot_read(entry);
+			if ((state & SM2_SLOT_KIND) == SM2_SLOT_EMPTY)
+				return -1;
+
+			match = entry->name_hash == hash &&
+				!strncmp(name, entry->ep_name, OFI_NAME_MAX);
+			atomic_rmb();
+		} while (entry->state != state);
+
+		if (match) {
 			FI_DBG(&sm2_prov, FI_LOG_AV,
 			       "Found existing %s in slot %d\n", name, item);
 			return item;
 		}
-		if (entries[item].ep_name[0] != '\0') {
-			FI_DBG(&sm2_prov, FI_LOG_AV,
-			       "Searching for %s. Not yet found in spot "
-			       "allocation[%d]=%s, PID=%d\n",
-			       name, item, entries[item].ep_name,
-			       entries[item].pid);
-		} else if (!strcmp(entries[item].ep_name,
-				   ZOMBIE_ALLOCATION_NAME)) {
-			FI_DBG(&sm2_prov, FI_LOG_AV,
-			       "Found zombie in spot allocation[%d], PID= %d\n",
-			       item, entries[item].pid);
-		}
 	}
 	return -1;
 }
 
 /*
- * Clear the pid for this entry.  must already hold lock.
+ * Clear the pid for this entry.
  */
 void sm2_entry_free(struct sm2_mmap *map, sm2_gid_t gid)
 {
-	struct sm2_ep_allocation_entry *entries;
+	struct sm2_ep_allocation_entry *entry;
 
-	entries = sm2_mmap_entries(map);
-	assert(entries[gid].pid == getpid());
-	entries[gid].pid = 0;
+	entry = &sm2_mmap_entries(map)[gid];
+	sm2_slot_lock(entry);
+	assert(entry->pid == getpid());
+	entry->pid = 0;
+	sm2_slot_unlock(entry);
 }
 
 void sm2_file_lock(struct sm2_mmap *map)
@@ -584,24 +753,57 @@ out:
  * my PID must be alive in the file in order for me to hold any of my peers
  * allocations.
  *
+ * Entries are claimed without the file lock, so every entry is held BUSY
+ * while the file is checked and reset.  A process that starts claiming an
+ * entry meanwhile waits until the file has been grown back and the entry
+ * is EMPTY again.
+ *
  * NOTE: SHM file lock must be held before calling this function
  */
 static void sm2_file_attempt_shrink(struct sm2_mmap *map)
 {
 	struct sm2_coord_file_header *header = (void *) map->base;
 	struct sm2_ep_allocation_entry *entries = sm2_mmap_entries(map);
+	uintptr_t states[SM2_MAX_UNIVERSE_SIZE];
+	size_t file_size;
 	int item;
 
 	for (item = 0; item < SM2_MAX_UNIVERSE_SIZE; item++) {
+		do {
+			states[item] = sm2_slot_read(&entries[item]);
+		} while (!sm2_slot_trylock(&entries[item], states[item]));
+
 		if (entries[item].pid != 0 &&
 		    pid_lives(abs(entries[item].pid))) {
 			FI_INFO(&sm2_prov, FI_LOG_AV,
 				"Cannot shrink file b/c PID %d still lives",
 				abs(entries[item].pid));
-			return;
+			goto release;
 		}
 	}
 
-	memset(entries, 0, sizeof(*entries) * SM2_MAX_UNIVERSE_SIZE);
-	sm2_mmap_shrink_to_size(map, header->ep_regions_offset);
+	file_size = header->ep_regions_offset +
+		    header->ep_region_size * SM2_MAX_UNIVERSE_SIZE;
+	if (!sm2_mmap_shrink_to_size(map, header->ep_regions_offset))
+		return;
+
+	if (sm2_mmap_remap(map, file_size))
+		FI_WARN(&sm2_prov, FI_LOG_AV,
+			"Failed to grow the coordination file after shrinking "
+			"it\n");
+
+	entries = sm2_mmap_entries(map);
+	for (item = 0; item < SM2_MAX_UNIVERSE_SIZE; item++) {
+		memset(&entries[item], 0,
+		       offsetof(struct sm2_ep_allocation_entry, state));
+		atomic_wmb();
+		entries[item].state = SM2_SLOT_EMPTY;
+	}
+	return;
+
+release:
+	/* nothing was changed, so the previous states are restored as is */
+	atomic_wmb();
+	for (; item >= 0; item--)
+		entries[item].state = states[item];
 }
@@ -63,10 +63,31 @@ struct sm2_mmap {
 	int fd;
 };
 
+/*
+ * Allocation entries form an open addressed hash table keyed by ep_name, so
+ * lookups start at the slot picked by name_hash instead of scanning the
+ * whole array.  Slots are claimed with a CAS on state instead of taking the
+ * file lock.  A slot is EMPTY until it is first named and never goes back to
+ * EMPTY (until the file is reset), so a lookup can stop at the first EMPTY
+ * slot.  BUSY is held for the few stores needed to update a slot; every
+ * release bumps the generation so readers can detect a concurrent update.
+ * While a slot is BUSY, the upper half of state holds the pid of the holder
+ * so that a slot left BUSY by a dead process can be recovered.
+ */
+#define SM2_SLOT_EMPTY		0
+#define SM2_SLOT_BUSY		1
+#define SM2_SLOT_NAMED		2
+#define SM2_SLOT_KIND		3
+#define SM2_SLOT_GEN		4
+#define SM2_SLOT_GEN_MASK	0xfffffffcUL
+#define SM2_SLOT_OWNER_SHIFT	32
+
 struct sm2_ep_allocation_entry {
 	int pid; /* This is for allocation startup */
 	char ep_name[OFI_NAME_MAX];
 	bool startup_ready; /* TODO Do I need to make atomic */
+	uint32_t name_hash;
+	uintptr_t state;
 };
 
 struct sm2_coord_file_header {
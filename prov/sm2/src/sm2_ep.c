@@ -308,6 +308,85 @@ static ssize_t sm2_do_ipc(struct sm2_ep *ep, struct sm2_region *peer_smr,
 	return FI_SUCCESS;
 }
 
+static ssize_t sm2_do_sar(struct sm2_ep *ep, struct sm2_region *peer_smr,
+			  sm2_gid_t peer_gid, uint32_t op, uint64_t tag,
+			  uint64_t data, uint64_t op_flags, struct ofi_mr **mr,
+			  const struct iovec *iov, size_t iov_count,
+			  size_t total_len, void *context)
+{
+	struct smr_freestack *freestack = sm2_freestack(ep->self_region);
+	struct sm2_xfer_entry *xfer_entry, *next;
+	struct sm2_sar_data *sar_data;
+	size_t offset = 0;
+	ssize_t ret;
+
+	/* Reserve every segment up front so the receiver never sees a
+	 * partial message from us interleaved with a later one */
+	if (freestack->free < ofi_div_ceil(total_len, SM2_SAR_SEG_SIZE))
+		return -FI_EAGAIN;
+
+	ret = sm2_pop_xfer_entry(ep, &xfer_entry);
+	if (ret)
+		return ret;
+
+	for (;;) {
+		sm2_generic_format(xfer_entry, ep->gid, op, tag, data,
+				   op_flags, context);
+		xfer_entry->hdr.proto = sm2_proto_sar;
+		xfer_entry->hdr.size = total_len;
+
+		sar_data = (struct sm2_sar_data *) xfer_entry->user_data;
+		sar_data->offset = offset;
+		ret = ofi_copy_from_mr_iov(sar_data->buf, SM2_SAR_SEG_SIZE,
+					   mr, iov, iov_count, offset);
+		if (ret <= 0) {
+			FI_WARN(&sm2_prov, FI_LOG_EP_DATA,
+				"SAR copy failed at offset %zu: %zd\n",
+				offset, ret);
+			if (!ret)
+				ret = -FI_EIO;
+			goto abort;
+		}
+		sar_data->len = ret;
+		offset += ret;
+		if (offset == total_len)
+			break;
+
+		/* Hold on to this segment until the next one is secured, so
+		 * that it can end the message if there is none */
+		ret = sm2_pop_xfer_entry(ep, &next);
+		if (ret) {
+			FI_WARN(&sm2_prov, FI_LOG_EP_DATA,
+				"SAR out of entries at offset %zu\n", offset);
+			if (!sar_data->offset) {
+				smr_freestack_push(freestack, xfer_entry);
+				return ret;
+			}
+			ret = -FI_EIO;
+			goto abort;
+		}
+
+		sm2_fifo_write(ep, peer_gid, xfer_entry);
+		xfer_entry = next;
+	}
+
+	sm2_fifo_write(ep, peer_gid, xfer_entry);
+	return FI_SUCCESS;
+
+abort:
+	if (!sar_data->offset) {
+		smr_freestack_push(freestack, xfer_entry);
+		return ret;
+	}
+
+	/* The receiver already has part of the message, end it with an
+	 * empty segment so it fails the receive */
+	sar_data->len = 0;
+	xfer_entry->hdr.proto_flags |= SM2_SAR_ABORT;
+	sm2_fifo_write(ep, peer_gid, xfer_entry);
+	return ret;
+}
+
 static void cleanup_shm_resources(struct sm2_ep *ep)
 {
 	struct sm2_xfer_entry *xfer_entry;
@@ -366,11 +445,8 @@ static int sm2_ep_close(struct fid *fid)
 	 */
 	/* TODO Do we want to mark our entry as zombie now if we don't have all
 	   our xfer_entry? */
-	if (smr_freestack_isfull(sm2_freestack(ep->self_region))) {
-		sm2_file_lock(ep->mmap);
+	if (smr_freestack_isfull(sm2_freestack(ep->self_region)))
 		sm2_entry_free(ep->mmap, ep->gid);
-		sm2_file_unlock(ep->mmap);
-	}
 
 	if (ep->xfer_ctx_pool)
 		ofi_bufpool_destroy(ep->xfer_ctx_pool);
@@ -473,6 +549,8 @@ static int sm2_discard(struct fi_peer_rx_entry *rx_entry)
 	struct sm2_xfer_ctx *xfer_ctx = rx_entry->peer_context;
 
 	ofi_genlock_lock(&xfer_ctx->ep->util_ep.lock);
+	if (xfer_ctx->sar_buf)
+		sm2_sar_discard(xfer_ctx);
 	ofi_buf_free(xfer_ctx);
 	ofi_genlock_unlock(&xfer_ctx->ep->util_ep.lock);
 	return FI_SUCCESS;
@@ -670,4 +748,5 @@ sm2_proto_func sm2_proto_ops[sm2_proto_max] = {
 	[sm2_proto_inject] = &sm2_do_inject,
 	[sm2_proto_cma] = &sm2_do_cma,
 	[sm2_proto_ipc] = &sm2_do_ipc,
+	[sm2_proto_sar] = &sm2_do_sar,
 };
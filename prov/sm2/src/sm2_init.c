@@ -38,6 +38,22 @@
 #include <ofi_hmem.h>
 #include <ofi_prov.h>
 
+struct sm2_env sm2_env = {
+	.sar_threshold = SM2_SAR_THRESHOLD,
+};
+
+static void sm2_init_env(void)
+{
+	fi_param_get_size_t(&sm2_prov, "sar_threshold",
+			    &sm2_env.sar_threshold);
+	if (sm2_env.sar_threshold > SM2_SAR_MAX_SIZE) {
+		FI_WARN(&sm2_prov, FI_LOG_CORE,
+			"FI_SM2_SAR_THRESHOLD limited to %zu\n",
+			(size_t) SM2_SAR_MAX_SIZE);
+		sm2_env.sar_threshold = SM2_SAR_MAX_SIZE;
+	}
+}
+
 size_t sm2_calculate_size_offsets(ptrdiff_t *rq_offset, ptrdiff_t *fs_offset)
 {
 	size_t total_size;
@@ -68,14 +84,12 @@ int sm2_create(const struct fi_provider *prov, const struct sm2_attr *attr,
 
 	FI_INFO(prov, FI_LOG_EP_CTRL, "Claiming an entry for (%s)\n",
 		attr->name);
-	sm2_file_lock(sm2_mmap);
 	ret = sm2_entry_allocate(attr->name, sm2_mmap, gid, true);
 
 	if (ret) {
 		FI_WARN(prov, FI_LOG_EP_CTRL,
 			"Failed to allocate an entry in the SHM file for "
 			"ourselves\n");
-		sm2_file_unlock(sm2_mmap);
 		return ret;
 	}
 
@@ -83,8 +97,7 @@ int sm2_create(const struct fi_provider *prov, const struct sm2_attr *attr,
 
 	if (mapped_addr == MAP_FAILED) {
 		FI_WARN(prov, FI_LOG_EP_CTRL, "mmap error\n");
-		ret = -errno;
-		goto remove;
+		return -errno;
 	}
 
 	smr = mapped_addr;
@@ -100,23 +113,16 @@ int sm2_create(const struct fi_provider *prov, const struct sm2_attr *attr,
 
 	/*
 	 * Need to set PID in header here...
-	 * this will unblock other processes trying to send to us
+	 * this will unblock other processes trying to send to us.
+	 * The region must be visible before startup_ready.
 	 */
 	assert(sm2_mmap_entries(sm2_mmap)[*gid].pid == getpid());
-	sm2_mmap_entries(sm2_mmap)[*gid].startup_ready = true;
 	atomic_wmb();
-
-	/* Need to unlock coordinator so that others can add themselves to
-	 * header */
-	sm2_file_unlock(sm2_mmap);
+	sm2_mmap_entries(sm2_mmap)[*gid].startup_ready = true;
 
 	FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
 		"Created sm2 endpoint at allocation[%d]\n", *gid);
 	return 0;
-
-remove:
-	sm2_file_unlock(sm2_mmap);
-	return ret;
 }
 
 /*
@@ -253,5 +259,12 @@ struct util_prov sm2_util_prov = {
 
 SM2_INI
 {
+	fi_param_define(&sm2_prov, "sar_threshold", FI_PARAM_SIZE_T,
+			"Largest message size sent through the segmented copy "
+			"(SAR) protocol.  Larger messages use CMA.  Set to 0 "
+			"to disable SAR. (default: %d)", SM2_SAR_THRESHOLD);
+
+	sm2_init_env();
+
 	return &sm2_prov;
 }
@@ -69,6 +69,9 @@ static inline int sm2_select_proto(void **desc, size_t iov_count,
 	if (total_len <= SM2_INJECT_SIZE)
 		return sm2_proto_inject;
 
+	if (total_len <= sm2_env.sar_threshold)
+		return sm2_proto_sar;
+
 	return sm2_proto_cma;
 }
 
@@ -324,6 +324,178 @@ static int sm2_progress_ipc(struct sm2_xfer_entry *xfer_entry,
 	return err;
 }
 
+static inline bool sm2_sar_last(struct sm2_xfer_entry *xfer_entry)
+{
+	struct sm2_sar_data *sar_data =
+		(struct sm2_sar_data *) xfer_entry->user_data;
+
+	return (xfer_entry->hdr.proto_flags & SM2_SAR_ABORT) ||
+	       sar_data->offset + sar_data->len == xfer_entry->hdr.size;
+}
+
+static int sm2_sar_copy_to_rx(struct fi_peer_rx_entry *rx_entry,
+			      uint64_t offset, const void *buf, size_t len)
+{
+	ssize_t hmem_copy_ret;
+
+	hmem_copy_ret = ofi_copy_to_mr_iov((struct ofi_mr **) rx_entry->desc,
+					   rx_entry->iov, rx_entry->count,
+					   offset, buf, len);
+	if (hmem_copy_ret < 0) {
+		FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
+			"SAR recv failed with code %d\n",
+			(int) (-hmem_copy_ret));
+		return hmem_copy_ret;
+	} else if (hmem_copy_ret != len) {
+		FI_WARN(&sm2_prov, FI_LOG_EP_CTRL, "SAR recv truncated\n");
+		return -FI_ETRUNC;
+	}
+
+	return FI_SUCCESS;
+}
+
+static void sm2_sar_complete_rx(struct sm2_ep *ep,
+				struct sm2_xfer_entry *xfer_entry,
+				struct fi_peer_rx_entry *rx_entry, int err)
+{
+	uint64_t comp_flags;
+	int ret;
+
+	comp_flags = sm2_rx_cq_flags(xfer_entry->hdr.op, rx_entry->flags,
+				     xfer_entry->hdr.op_flags);
+
+	if (err) {
+		FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
+			"Error processing SAR message\n");
+		ret = sm2_write_err_comp(ep->util_ep.rx_cq, rx_entry->context,
+					 comp_flags, rx_entry->tag, err);
+	} else {
+		ret = sm2_complete_rx(ep, rx_entry->context, xfer_entry->hdr.op,
+				      comp_flags, xfer_entry->hdr.size,
+				      rx_entry->iov[0].iov_base,
+				      xfer_entry->hdr.sender_gid,
+				      xfer_entry->hdr.tag,
+				      xfer_entry->hdr.cq_data);
+	}
+
+	if (ret) {
+		FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
+			"Unable to process rx completion\n");
+	}
+
+	sm2_get_peer_srx(ep)->owner_ops->free_entry(rx_entry);
+}
+
+/* First segment of a SAR message that matched a posted receive */
+static int sm2_progress_sar_start(struct sm2_ep *ep,
+				  struct sm2_xfer_entry *xfer_entry,
+				  struct fi_peer_rx_entry *rx_entry,
+				  size_t *total_len, bool *sar_pending)
+{
+	struct sm2_sar_data *sar_data =
+		(struct sm2_sar_data *) xfer_entry->user_data;
+	struct sm2_sar_rx *sar_rx = &ep->sar_rx[xfer_entry->hdr.sender_gid];
+	int err;
+
+	assert(!sar_data->offset);
+	err = sm2_sar_copy_to_rx(rx_entry, 0, sar_data->buf, sar_data->len);
+
+	if (!sm2_sar_last(xfer_entry)) {
+		sar_rx->rx_entry = rx_entry;
+		sar_rx->xfer_ctx = NULL;
+		sar_rx->err = err;
+		*sar_pending = true;
+		return FI_SUCCESS;
+	}
+
+	*total_len = xfer_entry->hdr.size;
+	return err;
+}
+
+/* Any segment after the first one.  The sender does not interleave
+ * messages, so this belongs to the message tracked in sar_rx. */
+static void sm2_progress_sar(struct sm2_ep *ep,
+			     struct sm2_xfer_entry *xfer_entry)
+{
+	struct sm2_sar_data *sar_data =
+		(struct sm2_sar_data *) xfer_entry->user_data;
+	struct sm2_sar_rx *sar_rx = &ep->sar_rx[xfer_entry->hdr.sender_gid];
+	struct sm2_xfer_ctx *xfer_ctx = sar_rx->xfer_ctx;
+	int err;
+
+	assert(sar_data->offset + sar_data->len <= xfer_entry->hdr.size);
+
+	if (sar_rx->rx_entry) {
+		err = sm2_sar_copy_to_rx(sar_rx->rx_entry, sar_data->offset,
+					 sar_data->buf, sar_data->len);
+		if (err && !sar_rx->err)
+			sar_rx->err = err;
+	} else if (xfer_ctx && xfer_ctx->sar_buf) {
+		memcpy((char *) xfer_ctx->sar_buf + sar_data->offset,
+		       sar_data->buf, sar_data->len);
+		xfer_ctx->sar_bytes += sar_data->len;
+	}
+
+	if (sm2_sar_last(xfer_entry)) {
+		if ((xfer_entry->hdr.proto_flags & SM2_SAR_ABORT) &&
+		    !sar_rx->err)
+			sar_rx->err = -FI_EIO;
+		if (sar_rx->rx_entry)
+			sm2_sar_complete_rx(ep, xfer_entry, sar_rx->rx_entry,
+					    sar_rx->err);
+		memset(sar_rx, 0, sizeof(*sar_rx));
+	}
+
+	sm2_fifo_write_back(ep, xfer_entry);
+}
+
+/* The application posted a receive for an unexpected SAR message.  Copy
+ * what has arrived so far and have any remaining segments delivered
+ * directly to the receive buffer. */
+static int sm2_sar_unexp_start(struct sm2_xfer_ctx *xfer_ctx,
+			       struct fi_peer_rx_entry *rx_entry)
+{
+	struct sm2_xfer_entry *xfer_entry = &xfer_ctx->xfer_entry;
+	struct sm2_ep *ep = xfer_ctx->ep;
+	struct sm2_sar_rx *sar_rx = &ep->sar_rx[xfer_entry->hdr.sender_gid];
+	int err;
+
+	/* No buffer means the message could not be held for us */
+	if (xfer_ctx->sar_buf)
+		err = sm2_sar_copy_to_rx(rx_entry, 0, xfer_ctx->sar_buf,
+					 xfer_ctx->sar_bytes);
+	else
+		err = -FI_ENOMEM;
+	free(xfer_ctx->sar_buf);
+	xfer_ctx->sar_buf = NULL;
+
+	if (sar_rx->xfer_ctx == xfer_ctx) {
+		sar_rx->xfer_ctx = NULL;
+		sar_rx->rx_entry = rx_entry;
+		sar_rx->err = err;
+		return FI_SUCCESS;
+	}
+
+	if (!err && xfer_ctx->sar_bytes != xfer_entry->hdr.size)
+		err = -FI_EIO;
+
+	sm2_sar_complete_rx(ep, xfer_entry, rx_entry, err);
+	return FI_SUCCESS;
+}
+
+void sm2_sar_discard(struct sm2_xfer_ctx *xfer_ctx)
+{
+	struct sm2_sar_rx *sar_rx =
+		&xfer_ctx->ep->sar_rx[xfer_ctx->xfer_entry.hdr.sender_gid];
+
+	/* Drop the segments that are still in flight */
+	if (sar_rx->xfer_ctx == xfer_ctx)
+		sar_rx->xfer_ctx = NULL;
+
+	free(xfer_ctx->sar_buf);
+	xfer_ctx->sar_buf = NULL;
+}
+
 static int sm2_start_common(struct sm2_ep *ep,
 			    struct sm2_xfer_entry *xfer_entry,
 			    struct fi_peer_rx_entry *rx_entry)
@@ -333,7 +505,7 @@ static int sm2_start_common(struct sm2_ep *ep,
 	void *comp_buf;
 	int err = 0, ret = 0;
 	struct sm2_xfer_entry *new_xfer_entry;
-	bool ipc_host_to_dev = false;
+	bool ipc_host_to_dev = false, sar_pending = false;
 
 	switch (xfer_entry->hdr.proto) {
 	case sm2_proto_inject:
@@ -350,6 +522,10 @@ static int sm2_start_common(struct sm2_ep *ep,
 		err = sm2_progress_cma(ep, xfer_entry, rx_entry, &total_len, 0,
 				       &ipc_host_to_dev);
 		break;
+	case sm2_proto_sar:
+		err = sm2_progress_sar_start(ep, xfer_entry, rx_entry,
+					     &total_len, &sar_pending);
+		break;
 	default:
 		FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
 			"Unidentified operation type\n");
@@ -367,8 +543,9 @@ static int sm2_start_common(struct sm2_ep *ep,
 	} else {
 		/* If the IPC device to host protocol is used, the receive
 		 * completion is not generated at this stage. Instead, it's
-		 * generated after the sender completes the device memcpy */
-		if (!ipc_host_to_dev)
+		 * generated after the sender completes the device memcpy.
+		 * SAR messages complete with their last segment. */
+		if (!ipc_host_to_dev && !sar_pending)
 			ret = sm2_complete_rx(
 				ep, rx_entry->context, xfer_entry->hdr.op,
 				comp_flags, total_len, comp_buf,
@@ -381,7 +558,8 @@ static int sm2_start_common(struct sm2_ep *ep,
 			"Unable to process rx completion\n");
 	}
 
-	sm2_get_peer_srx(ep)->owner_ops->free_entry(rx_entry);
+	if (!sar_pending)
+		sm2_get_peer_srx(ep)->owner_ops->free_entry(rx_entry);
 
 	if (ipc_host_to_dev)
 		return 0;
@@ -429,7 +607,11 @@ int sm2_unexp_start(struct fi_peer_rx_entry *rx_entry)
 	struct sm2_xfer_ctx *xfer_ctx = rx_entry->peer_context;
 	int ret;
 
-	ret = sm2_start_common(xfer_ctx->ep, &xfer_ctx->xfer_entry, rx_entry);
+	if (xfer_ctx->xfer_entry.hdr.proto == sm2_proto_sar)
+		ret = sm2_sar_unexp_start(xfer_ctx, rx_entry);
+	else
+		ret = sm2_start_common(xfer_ctx->ep, &xfer_ctx->xfer_entry,
+				       rx_entry);
 	ofi_buf_free(xfer_ctx);
 
 	return ret;
@@ -440,6 +622,7 @@ static int sm2_alloc_xfer_entry_ctx(struct sm2_ep *ep,
 				    struct sm2_xfer_entry *xfer_entry)
 {
 	struct sm2_xfer_ctx *xfer_ctx;
+	struct sm2_sar_data *sar_data;
 
 	xfer_ctx = ofi_buf_alloc(ep->xfer_ctx_pool);
 	if (!xfer_ctx) {
@@ -450,6 +633,32 @@ static int sm2_alloc_xfer_entry_ctx(struct sm2_ep *ep,
 
 	memcpy(&xfer_ctx->xfer_entry, xfer_entry, sizeof(*xfer_entry));
 	xfer_ctx->ep = ep;
+	xfer_ctx->sar_buf = NULL;
+
+	if (xfer_entry->hdr.proto == sm2_proto_sar) {
+		sar_data = (struct sm2_sar_data *) xfer_entry->user_data;
+		/* Without a buffer the message is still queued, so that the
+		 * receive matching it fails instead of never completing.  Its
+		 * segments are dropped. */
+		xfer_ctx->sar_buf = malloc(xfer_entry->hdr.size);
+		if (xfer_ctx->sar_buf) {
+			memcpy(xfer_ctx->sar_buf, sar_data->buf,
+			       sar_data->len);
+			xfer_ctx->sar_bytes = sar_data->len;
+		} else {
+			FI_WARN(&sm2_prov, FI_LOG_EP_CTRL,
+				"Error allocating SAR buffer, dropping "
+				"message of %zu bytes\n",
+				(size_t) xfer_entry->hdr.size);
+			xfer_ctx->sar_bytes = 0;
+		}
+		if (!sm2_sar_last(xfer_entry)) {
+			ep->sar_rx[xfer_entry->hdr.sender_gid].xfer_ctx =
+				xfer_ctx;
+			ep->sar_rx[xfer_entry->hdr.sender_gid].rx_entry = NULL;
+			ep->sar_rx[xfer_entry->hdr.sender_gid].err = 0;
+		}
+	}
 
 	rx_entry->msg_size = xfer_entry->hdr.size;
 	rx_entry->flags |= xfer_entry->hdr.op_flags & FI_REMOTE_CQ_DATA;
@@ -556,6 +765,10 @@ static int sm2_progress_recv_msg(struct sm2_ep *ep,
 	} else if (xfer_entry->hdr.proto_flags & SM2_CMA_HOST_TO_DEV_ACK) {
 		sm2_progress_cma_host_to_dev_ack(ep, xfer_entry);
 		goto out;
+	} else if (xfer_entry->hdr.proto == sm2_proto_sar &&
+		   ((struct sm2_sar_data *) xfer_entry->user_data)->offset) {
+		sm2_progress_sar(ep, xfer_entry);
+		goto out;
 	}
 
 	sm2_av = container_of(ep->util_ep.av, struct sm2_av, util_av);
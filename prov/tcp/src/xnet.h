@@ -120,6 +120,8 @@ extern size_t xnet_max_saved_size;
 extern size_t xnet_max_inject;
 extern size_t xnet_buf_size;
 extern int xnet_firewall_addr;
+extern size_t xnet_eager_connect;
+extern size_t xnet_accept_batch;
 
 struct xnet_xfer_entry;
 struct xnet_ep;
@@ -288,6 +290,8 @@ enum {
 	XNET_CONN_INDEXED = BIT(0),
 	XNET_CONN_TX_LOOPBACK = BIT(1),
 	XNET_CONN_RX_LOOPBACK = BIT(2),
+	XNET_CONN_EAGER = BIT(3),
+	XNET_CONN_EAGER_ACTIVE = BIT(4),
 };
 
 struct xnet_conn {
@@ -296,6 +300,7 @@ struct xnet_conn {
 	struct util_peer_addr	*peer;
 	uint32_t		remote_pid;
 	int			flags;
+	struct dlist_entry	eager_entry;
 };
 
 struct xnet_rdm {
@@ -308,6 +313,13 @@ struct xnet_rdm {
 	struct xnet_conn	*rx_loopback;
 	union ofi_sock_ip	addr;
 
+	/* Connections queued for eager connect, see xnet_eager_connect */
+	struct dlist_entry	eager_queue;
+	size_t			eager_active;
+	size_t			eager_total;
+	size_t			eager_connected;
+	size_t			eager_failed;
+
 	xnet_profile_t *profile;
 };
 
@@ -317,6 +329,9 @@ ssize_t xnet_get_conn(struct xnet_rdm *rdm, fi_addr_t dest_addr,
 		      struct xnet_conn **conn);
 struct xnet_ep *xnet_get_rx_ep(struct xnet_rdm *rdm, fi_addr_t addr);
 void xnet_freeall_conns(struct xnet_rdm *rdm);
+void xnet_eager_connect_progress(struct xnet_rdm *rdm);
+void xnet_av_insert_handler(struct util_ep *util_ep,
+			    struct util_peer_addr *peer);
 
 struct xnet_uring {
 	struct fid fid;
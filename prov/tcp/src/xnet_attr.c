@@ -38,6 +38,7 @@
 #define XNET_SRX_EP_CAPS (XNET_EP_CAPS | FI_TAGGED)
 #define XNET_RDM_EP_CAPS (XNET_EP_CAPS | FI_TAGGED)
 #define XNET_TX_CAPS	 (FI_SEND | FI_WRITE | FI_READ)
+#define XNET_RDM_TX_CAPS (XNET_TX_CAPS | FI_TRIGGER)
 #define XNET_RX_CAPS	 (FI_RECV | FI_REMOTE_READ | \
 			  FI_REMOTE_WRITE | FI_RMA_EVENT)
 #define XNET_SRX_CAPS	 (XNET_RX_CAPS | FI_DIRECTED_RECV | FI_SOURCE | \
@@ -115,7 +116,7 @@ static struct fi_ep_attr xnet_srx_ep_attr = {
 };
 
 static struct fi_tx_attr xnet_rdm_tx_attr = {
-	.caps = XNET_RDM_EP_CAPS | XNET_TX_CAPS,
+	.caps = XNET_RDM_EP_CAPS | XNET_RDM_TX_CAPS,
 	.op_flags = XNET_TX_OP_FLAGS,
 	.msg_order = XNET_MSG_ORDER,
 	.inject_size = XNET_DEF_INJECT,
@@ -192,7 +193,8 @@ struct fi_fabric_attr xnet_fabric_attr = {
 };
 
 static struct fi_info xnet_rdm_info = {
-	.caps = XNET_DOMAIN_CAPS | XNET_RDM_EP_CAPS | XNET_TX_CAPS | XNET_SRX_CAPS,
+	.caps = XNET_DOMAIN_CAPS | XNET_RDM_EP_CAPS | XNET_RDM_TX_CAPS |
+		XNET_SRX_CAPS,
 	.addr_format = FI_SOCKADDR_IP,
 	.tx_attr = &xnet_rdm_tx_attr,
 	.rx_attr = &xnet_rdm_rx_attr,
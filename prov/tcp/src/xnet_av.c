@@ -38,7 +38,9 @@ int xnet_av_open(struct fid_domain *domain_fid, struct fi_av_attr *attr,
 		 struct fid_av **fid_av, void *context)
 {
 	return rxm_util_av_open(domain_fid, attr, fid_av, context,
-				sizeof(struct xnet_conn), NULL, NULL);
+				sizeof(struct xnet_conn), NULL,
+				xnet_eager_connect ? xnet_av_insert_handler :
+						     NULL, NULL);
 }
 
 static int xnet_mplex_av_remove(struct fid_av *av_fid, fi_addr_t *fi_addr,
@@ -220,6 +222,7 @@ int xnet_mplex_av_open(struct fid_domain *domain_fid, struct fi_av_attr *attr,
 
 	util_attr.context_len = sizeof(struct util_peer_addr *);
 	util_attr.addrlen = ofi_sizeof_addr_format(domain->addr_format);
+	util_attr.flags = OFI_AV_SHAREABLE;
 	if (attr->type == FI_AV_UNSPEC)
 		attr->type = FI_AV_TABLE;
 
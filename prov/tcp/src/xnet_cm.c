@@ -361,19 +361,16 @@ disable:
 	xnet_ep_disable(ep, -ret, NULL, 0);
 }
 
-void xnet_accept_sock(struct xnet_pep *pep)
+static int xnet_accept_one(struct xnet_pep *pep)
 {
 	struct xnet_conn_handle *conn;
 	int ret;
 
-	FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "accepting socket\n");
-	assert(xnet_progress_locked(pep->progress));
-
 	conn = calloc(1, sizeof(*conn));
 	if (!conn) {
 		FI_WARN(&xnet_prov, FI_LOG_EP_CTRL,
 			"cannot allocate memory\n");
-		return;
+		return -FI_ENOMEM;
 	}
 
 	conn->fid.fclass = FI_CLASS_CONNREQ;
@@ -387,9 +384,7 @@ void xnet_accept_sock(struct xnet_pep *pep)
 	if (ret < 0) {
 		conn->sock = INVALID_SOCKET;
 		if (ret == -OFI_EINPROGRESS_URING)
-			return;
-
-		/* FIXME: handle EAGAIN */
+			return ret;
 
 		if (!OFI_SOCK_TRY_ACCEPT_AGAIN(-ret)) {
 			FI_WARN(&xnet_prov, FI_LOG_EP_CTRL,
@@ -403,10 +398,30 @@ void xnet_accept_sock(struct xnet_pep *pep)
 	if (ret)
 		goto close;
 
-	return;
+	return 0;
 
 close:
 	ofi_close_socket(conn->sock);
 free:
 	free(conn);
+	return ret;
+}
+
+/* A burst of connection requests, e.g. from an eagerly connecting job,
+ * is drained with up to xnet_accept_batch accept calls per wakeup.  The
+ * io_uring path posts a single accept and completes asynchronously.
+ */
+void xnet_accept_sock(struct xnet_pep *pep)
+{
+	size_t i;
+	int ret;
+
+	FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "accepting socket\n");
+	assert(xnet_progress_locked(pep->progress));
+
+	for (i = 0; i < xnet_accept_batch; i++) {
+		ret = xnet_accept_one(pep);
+		if (ret)
+			break;
+	}
 }
@@ -343,6 +343,7 @@ static uint64_t xnet_cntr_read(struct fid_cntr *cntr_fid)
 
 	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
 	xnet_progress(xnet_cntr2_progress(cntr), false);
+	ofi_trigger_progress(cntr->domain);
 	return ofi_atomic_get64(&cntr->cnt);
 }
 
@@ -352,6 +353,7 @@ static uint64_t xnet_cntr_readerr(struct fid_cntr *cntr_fid)
 
 	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
 	xnet_progress(xnet_cntr2_progress(cntr), false);
+	ofi_trigger_progress(cntr->domain);
 	return ofi_atomic_get64(&cntr->err);
 }
 
@@ -361,6 +363,7 @@ static int xnet_cntr_add(struct fid_cntr *cntr_fid, uint64_t value)
 
 	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
 	ofi_atomic_add64(&cntr->cnt, value);
+	ofi_trigger_cntr_update(cntr);
 	/* No need to signal, see comment above xnet_cntr_ops */
 	return FI_SUCCESS;
 }
@@ -371,6 +374,7 @@ static int xnet_cntr_adderr(struct fid_cntr *cntr_fid, uint64_t value)
 
 	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
 	ofi_atomic_add64(&cntr->err, value);
+	ofi_trigger_cntr_update(cntr);
 	/* No need to signal, see comment above xnet_cntr_ops */
 	return FI_SUCCESS;
 }
@@ -381,6 +385,7 @@ static int xnet_cntr_set(struct fid_cntr *cntr_fid, uint64_t value)
 
 	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
 	ofi_atomic_set64(&cntr->cnt, value);
+	ofi_trigger_cntr_update(cntr);
 	/* No need to signal, see comment above xnet_cntr_ops */
 	return FI_SUCCESS;
 }
@@ -391,6 +396,7 @@ static int xnet_cntr_seterr(struct fid_cntr *cntr_fid, uint64_t value)
 
 	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
 	ofi_atomic_set64(&cntr->err, value);
+	ofi_trigger_cntr_update(cntr);
 	/* No need to signal, see comment above xnet_cntr_ops */
 	return FI_SUCCESS;
 }
@@ -407,6 +413,7 @@ xnet_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold, int timeout)
 	endtime = ofi_timeout_time(timeout);
 
 	do {
+		ofi_trigger_progress(cntr->domain);
 		if (threshold <= (uint64_t) ofi_atomic_get64(&cntr->cnt))
 			return FI_SUCCESS;
 
@@ -456,6 +463,7 @@ int xnet_cntr_open(struct fid_domain *fid_domain, struct fi_cntr_attr *attr,
 	struct xnet_domain *domain;
 	struct util_cntr *cntr;
 	struct fi_cntr_attr cntr_attr;
+	bool auto_progress;
 	int ret;
 
 	cntr = calloc(1, sizeof(*cntr));
@@ -464,7 +472,10 @@ int xnet_cntr_open(struct fid_domain *fid_domain, struct fi_cntr_attr *attr,
 
 	domain = container_of(fid_domain, struct xnet_domain,
 			      util_domain.domain_fid);
-	if (attr->wait_obj == FI_WAIT_UNSPEC) {
+	auto_progress = !xnet_disable_autoprog &&
+			(domain->progress.auto_progress ||
+			 domain->util_domain.data_progress == FI_PROGRESS_AUTO);
+	if (attr->wait_obj == FI_WAIT_UNSPEC && !auto_progress) {
 		cntr_attr = *attr;
 		if (domain->progress.auto_progress ||
 		    domain->util_domain.threading != FI_THREAD_DOMAIN) {
@@ -476,8 +487,16 @@ int xnet_cntr_open(struct fid_domain *fid_domain, struct fi_cntr_attr *attr,
 		attr = &cntr_attr;
 	}
 
-	ret = ofi_cntr_init(&xnet_prov, fid_domain, attr, cntr,
-			    &xnet_cntr_progress, context);
+	/* With auto progress, FI_WAIT_UNSPEC waiters block on the counter
+	 * while the progress thread, started below, updates it.
+	 */
+	if (auto_progress)
+		ret = ofi_cntr_init_auto_progress(&xnet_prov, fid_domain, attr,
+						  cntr, &xnet_cntr_progress,
+						  context);
+	else
+		ret = ofi_cntr_init(&xnet_prov, fid_domain, attr, cntr,
+				    &xnet_cntr_progress, context);
 	if (ret)
 		goto free;
 
@@ -178,6 +178,7 @@ xnet_mplex_mr_regattr(struct fid *fid, const struct fi_mr_attr *attr,
 	struct xnet_domain *domain;
 	struct fid_list_entry *item;
 	struct fid_mr *sub_mr_fid;
+	struct fi_mr_attr sub_attr;
 	struct ofi_mr *mr;
 	int ret;
 
@@ -190,10 +191,16 @@ xnet_mplex_mr_regattr(struct fid *fid, const struct fi_mr_attr *attr,
 	mr = container_of(*mr_fid, struct ofi_mr, mr_fid.fid);
 	mr->mr_fid.fid.ops = &xnet_mplex_mr_fi_ops;
 
+	/* Subdomains must accept the key that was handed to the user */
+	sub_attr = *attr;
+	sub_attr.requested_key = mr->key;
+
 	ofi_genlock_lock(&domain->subdomain_list_lock);
 	dlist_foreach_container(&domain->subdomain_list,
 				struct fid_list_entry, item, entry) {
-		ret = xnet_mr_regattr(item->fid, attr, flags, &sub_mr_fid);
+		ret = xnet_mr_regattr(item->fid, &sub_attr,
+				      flags | OFI_MR_MAP_KEEP_KEY,
+				      &sub_mr_fid);
 		if (ret) {
 			FI_WARN(&xnet_prov, FI_LOG_MR,
 				"Failed to reg mr (%" PRIu64 ") from subdomain (%p)\n",
@@ -329,11 +336,19 @@ static struct fi_ops_domain xnet_mplex_domain_ops = {
 	.query_collective = fi_no_query_collective,
 };
 
+static int xnet_domain_ctrl(struct fid *fid, int command, void *arg)
+{
+	struct xnet_domain *domain;
+
+	domain = container_of(fid, struct xnet_domain, util_domain.domain_fid.fid);
+	return ofi_trigger_control(&domain->util_domain, command, arg);
+}
+
 static struct fi_ops xnet_mplex_domain_fi_ops = {
 	.size = sizeof(struct fi_ops),
 	.close = xnet_mplex_domain_close,
 	.bind = fi_no_bind,
-	.control = fi_no_control,
+	.control = xnet_domain_ctrl,
 	.ops_open = fi_no_ops_open,
 	.tostr = fi_no_tostr,
 	.ops_set = fi_no_ops_set,
@@ -413,7 +428,7 @@ static struct fi_ops xnet_domain_fi_ops = {
 	.size = sizeof(struct fi_ops),
 	.close = xnet_domain_close,
 	.bind = ofi_domain_bind,
-	.control = fi_no_control,
+	.control = xnet_domain_ctrl,
 	.ops_open = fi_no_ops_open,
 	.tostr = fi_no_tostr,
 	.ops_set = fi_no_ops_set,
@@ -72,6 +72,8 @@ size_t xnet_max_inject = XNET_DEF_INJECT;
 size_t xnet_buf_size = XNET_DEF_BUF_SIZE;
 size_t xnet_max_saved_size = SIZE_MAX;
 int xnet_firewall_addr = 0;
+size_t xnet_eager_connect;
+size_t xnet_accept_batch = 32;
 
 
 static void xnet_init_env(void)
@@ -190,6 +192,24 @@ static void xnet_init_env(void)
 
 	fi_param_define(&xnet_prov, "firewall_addr", FI_PARAM_BOOL, "if this node is behind firewall");
 	fi_param_get_bool(&xnet_prov, "firewall_addr", &xnet_firewall_addr);
+
+	fi_param_define(&xnet_prov, "eager_connect", FI_PARAM_SIZE_T,
+			"RDM endpoints connect to peers in the background as "
+			"they are inserted into the AV, rather than on the "
+			"first transfer to each peer.  The value bounds the "
+			"number of connections established concurrently "
+			"(default: 0, connect on first use)");
+	fi_param_get_size_t(&xnet_prov, "eager_connect", &xnet_eager_connect);
+
+	fi_param_define(&xnet_prov, "accept_batch", FI_PARAM_SIZE_T,
+			"Maximum number of pending connections accepted by "
+			"a listening socket per progress call (default: %zu)",
+			xnet_accept_batch);
+	fi_param_get_size_t(&xnet_prov, "accept_batch", &xnet_accept_batch);
+	if (!xnet_accept_batch)
+		xnet_accept_batch = 1;
+
+	ofi_bufpool_param_define(&xnet_prov);
 }
 
 static void xnet_fini(void)
@@ -1867,6 +1867,7 @@ static void xnet_destroy_uring(struct xnet_uring *uring,
 
 int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info)
 {
+	struct ofi_bufpool_attr attr = {0};
 	int ret;
 
 	progress->fid.fclass = XNET_CLASS_PROGRESS;
@@ -1890,9 +1891,11 @@ int xnet_init_progress(struct xnet_progress *progress, struct fi_info *info)
 	if (ret)
 		goto err2;
 
-	ret = ofi_bufpool_create(&progress->xfer_pool,
-			sizeof(struct xnet_xfer_entry) + xnet_buf_size,
-			16, 0, 1024, 0);
+	attr.size = sizeof(struct xnet_xfer_entry) + xnet_buf_size;
+	attr.alignment = 16;
+	attr.chunk_cnt = 1024;
+	ofi_bufpool_param_get(&xnet_prov, &attr);
+	ret = ofi_bufpool_create_attr(&attr, &progress->xfer_pool);
 	if (ret)
 		goto err3;
 
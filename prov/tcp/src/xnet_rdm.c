@@ -63,6 +63,9 @@ xnet_rdm_recvmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 {
 	struct xnet_rdm *rdm;
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_msg(ep_fid, msg, flags, FI_OP_RECV);
+
 	rdm = container_of(ep_fid, struct xnet_rdm, util_ep.ep_fid);
 	return fi_recvmsg(&rdm->srx->rx_fid, msg, flags);
 }
@@ -115,6 +118,9 @@ xnet_rdm_sendmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 	struct xnet_conn *conn;
 	ssize_t ret;
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_msg(ep_fid, msg, flags, FI_OP_SEND);
+
 	rdm = container_of(ep_fid, struct xnet_rdm, util_ep.ep_fid);
 	ofi_genlock_lock(&xnet_rdm2_progress(rdm)->rdm_lock);
 	ret = xnet_get_conn(rdm, msg->addr, &conn);
@@ -231,6 +237,9 @@ xnet_rdm_trecvmsg(struct fid_ep *ep_fid, const struct fi_msg_tagged *msg,
 {
 	struct xnet_rdm *rdm;
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_tagged(ep_fid, msg, flags, FI_OP_TRECV);
+
 	rdm = container_of(ep_fid, struct xnet_rdm, util_ep.ep_fid);
 	return fi_trecvmsg(&rdm->srx->rx_fid, msg, flags);
 }
@@ -286,6 +295,9 @@ xnet_rdm_tsendmsg(struct fid_ep *ep_fid, const struct fi_msg_tagged *msg,
 	struct xnet_conn *conn;
 	ssize_t ret;
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_tagged(ep_fid, msg, flags, FI_OP_TSEND);
+
 	rdm = container_of(ep_fid, struct xnet_rdm, util_ep.ep_fid);
 	ofi_genlock_lock(&xnet_rdm2_progress(rdm)->rdm_lock);
 	ret = xnet_get_conn(rdm, msg->addr, &conn);
@@ -425,6 +437,9 @@ xnet_rdm_readmsg(struct fid_ep *ep_fid, const struct fi_msg_rma *msg,
 	struct xnet_conn *conn;
 	ssize_t ret;
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_rma(ep_fid, msg, flags, FI_OP_READ);
+
 	rdm = container_of(ep_fid, struct xnet_rdm, util_ep.ep_fid);
 	ofi_genlock_lock(&xnet_rdm2_progress(rdm)->rdm_lock);
 	ret = xnet_get_conn(rdm, msg->addr, &conn);
@@ -489,6 +504,9 @@ xnet_rdm_writemsg(struct fid_ep *ep_fid, const struct fi_msg_rma *msg,
 	struct xnet_conn *conn;
 	ssize_t ret;
 
+	if (flags & FI_TRIGGER)
+		return ofi_trigger_queue_rma(ep_fid, msg, flags, FI_OP_WRITE);
+
 	rdm = container_of(ep_fid, struct xnet_rdm, util_ep.ep_fid);
 	ofi_genlock_lock(&xnet_rdm2_progress(rdm)->rdm_lock);
 	ret = xnet_get_conn(rdm, msg->addr, &conn);
@@ -712,17 +730,24 @@ static int xnet_mplex_av_dup(struct util_ep *ep, struct xnet_mplex_av *mplex_av,
 	char addr[sizeof(struct sockaddr_in6)];
 	struct fi_av_attr av_attr = {
 		.type = ep->domain->av_type,
-		.count = mplex_av->util_av.av_entry_pool->entry_cnt,
+		.count = ofi_av_size(&mplex_av->util_av),
 		.flags = 0,
 	};
 
 	assert(ofi_genlock_held(&mplex_av->lock));
+	/* A shared AV is mapped again rather than copied */
+	if (mplex_av->util_av.shm) {
+		av_attr.name = mplex_av->util_av.shm_name;
+		av_attr.flags = FI_READ;
+	}
+
 	ret = fi_av_open(&subdomain->util_domain.domain_fid, &av_attr, av_fid, NULL);
 	if (ret)
 		return ret;
 
 	subav = container_of(*av_fid, struct util_av, av_fid);
-	for (i = 0; i < mplex_av->util_av.av_entry_pool->entry_cnt; i++) {
+	for (i = 0; !subav->shm &&
+		    i < mplex_av->util_av.av_entry_pool->entry_cnt; i++) {
 		if (!ofi_ip_av_is_valid(&mplex_av->util_av.av_fid, i))
 			continue;
 
@@ -772,15 +797,17 @@ out:
 	return ret;
 }
 
-static int xnet_reg_subdomain_mr(struct ofi_rbmap *map, struct ofi_rbnode *node, void *context)
+static int xnet_reg_subdomain_mr(struct ofi_mr_map *map,
+				 struct fi_mr_attr *attr, void *context)
 {
 	int ret;
-	struct fi_mr_attr *attr = (struct fi_mr_attr *)node->data;
+	uint64_t key;
 	struct xnet_domain *subdomain = context;
 
 	ret = ofi_mr_map_insert(&subdomain->util_domain.mr_map, attr,
-				&attr->requested_key, attr->context,
-				((struct ofi_mr*)attr->context)->flags);
+				&key, attr->context,
+				((struct ofi_mr*)attr->context)->flags |
+				OFI_MR_MAP_KEEP_KEY);
 	if (ret) {
 		XNET_WARN_ERR(FI_LOG_MR, "ofi_mr_map_insert", ret);
 		return ret;
@@ -882,9 +909,8 @@ int xnet_rdm_resolve_domains(struct xnet_rdm *rdm)
 			goto out;
 		}
 
-		ret = ofi_rbmap_foreach(domain->util_domain.mr_map.rbtree,
-					domain->util_domain.mr_map.rbtree->root,
-					xnet_reg_subdomain_mr, subdomain);
+		ret = ofi_mr_map_foreach(&domain->util_domain.mr_map,
+					 xnet_reg_subdomain_mr, subdomain);
 		if (ret)
 			goto out;
 	}
@@ -928,6 +954,11 @@ static int xnet_enable_rdm(struct xnet_rdm *rdm)
 	}
 	(void) fi_ep_bind(&rdm->srx->rx_fid, &rdm->util_ep.ep_fid.fid,
 			  FI_TAGGED | FI_MSG);
+
+	/* queue eager connections to peers inserted before binding */
+	if (rdm->util_ep.av)
+		rxm_av_notify_ep(rdm->util_ep.av, &rdm->util_ep);
+
 	progress = xnet_rdm2_progress(rdm);
 	ofi_genlock_lock(&progress->rdm_lock);
 
@@ -960,6 +991,7 @@ static int xnet_enable_rdm(struct xnet_rdm *rdm)
 
 	info->src_addrlen = len;
 	ofi_addr_set_port(info->src_addr, 0);
+	xnet_eager_connect_progress(rdm);
 
 unlock:
 	ofi_genlock_unlock(&progress->rdm_lock);
@@ -992,6 +1024,8 @@ static int xnet_rdm_close(struct fid *fid)
 	int ret;
 
 	rdm = container_of(fid, struct xnet_rdm, util_ep.ep_fid.fid);
+	ofi_trigger_ep_cleanup(&rdm->util_ep);
+
 	ofi_genlock_lock(&xnet_rdm2_progress(rdm)->rdm_lock);
 	ret = fi_close(&rdm->pep->util_pep.pep_fid.fid);
 	if (ret) {
@@ -1101,6 +1135,8 @@ int xnet_rdm_ep(struct fid_domain *domain, struct fi_info *info,
 	if (ret)
 		goto err2;
 
+	dlist_init(&rdm->eager_queue);
+
 	*ep_fid = &rdm->util_ep.ep_fid;
 	(*ep_fid)->fid.ops = &xnet_rdm_fid_ops;
 	(*ep_fid)->ops = &xnet_rdm_ep_ops;
@@ -258,6 +258,36 @@ err:
 	return ret;
 }
 
+static void xnet_eager_conn_done(struct xnet_conn *conn, bool connected)
+{
+	struct xnet_rdm *rdm = conn->rdm;
+	size_t done;
+
+	if (!(conn->flags & (XNET_CONN_EAGER | XNET_CONN_EAGER_ACTIVE)))
+		return;
+
+	dlist_remove_init(&conn->eager_entry);
+	if (conn->flags & XNET_CONN_EAGER_ACTIVE)
+		rdm->eager_active--;
+	conn->flags &= ~(XNET_CONN_EAGER | XNET_CONN_EAGER_ACTIVE);
+
+	if (connected)
+		rdm->eager_connected++;
+	else
+		rdm->eager_failed++;
+
+	done = rdm->eager_connected + rdm->eager_failed;
+	if (done == rdm->eager_total) {
+		FI_INFO(&xnet_prov, FI_LOG_EP_CTRL,
+			"eager connect done: %zu connected, %zu failed\n",
+			rdm->eager_connected, rdm->eager_failed);
+	} else if (!(done % 1024)) {
+		FI_INFO(&xnet_prov, FI_LOG_EP_CTRL,
+			"eager connect: %zu of %zu done\n",
+			done, rdm->eager_total);
+	}
+}
+
 static void xnet_free_conn(struct xnet_conn *conn)
 {
 	struct rxm_av *av;
@@ -265,6 +295,8 @@ static void xnet_free_conn(struct xnet_conn *conn)
 	FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "free conn %p\n", conn);
 	assert(xnet_progress_locked(xnet_rdm2_progress(conn->rdm)));
 
+	xnet_eager_conn_done(conn, false);
+
 	if (conn->flags & XNET_CONN_INDEXED)
 		ofi_idm_clear(&conn->rdm->conn_idx_map, conn->peer->index);
 
@@ -323,6 +355,7 @@ static struct xnet_conn *xnet_alloc_conn(struct xnet_rdm *rdm,
 	conn->rdm = rdm;
 	conn->flags = 0;
 	conn->peer = peer;
+	dlist_init(&conn->eager_entry);
 	rxm_ref_peer(peer);
 
 	FI_DBG(&xnet_prov, FI_LOG_EP_CTRL, "allocated conn %p\n", conn);
@@ -353,6 +386,68 @@ static struct xnet_conn *xnet_add_conn(struct xnet_rdm *rdm,
 	return conn;
 }
 
+/* Start queued connections until xnet_eager_connect are in progress.
+ * An active connection is retired by its CONNECTED event, or when the
+ * conn is freed after a failure.
+ */
+void xnet_eager_connect_progress(struct xnet_rdm *rdm)
+{
+	struct xnet_conn *conn;
+	int ret;
+
+	assert(xnet_progress_locked(xnet_rdm2_progress(rdm)));
+	while (rdm->pep->state == XNET_LISTENING &&
+	       rdm->eager_active < xnet_eager_connect &&
+	       !dlist_empty(&rdm->eager_queue)) {
+		dlist_pop_front(&rdm->eager_queue, struct xnet_conn, conn,
+				eager_entry);
+		dlist_init(&conn->eager_entry);
+		conn->flags |= XNET_CONN_EAGER_ACTIVE;
+		rdm->eager_active++;
+
+		if (conn->ep) {
+			if (conn->ep->state == XNET_CONNECTED)
+				xnet_eager_conn_done(conn, true);
+			continue;
+		}
+
+		if (conn->peer->firewall_addr) {
+			xnet_eager_conn_done(conn, false);
+			continue;
+		}
+
+		ret = xnet_rdm_connect(conn);
+		if (ret) {
+			/* A later transfer retries the connection */
+			XNET_WARN_ERR(FI_LOG_EP_CTRL, "xnet_rdm_connect", ret);
+			xnet_eager_conn_done(conn, false);
+		}
+	}
+}
+
+void xnet_av_insert_handler(struct util_ep *util_ep,
+			    struct util_peer_addr *peer)
+{
+	struct xnet_progress *progress;
+	struct xnet_conn *conn;
+	struct xnet_rdm *rdm;
+
+	rdm = container_of(util_ep, struct xnet_rdm, util_ep);
+	progress = xnet_rdm2_progress(rdm);
+	ofi_genlock_lock(&progress->rdm_lock);
+	conn = xnet_add_conn(rdm, peer);
+	if (!conn || (conn->ep && conn->ep->state == XNET_CONNECTED) ||
+	    (conn->flags & (XNET_CONN_EAGER | XNET_CONN_EAGER_ACTIVE)))
+		goto unlock;
+
+	conn->flags |= XNET_CONN_EAGER;
+	dlist_insert_tail(&conn->eager_entry, &rdm->eager_queue);
+	rdm->eager_total++;
+	xnet_eager_connect_progress(rdm);
+unlock:
+	ofi_genlock_unlock(&progress->rdm_lock);
+}
+
 /* The returned conn is only valid if the function returns success.
  * This is called from data transfer ops, which return ssize_t, so
  * we return that rather than int.
@@ -364,7 +459,10 @@ ssize_t xnet_get_conn(struct xnet_rdm *rdm, fi_addr_t addr,
 	ssize_t ret;
 
 	assert(xnet_progress_locked(xnet_rdm2_progress(rdm)));
-	peer = ofi_av_addr_context(rdm->util_ep.av, addr);
+	peer = rxm_av_peer_ctx(rdm->util_ep.av, addr);
+	if (!*peer)
+		return -FI_ENOMEM;
+
 	*conn = xnet_add_conn(rdm, *peer);
 	if (!*conn)
 		return -FI_ENOMEM;
@@ -401,6 +499,9 @@ struct xnet_ep *xnet_get_rx_ep(struct xnet_rdm *rdm, fi_addr_t addr)
 
 	assert(xnet_progress_locked(xnet_rdm2_progress(rdm)));
 	peer = ofi_av_addr_context(rdm->util_ep.av, addr);
+	if (!*peer)
+		return NULL;
+
 	conn = ofi_idm_lookup(&rdm->conn_idx_map, (*peer)->index);
 	if (conn) {
 		if (conn->flags & XNET_CONN_TX_LOOPBACK) {
@@ -577,6 +678,7 @@ static void xnet_process_connected(struct fi_eq_cm_entry *cm_entry)
 
 	FI_INFO(&xnet_prov, FI_LOG_EP_CTRL, "peer %s feature supported: %x\n",
 		conn->peer->str_addr, msg->features);
+	xnet_eager_conn_done(conn, true);
 }
 
 void xnet_handle_event_list(struct xnet_progress *progress)
@@ -609,6 +711,8 @@ void xnet_handle_event_list(struct xnet_progress *progress)
 			assert(0);
 			break;
 		}
+		if (!dlist_empty(&event->rdm->eager_queue))
+			xnet_eager_connect_progress(event->rdm);
 		free(event);
 	};
 }
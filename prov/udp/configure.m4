@@ -13,6 +13,7 @@ AC_DEFUN([FI_UDP_CONFIGURE],[
 	AS_IF([test x"$enable_udp" != x"no"],
 	      [AC_CHECK_HEADER([sys/socket.h], [udp_h_happy=1],
 	                       [udp_h_happy=0])
+	       AC_CHECK_FUNCS([recvmmsg sendmmsg])
 	      ])
 
 	AS_IF([test $udp_h_happy -eq 1], [$1], [$2])
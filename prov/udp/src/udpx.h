@@ -68,6 +68,11 @@ extern struct fi_provider udpx_prov;
 extern struct util_prov udpx_util_prov;
 extern struct fi_info udpx_info;
 
+extern size_t udpx_rx_batch;
+extern size_t udpx_tx_batch;
+extern int udpx_busy_poll;
+extern int udpx_prefer_busy_poll;
+
 
 int udpx_fabric(struct fi_fabric_attr *attr, struct fid_fabric **fabric,
 		void *context);
@@ -79,6 +84,7 @@ int udpx_eq_open(struct fid_fabric *fabric, struct fi_eq_attr *attr,
 
 #define UDPX_FLAG_MULTI_RECV	1
 #define UDPX_IOV_LIMIT		4
+#define UDPX_BATCH_MAX		64
 
 struct udpx_ep_entry {
 	void			*context;
@@ -90,6 +96,20 @@ struct udpx_ep_entry {
 
 OFI_DECLARE_CIRQUE(struct udpx_ep_entry, udpx_rx_cirq);
 
+/* A send waiting to be flushed with the next batch */
+struct udpx_tx_entry {
+	void			*context;
+	struct iovec		iov[UDPX_IOV_LIMIT];
+	size_t			iov_count;
+	union {
+		struct sockaddr_in	sin;
+		struct sockaddr_in6	sin6;
+	} addr;
+	socklen_t		addrlen;
+};
+
+OFI_DECLARE_CIRQUE(struct udpx_tx_entry, udpx_tx_cirq);
+
 struct udpx_ep;
 typedef void (*udpx_rx_comp_func)(struct udpx_ep *ep, void *context, size_t len,
 				  void *addr);
@@ -100,6 +120,7 @@ struct udpx_ep {
 	udpx_rx_comp_func	rx_comp;
 	udpx_tx_comp_func	tx_comp;
 	struct udpx_rx_cirq	*rxq;    /* protected by rx_cq lock */
+	struct udpx_tx_cirq	*txq;    /* protected by tx_cq lock */
 	SOCKET			sock;
 	int			is_bound;
 	ofi_atomic32_t		ref;
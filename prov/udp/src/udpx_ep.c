@@ -272,36 +272,189 @@ static void udpx_rx_src_comp_signal(struct udpx_ep *ep, void *context,
 	ep->util_ep.rx_cq->wait->signal(ep->util_ep.rx_cq->wait);
 }
 
-static void udpx_ep_progress(struct util_ep *util_ep)
+#if HAVE_RECVMMSG
+/*
+ * Fill as many posted receives as there are datagrams waiting, up to
+ * udpx_rx_batch, with a single recvmmsg call.
+ */
+static void udpx_ep_progress_rx(struct udpx_ep *ep)
+{
+	struct mmsghdr msgs[UDPX_BATCH_MAX];
+	struct sockaddr_in6 addrs[UDPX_BATCH_MAX];
+	struct udpx_ep_entry *entry;
+	size_t i, cnt;
+	int ret;
+
+	cnt = MIN(MIN(ofi_cirque_usedcnt(ep->rxq),
+		      ofi_cirque_freecnt(ep->util_ep.rx_cq->cirq)),
+		  udpx_rx_batch);
+
+	for (i = 0; i < cnt; i++) {
+		entry = &ep->rxq->buf[(ep->rxq->rcnt + i) &
+				      ep->rxq->size_mask];
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+		msgs[i].msg_hdr.msg_iov = entry->iov;
+		msgs[i].msg_hdr.msg_iovlen = entry->iov_count;
+		msgs[i].msg_hdr.msg_control = NULL;
+		msgs[i].msg_hdr.msg_controllen = 0;
+		msgs[i].msg_hdr.msg_flags = 0;
+	}
+
+	ret = recvmmsg(ep->sock, msgs, (unsigned int) cnt, MSG_DONTWAIT, NULL);
+	for (i = 0; ret > 0 && i < (size_t) ret; i++) {
+		entry = ofi_cirque_head(ep->rxq);
+		ep->rx_comp(ep, entry->context, msgs[i].msg_len, &addrs[i]);
+		ofi_cirque_discard(ep->rxq);
+	}
+}
+#else
+static void udpx_ep_progress_rx(struct udpx_ep *ep)
 {
-	struct udpx_ep *ep;
 	struct udpx_ep_entry *entry;
 	struct msghdr hdr;
 	struct sockaddr_in6 addr;
+	size_t cnt;
 	ssize_t ret;
 
-	ep = container_of(util_ep, struct udpx_ep, util_ep);
 	hdr.msg_name = &addr;
-	hdr.msg_namelen = sizeof(addr);
 	hdr.msg_control = NULL;
 	hdr.msg_controllen = 0;
 	hdr.msg_flags = 0;
 
-	ofi_genlock_lock(&ep->util_ep.rx_cq->cq_lock);
-	if (ofi_cirque_isempty(ep->rxq) ||
-	    ofi_cirque_isfull(ep->util_ep.rx_cq->cirq))
-		goto out;
+	cnt = MIN(MIN(ofi_cirque_usedcnt(ep->rxq),
+		      ofi_cirque_freecnt(ep->util_ep.rx_cq->cirq)),
+		  udpx_rx_batch);
 
-	entry = ofi_cirque_head(ep->rxq);
-	hdr.msg_iov = entry->iov;
-	hdr.msg_iovlen = entry->iov_count;
+	while (cnt--) {
+		entry = ofi_cirque_head(ep->rxq);
+		hdr.msg_namelen = sizeof(addr);
+		hdr.msg_iov = entry->iov;
+		hdr.msg_iovlen = entry->iov_count;
+
+		ret = ofi_recvmsg_udp(ep->sock, &hdr, 0);
+		if (ret < 0)
+			break;
 
-	ret = ofi_recvmsg_udp(ep->sock, &hdr, 0);
-	if (ret >= 0) {
 		ep->rx_comp(ep, entry->context, ret, &addr);
 		ofi_cirque_discard(ep->rxq);
 	}
-out:
+}
+#endif
+
+static void udpx_tx_flush_err(struct udpx_ep *ep, int err)
+{
+	struct fi_cq_err_entry err_entry = {0};
+	struct udpx_tx_entry *entry;
+
+	entry = ofi_cirque_remove(ep->txq);
+	err_entry.op_context = entry->context;
+	err_entry.flags = FI_SEND;
+	err_entry.err = err;
+	err_entry.prov_errno = -err;
+
+	FI_WARN(&udpx_prov, FI_LOG_EP_DATA, "send failed %d (%s)\n",
+		err, strerror(err));
+
+	if (ofi_cq_insert_error(ep->util_ep.tx_cq, &err_entry))
+		FI_WARN(&udpx_prov, FI_LOG_EP_DATA,
+			"unable to report send error\n");
+	else if (ep->util_ep.tx_cq->wait)
+		ep->util_ep.tx_cq->wait->signal(ep->util_ep.tx_cq->wait);
+}
+
+/*
+ * Write the queued sends to the socket. Sends that would block stay queued
+ * for the next flush, other socket errors are reported as error completions.
+ * Called with the tx_cq lock held.
+ */
+#if HAVE_SENDMMSG
+static void udpx_tx_flush(struct udpx_ep *ep)
+{
+	struct mmsghdr msgs[UDPX_BATCH_MAX];
+	struct udpx_tx_entry *entry;
+	size_t i, cnt;
+	int ret;
+
+	while (!ofi_cirque_isempty(ep->txq)) {
+		cnt = ofi_cirque_usedcnt(ep->txq);
+		for (i = 0; i < cnt; i++) {
+			entry = &ep->txq->buf[(ep->txq->rcnt + i) &
+					      ep->txq->size_mask];
+			msgs[i].msg_hdr.msg_name = &entry->addr;
+			msgs[i].msg_hdr.msg_namelen = entry->addrlen;
+			msgs[i].msg_hdr.msg_iov = entry->iov;
+			msgs[i].msg_hdr.msg_iovlen = entry->iov_count;
+			msgs[i].msg_hdr.msg_control = NULL;
+			msgs[i].msg_hdr.msg_controllen = 0;
+			msgs[i].msg_hdr.msg_flags = 0;
+		}
+
+		ret = sendmmsg(ep->sock, msgs, (unsigned int) cnt, 0);
+		if (ret < 0) {
+			if (OFI_SOCK_TRY_SND_RCV_AGAIN(errno))
+				return;
+			udpx_tx_flush_err(ep, errno);
+			continue;
+		}
+
+		while (ret--) {
+			entry = ofi_cirque_remove(ep->txq);
+			ep->tx_comp(ep, entry->context);
+		}
+	}
+}
+#else
+static void udpx_tx_flush(struct udpx_ep *ep)
+{
+	struct udpx_tx_entry *entry;
+	struct msghdr hdr;
+	ssize_t ret;
+
+	hdr.msg_control = NULL;
+	hdr.msg_controllen = 0;
+	hdr.msg_flags = 0;
+
+	while (!ofi_cirque_isempty(ep->txq)) {
+		entry = ofi_cirque_head(ep->txq);
+		hdr.msg_name = &entry->addr;
+		hdr.msg_namelen = entry->addrlen;
+		hdr.msg_iov = entry->iov;
+		hdr.msg_iovlen = entry->iov_count;
+
+		ret = ofi_sendmsg_udp(ep->sock, &hdr, 0);
+		if (ret < 0) {
+			if (OFI_SOCK_TRY_SND_RCV_AGAIN(ofi_sockerr()))
+				return;
+			udpx_tx_flush_err(ep, ofi_sockerr());
+			continue;
+		}
+
+		ofi_cirque_discard(ep->txq);
+		ep->tx_comp(ep, entry->context);
+	}
+}
+#endif
+
+static void udpx_ep_progress(struct util_ep *util_ep)
+{
+	struct udpx_ep *ep;
+
+	ep = container_of(util_ep, struct udpx_ep, util_ep);
+
+	if (ep->txq) {
+		ofi_genlock_lock(&ep->util_ep.tx_cq->cq_lock);
+		udpx_tx_flush(ep);
+		ofi_genlock_unlock(&ep->util_ep.tx_cq->cq_lock);
+	}
+
+	if (!ep->util_ep.rx_cq)
+		return;
+
+	ofi_genlock_lock(&ep->util_ep.rx_cq->cq_lock);
+	if (!ofi_cirque_isempty(ep->rxq) &&
+	    !ofi_cirque_isfull(ep->util_ep.rx_cq->cirq))
+		udpx_ep_progress_rx(ep);
 	ofi_genlock_unlock(&ep->util_ep.rx_cq->cq_lock);
 }
 
@@ -390,9 +543,63 @@ udpx_dest_addrlen(struct udpx_ep *ep, fi_addr_t addr, uint64_t flags)
 		ep->util_ep.av->addrlen;
 }
 
+/*
+ * Queue a send for the next batch. Sends posted with FI_MORE wait for the
+ * first one posted without it, which writes the whole batch to the socket.
+ * A full batch is written right away. Called with the tx_cq lock held.
+ */
+static ssize_t udpx_tx_queue(struct udpx_ep *ep, const struct iovec *iov,
+			     size_t count, const void *addr, size_t addrlen,
+			     void *context, uint64_t flags)
+{
+	struct udpx_tx_entry *entry;
+
+	assert(count <= UDPX_IOV_LIMIT && addrlen <= sizeof(entry->addr));
+
+	if (ofi_cirque_isfull(ep->txq))
+		udpx_tx_flush(ep);
+
+	/* every queued send needs a CQ entry once it is flushed */
+	if (ofi_cirque_isfull(ep->txq) ||
+	    ofi_cirque_freecnt(ep->util_ep.tx_cq->cirq) <=
+	    ofi_cirque_usedcnt(ep->txq))
+		return -FI_EAGAIN;
+
+	entry = ofi_cirque_next(ep->txq);
+	entry->context = context;
+	memcpy(entry->iov, iov, sizeof(*iov) * count);
+	entry->iov_count = count;
+	memcpy(&entry->addr, addr, addrlen);
+	entry->addrlen = (socklen_t) addrlen;
+	ofi_cirque_commit(ep->txq);
+
+	if (!(flags & FI_MORE) || ofi_cirque_isfull(ep->txq))
+		udpx_tx_flush(ep);
+
+	return 0;
+}
+
+static void udpx_tx_flush_locked(struct udpx_ep *ep)
+{
+	ofi_genlock_lock(&ep->util_ep.tx_cq->cq_lock);
+	udpx_tx_flush(ep);
+	ofi_genlock_unlock(&ep->util_ep.tx_cq->cq_lock);
+}
+
+/* Flush the queued sends one last time, and cancel those still queued */
+static void udpx_tx_cancel(struct udpx_ep *ep)
+{
+	ofi_genlock_lock(&ep->util_ep.tx_cq->cq_lock);
+	udpx_tx_flush(ep);
+	while (!ofi_cirque_isempty(ep->txq))
+		udpx_tx_flush_err(ep, FI_ECANCELED);
+	ofi_genlock_unlock(&ep->util_ep.tx_cq->cq_lock);
+}
+
 static ssize_t udpx_sendto(struct udpx_ep *ep, const void *buf, size_t len,
 			   const void *addr, size_t addrlen, void *context)
 {
+	struct iovec iov;
 	ssize_t ret;
 
 	ofi_genlock_lock(&ep->util_ep.tx_cq->cq_lock);
@@ -401,6 +608,13 @@ static ssize_t udpx_sendto(struct udpx_ep *ep, const void *buf, size_t len,
 		goto out;
 	}
 
+	if (ep->txq) {
+		iov.iov_base = (void *) buf;
+		iov.iov_len = len;
+		ret = udpx_tx_queue(ep, &iov, 1, addr, addrlen, context, 0);
+		goto out;
+	}
+
 	ret = ofi_sendto_socket(ep->sock, buf, len, 0,
 				addr, (socklen_t)addrlen);
 	if (ret == (ssize_t)len) {
@@ -457,6 +671,17 @@ static ssize_t udpx_sendmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 		goto out;
 	}
 
+	if (ep->txq) {
+		/* the buffers of an inject may be reused once we return */
+		if (!(flags & FI_INJECT)) {
+			ret = udpx_tx_queue(ep, msg->msg_iov, msg->iov_count,
+					    hdr.msg_name, hdr.msg_namelen,
+					    msg->context, flags);
+			goto out;
+		}
+		udpx_tx_flush(ep);
+	}
+
 	ret = ofi_sendmsg_udp(ep->sock, &hdr, 0);
 	if (ret >= 0) {
 		ep->tx_comp(ep, msg->context);
@@ -504,6 +729,9 @@ static ssize_t udpx_inject(struct fid_ep *ep_fid, const void *buf, size_t len,
 	ssize_t ret;
 
 	ep = container_of(ep_fid, struct udpx_ep, util_ep.ep_fid.fid);
+	if (ep->txq)
+		udpx_tx_flush_locked(ep);
+
 	ret = ofi_sendto_socket(ep->sock, buf, len, 0,
 				ofi_ip_av_get_addr(ep->util_ep.av, (int)dest_addr),
 				(socklen_t)ep->util_ep.av->addrlen);
@@ -517,6 +745,9 @@ static ssize_t udpx_inject_mc(struct fid_ep *ep_fid, const void *buf,
 	ssize_t ret;
 
 	ep = container_of(ep_fid, struct udpx_ep, util_ep.ep_fid.fid);
+	if (ep->txq)
+		udpx_tx_flush_locked(ep);
+
 	ret = ofi_sendto_socket(ep->sock, buf, len, 0,
 				(const void *)(uintptr_t)dest_addr,
 				(socklen_t)ofi_sizeofaddr((const void *)(uintptr_t)dest_addr));
@@ -571,6 +802,15 @@ static int udpx_ep_close(struct fid *fid)
 				&ep->util_ep.ep_fid.fid);
 	}
 
+	if (ep->txq) {
+		if (ep->util_ep.tx_cq != ep->util_ep.rx_cq)
+			fid_list_remove2(&ep->util_ep.tx_cq->ep_list,
+					 &ep->util_ep.tx_cq->ep_list_lock,
+					 &ep->util_ep.ep_fid.fid);
+		udpx_tx_cancel(ep);
+		udpx_tx_cirq_free(ep->txq);
+	}
+
 	udpx_rx_cirq_free(ep->rxq);
 	ofi_close_socket(ep->sock);
 	ofi_endpoint_close(&ep->util_ep);
@@ -593,6 +833,20 @@ static int udpx_ep_bind_cq(struct udpx_ep *ep, struct util_cq *cq,
 		ofi_atomic_inc32(&cq->ref);
 		ep->tx_comp = cq->wait ? udpx_tx_comp_signal :
 					 udpx_tx_comp;
+
+		/* queued sends are flushed by progress, which has to run
+		 * when either CQ is read */
+		if (udpx_tx_batch > 1) {
+			ep->txq = udpx_tx_cirq_create(udpx_tx_batch);
+			if (!ep->txq)
+				return -FI_ENOMEM;
+
+			ret = fid_list_insert2(&cq->ep_list,
+					       &cq->ep_list_lock,
+					       &ep->util_ep.ep_fid.fid);
+			if (ret)
+				return ret;
+		}
 	}
 
 	if (flags & FI_RECV) {
@@ -724,6 +978,36 @@ static struct fi_ops udpx_ep_fi_ops = {
 	.ops_open = fi_no_ops_open,
 };
 
+/* Busy polling is a latency optimization, failing to enable it is not fatal */
+static void udpx_set_busy_poll(struct udpx_ep *ep)
+{
+#ifdef SO_BUSY_POLL
+	int val;
+
+	if (udpx_busy_poll > 0 &&
+	    setsockopt(ep->sock, SOL_SOCKET, SO_BUSY_POLL,
+		       (const void *) &udpx_busy_poll,
+		       sizeof(udpx_busy_poll))) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+			"setsockopt SO_BUSY_POLL failed %d (%s)\n",
+			errno, strerror(errno));
+	}
+
+#ifdef SO_PREFER_BUSY_POLL
+	val = 1;
+	if (udpx_prefer_busy_poll &&
+	    setsockopt(ep->sock, SOL_SOCKET, SO_PREFER_BUSY_POLL,
+		       (const void *) &val, sizeof(val))) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+			"setsockopt SO_PREFER_BUSY_POLL failed %d (%s)\n",
+			errno, strerror(errno));
+	}
+#else
+	(void) val;
+#endif
+#endif
+}
+
 static int udpx_ep_init(struct udpx_ep *ep, struct fi_info *info)
 {
 	int family;
@@ -755,6 +1039,7 @@ static int udpx_ep_init(struct udpx_ep *ep, struct fi_info *info)
 	if (ret)
 		goto err2;
 
+	udpx_set_busy_poll(ep);
 	return 0;
 err2:
 	ofi_close_socket(ep->sock);
@@ -37,6 +37,10 @@
 
 #include <sys/types.h>
 
+size_t udpx_rx_batch = 16;
+size_t udpx_tx_batch = 16;
+int udpx_busy_poll;
+int udpx_prefer_busy_poll;
 
 static int udpx_getinfo(uint32_t version, const char *node, const char *service,
 			uint64_t flags, const struct fi_info *hints,
@@ -46,6 +50,23 @@ static int udpx_getinfo(uint32_t version, const char *node, const char *service,
 			      hints, info);
 }
 
+static void udpx_init_env(void)
+{
+	fi_param_get_size_t(&udpx_prov, "rx_batch", &udpx_rx_batch);
+	if (!udpx_rx_batch)
+		udpx_rx_batch = 1;
+	else if (udpx_rx_batch > UDPX_BATCH_MAX)
+		udpx_rx_batch = UDPX_BATCH_MAX;
+
+	fi_param_get_size_t(&udpx_prov, "tx_batch", &udpx_tx_batch);
+	if (udpx_tx_batch > UDPX_BATCH_MAX)
+		udpx_tx_batch = UDPX_BATCH_MAX;
+
+	fi_param_get_int(&udpx_prov, "busy_poll", &udpx_busy_poll);
+	fi_param_get_bool(&udpx_prov, "prefer_busy_poll",
+			  &udpx_prefer_busy_poll);
+}
+
 static void udpx_fini(void)
 {
 	/* yawn */
@@ -64,6 +85,26 @@ UDP_INI
 {
 	fi_param_define(&udpx_prov, "iface", FI_PARAM_STRING,
 			"Specify interface name");
+	fi_param_define(&udpx_prov, "rx_batch", FI_PARAM_SIZE_T,
+			"Maximum number of datagrams received by a single "
+			"progress call, using recvmmsg where available "
+			"(default: %zu, max: %d)", udpx_rx_batch,
+			UDPX_BATCH_MAX);
+	fi_param_define(&udpx_prov, "tx_batch", FI_PARAM_SIZE_T,
+			"Maximum number of sends posted with FI_MORE that are "
+			"queued until a send without FI_MORE writes them to "
+			"the socket, using sendmmsg where available.  0 or 1 "
+			"ignores FI_MORE (default: %zu, max: %d)", udpx_tx_batch,
+			UDPX_BATCH_MAX);
+	fi_param_define(&udpx_prov, "busy_poll", FI_PARAM_INT,
+			"Set SO_BUSY_POLL on the endpoint sockets to the "
+			"given number of microseconds (default: %d)",
+			udpx_busy_poll);
+	fi_param_define(&udpx_prov, "prefer_busy_poll", FI_PARAM_BOOL,
+			"Set SO_PREFER_BUSY_POLL on the endpoint sockets "
+			"(default: %d)", udpx_prefer_busy_poll);
+
+	udpx_init_env();
 
 	return &udpx_prov;
 }
@@ -80,6 +80,10 @@ static struct util_peer_addr *rxm_alloc_peer(struct rxm_av *av,
 	peer->index = (int) ofi_buf_index(peer);
 	peer->fi_addr = FI_ADDR_NOTAVAIL;
 	peer->refcnt = 1;
+	/* another process may have inserted the address */
+	if (av->util_av.shm)
+		peer->fi_addr = ofi_av_lookup_fi_addr_unsafe(&av->util_av,
+							     addr);
 	memcpy(&peer->addr, addr, av->util_av.addrlen);
 	peer->firewall_addr = false;
 
@@ -149,6 +153,40 @@ void rxm_ref_peer(struct util_peer_addr *peer)
 	ofi_genlock_unlock(&peer->av->util_av.lock);
 }
 
+/*
+ * Entries of a shared AV may have been inserted by another process, in
+ * which case their peer is created on first use.
+ */
+struct util_peer_addr **rxm_av_peer_ctx(struct util_av *util_av,
+					fi_addr_t fi_addr)
+{
+	struct util_peer_addr **peer;
+	struct ofi_rbnode *node;
+	struct rxm_av *av;
+	void *addr;
+
+	peer = ofi_av_addr_context(util_av, fi_addr);
+	if (OFI_LIKELY(!util_av->shm || *peer))
+		return peer;
+
+	av = container_of(util_av, struct rxm_av, util_av);
+	ofi_genlock_lock(&util_av->lock);
+	addr = ofi_av_get_addr(util_av, fi_addr);
+	if (!*peer && addr) {
+		node = ofi_rbmap_find(&av->addr_map, addr);
+		if (node) {
+			*peer = node->data;
+			(*peer)->refcnt++;
+		} else {
+			*peer = rxm_alloc_peer(av, addr);
+		}
+		if (*peer)
+			(*peer)->fi_addr = fi_addr;
+	}
+	ofi_genlock_unlock(&util_av->lock);
+	return peer;
+}
+
 static void rxm_set_av_context(struct rxm_av *av, fi_addr_t fi_addr,
 			       struct util_peer_addr *peer)
 {
@@ -231,6 +269,11 @@ static int rxm_av_remove(struct fid_av *av_fid, fi_addr_t *fi_addr,
 		return -FI_EINVAL;
 
 	av = container_of(av_fid, struct rxm_av, util_av.av_fid);
+	if (av->util_av.shm) {
+		FI_WARN(av->util_av.prov, FI_LOG_AV,
+			"addresses cannot be removed from a shared AV\n");
+		return -FI_EOPNOTSUPP;
+	}
 
 	/*
 	 * It's more efficient to remove addresses from high to low index.
@@ -278,8 +321,7 @@ static int rxm_av_remove(struct fid_av *av_fid, fi_addr_t *fi_addr,
 
 		if (!ofi_atomic_dec32(&av_entry->use_cnt)) {
 			rxm_put_peer_addr(av, fi_addr[i]);
-			HASH_DELETE(hh, av->util_av.hash, av_entry);
-			ofi_ibuf_free(av_entry);
+			ofi_av_free_entry(&av->util_av, av_entry);
 		}
 	}
 	ofi_genlock_unlock(&av->util_av.lock);
@@ -287,6 +329,89 @@ static int rxm_av_remove(struct fid_av *av_fid, fi_addr_t *fi_addr,
 	return ret;
 }
 
+static void rxm_av_notify_insert(struct rxm_av *av, const void *addr,
+				 size_t count, fi_addr_t *fi_addr)
+{
+	struct util_peer_addr **peer;
+	struct util_ep *util_ep;
+	struct dlist_entry *item;
+	fi_addr_t cur_fi_addr;
+	size_t i;
+
+	ofi_genlock_lock(&av->util_av.ep_list_lock);
+	if (dlist_empty(&av->util_av.ep_list))
+		goto out;
+
+	for (i = 0; i < count; i++) {
+		cur_fi_addr = (fi_addr) ? fi_addr[i] :
+			ofi_av_lookup_fi_addr(&av->util_av,
+				(char *) addr + i * av->util_av.addrlen);
+		if (cur_fi_addr == FI_ADDR_NOTAVAIL)
+			continue;
+
+		peer = ofi_av_addr_context(&av->util_av, cur_fi_addr);
+		if (!*peer)
+			continue;
+
+		dlist_foreach(&av->util_av.ep_list, item) {
+			util_ep = container_of(item, struct util_ep, av_entry);
+			av->insert_handler(util_ep, *peer);
+		}
+	}
+out:
+	ofi_genlock_unlock(&av->util_av.ep_list_lock);
+}
+
+/*
+ * Pass the addresses inserted before an endpoint was bound to the AV to
+ * its insert handler.  Called when the endpoint is enabled.  As with
+ * removal, the AV lock is dropped around the handler and a reference
+ * keeps the peer valid.
+ */
+void rxm_av_notify_ep(struct util_av *util_av, struct util_ep *util_ep)
+{
+	struct util_peer_addr *peer;
+	struct ofi_bufpool *pool;
+	struct rxm_av *av;
+	fi_addr_t fi_addr;
+	size_t cnt;
+
+	av = container_of(util_av, struct rxm_av, util_av);
+	if (!av->insert_handler)
+		return;
+
+	ofi_genlock_lock(&util_av->lock);
+	pool = util_av->av_entry_pool;
+	cnt = util_av->shm ?
+	      (size_t) ofi_atomic_load_explicit64(&util_av->shm->count,
+						  memory_order_acquire) :
+	      pool->region_cnt * pool->attr.chunk_cnt;
+	ofi_genlock_unlock(&util_av->lock);
+
+	for (fi_addr = 0; fi_addr < cnt; fi_addr++) {
+		/* creates the peers of entries inserted by other processes */
+		if (util_av->shm)
+			(void) rxm_av_peer_ctx(util_av, fi_addr);
+
+		ofi_genlock_lock(&util_av->lock);
+		peer = ofi_av_is_valid(util_av, fi_addr) ?
+		       *(struct util_peer_addr **)
+		       ofi_av_addr_context(util_av, fi_addr) : NULL;
+		if (!peer) {
+			ofi_genlock_unlock(&util_av->lock);
+			continue;
+		}
+		peer->refcnt++;
+		ofi_genlock_unlock(&util_av->lock);
+
+		av->insert_handler(util_ep, peer);
+
+		ofi_genlock_lock(&util_av->lock);
+		util_deref_peer(peer);
+		ofi_genlock_unlock(&util_av->lock);
+	}
+}
+
 static int rxm_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
 			 fi_addr_t *fi_addr, uint64_t flags, void *context)
 {
@@ -316,6 +441,9 @@ static int rxm_av_insert(struct fid_av *av_fid, const void *addr, size_t count,
 		goto out;
 	}
 
+	if (av->insert_handler)
+		rxm_av_notify_insert(av, addr, count, fi_addr);
+
 	if (!av->foreach_ep)
 		goto out;
 
@@ -362,6 +490,9 @@ static int rxm_av_insertsym(struct fid_av *av_fid, const char *node,
 		return ret;
 	}
 
+	if (av->insert_handler)
+		rxm_av_notify_insert(av, addr, count, fi_addr);
+
 	free(addr);
 	return (int) count;
 }
@@ -443,6 +574,8 @@ int rxm_util_av_open(struct fid_domain *domain_fid, struct fi_av_attr *attr,
 		     struct fid_av **fid_av, void *context, size_t conn_size,
 		     void (*remove_handler)(struct util_ep *util_ep,
 					    struct util_peer_addr *peer),
+		     void (*insert_handler)(struct util_ep *util_ep,
+					    struct util_peer_addr *peer),
 		     void (*foreach_ep)(struct util_av *av, struct util_ep *ep))
 
 {
@@ -469,7 +602,7 @@ int rxm_util_av_open(struct fid_domain *domain_fid, struct fi_av_attr *attr,
 	domain = container_of(domain_fid, struct util_domain, domain_fid);
 
 	util_attr.context_len = sizeof(struct util_peer_addr *);
-	util_attr.flags = 0;
+	util_attr.flags = OFI_AV_SHAREABLE;
 	util_attr.addrlen = ofi_sizeof_addr_format(domain->addr_format);
 	if (attr->type == FI_AV_UNSPEC)
 		attr->type = FI_AV_TABLE;
@@ -481,6 +614,7 @@ int rxm_util_av_open(struct fid_domain *domain_fid, struct fi_av_attr *attr,
 	av->util_av.av_fid.fid.ops = &rxm_av_fi_ops;
 	av->util_av.av_fid.ops = &rxm_av_ops;
 	av->util_av.remove_handler = remove_handler;
+	av->insert_handler = insert_handler;
 	av->foreach_ep = foreach_ep;
 	*fid_av = &av->util_av.av_fid;
 	return 0;
@@ -86,6 +86,52 @@ static void ofi_uffd_unsubscribe(struct ofi_mem_monitor *monitor,
 				 const void *addr, size_t len,
 				 union ofi_mr_hmem_info *hmem_info);
 
+/* Maximum number of events read from the userfault fd with one read(). */
+#define OFI_UFFD_BATCH 64
+
+static int ofi_uffd_range_cmp(const void *a, const void *b)
+{
+	const struct iovec *x = a, *y = b;
+
+	if (x->iov_base < y->iov_base)
+		return -1;
+	return x->iov_base > y->iov_base;
+}
+
+static void ofi_uffd_add_range(struct iovec *ranges, size_t *cnt,
+			       uint64_t start, uint64_t len)
+{
+	ranges[*cnt].iov_base = (void *) (uintptr_t) start;
+	ranges[*cnt].iov_len = (size_t) len;
+	(*cnt)++;
+}
+
+/* Merge overlapping and adjacent ranges, then notify each result once. */
+static void ofi_uffd_notify_ranges(struct iovec *ranges, size_t cnt)
+{
+	size_t i, j;
+	uintptr_t end;
+
+	if (!cnt)
+		return;
+
+	qsort(ranges, cnt, sizeof(*ranges), ofi_uffd_range_cmp);
+	for (i = 0, j = 1; j < cnt; j++) {
+		end = (uintptr_t) ranges[i].iov_base + ranges[i].iov_len;
+		if ((uintptr_t) ranges[j].iov_base <= end) {
+			end = MAX(end, (uintptr_t) ranges[j].iov_base +
+				       ranges[j].iov_len);
+			ranges[i].iov_len = end - (uintptr_t) ranges[i].iov_base;
+		} else {
+			ranges[++i] = ranges[j];
+		}
+	}
+
+	for (j = 0; j <= i; j++)
+		ofi_monitor_notify(&uffd.monitor, ranges[j].iov_base,
+				   ranges[j].iov_len);
+}
+
 /* The userfault fd monitor requires for events that could
  * trigger it to be handled outside of the monitor functions
  * itself. When a fault occurs on a monitored region, the
@@ -94,12 +140,18 @@ static void ofi_uffd_unsubscribe(struct ofi_mem_monitor *monitor,
  * within the userfault handling thread, no threads will
  * read this event and our threads cannot progress, resulting
  * in a hang.
+ *
+ * Events are read in batches.  The locks are held across the read and
+ * the processing of the whole batch, so no cache search can run between
+ * an unmap being released by the read and the cache being notified.
  */
 static void *ofi_uffd_handler(void *arg)
 {
-	struct uffd_msg msg;
+	struct uffd_msg msg[OFI_UFFD_BATCH];
+	struct iovec ranges[OFI_UFFD_BATCH];
 	struct pollfd fds[2];
-	int ret;
+	size_t i, cnt, range_cnt;
+	ssize_t ret;
 
 	fds[0].fd     = uffd.fd;
 	fds[0].events = POLLIN;
@@ -116,8 +168,8 @@ static void *ofi_uffd_handler(void *arg)
 
 		pthread_rwlock_rdlock(&mm_list_rwlock);
 		pthread_mutex_lock(&mm_lock);
-		ret = read(uffd.fd, &msg, sizeof(msg));
-		if (ret != sizeof(msg)) {
+		ret = read(uffd.fd, msg, sizeof(msg));
+		if (ret < (ssize_t) sizeof(*msg)) {
 			pthread_mutex_unlock(&mm_lock);
 			pthread_rwlock_unlock(&mm_list_rwlock);
 			if (errno != EAGAIN && errno != EINTR)
@@ -125,34 +177,40 @@ static void *ofi_uffd_handler(void *arg)
 			continue;
 		}
 
-		FI_DBG(&core_prov, FI_LOG_MR, "Received UFFD event %d\n", msg.event);
-
-		switch (msg.event) {
-		case UFFD_EVENT_REMOVE:
-			ofi_uffd_unsubscribe(&uffd.monitor,
-				(void *) (uintptr_t) msg.arg.remove.start,
-				(size_t) (msg.arg.remove.end -
-					  msg.arg.remove.start), NULL);
-			/* fall through */
-		case UFFD_EVENT_UNMAP:
-			ofi_monitor_notify(&uffd.monitor,
-				(void *) (uintptr_t) msg.arg.remove.start,
-				(size_t) (msg.arg.remove.end -
-					  msg.arg.remove.start));
-			break;
-		case UFFD_EVENT_REMAP:
-			ofi_monitor_notify(&uffd.monitor,
-				(void *) (uintptr_t) msg.arg.remap.from,
-				(size_t) msg.arg.remap.len);
-			break;
-		case UFFD_EVENT_PAGEFAULT:
-			ofi_uffd_pagefault_handler(&msg);
-			break;
-		default:
-			FI_WARN(&core_prov, FI_LOG_MR,
-				"Unhandled uffd event %d\n", msg.event);
-			break;
+		cnt = ret / sizeof(*msg);
+		range_cnt = 0;
+		for (i = 0; i < cnt; i++) {
+			FI_DBG(&core_prov, FI_LOG_MR, "Received UFFD event %d\n",
+			       msg[i].event);
+
+			switch (msg[i].event) {
+			case UFFD_EVENT_REMOVE:
+				ofi_uffd_unsubscribe(&uffd.monitor,
+					(void *) (uintptr_t) msg[i].arg.remove.start,
+					(size_t) (msg[i].arg.remove.end -
+						  msg[i].arg.remove.start), NULL);
+				/* fall through */
+			case UFFD_EVENT_UNMAP:
+				ofi_uffd_add_range(ranges, &range_cnt,
+					msg[i].arg.remove.start,
+					msg[i].arg.remove.end -
+					msg[i].arg.remove.start);
+				break;
+			case UFFD_EVENT_REMAP:
+				ofi_uffd_add_range(ranges, &range_cnt,
+					msg[i].arg.remap.from,
+					msg[i].arg.remap.len);
+				break;
+			case UFFD_EVENT_PAGEFAULT:
+				ofi_uffd_pagefault_handler(&msg[i]);
+				break;
+			default:
+				FI_WARN(&core_prov, FI_LOG_MR,
+					"Unhandled uffd event %d\n", msg[i].event);
+				break;
+			}
 		}
+		ofi_uffd_notify_ranges(ranges, range_cnt);
 		pthread_mutex_unlock(&mm_lock);
 		pthread_rwlock_unlock(&mm_list_rwlock);
 	}
@@ -39,6 +39,10 @@
 #include <stdio.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <inttypes.h>
@@ -49,6 +53,8 @@
 #endif
 
 #include <ofi_util.h>
+#include <ofi_mb.h>
+#include <fasthash.h>
 
 
 enum {
@@ -245,21 +251,41 @@ int ofi_get_addr(uint32_t *addr_format, uint64_t flags,
 	}
 }
 
-void *ofi_av_get_addr(struct util_av *av, fi_addr_t fi_addr)
+bool ofi_av_is_valid(struct util_av *av, fi_addr_t fi_addr)
+{
+	if (av->shm)
+		return fi_addr < (uint64_t) ofi_atomic_load_explicit64(
+				&av->shm->count, memory_order_acquire);
+
+	return ofi_bufpool_ibuf_is_valid(av->av_entry_pool, fi_addr);
+}
+
+static inline void *util_av_entry_addr(struct util_av *av, fi_addr_t fi_addr)
 {
 	struct util_av_entry *entry;
 
-	if (!ofi_bufpool_ibuf_is_valid(av->av_entry_pool, fi_addr))
-		return NULL;
+	if (av->shm)
+		return av->shm_addrs + fi_addr * av->shm_stride;
 
 	entry = ofi_bufpool_get_ibuf(av->av_entry_pool, fi_addr);
 	return entry->data;
 }
 
+void *ofi_av_get_addr(struct util_av *av, fi_addr_t fi_addr)
+{
+	if (!ofi_av_is_valid(av, fi_addr))
+		return NULL;
+
+	return util_av_entry_addr(av, fi_addr);
+}
+
 void *ofi_av_addr_context(struct util_av *av, fi_addr_t fi_addr)
 {
 	void *addr;
 
+	if (av->shm)
+		return av->ctx_array + fi_addr * av->context_len;
+
 	addr = ofi_av_get_addr(av, fi_addr);
 	return (char *) addr + av->context_offset;
 }
@@ -279,28 +305,241 @@ int ofi_verify_av_insert(struct util_av *av, uint64_t flags, void *context)
 	return 0;
 }
 
+/*
+ * Addresses are found through an open-addressing table with linear
+ * probing.  The table is sized from fi_av_attr.count so that inserting
+ * the expected number of addresses does not rehash, and is kept at most
+ * 3/4 full, counting the tombstones left by removed addresses.
+ */
+#define UTIL_AV_SLOT_FREE	FI_ADDR_NOTAVAIL
+#define UTIL_AV_SLOT_DELETED	(FI_ADDR_NOTAVAIL - 1)
+#define UTIL_AV_MIN_SLOTS	64
+
+static inline uint64_t util_av_hash(struct util_av *av, const void *addr)
+{
+	return fasthash64(addr, av->addrlen, 0);
+}
+
+static inline bool util_av_slot_full(size_t cnt, size_t size)
+{
+	return cnt * 4 > size * 3;
+}
+
+static inline fi_addr_t util_av_slot_addr(struct util_av_slot *slot)
+{
+	return (fi_addr_t) ofi_atomic_load_explicit64(&slot->fi_addr,
+						      memory_order_relaxed);
+}
+
+static inline void util_av_slot_set_addr(struct util_av_slot *slot,
+					 fi_addr_t fi_addr)
+{
+	ofi_atomic_store_explicit64(&slot->fi_addr, (int64_t) fi_addr,
+				    memory_order_relaxed);
+}
+
+/*
+ * The slots of a shared AV are filled in by the creating process while
+ * others may be probing them.  A slot's fi_addr is published last with
+ * release ordering, so a reader that acquires it also sees the hash and
+ * the address.
+ */
+static fi_addr_t util_av_find(struct util_av *av, const void *addr,
+			      uint64_t hash)
+{
+	struct util_av_slot *slot;
+	fi_addr_t fi_addr;
+	size_t i;
+
+	for (i = hash & av->slot_mask; ; i = (i + 1) & av->slot_mask) {
+		slot = &av->slots[i];
+		fi_addr = (fi_addr_t) ofi_atomic_load_explicit64(&slot->fi_addr,
+							memory_order_acquire);
+		if (fi_addr == UTIL_AV_SLOT_FREE)
+			return FI_ADDR_NOTAVAIL;
+
+		if (slot->hash != hash || fi_addr == UTIL_AV_SLOT_DELETED)
+			continue;
+
+		if (!memcmp(util_av_entry_addr(av, fi_addr), addr,
+			    av->addrlen))
+			return fi_addr;
+	}
+}
+
+static void util_av_set_slot(struct util_av_slot *slots, size_t mask,
+			     uint64_t hash, fi_addr_t fi_addr)
+{
+	size_t i;
+
+	for (i = hash & mask;
+	     util_av_slot_addr(&slots[i]) < UTIL_AV_SLOT_DELETED;
+	     i = (i + 1) & mask)
+		;
+
+	slots[i].hash = hash;
+	util_av_slot_set_addr(&slots[i], fi_addr);
+}
+
+static int util_av_resize(struct util_av *av, size_t size)
+{
+	struct util_av_slot *slots;
+	size_t i;
+
+	slots = malloc(size * sizeof(*slots));
+	if (!slots)
+		return -FI_ENOMEM;
+
+	memset(slots, 0xff, size * sizeof(*slots));
+	for (i = 0; av->slots && i <= av->slot_mask; i++) {
+		if (util_av_slot_addr(&av->slots[i]) < UTIL_AV_SLOT_DELETED)
+			util_av_set_slot(slots, size - 1, av->slots[i].hash,
+					 util_av_slot_addr(&av->slots[i]));
+	}
+
+	free(av->slots);
+	av->slots = slots;
+	av->slot_mask = size - 1;
+	av->slot_deleted = 0;
+	return 0;
+}
+
+/*
+ * Make room for count more addresses, so that a bulk insert grows the
+ * table at most once.
+ */
+int ofi_av_reserve(struct util_av *av, size_t count)
+{
+	size_t cnt = av->slot_used + count;
+
+	assert(ofi_genlock_held(&av->lock));
+	if (av->shm)
+		return cnt > av->shm->capacity ? -FI_ENOSPC : 0;
+
+	if (!util_av_slot_full(cnt + av->slot_deleted, av->slot_mask + 1))
+		return 0;
+
+	return util_av_resize(av, MAX(roundup_power_of_two(cnt * 2),
+				      av->slot_mask + 1));
+}
+
+static int util_av_add_entry(struct util_av *av, struct util_av_entry *entry,
+			     const void *addr, uint64_t hash)
+{
+	size_t i;
+	int ret;
+
+	ret = ofi_av_reserve(av, 1);
+	if (ret)
+		return ret;
+
+	memcpy(entry->data, addr, av->addrlen);
+	ofi_atomic_initialize32(&entry->use_cnt, 1);
+	entry->hash = hash;
+
+	for (i = hash & av->slot_mask;
+	     util_av_slot_addr(&av->slots[i]) < UTIL_AV_SLOT_DELETED;
+	     i = (i + 1) & av->slot_mask)
+		;
+
+	if (util_av_slot_addr(&av->slots[i]) == UTIL_AV_SLOT_DELETED)
+		av->slot_deleted--;
+	av->slots[i].hash = hash;
+	util_av_slot_set_addr(&av->slots[i], ofi_buf_index(entry));
+	av->slot_used++;
+	return 0;
+}
+
+static int util_av_shm_add(struct util_av *av, const void *addr,
+			   uint64_t hash, fi_addr_t *fi_addr)
+{
+	struct util_av_slot *slot;
+	fi_addr_t index;
+	size_t i;
+
+	if (av->flags & FI_READ) {
+		ofi_av_straddr_log(av, FI_LOG_WARN, "read-only AV, cannot add",
+				   addr);
+		return -FI_EOPNOTSUPP;
+	}
+
+	index = ofi_atomic_get64(&av->shm->count);
+	if (index == av->shm->capacity) {
+		FI_WARN(av->prov, FI_LOG_AV, "shared AV is full\n");
+		return -FI_ENOSPC;
+	}
+
+	memcpy(av->shm_addrs + index * av->shm_stride, addr, av->addrlen);
+	for (i = hash & av->slot_mask;
+	     util_av_slot_addr(&av->slots[i]) != UTIL_AV_SLOT_FREE;
+	     i = (i + 1) & av->slot_mask)
+		;
+
+	slot = &av->slots[i];
+	slot->hash = hash;
+	ofi_atomic_store_explicit64(&slot->fi_addr, (int64_t) index,
+				    memory_order_release);
+	av->slot_used++;
+	ofi_atomic_store_explicit64(&av->shm->count, index + 1,
+				    memory_order_release);
+	if (fi_addr)
+		*fi_addr = index;
+	return 0;
+}
+
+/* Removes the entry from the lookup table and releases it */
+void ofi_av_free_entry(struct util_av *av, struct util_av_entry *entry)
+{
+	fi_addr_t fi_addr = ofi_buf_index(entry);
+	size_t i;
+
+	assert(ofi_genlock_held(&av->lock));
+	for (i = entry->hash & av->slot_mask;
+	     util_av_slot_addr(&av->slots[i]) != fi_addr;
+	     i = (i + 1) & av->slot_mask)
+		assert(util_av_slot_addr(&av->slots[i]) != UTIL_AV_SLOT_FREE);
+
+	util_av_slot_set_addr(&av->slots[i], UTIL_AV_SLOT_DELETED);
+	av->slot_used--;
+	av->slot_deleted++;
+	ofi_ibuf_free(entry);
+}
+
 int ofi_av_insert_addr_at(struct util_av *av, const void *addr, fi_addr_t fi_addr)
 {
-	struct util_av_entry *entry = NULL;
+	struct util_av_entry *entry;
+	fi_addr_t found;
+	uint64_t hash;
+	int ret;
 
 	assert(ofi_genlock_held(&av->lock));
 	ofi_av_straddr_log(av, FI_LOG_INFO, "inserting addr", addr);
-	HASH_FIND(hh, av->hash, addr, av->addrlen, entry);
-	if (entry) {
-		if (fi_addr == ofi_buf_index(entry))
+	hash = util_av_hash(av, addr);
+	found = util_av_find(av, addr, hash);
+	if (found != FI_ADDR_NOTAVAIL) {
+		if (fi_addr == found)
 			return FI_SUCCESS;
 
 		ofi_av_straddr_log(av, FI_LOG_WARN, "addr already in AV", addr);
 		return -FI_EALREADY;
 	}
 
+	if (av->shm) {
+		FI_WARN(av->prov, FI_LOG_AV,
+			"shared AV assigns fi_addr's in insertion order\n");
+		return -FI_EOPNOTSUPP;
+	}
+
 	entry = ofi_ibuf_alloc_at(av->av_entry_pool, fi_addr);
 	if (!entry)
 		return -FI_ENOMEM;
 
-	memcpy(entry->data, addr, av->addrlen);
-	ofi_atomic_initialize32(&entry->use_cnt, 1);
-	HASH_ADD(hh, av->hash, data, av->addrlen, entry);
+	ret = util_av_add_entry(av, entry, addr, hash);
+	if (ret) {
+		ofi_ibuf_free(entry);
+		return ret;
+	}
+
 	FI_INFO(av->prov, FI_LOG_AV, "fi_addr: %zu\n",
 		ofi_buf_index(entry));
 	return 0;
@@ -308,34 +547,53 @@ int ofi_av_insert_addr_at(struct util_av *av, const void *addr, fi_addr_t fi_add
 
 int ofi_av_insert_addr(struct util_av *av, const void *addr, fi_addr_t *fi_addr)
 {
-	struct util_av_entry *entry = NULL;
+	struct util_av_entry *entry;
+	fi_addr_t found;
+	uint64_t hash;
+	int ret;
 
 	assert(ofi_genlock_held(&av->lock));
 	ofi_av_straddr_log(av, FI_LOG_INFO, "inserting addr", addr);
-	HASH_FIND(hh, av->hash, addr, av->addrlen, entry);
-	if (entry) {
+	hash = util_av_hash(av, addr);
+	found = util_av_find(av, addr, hash);
+	if (found != FI_ADDR_NOTAVAIL) {
 		if (fi_addr)
-			*fi_addr = ofi_buf_index(entry);
+			*fi_addr = found;
+		/* entries of a shared AV are never removed */
+		if (av->shm)
+			return 0;
+
+		entry = ofi_bufpool_get_ibuf(av->av_entry_pool, found);
 		if (ofi_atomic_inc32(&entry->use_cnt) > 1) {
 			ofi_av_straddr_log(av, FI_LOG_WARN, "addr already in AV", addr);
 		}
+	} else if (av->shm) {
+		ret = util_av_shm_add(av, addr, hash, fi_addr);
+		if (ret && fi_addr)
+			*fi_addr = FI_ADDR_NOTAVAIL;
+		return ret;
 	} else {
 		entry = ofi_ibuf_alloc(av->av_entry_pool);
-		if (!entry) {
-			if (fi_addr)
-				*fi_addr = FI_ADDR_NOTAVAIL;
-			return -FI_ENOMEM;
+		if (!entry)
+			goto err;
+
+		ret = util_av_add_entry(av, entry, addr, hash);
+		if (ret) {
+			ofi_ibuf_free(entry);
+			goto err;
 		}
 
 		if (fi_addr)
 			*fi_addr = ofi_buf_index(entry);
-		memcpy(entry->data, addr, av->addrlen);
-		ofi_atomic_initialize32(&entry->use_cnt, 1);
-		HASH_ADD(hh, av->hash, data, av->addrlen, entry);
 		FI_INFO(av->prov, FI_LOG_AV, "fi_addr: %zu\n",
 			ofi_buf_index(entry));
 	}
 	return 0;
+
+err:
+	if (fi_addr)
+		*fi_addr = FI_ADDR_NOTAVAIL;
+	return -FI_ENOMEM;
 }
 
 int ofi_av_remove_addr(struct util_av *av, fi_addr_t fi_addr)
@@ -343,6 +601,12 @@ int ofi_av_remove_addr(struct util_av *av, fi_addr_t fi_addr)
 	struct util_av_entry *av_entry;
 
 	assert(ofi_genlock_held(&av->lock));
+	if (av->shm) {
+		FI_WARN(av->prov, FI_LOG_AV,
+			"addresses cannot be removed from a shared AV\n");
+		return -FI_EOPNOTSUPP;
+	}
+
 	if (!ofi_bufpool_ibuf_is_valid(av->av_entry_pool, fi_addr))
 		return -FI_EINVAL;
 
@@ -350,26 +614,22 @@ int ofi_av_remove_addr(struct util_av *av, fi_addr_t fi_addr)
 	if (ofi_atomic_dec32(&av_entry->use_cnt))
 		return FI_SUCCESS;
 
-	HASH_DELETE(hh, av->hash, av_entry);
 	FI_DBG(av->prov, FI_LOG_AV, "av_remove fi_addr: %" PRIu64 "\n", fi_addr);
-	ofi_ibuf_free(av_entry);
+	ofi_av_free_entry(av, av_entry);
 	return 0;
 }
 
 fi_addr_t ofi_av_lookup_fi_addr_unsafe(struct util_av *av, const void *addr)
 {
-	struct util_av_entry *entry = NULL;
-
-	HASH_FIND(hh, av->hash, addr, av->addrlen, entry);
-	return entry ? ofi_buf_index(entry) : FI_ADDR_NOTAVAIL;
+	return util_av_find(av, addr, util_av_hash(av, addr));
 }
 
 fi_addr_t ofi_av_lookup_fi_addr(struct util_av *av, const void *addr)
 {
 	fi_addr_t fi_addr;
-	ofi_genlock_lock(&av->lock);
+	ofi_genlock_rdlock(&av->lock);
 	fi_addr = ofi_av_lookup_fi_addr_unsafe(av, addr);
-	ofi_genlock_unlock(&av->lock);
+	ofi_genlock_rdunlock(&av->lock);
 	return fi_addr;
 }
 
@@ -380,9 +640,28 @@ ofi_av_lookup_addr(struct util_av *av, fi_addr_t fi_addr, size_t *addrlen)
 	return ofi_av_get_addr(av, fi_addr);
 }
 
+static void util_av_shm_close(struct util_av *av)
+{
+	/* processes that mapped the AV keep their mapping */
+	if (!(av->flags & FI_READ))
+		shm_unlink(av->shm_name);
+
+	munmap(av->shm, av->shm_size);
+	free(av->ctx_array);
+	free(av->shm_name);
+	av->shm = NULL;
+	av->slots = NULL;
+}
+
 static void util_av_close(struct util_av *av)
 {
-	HASH_CLEAR(hh, av->hash);
+	if (av->shm) {
+		util_av_shm_close(av);
+		return;
+	}
+
+	free(av->slots);
+	av->slots = NULL;
 	ofi_bufpool_destroy(av->av_entry_pool);
 }
 
@@ -426,6 +705,9 @@ int ofi_av_close(struct util_av *av)
 
 size_t ofi_av_size(struct util_av *av)
 {
+	if (av->shm)
+		return av->shm->capacity;
+
 	return av->av_entry_pool->entry_cnt ?
 	       av->av_entry_pool->entry_cnt :
 	       av->av_entry_pool->attr.chunk_cnt;
@@ -434,7 +716,7 @@ size_t ofi_av_size(struct util_av *av)
 static int util_verify_av_util_attr(struct util_domain *domain,
 				    const struct util_av_attr *util_attr)
 {
-	if (util_attr->flags & ~(OFI_AV_DYN_ADDRLEN)) {
+	if (util_attr->flags & ~(OFI_AV_DYN_ADDRLEN | OFI_AV_SHAREABLE)) {
 		FI_WARN(domain->prov, FI_LOG_AV, "invalid internal flags\n");
 		return -FI_EINVAL;
 	}
@@ -442,6 +724,176 @@ static int util_verify_av_util_attr(struct util_domain *domain,
 	return 0;
 }
 
+#define UTIL_AV_SHM_MAGIC 0x6f66695f61767368ULL	/* "ofi_avsh" */
+
+static int util_av_shm_create(struct util_av *av, int *fd)
+{
+	struct util_av_shm *shm;
+	pid_t pid;
+
+	*fd = shm_open(av->shm_name, O_RDWR | O_CREAT | O_EXCL,
+		       S_IRUSR | S_IWUSR);
+	if (*fd >= 0 || errno != EEXIST)
+		return *fd < 0 ? -errno : 0;
+
+	/* Take over the AV of a process that exited without closing it */
+	*fd = shm_open(av->shm_name, O_RDONLY, 0);
+	if (*fd < 0)
+		return -errno;
+
+	shm = mmap(NULL, sizeof(*shm), PROT_READ, MAP_SHARED, *fd, 0);
+	close(*fd);
+	if (shm == MAP_FAILED)
+		return -FI_EBUSY;
+
+	pid = shm->pid;
+	munmap(shm, sizeof(*shm));
+	if (!pid || !kill(pid, 0) || errno != ESRCH) {
+		FI_WARN(av->prov, FI_LOG_AV, "shared AV %s is in use\n",
+			av->shm_name);
+		return -FI_EBUSY;
+	}
+
+	FI_WARN(av->prov, FI_LOG_AV,
+		"Overwriting shared AV %s of dead process\n", av->shm_name);
+	shm_unlink(av->shm_name);
+	*fd = shm_open(av->shm_name, O_RDWR | O_CREAT | O_EXCL,
+		       S_IRUSR | S_IWUSR);
+	return *fd < 0 ? -errno : 0;
+}
+
+static int util_av_shm_map(struct util_av *av, size_t capacity)
+{
+	struct util_av_shm *shm;
+	struct stat st;
+	size_t slot_cnt;
+	int fd, ret;
+
+	if (av->flags & FI_READ) {
+		fd = shm_open(av->shm_name, O_RDONLY, 0);
+		if (fd < 0)
+			return -errno;
+
+		ret = fstat(fd, &st) ? -errno : 0;
+		if (!ret && st.st_size < sizeof(*shm))
+			ret = -FI_EAGAIN;
+		if (ret)
+			goto close;
+
+		av->shm_size = st.st_size;
+		shm = mmap(NULL, av->shm_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (shm == MAP_FAILED) {
+			ret = -errno;
+			goto close;
+		}
+
+		/* the creator may still be laying out the table */
+		if (shm->magic != UTIL_AV_SHM_MAGIC) {
+			ret = -FI_EAGAIN;
+			goto unmap;
+		}
+		ofi_rmb();
+
+		if (shm->addrlen != av->addrlen) {
+			FI_WARN(av->prov, FI_LOG_AV,
+				"shared AV %s has address length %u, "
+				"expected %zu\n", av->shm_name, shm->addrlen,
+				av->addrlen);
+			ret = -FI_EINVAL;
+			goto unmap;
+		}
+		slot_cnt = shm->slot_cnt;
+		capacity = shm->capacity;
+	} else {
+		ret = util_av_shm_create(av, &fd);
+		if (ret)
+			return ret;
+
+		slot_cnt = MAX(roundup_power_of_two(capacity * 2),
+			       UTIL_AV_MIN_SLOTS);
+		av->shm_size = sizeof(*shm) + slot_cnt * sizeof(*shm->slots) +
+			       capacity * av->shm_stride;
+		if (ftruncate(fd, av->shm_size)) {
+			ret = -errno;
+			goto unlink;
+		}
+
+		shm = mmap(NULL, av->shm_size, PROT_READ | PROT_WRITE,
+			   MAP_SHARED, fd, 0);
+		if (shm == MAP_FAILED) {
+			ret = -errno;
+			goto unlink;
+		}
+
+		shm->pid = getpid();
+		shm->addrlen = (uint32_t) av->addrlen;
+		shm->capacity = capacity;
+		shm->slot_cnt = slot_cnt;
+		ofi_atomic_initialize64(&shm->count, 0);
+		memset(shm->slots, 0xff, slot_cnt * sizeof(*shm->slots));
+		ofi_wmb();
+		shm->magic = UTIL_AV_SHM_MAGIC;
+	}
+	close(fd);
+
+	av->shm = shm;
+	av->slots = shm->slots;
+	av->slot_mask = slot_cnt - 1;
+	av->slot_used = ofi_atomic_get64(&shm->count);
+	av->shm_addrs = (char *) (shm->slots + slot_cnt);
+	if (av->context_len) {
+		av->ctx_array = calloc(capacity, av->context_len);
+		if (!av->ctx_array) {
+			util_av_shm_close(av);
+			return -FI_ENOMEM;
+		}
+	}
+	return 0;
+
+unmap:
+	munmap(shm, av->shm_size);
+	goto close;
+unlink:
+	shm_unlink(av->shm_name);
+close:
+	close(fd);
+	return ret;
+}
+
+static int util_av_shm_init(struct util_av *av, const struct fi_av_attr *attr,
+			    const struct util_av_attr *util_attr,
+			    size_t capacity)
+{
+	int ret;
+
+	if (util_attr->flags & OFI_AV_DYN_ADDRLEN) {
+		FI_WARN(av->prov, FI_LOG_AV,
+			"shared AV requires a fixed address format\n");
+		return -FI_EINVAL;
+	}
+
+	if (asprintf(&av->shm_name, "%s%s", attr->name[0] == '/' ? "" : "/",
+		     attr->name) < 0)
+		return -FI_ENOMEM;
+
+	av->shm_stride = ofi_get_aligned_size(av->addrlen, 8);
+	av->context_len = ofi_get_aligned_size(util_attr->context_len, 8);
+	ret = util_av_shm_map(av, capacity);
+	if (ret) {
+		FI_WARN(av->prov, FI_LOG_AV, "unable to %s shared AV %s: %s\n",
+			av->flags & FI_READ ? "open" : "create", av->shm_name,
+			fi_strerror(-ret));
+		free(av->shm_name);
+		av->shm_name = NULL;
+		return ret;
+	}
+
+	FI_INFO(av->prov, FI_LOG_AV, "%s shared AV %s, %zu entries\n",
+		av->flags & FI_READ ? "opened" : "created", av->shm_name,
+		(size_t) av->shm->capacity);
+	return 0;
+}
+
 static int util_av_init(struct util_av *av, const struct fi_av_attr *attr,
 			const struct util_av_attr *util_attr)
 {
@@ -464,9 +916,6 @@ static int util_av_init(struct util_av *av, const struct fi_av_attr *attr,
 		.flags		= OFI_BUFPOOL_NO_TRACK | OFI_BUFPOOL_INDEXED,
 	};
 
-	/* TODO: Handle FI_READ */
-	/* TODO: Handle mmap - shared AV */
-
 	ret = util_verify_av_util_attr(av->domain, util_attr);
 	if (ret)
 		return ret;
@@ -478,14 +927,27 @@ static int util_av_init(struct util_av *av, const struct fi_av_attr *attr,
 	av->addrlen = util_attr->addrlen;
 	av->context_offset = offset + av->addrlen;
 	av->flags = util_attr->flags | attr->flags;
-	av->hash = NULL;
+	av->slots = NULL;
+	av->slot_used = 0;
+	av->shm = NULL;
+	if (attr->name)
+		return util_av_shm_init(av, attr, util_attr, orig_size);
+
+	ret = util_av_resize(av, MAX(orig_size * 2, UTIL_AV_MIN_SLOTS));
+	if (ret)
+		return ret;
 
 	pool_attr.chunk_cnt = orig_size;
-	return ofi_bufpool_create_attr(&pool_attr, &av->av_entry_pool);
+	ret = ofi_bufpool_create_attr(&pool_attr, &av->av_entry_pool);
+	if (ret) {
+		free(av->slots);
+		av->slots = NULL;
+	}
+	return ret;
 }
 
 static int util_verify_av_attr(struct util_domain *domain,
-			       const struct fi_av_attr *attr)
+			       const struct fi_av_attr *attr, bool shareable)
 {
 	char str1[20], str2[20];
 
@@ -509,7 +971,7 @@ static int util_verify_av_attr(struct util_domain *domain,
 		return -FI_EINVAL;
 	}
 
-	if (attr->name) {
+	if (attr->name && !shareable) {
 		FI_WARN(domain->prov, FI_LOG_AV, "Shared AV is unsupported\n");
 		return -FI_ENOSYS;
 	}
@@ -522,13 +984,14 @@ static int util_verify_av_attr(struct util_domain *domain,
 	return 0;
 }
 
-int ofi_av_init_lightweight(struct util_domain *domain, const struct fi_av_attr *attr,
-			    struct util_av *av, void *context)
+static int util_av_init_base(struct util_domain *domain,
+			     const struct fi_av_attr *attr,
+			     struct util_av *av, void *context, bool shareable)
 {
 	int ret;
 	enum ofi_lock_type av_lock_type, ep_list_lock_type;
 
-	ret = util_verify_av_attr(domain, attr);
+	ret = util_verify_av_attr(domain, attr, shareable);
 	if (ret)
 		return ret;
 
@@ -548,7 +1011,7 @@ int ofi_av_init_lightweight(struct util_domain *domain, const struct fi_av_attr
 				       domain->control_progress ==
 					       FI_PROGRESS_CONTROL_UNIFIED ?
 			       OFI_LOCK_NOOP :
-			       OFI_LOCK_MUTEX;
+			       OFI_LOCK_RWLOCK;
 
 	ret = ofi_genlock_init(&av->lock, av_lock_type);
 	if (ret)
@@ -566,17 +1029,24 @@ int ofi_av_init_lightweight(struct util_domain *domain, const struct fi_av_attr
 	return 0;
 }
 
+int ofi_av_init_lightweight(struct util_domain *domain, const struct fi_av_attr *attr,
+			    struct util_av *av, void *context)
+{
+	return util_av_init_base(domain, attr, av, context, false);
+}
+
 int ofi_av_init(struct util_domain *domain, const struct fi_av_attr *attr,
 		const struct util_av_attr *util_attr,
 		struct util_av *av, void *context)
 {
-	int ret = ofi_av_init_lightweight(domain, attr, av, context);
+	int ret = util_av_init_base(domain, attr, av, context,
+				    util_attr->flags & OFI_AV_SHAREABLE);
 	if (ret)
 		return ret;
 
 	ret = util_av_init(av, attr, util_attr);
 	if (ret)
-		return ret;
+		(void) ofi_av_close_lightweight(av);
 	return ret;
 }
 
@@ -597,10 +1067,9 @@ static int ip_av_insert_addr(struct util_av *av, const void *addr,
 {
 	int ret;
 
+	assert(ofi_genlock_held(&av->lock));
 	if (ofi_valid_dest_ipaddr(addr)) {
-		ofi_genlock_lock(&av->lock);
 		ret = ofi_av_insert_addr(av, addr, fi_addr);
-		ofi_genlock_unlock(&av->lock);
 	} else {
 		ret = -FI_EADDRNOTAVAIL;
 		if (fi_addr)
@@ -632,6 +1101,12 @@ int ofi_ip_av_insertv(struct util_av *av, const void *addr, size_t addrlen,
 		return -FI_EINVAL;
 	}
 
+	if (av->shm && addrlen != av->addrlen) {
+		FI_WARN(av->prov, FI_LOG_AV,
+			"Address length does not match shared AV\n");
+		return -FI_EINVAL;
+	}
+
 	if (!(av->flags & OFI_AV_DYN_ADDRLEN)) {
 		av->addrlen = addrlen;
 		av->flags &= ~OFI_AV_DYN_ADDRLEN;
@@ -644,6 +1119,12 @@ int ofi_ip_av_insertv(struct util_av *av, const void *addr, size_t addrlen,
 		memset(sync_err, 0, sizeof(*sync_err) * count);
 	}
 
+	/* Insert the whole batch under one lock, growing the table once */
+	ofi_genlock_lock(&av->lock);
+	ret = ofi_av_reserve(av, count);
+	if (ret)
+		FI_WARN(av->prov, FI_LOG_AV, "unable to grow AV table\n");
+
 	for (i = 0; i < count; i++) {
 		ret = ip_av_insert_addr(av, (const char *) addr + i * addrlen,
 					fi_addr ? &fi_addr[i] : NULL, context);
@@ -652,6 +1133,7 @@ int ofi_ip_av_insertv(struct util_av *av, const void *addr, size_t addrlen,
 		else if (sync_err)
 			sync_err[i] = -ret;
 	}
+	ofi_genlock_unlock(&av->lock);
 
 done:
 	FI_DBG(av->prov, FI_LOG_AV, "%d addresses successful\n", success_cnt);
@@ -918,7 +1400,7 @@ bool ofi_ip_av_is_valid(struct fid_av *av_fid, fi_addr_t fi_addr)
 	struct util_av *av =
 		container_of(av_fid, struct util_av, av_fid);
 
-	return ofi_bufpool_ibuf_is_valid(av->av_entry_pool, fi_addr);
+	return ofi_av_is_valid(av, fi_addr);
 }
 
 int ofi_ip_av_lookup(struct fid_av *av_fid, fi_addr_t fi_addr,
@@ -987,8 +1469,10 @@ int ofi_ip_av_create(struct fid_domain *domain_fid, struct fi_av_attr *attr,
 
 	if (domain->addr_format == FI_SOCKADDR_IN) {
 		util_attr.addrlen = sizeof(struct sockaddr_in);
+		util_attr.flags = OFI_AV_SHAREABLE;
 	} else if (domain->addr_format == FI_SOCKADDR_IN6) {
 		util_attr.addrlen = sizeof(struct sockaddr_in6);
+		util_attr.flags = OFI_AV_SHAREABLE;
 	} else {
 		util_attr.addrlen = sizeof(struct sockaddr_in6);
 		util_attr.flags = OFI_AV_DYN_ADDRLEN;
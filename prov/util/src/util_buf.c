@@ -34,6 +34,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sched.h>
 #include <inttypes.h>
 #include <ofi_enosys.h>
 #include <ofi_mem.h>
@@ -60,6 +61,35 @@ enum {
 };
 
 
+/* Called before the region's pages are first touched */
+static void ofi_bufpool_region_bind(struct ofi_bufpool_region *buf_region)
+{
+	struct ofi_bufpool *pool = buf_region->pool;
+	int ret;
+
+	if (!(pool->attr.flags & OFI_BUFPOOL_NUMA))
+		return;
+
+	ret = ofi_mbind_node(buf_region->alloc_region, pool->alloc_size,
+			     pool->attr.numa_node);
+	if (ret) {
+		FI_WARN(&core_prov, FI_LOG_CORE,
+			"unable to bind pool %p to NUMA node %d: %s\n",
+			pool, pool->attr.numa_node, fi_strerror(-ret));
+		pool->attr.flags &= ~OFI_BUFPOOL_NUMA;
+		pool->stats.numa_node = -1;
+	}
+}
+
+static void ofi_bufpool_region_prefault(struct ofi_bufpool_region *buf_region)
+{
+	struct ofi_bufpool *pool = buf_region->pool;
+	size_t i;
+
+	for (i = 0; i < pool->alloc_size; i += page_sizes[OFI_PAGE_SIZE])
+		((volatile char *) buf_region->alloc_region)[i] = 0;
+}
+
 static int ofi_bufpool_region_alloc(struct ofi_bufpool_region *buf_region)
 {
 	int ret;
@@ -68,25 +98,58 @@ static int ofi_bufpool_region_alloc(struct ofi_bufpool_region *buf_region)
 	struct ofi_bufpool *pool = buf_region->pool;
 
 	if (pool->attr.flags & OFI_BUFPOOL_HUGEPAGES) {
-		page_size = ofi_get_hugepage_size();
-		if (page_size > 0 && pool->alloc_size >= (size_t) page_size) {
+		page_size = pool->attr.page_size ?
+			    (ssize_t) pool->attr.page_size :
+			    ofi_get_hugepage_size();
+		if (page_size > 0 && (pool->attr.page_size ||
+		    pool->alloc_size >= (size_t) page_size)) {
 			alloc_size = ofi_get_aligned_size(pool->alloc_size, (size_t) page_size);
-			ret = ofi_alloc_hugepage_buf((void **) &buf_region->alloc_region,
+			ret = pool->attr.page_size ?
+			      ofi_alloc_hugepage_buf_size(
+					(void **) &buf_region->alloc_region,
+					alloc_size, page_size) :
+			      ofi_alloc_hugepage_buf((void **) &buf_region->alloc_region,
 					     alloc_size);
 			if (!ret) {
 				buf_region->flags = OFI_BUFPOOL_HUGEPAGES | OFI_BUFPOOL_NONSHARED;
 				pool->alloc_size = alloc_size;
 				pool->region_size = pool->alloc_size - pool->entry_size;
+				pool->stats.page_size = page_size;
+				pool->stats.huge_regions++;
+				ofi_bufpool_region_bind(buf_region);
 				return 0;
 			}
+			FI_WARN(&core_prov, FI_LOG_CORE,
+				"pool %p: %zd byte huge pages unavailable: %s, "
+				"using base pages\n", pool, page_size,
+				fi_strerror(-ret));
+		} else {
+			FI_INFO(&core_prov, FI_LOG_CORE,
+				"pool %p: region of %zu bytes is smaller than a "
+				"huge page, using base pages\n", pool,
+				pool->alloc_size);
 		}
 		/* If we can't allocate huge pages, fall back to mmap
 		 * for all future attempts.
 		 */
+		pool->stats.huge_fallbacks++;
 		pool->attr.flags &= ~OFI_BUFPOOL_HUGEPAGES;
 		pool->attr.flags |= OFI_BUFPOOL_NONSHARED;
+
+		/* Buffer indices assume one chunk_cnt for all regions, so
+		 * only go back to the requested count before the first one.
+		 */
+		if (!pool->region_cnt &&
+		    pool->attr.chunk_cnt != pool->base_chunk_cnt) {
+			pool->attr.chunk_cnt = pool->base_chunk_cnt;
+			pool->alloc_size = (pool->attr.chunk_cnt + 1) *
+					   pool->entry_size;
+			pool->region_size = pool->alloc_size - pool->entry_size;
+		}
 	}
 
+	pool->stats.page_size = page_sizes[OFI_PAGE_SIZE];
+
 	if (pool->attr.flags & OFI_BUFPOOL_NONSHARED) {
 		page_size = ofi_get_page_size();
 		if (page_size < 0) {
@@ -98,6 +161,7 @@ static int ofi_bufpool_region_alloc(struct ofi_bufpool_region *buf_region)
 		if (!ret) {
 			buf_region->flags = OFI_BUFPOOL_NONSHARED;
 			pool->region_size = pool->alloc_size - pool->entry_size;
+			ofi_bufpool_region_bind(buf_region);
 			return 0;
 		} else if (ret != -FI_ENOSYS) {
 			return ret;
@@ -132,15 +196,16 @@ static void ofi_bufpool_region_free(struct ofi_bufpool_region *buf_region)
 	}
 }
 
-int ofi_bufpool_grow(struct ofi_bufpool *pool)
+/*
+ * Allocate and initialize the memory of a new region.  This does not touch
+ * the free list or region table, so magazine pools call it without holding
+ * the depot lock.
+ */
+static int ofi_bufpool_region_create(struct ofi_bufpool *pool,
+				     struct ofi_bufpool_region **region)
 {
 	struct ofi_bufpool_region *buf_region;
-	struct ofi_bufpool_hdr *buf_hdr;
-	void *buf;
 	int ret;
-	size_t i;
-
-	size_t mem_allocated = 0;
 
 	FI_DBG(&core_prov, FI_LOG_CORE, "%s pool %p  size %zu region_size %zu "
 	       "entry_cnt %d chunk_cnt %d\n",
@@ -166,10 +231,11 @@ int ofi_bufpool_grow(struct ofi_bufpool *pool)
 		goto err1;
 	}
 
-	mem_allocated += buf_region->pool->alloc_size;
-
+	/* zeroing a region faults in all of its pages */
 	if (!(pool->attr.flags & OFI_BUFPOOL_NO_ZERO))
 		memset(buf_region->alloc_region, 0, pool->alloc_size);
+	else if (pool->attr.flags & OFI_BUFPOOL_PREFAULT)
+		ofi_bufpool_region_prefault(buf_region);
 	buf_region->mem_region = buf_region->alloc_region + pool->entry_size;
 	if (pool->attr.alloc_fn) {
 		ret = pool->attr.alloc_fn(buf_region);
@@ -177,16 +243,44 @@ int ofi_bufpool_grow(struct ofi_bufpool *pool)
 			goto err2;
 	}
 
+	*region = buf_region;
+	return 0;
+
+err2:
+	ofi_bufpool_region_free(buf_region);
+err1:
+	free(buf_region);
+	return ret;
+}
+
+static void ofi_bufpool_region_destroy(struct ofi_bufpool_region *buf_region)
+{
+	if (buf_region->pool->attr.free_fn)
+		buf_region->pool->attr.free_fn(buf_region);
+
+	ofi_bufpool_region_free(buf_region);
+	free(buf_region);
+}
+
+/* Add a region created by ofi_bufpool_region_create() to the pool. */
+static int ofi_bufpool_region_insert(struct ofi_bufpool *pool,
+				     struct ofi_bufpool_region *buf_region)
+{
+	struct ofi_bufpool_hdr *buf_hdr;
+	uintptr_t start, end;
+	void *buf;
+	size_t i;
+
+	size_t mem_allocated = pool->alloc_size;
+
 	if (!(pool->region_cnt % OFI_BUFPOOL_REGION_CHUNK_CNT)) {
 		struct ofi_bufpool_region **new_table;
 
 		new_table = realloc(pool->region_table,
 				(pool->region_cnt + OFI_BUFPOOL_REGION_CHUNK_CNT) *
 				sizeof(*pool->region_table));
-		if (!new_table) {
-			ret = -FI_ENOMEM;
-			goto err3;
-		}
+		if (!new_table)
+			return -FI_ENOMEM;
 		pool->region_table = new_table;
 		mem_allocated += OFI_BUFPOOL_REGION_CHUNK_CNT *
 				 sizeof(*pool->region_table);
@@ -199,6 +293,11 @@ int ofi_bufpool_grow(struct ofi_bufpool *pool)
 		buf_hdr = ofi_buf_hdr(buf);
 		buf_hdr->region = buf_region;
 		buf_hdr->index = pool->entry_cnt + i;
+		start = (uintptr_t) buf_hdr / pool->stats.page_size;
+		end = ((uintptr_t) buf_hdr + pool->entry_size - 1) /
+		      pool->stats.page_size;
+		if (start != end)
+			pool->stats.split_entries++;
 		OFI_DBG_SET(buf_hdr->magic, OFI_MAGIC_SIZE_T);
 		OFI_DBG_SET(buf_hdr->ftr,
 			    (struct ofi_bufpool_ftr *) ((char *) buf +
@@ -228,22 +327,510 @@ int ofi_bufpool_grow(struct ofi_bufpool *pool)
 
 	ofi_bufpool_track_mem(mem_allocated);
 	return 0;
+}
 
-err3:
-	if (pool->attr.free_fn)
-	    pool->attr.free_fn(buf_region);
-err2:
-	ofi_bufpool_region_free(buf_region);
-err1:
-	free(buf_region);
+int ofi_bufpool_grow(struct ofi_bufpool *pool)
+{
+	struct ofi_bufpool_region *buf_region;
+	int ret;
+
+	ret = ofi_bufpool_region_create(pool, &buf_region);
+	if (ret)
+		return ret;
+
+	ret = ofi_bufpool_region_insert(pool, buf_region);
+	if (ret)
+		ofi_bufpool_region_destroy(buf_region);
+	return ret;
+}
+
+/*
+ * Magazine layer
+ *
+ * Each thread using an OFI_BUFPOOL_MAGAZINE pool owns two magazines, a
+ * loaded one that serves allocations and frees, and a previous one that is
+ * swapped in when the loaded magazine runs empty or full.  Only when both
+ * are exhausted does the thread take the depot lock to trade a magazine
+ * with the depot, so the lock is taken at most once per
+ * OFI_BUFPOOL_MAG_SIZE operations.  The depot lock also protects the
+ * underlying pool.
+ *
+ * All magazine pools share one pthread key.  Its value is the thread's
+ * table of caches, indexed by the id of each pool's depot.
+ * ofi_bufpool_lock protects the depot ids, the key, the table of every
+ * thread except for lookups by the thread itself, and the tcaches lists
+ * of the depots.  It is only taken the first time a thread uses a pool,
+ * and when a thread exits or a pool is destroyed.
+ */
+enum {
+	OFI_BUFPOOL_MAG_SIZE = 32
+};
+
+struct ofi_bufpool_mag {
+	struct slist_entry	entry;
+	size_t			cnt;
+	void			*bufs[OFI_BUFPOOL_MAG_SIZE];
+};
+
+struct ofi_bufpool_thread {
+	size_t				cnt;
+	struct ofi_bufpool_tcache	**tcaches;
+};
+
+struct ofi_bufpool_tcache {
+	struct dlist_entry	entry;
+	struct ofi_bufpool_thread *thread;
+	struct ofi_bufpool_depot *depot;
+	struct ofi_bufpool_mag	*loaded;
+	struct ofi_bufpool_mag	*prev;
+};
+
+struct ofi_bufpool_depot {
+	ofi_mutex_t		lock;
+	size_t			id;
+	struct ofi_bufpool	*pool;
+	struct slist		full;
+	struct slist		empty;
+	size_t			full_cnt;
+	struct dlist_entry	tcaches;
+	bool			growing;
+};
+
+static pthread_mutex_t ofi_bufpool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t ofi_bufpool_key;
+static bool ofi_bufpool_key_valid;
+static struct ofi_bufpool_depot **ofi_bufpool_depots;
+static size_t ofi_bufpool_depot_cnt;
+
+static void ofi_bufpool_mag_fill(struct ofi_bufpool *pool,
+				 struct ofi_bufpool_mag *mag)
+{
+	struct ofi_bufpool_hdr *buf_hdr;
+
+	while (mag->cnt < OFI_BUFPOOL_MAG_SIZE && !ofi_bufpool_empty(pool)) {
+		slist_remove_head_container(&pool->free_list.entries,
+					    struct ofi_bufpool_hdr, buf_hdr,
+					    entry.slist);
+		buf_hdr->entry.slist.next = NULL;
+		mag->bufs[mag->cnt++] = ofi_buf_data(buf_hdr);
+	}
+}
+
+static void ofi_bufpool_mag_drain(struct ofi_bufpool *pool,
+				  struct ofi_bufpool_mag *mag)
+{
+	struct ofi_bufpool_hdr *buf_hdr;
+
+	while (mag->cnt) {
+		buf_hdr = ofi_buf_hdr(mag->bufs[--mag->cnt]);
+		slist_insert_head(&buf_hdr->entry.slist,
+				  &pool->free_list.entries);
+	}
+}
+
+static struct ofi_bufpool_mag *
+ofi_bufpool_mag_get_empty(struct ofi_bufpool_depot *depot)
+{
+	struct ofi_bufpool_mag *mag;
+
+	if (slist_empty(&depot->empty))
+		return calloc(1, sizeof(*mag));
+
+	slist_remove_head_container(&depot->empty, struct ofi_bufpool_mag,
+				    mag, entry);
+	return mag;
+}
+
+/* Return a magazine to the depot, called with the depot lock held */
+static void ofi_bufpool_mag_put(struct ofi_bufpool_depot *depot,
+				struct ofi_bufpool_mag *mag)
+{
+	if (mag->cnt == OFI_BUFPOOL_MAG_SIZE) {
+		slist_insert_head(&mag->entry, &depot->full);
+		depot->full_cnt++;
+	} else {
+		ofi_bufpool_mag_drain(depot->pool, mag);
+		slist_insert_head(&mag->entry, &depot->empty);
+	}
+}
+
+/*
+ * Called with the depot lock held.  The lock is dropped while the new
+ * region is allocated and cleared, so other threads can keep trading
+ * magazines.  If another thread is already growing the pool, wait for it
+ * and let the caller check for free buffers again.
+ */
+static int ofi_bufpool_depot_grow(struct ofi_bufpool_depot *depot)
+{
+	struct ofi_bufpool_region *buf_region;
+	int ret;
+
+	if (depot->growing) {
+		do {
+			ofi_mutex_unlock(&depot->lock);
+			sched_yield();
+			ofi_mutex_lock(&depot->lock);
+		} while (depot->growing);
+		return 0;
+	}
+
+	depot->growing = true;
+	ofi_mutex_unlock(&depot->lock);
+	ret = ofi_bufpool_region_create(depot->pool, &buf_region);
+	ofi_mutex_lock(&depot->lock);
+	if (!ret) {
+		ret = ofi_bufpool_region_insert(depot->pool, buf_region);
+		if (ret)
+			ofi_bufpool_region_destroy(buf_region);
+	}
+	depot->growing = false;
+	return ret;
+}
+
+/* Replace the thread's empty magazines with a full one */
+static int ofi_bufpool_depot_load(struct ofi_bufpool_depot *depot,
+				  struct ofi_bufpool_tcache *tcache)
+{
+	struct ofi_bufpool *pool = depot->pool;
+	int ret = 0;
+
+	ofi_mutex_lock(&depot->lock);
+	if (!slist_empty(&depot->full)) {
+		slist_insert_head(&tcache->prev->entry, &depot->empty);
+		tcache->prev = tcache->loaded;
+		slist_remove_head_container(&depot->full,
+					    struct ofi_bufpool_mag,
+					    tcache->loaded, entry);
+		depot->full_cnt--;
+	} else {
+		while (ofi_bufpool_empty(pool)) {
+			ret = ofi_bufpool_depot_grow(depot);
+			if (ret)
+				goto unlock;
+		}
+		ofi_bufpool_mag_fill(pool, tcache->loaded);
+	}
+unlock:
+	ofi_mutex_unlock(&depot->lock);
 	return ret;
 }
 
+/* Replace the thread's full magazines with an empty one */
+static void ofi_bufpool_depot_unload(struct ofi_bufpool_depot *depot,
+				     struct ofi_bufpool_tcache *tcache)
+{
+	struct ofi_bufpool_mag *mag;
+
+	ofi_mutex_lock(&depot->lock);
+	mag = ofi_bufpool_mag_get_empty(depot);
+	if (mag) {
+		ofi_bufpool_mag_put(depot, tcache->prev);
+		tcache->prev = tcache->loaded;
+		tcache->loaded = mag;
+	} else {
+		ofi_bufpool_mag_drain(depot->pool, tcache->loaded);
+	}
+	ofi_mutex_unlock(&depot->lock);
+}
+
+static void ofi_bufpool_tcache_free(struct ofi_bufpool_tcache *tcache)
+{
+	free(tcache->loaded);
+	free(tcache->prev);
+	free(tcache);
+}
+
+/* pthread key destructor, returns an exiting thread's buffers */
+static void ofi_bufpool_thread_exit(void *arg)
+{
+	struct ofi_bufpool_thread *thread = arg;
+	struct ofi_bufpool_tcache *tcache;
+	struct ofi_bufpool_depot *depot;
+	size_t i;
+
+	pthread_mutex_lock(&ofi_bufpool_lock);
+	for (i = 0; i < thread->cnt; i++) {
+		tcache = thread->tcaches[i];
+		if (!tcache)
+			continue;
+
+		depot = tcache->depot;
+		dlist_remove(&tcache->entry);
+		ofi_mutex_lock(&depot->lock);
+		ofi_bufpool_mag_put(depot, tcache->loaded);
+		ofi_bufpool_mag_put(depot, tcache->prev);
+		ofi_mutex_unlock(&depot->lock);
+		free(tcache);
+	}
+	pthread_mutex_unlock(&ofi_bufpool_lock);
+
+	free(thread->tcaches);
+	free(thread);
+}
+
+/* Called with ofi_bufpool_lock held */
+static struct ofi_bufpool_thread *ofi_bufpool_thread_get(size_t id)
+{
+	struct ofi_bufpool_thread *thread;
+	struct ofi_bufpool_tcache **tcaches;
+	size_t cnt;
+
+	thread = pthread_getspecific(ofi_bufpool_key);
+	if (!thread) {
+		thread = calloc(1, sizeof(*thread));
+		if (!thread)
+			return NULL;
+
+		if (pthread_setspecific(ofi_bufpool_key, thread)) {
+			free(thread);
+			return NULL;
+		}
+	}
+
+	if (id < thread->cnt)
+		return thread;
+
+	cnt = MAX(ofi_bufpool_depot_cnt, id + 1);
+	tcaches = realloc(thread->tcaches, cnt * sizeof(*tcaches));
+	if (!tcaches)
+		return NULL;
+
+	memset(&tcaches[thread->cnt], 0,
+	       (cnt - thread->cnt) * sizeof(*tcaches));
+	thread->tcaches = tcaches;
+	thread->cnt = cnt;
+	return thread;
+}
+
+static struct ofi_bufpool_tcache *
+ofi_bufpool_tcache_create(struct ofi_bufpool_depot *depot)
+{
+	struct ofi_bufpool_tcache *tcache;
+
+	tcache = calloc(1, sizeof(*tcache));
+	if (!tcache)
+		return NULL;
+
+	tcache->depot = depot;
+	tcache->loaded = calloc(1, sizeof(*tcache->loaded));
+	tcache->prev = calloc(1, sizeof(*tcache->prev));
+	if (!tcache->loaded || !tcache->prev)
+		goto err;
+
+	pthread_mutex_lock(&ofi_bufpool_lock);
+	tcache->thread = ofi_bufpool_thread_get(depot->id);
+	if (!tcache->thread) {
+		pthread_mutex_unlock(&ofi_bufpool_lock);
+		goto err;
+	}
+
+	tcache->thread->tcaches[depot->id] = tcache;
+	dlist_insert_tail(&tcache->entry, &depot->tcaches);
+	pthread_mutex_unlock(&ofi_bufpool_lock);
+	return tcache;
+
+err:
+	ofi_bufpool_tcache_free(tcache);
+	return NULL;
+}
+
+static inline struct ofi_bufpool_tcache *
+ofi_bufpool_tcache_get(struct ofi_bufpool_depot *depot)
+{
+	struct ofi_bufpool_thread *thread;
+
+	thread = pthread_getspecific(ofi_bufpool_key);
+	if (OFI_LIKELY(thread && depot->id < thread->cnt &&
+		       thread->tcaches[depot->id]))
+		return thread->tcaches[depot->id];
+
+	return ofi_bufpool_tcache_create(depot);
+}
+
+void *ofi_buf_mag_alloc(struct ofi_bufpool *pool)
+{
+	struct ofi_bufpool_tcache *tcache;
+	struct ofi_bufpool_hdr *buf_hdr;
+	struct ofi_bufpool_mag *mag;
+
+	tcache = ofi_bufpool_tcache_get(pool->depot);
+	if (!tcache)
+		return NULL;
+
+	if (!tcache->loaded->cnt) {
+		if (tcache->prev->cnt) {
+			mag = tcache->loaded;
+			tcache->loaded = tcache->prev;
+			tcache->prev = mag;
+		} else if (ofi_bufpool_depot_load(pool->depot, tcache)) {
+			return NULL;
+		}
+	}
+
+	mag = tcache->loaded;
+	buf_hdr = ofi_buf_hdr(mag->bufs[--mag->cnt]);
+	assert(ofi_atomic_inc32(&buf_hdr->region->use_cnt));
+	assert(!ofi_buf_is_valid(ofi_buf_data(buf_hdr)));
+
+	buf_hdr->entry.slist.next = &buf_hdr->entry.slist;
+
+	return ofi_buf_data(buf_hdr);
+}
+
+void ofi_buf_mag_free(struct ofi_bufpool *pool, void *buf)
+{
+	struct ofi_bufpool_tcache *tcache;
+	struct ofi_bufpool_mag *mag;
+
+	ofi_buf_hdr(buf)->entry.slist.next = NULL;
+
+	tcache = ofi_bufpool_tcache_get(pool->depot);
+	if (!tcache) {
+		ofi_mutex_lock(&pool->depot->lock);
+		slist_insert_head(&ofi_buf_hdr(buf)->entry.slist,
+				  &pool->free_list.entries);
+		ofi_mutex_unlock(&pool->depot->lock);
+		return;
+	}
+
+	if (tcache->loaded->cnt == OFI_BUFPOOL_MAG_SIZE) {
+		if (tcache->prev->cnt < OFI_BUFPOOL_MAG_SIZE) {
+			mag = tcache->loaded;
+			tcache->loaded = tcache->prev;
+			tcache->prev = mag;
+		} else {
+			ofi_bufpool_depot_unload(pool->depot, tcache);
+		}
+	}
+
+	mag = tcache->loaded;
+	mag->bufs[mag->cnt++] = buf;
+}
+
+/* Called with ofi_bufpool_lock held */
+static int ofi_bufpool_depot_add(struct ofi_bufpool_depot *depot)
+{
+	struct ofi_bufpool_depot **depots;
+	size_t id;
+	int ret;
+
+	if (!ofi_bufpool_key_valid) {
+		ret = pthread_key_create(&ofi_bufpool_key,
+					 ofi_bufpool_thread_exit);
+		if (ret)
+			return -ret;
+		ofi_bufpool_key_valid = true;
+	}
+
+	for (id = 0; id < ofi_bufpool_depot_cnt; id++) {
+		if (!ofi_bufpool_depots[id])
+			goto out;
+	}
+
+	depots = realloc(ofi_bufpool_depots, (id + 1) * sizeof(*depots));
+	if (!depots)
+		return -FI_ENOMEM;
+
+	ofi_bufpool_depots = depots;
+	ofi_bufpool_depot_cnt++;
+out:
+	ofi_bufpool_depots[id] = depot;
+	depot->id = id;
+	return 0;
+}
+
+static int ofi_bufpool_depot_create(struct ofi_bufpool *pool)
+{
+	struct ofi_bufpool_depot *depot;
+	int ret;
+
+	if (pool->attr.flags & OFI_BUFPOOL_INDEXED)
+		return -FI_EINVAL;
+
+	depot = calloc(1, sizeof(*depot));
+	if (!depot)
+		return -FI_ENOMEM;
+
+	pthread_mutex_lock(&ofi_bufpool_lock);
+	ret = ofi_bufpool_depot_add(depot);
+	pthread_mutex_unlock(&ofi_bufpool_lock);
+	if (ret) {
+		free(depot);
+		return ret;
+	}
+
+	ofi_mutex_init(&depot->lock);
+	depot->pool = pool;
+	slist_init(&depot->full);
+	slist_init(&depot->empty);
+	dlist_init(&depot->tcaches);
+	pool->depot = depot;
+	return 0;
+}
+
+static void ofi_bufpool_depot_destroy(struct ofi_bufpool_depot *depot)
+{
+	struct ofi_bufpool_tcache *tcache;
+	struct ofi_bufpool_mag *mag;
+
+	/* Threads that are still alive simply lose their cache of this pool,
+	 * and the depot id may be given to a new pool.
+	 */
+	pthread_mutex_lock(&ofi_bufpool_lock);
+	while (!dlist_empty(&depot->tcaches)) {
+		dlist_pop_front(&depot->tcaches, struct ofi_bufpool_tcache,
+				tcache, entry);
+		tcache->thread->tcaches[depot->id] = NULL;
+		ofi_bufpool_tcache_free(tcache);
+	}
+	ofi_bufpool_depots[depot->id] = NULL;
+	pthread_mutex_unlock(&ofi_bufpool_lock);
+
+	while (!slist_empty(&depot->full)) {
+		slist_remove_head_container(&depot->full,
+					    struct ofi_bufpool_mag, mag, entry);
+		free(mag);
+	}
+	while (!slist_empty(&depot->empty)) {
+		slist_remove_head_container(&depot->empty,
+					    struct ofi_bufpool_mag, mag, entry);
+		free(mag);
+	}
+	ofi_mutex_destroy(&depot->lock);
+	free(depot);
+}
+
+/*
+ * Delete the shared key, so that no destructor runs from a library that
+ * has been unloaded.  Magazine pools must be destroyed before this.
+ */
+void ofi_bufpool_fini(void)
+{
+	size_t id;
+
+	pthread_mutex_lock(&ofi_bufpool_lock);
+	if (ofi_bufpool_key_valid) {
+		pthread_key_delete(ofi_bufpool_key);
+		ofi_bufpool_key_valid = false;
+	}
+
+	for (id = 0; id < ofi_bufpool_depot_cnt; id++) {
+		if (ofi_bufpool_depots[id])
+			goto unlock;
+	}
+	free(ofi_bufpool_depots);
+	ofi_bufpool_depots = NULL;
+	ofi_bufpool_depot_cnt = 0;
+unlock:
+	pthread_mutex_unlock(&ofi_bufpool_lock);
+}
+
 int ofi_bufpool_create_attr(struct ofi_bufpool_attr *attr,
 			      struct ofi_bufpool **buf_pool)
 {
 	struct ofi_bufpool *pool;
 	size_t entry_sz;
+	int ret;
 
 	pool = calloc(1, sizeof(**buf_pool));
 	if (!pool)
@@ -262,6 +849,32 @@ int ofi_bufpool_create_attr(struct ofi_bufpool_attr *attr,
 			pool->entry_size < page_sizes[OFI_PAGE_SIZE] ? 64 : 16;
 	}
 
+	/* With an explicit huge page size, fill at least one page per region
+	 * rather than falling back to base pages for small regions.
+	 */
+	pool->base_chunk_cnt = pool->attr.chunk_cnt;
+	if ((pool->attr.flags & OFI_BUFPOOL_HUGEPAGES) && attr->page_size &&
+	    (pool->attr.chunk_cnt + 1) * pool->entry_size < attr->page_size) {
+		pool->attr.chunk_cnt = attr->page_size / pool->entry_size - 1;
+		if (attr->max_cnt && pool->attr.chunk_cnt > attr->max_cnt)
+			pool->attr.chunk_cnt = attr->max_cnt;
+	}
+
+	pool->stats.numa_node = -1;
+	if (pool->attr.flags & OFI_BUFPOOL_NUMA) {
+		if (pool->attr.numa_node < 0)
+			pool->attr.numa_node = ofi_get_numa_node();
+		if (pool->attr.numa_node < 0) {
+			FI_WARN(&core_prov, FI_LOG_CORE,
+				"unable to find NUMA node of pool %p\n", pool);
+			pool->attr.flags &= ~OFI_BUFPOOL_NUMA;
+		} else {
+			/* node placement needs page aligned regions */
+			pool->attr.flags |= OFI_BUFPOOL_NONSHARED;
+			pool->stats.numa_node = pool->attr.numa_node;
+		}
+	}
+
 	if (pool->attr.flags & OFI_BUFPOOL_INDEXED)
 		dlist_init(&pool->free_list.regions);
 	else
@@ -270,6 +883,14 @@ int ofi_bufpool_create_attr(struct ofi_bufpool_attr *attr,
 	pool->alloc_size = (pool->attr.chunk_cnt + 1) * pool->entry_size;
 	pool->region_size = pool->alloc_size - pool->entry_size;
 
+	if (pool->attr.flags & OFI_BUFPOOL_MAGAZINE) {
+		ret = ofi_bufpool_depot_create(pool);
+		if (ret) {
+			free(pool);
+			return ret;
+		}
+	}
+
 	FI_DBG(&core_prov, FI_LOG_CORE,
 		"%s alloc_size %zu region_size %zu align_entry %zu "
 		"entry_size %zu chunk_cnt %zu pool %p  (%p)\n",
@@ -285,16 +906,27 @@ void ofi_bufpool_destroy(struct ofi_bufpool *pool)
 	struct ofi_bufpool_region *buf_region;
 	size_t i;
 
+	if (pool->depot)
+		ofi_bufpool_depot_destroy(pool->depot);
+
+	if (pool->region_cnt && (pool->stats.huge_regions ||
+	    pool->stats.huge_fallbacks || pool->stats.numa_node >= 0)) {
+		FI_INFO(&core_prov, FI_LOG_CORE,
+			"pool %p: %zu regions of %zu bytes on %zu byte pages, "
+			"%zu huge page regions, %zu huge page fallbacks, "
+			"%zu of %zu entries cross a page, NUMA node %d\n",
+			pool, pool->region_cnt, pool->alloc_size,
+			pool->stats.page_size, pool->stats.huge_regions,
+			pool->stats.huge_fallbacks, pool->stats.split_entries,
+			pool->entry_cnt, pool->stats.numa_node);
+	}
+
 	for (i = 0; i < pool->region_cnt; i++) {
 		buf_region = pool->region_table[i];
 
 		assert((pool->attr.flags & OFI_BUFPOOL_NO_TRACK) ||
 			!ofi_atomic_get32(&buf_region->use_cnt));
-		if (pool->attr.free_fn)
-			pool->attr.free_fn(buf_region);
-
-		ofi_bufpool_region_free(buf_region);
-		free(buf_region);
+		ofi_bufpool_region_destroy(buf_region);
 	}
 	free(pool->region_table);
 	free(pool);
@@ -319,3 +951,42 @@ int ofi_ibufpool_region_is_lower(struct dlist_entry *item, const void *arg)
 
 	return reg1->index < reg2->index;
 }
+
+void ofi_bufpool_param_define(struct fi_provider *prov)
+{
+	fi_param_define(prov, "bufpool_page_size", FI_PARAM_SIZE_T,
+			"Back the provider's data path buffer pools with huge "
+			"pages of this size in bytes, such as 2097152 or "
+			"1073741824.  Pools fall back to base pages if the "
+			"pages are not available. (default: 0, base pages)");
+	fi_param_define(prov, "bufpool_numa_node", FI_PARAM_INT,
+			"Place the provider's data path buffer pools on this "
+			"NUMA node, or on the node of the thread creating the "
+			"pool if -1. (default: unset)");
+	fi_param_define(prov, "bufpool_prefault", FI_PARAM_BOOL,
+			"Fault in the memory of the provider's buffer pools "
+			"when they grow, rather than on first use. "
+			"(default: false)");
+}
+
+void ofi_bufpool_param_get(struct fi_provider *prov,
+			   struct ofi_bufpool_attr *attr)
+{
+	size_t page_size;
+	int node, prefault;
+
+	if (!fi_param_get_size_t(prov, "bufpool_page_size", &page_size) &&
+	    page_size > page_sizes[OFI_PAGE_SIZE]) {
+		attr->flags |= OFI_BUFPOOL_HUGEPAGES;
+		attr->page_size = page_size;
+	}
+
+	if (!fi_param_get_int(prov, "bufpool_numa_node", &node)) {
+		attr->flags |= OFI_BUFPOOL_NUMA;
+		attr->numa_node = node;
+	}
+
+	if (!fi_param_get_bool(prov, "bufpool_prefault", &prefault) &&
+	    prefault)
+		attr->flags |= OFI_BUFPOOL_PREFAULT;
+}
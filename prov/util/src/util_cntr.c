@@ -32,8 +32,10 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #include <ofi_enosys.h>
+#include <ofi_mb.h>
 #include <ofi_util.h>
 
 static int ofi_check_cntr_attr(const struct fi_provider *prov,
@@ -42,7 +44,7 @@ static int ofi_check_cntr_attr(const struct fi_provider *prov,
 	if (!attr)
 		return FI_SUCCESS;
 
-        if (attr->flags && attr->flags != FI_PEER) {
+	if (attr->flags & ~FI_PEER) {
 		FI_WARN(prov, FI_LOG_CNTR, "unsupported flags\n");
 		return -FI_EINVAL;
 	}
@@ -75,6 +77,7 @@ uint64_t ofi_cntr_read(struct fid_cntr *cntr_fid)
 
 	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
 	cntr->progress(cntr);
+	ofi_trigger_progress(cntr->domain);
 
 	return ofi_atomic_get64(&cntr->cnt);
 }
@@ -85,6 +88,7 @@ uint64_t ofi_cntr_readerr(struct fid_cntr *cntr_fid)
 
 	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
 	cntr->progress(cntr);
+	ofi_trigger_progress(cntr->domain);
 
 	return ofi_atomic_get64(&cntr->err);
 }
@@ -96,6 +100,7 @@ int ofi_cntr_add(struct fid_cntr *cntr_fid, uint64_t value)
 	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
 
 	ofi_atomic_add64(&cntr->cnt, value);
+	ofi_trigger_cntr_update(cntr);
 	if (cntr->wait)
 		cntr->wait->signal(cntr->wait);
 
@@ -109,6 +114,7 @@ int ofi_cntr_adderr(struct fid_cntr *cntr_fid, uint64_t value)
 	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
 
 	ofi_atomic_add64(&cntr->err, value);
+	ofi_trigger_cntr_update(cntr);
 	if (cntr->wait)
 		cntr->wait->signal(cntr->wait);
 
@@ -122,6 +128,7 @@ int ofi_cntr_set(struct fid_cntr *cntr_fid, uint64_t value)
 	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
 
 	ofi_atomic_set64(&cntr->cnt, value);
+	ofi_trigger_cntr_update(cntr);
 	if (cntr->wait)
 		cntr->wait->signal(cntr->wait);
 
@@ -134,6 +141,7 @@ int ofi_cntr_seterr(struct fid_cntr *cntr_fid, uint64_t value)
 	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
 
 	ofi_atomic_set64(&cntr->err, value);
+	ofi_trigger_cntr_update(cntr);
 	if (cntr->wait)
 		cntr->wait->signal(cntr->wait);
 
@@ -153,6 +161,7 @@ int ofi_cntr_wait(struct fid_cntr *cntr_fid, uint64_t threshold, int timeout)
 
 	do {
 		cntr->progress(cntr);
+		ofi_trigger_progress(cntr->domain);
 		if (threshold <= (uint64_t)ofi_atomic_get64(&cntr->cnt))
 			return FI_SUCCESS;
 
@@ -193,6 +202,192 @@ static struct fi_ops_cntr util_cntr_ops = {
 	.wait = ofi_cntr_wait
 };
 
+/*
+ * Futex wait mode
+ *
+ * Used for FI_WAIT_UNSPEC counters that the provider updates from its own
+ * progress thread.  Reads and updates are plain atomics; fi_cntr_wait does
+ * not drive progress, but sleeps on futex_seq until the lowest threshold
+ * of the blocked waiters is crossed.  Updates only enter the kernel when
+ * that happens.
+ *
+ * A waiter reads futex_seq before it publishes its threshold, and an
+ * update resets the threshold before it bumps futex_seq, so a threshold
+ * cleared by a concurrent wake up makes the futex wait return at once
+ * and the waiter publishes it again.
+ */
+static void util_cntr_futex_wake(struct util_cntr *cntr, bool force)
+{
+	/* Order the counter update against the waiter count */
+	ofi_mb();
+	if (!ofi_atomic_get32(&cntr->futex_waiters))
+		return;
+
+	if (!force && (uint64_t) ofi_atomic_get64(&cntr->cnt) <
+		      (uint64_t) ofi_atomic_get64(&cntr->futex_threshold))
+		return;
+
+	ofi_atomic_set64(&cntr->futex_threshold, (int64_t) UINT64_MAX);
+	ofi_atomic_inc32(&cntr->futex_seq);
+	(void) ofi_futex_wake(&cntr->futex_seq, INT_MAX);
+}
+
+static void util_cntr_futex_arm(struct util_cntr *cntr, uint64_t threshold)
+{
+	int64_t cur;
+
+	do {
+		cur = ofi_atomic_get64(&cntr->futex_threshold);
+		if ((uint64_t) cur <= threshold)
+			return;
+	} while (!ofi_atomic_cas_bool64(&cntr->futex_threshold, cur,
+					(int64_t) threshold));
+}
+
+static uint64_t util_cntr_futex_read(struct fid_cntr *cntr_fid)
+{
+	struct util_cntr *cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
+
+	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
+	ofi_trigger_progress(cntr->domain);
+
+	return ofi_atomic_get64(&cntr->cnt);
+}
+
+static uint64_t util_cntr_futex_readerr(struct fid_cntr *cntr_fid)
+{
+	struct util_cntr *cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
+
+	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
+	ofi_trigger_progress(cntr->domain);
+
+	return ofi_atomic_get64(&cntr->err);
+}
+
+static int util_cntr_futex_add(struct fid_cntr *cntr_fid, uint64_t value)
+{
+	struct util_cntr *cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
+
+	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
+
+	ofi_atomic_add64(&cntr->cnt, value);
+	ofi_trigger_cntr_update(cntr);
+	util_cntr_futex_wake(cntr, false);
+
+	return FI_SUCCESS;
+}
+
+static int util_cntr_futex_adderr(struct fid_cntr *cntr_fid, uint64_t value)
+{
+	struct util_cntr *cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
+
+	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
+
+	ofi_atomic_add64(&cntr->err, value);
+	ofi_trigger_cntr_update(cntr);
+	util_cntr_futex_wake(cntr, true);
+
+	return FI_SUCCESS;
+}
+
+static int util_cntr_futex_set(struct fid_cntr *cntr_fid, uint64_t value)
+{
+	struct util_cntr *cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
+
+	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
+
+	ofi_atomic_set64(&cntr->cnt, value);
+	ofi_trigger_cntr_update(cntr);
+	util_cntr_futex_wake(cntr, false);
+
+	return FI_SUCCESS;
+}
+
+static int util_cntr_futex_seterr(struct fid_cntr *cntr_fid, uint64_t value)
+{
+	struct util_cntr *cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
+
+	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
+
+	ofi_atomic_set64(&cntr->err, value);
+	ofi_trigger_cntr_update(cntr);
+	util_cntr_futex_wake(cntr, true);
+
+	return FI_SUCCESS;
+}
+
+static int util_cntr_futex_wait(struct fid_cntr *cntr_fid, uint64_t threshold,
+				int timeout)
+{
+	struct util_cntr *cntr;
+	uint64_t endtime, errcnt;
+	int32_t seq;
+	int ret, sleep_ms;
+
+	cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
+	assert(cntr->cntr_fid.fid.fclass == FI_CLASS_CNTR);
+	errcnt = ofi_atomic_get64(&cntr->err);
+	endtime = ofi_timeout_time(timeout);
+
+	ofi_atomic_inc32(&cntr->futex_waiters);
+	for (;;) {
+		ofi_trigger_progress(cntr->domain);
+
+		seq = ofi_atomic_get32(&cntr->futex_seq);
+		util_cntr_futex_arm(cntr, threshold);
+		/* Order the threshold against the counter value */
+		ofi_mb();
+
+		if (threshold <= (uint64_t) ofi_atomic_get64(&cntr->cnt)) {
+			ret = FI_SUCCESS;
+			break;
+		}
+
+		if (errcnt != (uint64_t) ofi_atomic_get64(&cntr->err)) {
+			ret = -FI_EAVAIL;
+			break;
+		}
+
+		if (ofi_adjust_timeout(endtime, &timeout)) {
+			ret = -FI_ETIMEDOUT;
+			break;
+		}
+
+		/* Triggered operations are only issued by application calls */
+		sleep_ms = timeout;
+		if (ofi_trigger_pending(cntr->domain))
+			sleep_ms = (timeout < 0 ? OFI_TIMEOUT_QUANTUM_MS :
+				    MIN(OFI_TIMEOUT_QUANTUM_MS, timeout));
+
+		(void) ofi_futex_wait(&cntr->futex_seq, seq, sleep_ms);
+	}
+	ofi_atomic_dec32(&cntr->futex_waiters);
+
+	return ret;
+}
+
+static struct fi_ops_cntr util_cntr_futex_ops = {
+	.size = sizeof(struct fi_ops_cntr),
+	.read = util_cntr_futex_read,
+	.readerr = util_cntr_futex_readerr,
+	.add = util_cntr_futex_add,
+	.adderr = util_cntr_futex_adderr,
+	.set = util_cntr_futex_set,
+	.seterr = util_cntr_futex_seterr,
+	.wait = util_cntr_futex_wait,
+};
+
+static bool util_cntr_use_futex(struct util_cntr *cntr,
+				const struct fi_cntr_attr *attr)
+{
+	if (attr->wait_obj != FI_WAIT_UNSPEC ||
+	    !(cntr->flags & OFI_CNTR_AUTO_PROGRESS))
+		return false;
+
+	/* Fails with -FI_ENOSYS where futexes are not available */
+	return ofi_futex_wake(&cntr->futex_seq, 1) >= 0;
+}
+
 static struct fi_ops_cntr util_cntr_no_wait_ops = {
 	.size = sizeof(struct fi_ops_cntr),
 	.read = ofi_cntr_read,
@@ -250,6 +445,7 @@ int ofi_cntr_cleanup(struct util_cntr *cntr)
 	if (ofi_atomic_get32(&cntr->ref))
 		return -FI_EBUSY;
 
+	ofi_trigger_cntr_cleanup(cntr);
 	if (!(cntr->flags & FI_PEER))
 		fi_close(&cntr->peer_cntr->fid);
 
@@ -329,9 +525,10 @@ static int util_init_peer_cntr(struct util_cntr *cntr)
 	return FI_SUCCESS;
 }
 
-int ofi_cntr_init(const struct fi_provider *prov, struct fid_domain *domain,
-		  struct fi_cntr_attr *attr, struct util_cntr *cntr,
-		  ofi_cntr_progress_func progress, void *context)
+static int util_cntr_init(const struct fi_provider *prov,
+			  struct fid_domain *domain, struct fi_cntr_attr *attr,
+			  struct util_cntr *cntr, ofi_cntr_progress_func progress,
+			  void *context, uint64_t internal_flags)
 {
 	int ret;
 	struct fi_wait_attr wait_attr;
@@ -349,8 +546,14 @@ int ofi_cntr_init(const struct fi_provider *prov, struct fid_domain *domain,
 	ofi_atomic_initialize64(&cntr->cnt, 0);
 	ofi_atomic_initialize64(&cntr->err, 0);
 	dlist_init(&cntr->ep_list);
-
-	cntr->flags = attr->flags;
+	dlist_init(&cntr->trigger_list);
+	dlist_init(&cntr->trigger_entry);
+	ofi_atomic_initialize32(&cntr->trigger_cnt, 0);
+	ofi_atomic_initialize32(&cntr->futex_seq, 0);
+	ofi_atomic_initialize32(&cntr->futex_waiters, 0);
+	ofi_atomic_initialize64(&cntr->futex_threshold, (int64_t) UINT64_MAX);
+
+	cntr->flags = attr->flags | internal_flags;
 	cntr->cntr_fid.fid.fclass = FI_CLASS_CNTR;
 	cntr->cntr_fid.fid.context = context;
 	cntr->cntr_fid.fid.ops = &util_cntr_fi_ops;
@@ -362,6 +565,12 @@ int ofi_cntr_init(const struct fi_provider *prov, struct fid_domain *domain,
 		cntr->cntr_fid.ops = &util_cntr_no_wait_ops;
 		break;
 	case FI_WAIT_UNSPEC:
+		if (util_cntr_use_futex(cntr, attr)) {
+			wait = NULL;
+			cntr->cntr_fid.ops = &util_cntr_futex_ops;
+			break;
+		}
+		/* fall through */
 	case FI_WAIT_FD:
 	case FI_WAIT_POLLFD:
 	case FI_WAIT_MUTEX_COND:
@@ -417,3 +626,23 @@ errout_close_wait:
 		fi_close(&wait->fid);
 	return ret;
 }
+
+int ofi_cntr_init(const struct fi_provider *prov, struct fid_domain *domain,
+		  struct fi_cntr_attr *attr, struct util_cntr *cntr,
+		  ofi_cntr_progress_func progress, void *context)
+{
+	return util_cntr_init(prov, domain, attr, cntr, progress, context, 0);
+}
+
+/* For providers whose progress thread updates the counter.  FI_WAIT_UNSPEC
+ * waiters then block on a futex instead of driving progress.
+ */
+int ofi_cntr_init_auto_progress(const struct fi_provider *prov,
+				struct fid_domain *domain,
+				struct fi_cntr_attr *attr,
+				struct util_cntr *cntr,
+				ofi_cntr_progress_func progress, void *context)
+{
+	return util_cntr_init(prov, domain, attr, cntr, progress, context,
+			      OFI_CNTR_AUTO_PROGRESS);
+}
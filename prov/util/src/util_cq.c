@@ -81,8 +81,8 @@ int ofi_cq_write_overflow(struct util_cq *cq, void *context, uint64_t flags,
 	return 0;
 }
 
-static int util_cq_insert_error(struct util_cq *cq,
-				const struct fi_cq_err_entry *err_entry)
+int ofi_cq_insert_error(struct util_cq *cq,
+			const struct fi_cq_err_entry *err_entry)
 {
 	struct util_cq_aux_entry *entry;
 	void *err_data;
@@ -116,7 +116,7 @@ int ofi_cq_write_error(struct util_cq *cq,
 	int ret;
 
 	ofi_genlock_lock(&cq->cq_lock);
-	ret = util_cq_insert_error(cq, err_entry);
+	ret = ofi_cq_insert_error(cq, err_entry);
 	ofi_genlock_unlock(&cq->cq_lock);
 
 	if (cq->wait)
@@ -268,6 +268,7 @@ ssize_t ofi_cq_readfrom(struct fid_cq *cq_fid, void *buf, size_t count,
 	cq = container_of(cq_fid, struct util_cq, cq_fid);
 
 	cq->progress(cq);
+	ofi_trigger_progress(cq->domain);
 
 	return ofi_cq_read_entries(cq, buf, count, src_addr);
 }
@@ -588,7 +589,7 @@ static ssize_t util_peer_cq_writeerr(struct fid_peer_cq *cq,
 	int ret;
 
 	ofi_genlock_lock(&util_cq->cq_lock);
-	ret = util_cq_insert_error(util_cq, err_entry);
+	ret = ofi_cq_insert_error(util_cq, err_entry);
 	ofi_genlock_unlock(&util_cq->cq_lock);
 
 	if (util_cq->wait)
@@ -732,6 +733,10 @@ int ofi_cq_init(const struct fi_provider *prov, struct fid_domain *domain,
 	if (cq->domain->threading == FI_THREAD_COMPLETION ||
 	    cq->domain->threading == FI_THREAD_DOMAIN)
 		cq_lock_type = OFI_LOCK_NOOP;
+	else if (cq->domain->lock.lock_type == OFI_LOCK_RWLOCK ||
+		 cq->domain->lock.lock_type == OFI_LOCK_SHARDED)
+		/* the CQ lock is always taken exclusively */
+		cq_lock_type = OFI_LOCK_MUTEX;
 	else
 		cq_lock_type = cq->domain->lock.lock_type;
 
@@ -85,6 +85,7 @@ int ofi_domain_close(struct util_domain *domain)
 	dlist_remove(&domain->list_entry);
 	ofi_mutex_unlock(&domain->fabric->lock);
 
+	ofi_trigger_cleanup(domain);
 	free(domain->name);
 	ofi_genlock_destroy(&domain->lock);
 	ofi_atomic_dec32(&domain->fabric->ref);
@@ -122,6 +123,7 @@ util_domain_init(struct util_domain *domain, const struct fi_info *info,
 		ofi_genlock_destroy(&domain->lock);
 		return -FI_ENOMEM;
 	}
+	ofi_trigger_init(domain);
 	return 0;
 }
 
@@ -522,8 +522,92 @@ static int ofi_intercept_symbol(struct ofi_intercept *intercept)
 	return ret;
 }
 
+/*
+ * Lock-free summary of the regions subscribed by the MR caches.  Each
+ * 2 MiB chunk of the address space maps to a counter that is raised for
+ * every subscribed region touching the chunk.  An event whose chunks all
+ * have a zero count cannot overlap a cached region, so it is dropped
+ * without taking mm_list_rwlock and mm_lock.  Chunks alias every
+ * OFI_MEMHOOKS_SUMMARY_SIZE chunks, which only costs extra deliveries.
+ */
+#define OFI_MEMHOOKS_CHUNK_SHIFT	21
+#define OFI_MEMHOOKS_SUMMARY_SIZE	(1 << 14)
+#define OFI_MEMHOOKS_SUMMARY_MASK	(OFI_MEMHOOKS_SUMMARY_SIZE - 1)
+/* longer events are delivered without checking each chunk */
+#define OFI_MEMHOOKS_SCAN_MAX		64
+
+static ofi_atomic32_t memhooks_summary[OFI_MEMHOOKS_SUMMARY_SIZE];
+static ofi_atomic32_t memhooks_region_cnt;
+/* regions covering more chunks than the summary holds */
+static ofi_atomic32_t memhooks_wide_cnt;
+
+static void ofi_memhooks_chunks(const void *addr, size_t len,
+				uintptr_t *first, uintptr_t *last)
+{
+	*first = (uintptr_t) addr >> OFI_MEMHOOKS_CHUNK_SHIFT;
+	if (len > UINTPTR_MAX - (uintptr_t) addr)
+		len = UINTPTR_MAX - (uintptr_t) addr;
+	*last = ((uintptr_t) addr + (len ? len - 1 : 0)) >>
+		OFI_MEMHOOKS_CHUNK_SHIFT;
+}
+
+static void ofi_memhooks_summary_init(void)
+{
+	int i;
+
+	for (i = 0; i < OFI_MEMHOOKS_SUMMARY_SIZE; i++)
+		ofi_atomic_initialize32(&memhooks_summary[i], 0);
+	ofi_atomic_initialize32(&memhooks_region_cnt, 0);
+	ofi_atomic_initialize32(&memhooks_wide_cnt, 0);
+	ofi_atomic_initialize64(&memhooks.filtered_cnt, 0);
+	ofi_atomic_initialize64(&memhooks.delivered_cnt, 0);
+}
+
+/* Called with mm_lock held */
+static void ofi_memhooks_summary_update(const void *addr, size_t len,
+					int32_t val)
+{
+	uintptr_t first, last, chunk;
+
+	ofi_memhooks_chunks(addr, len, &first, &last);
+	if (last - first >= OFI_MEMHOOKS_SUMMARY_SIZE) {
+		ofi_atomic_add32(&memhooks_wide_cnt, val);
+	} else {
+		for (chunk = first; chunk <= last; chunk++)
+			ofi_atomic_add32(&memhooks_summary[chunk &
+					 OFI_MEMHOOKS_SUMMARY_MASK], val);
+	}
+	ofi_atomic_add32(&memhooks_region_cnt, val);
+}
+
+static bool ofi_memhooks_summary_hit(const void *addr, size_t len)
+{
+	uintptr_t first, last, chunk;
+
+	if (!ofi_atomic_get32(&memhooks_region_cnt))
+		return false;
+
+	ofi_memhooks_chunks(addr, len, &first, &last);
+	if (ofi_atomic_get32(&memhooks_wide_cnt) ||
+	    last - first >= OFI_MEMHOOKS_SCAN_MAX)
+		return true;
+
+	for (chunk = first; chunk <= last; chunk++) {
+		if (ofi_atomic_get32(&memhooks_summary[chunk &
+				     OFI_MEMHOOKS_SUMMARY_MASK]))
+			return true;
+	}
+	return false;
+}
+
 void ofi_intercept_handler(const void *addr, size_t len)
 {
+	if (!ofi_memhooks_summary_hit(addr, len)) {
+		ofi_atomic_inc64(&memhooks.filtered_cnt);
+		return;
+	}
+
+	ofi_atomic_inc64(&memhooks.delivered_cnt);
 	pthread_rwlock_rdlock(&mm_list_rwlock);
 	pthread_mutex_lock(&mm_lock);
 	ofi_monitor_notify(memhooks_monitor, addr, len);
@@ -671,7 +755,7 @@ static int ofi_memhooks_subscribe(struct ofi_mem_monitor *monitor,
 				  const void *addr, size_t len,
 				  union ofi_mr_hmem_info *hmem_info)
 {
-	/* no-op */
+	ofi_memhooks_summary_update(addr, len, 1);
 	return FI_SUCCESS;
 }
 
@@ -679,7 +763,7 @@ static void ofi_memhooks_unsubscribe(struct ofi_mem_monitor *monitor,
 				     const void *addr, size_t len,
 				     union ofi_mr_hmem_info *hmem_info)
 {
-	/* no-op */
+	ofi_memhooks_summary_update(addr, len, -1);
 }
 
 static bool ofi_memhooks_valid(struct ofi_mem_monitor *monitor,
@@ -701,6 +785,7 @@ static int ofi_memhooks_start(struct ofi_mem_monitor *monitor)
 	memhooks_monitor->unsubscribe = ofi_memhooks_unsubscribe;
 	memhooks_monitor->valid = ofi_memhooks_valid;
 	dlist_init(&memhooks.intercept_list);
+	ofi_memhooks_summary_init();
 
 	for (i = 0; i < OFI_INTERCEPT_MAX; ++i)
 		dlist_init(&intercepts[i].dl_intercept_list);
@@ -730,6 +815,10 @@ err_intercept_failed:
 
 static void ofi_memhooks_stop(struct ofi_mem_monitor *monitor)
 {
+	FI_INFO(&core_prov, FI_LOG_MR,
+		"memhooks events filtered %" PRId64 " delivered %" PRId64 "\n",
+		ofi_atomic_get64(&memhooks.filtered_cnt),
+		ofi_atomic_get64(&memhooks.delivered_cnt));
 	ofi_restore_intercepts();
 	memhooks_monitor->subscribe = NULL;
 	memhooks_monitor->unsubscribe = NULL;
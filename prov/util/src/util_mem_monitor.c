@@ -268,6 +268,18 @@ void ofi_monitors_init(void)
 #endif
 			" is the default if available on the system. 'disabled'"
 			" option disables memory caching.");
+	fi_param_define(NULL, "mr_cache_trace", FI_PARAM_STRING,
+			"Record the searches, releases, registrations and"
+			" deregistrations of every MR cache to"
+			" <path>.<pid>.<cache number>.  The trace can be"
+			" replayed with the fi_mr_cache_bench fabtest."
+			" (default: disabled)");
+	fi_param_define(NULL, "mr_cache_lazy_invalidate", FI_PARAM_BOOL,
+			"Mark cached regions affected by a memory monitor"
+			" event as stale instead of removing them from the"
+			" cache.  Stale regions are removed when a later"
+			" search finds them or when they are evicted."
+			" (default: false)");
 	fi_param_define(NULL, "mr_cuda_cache_monitor_enabled", FI_PARAM_BOOL,
 			"Enable or disable the CUDA cache memory monitor."
 			"Enabled by default.");
@@ -281,6 +293,9 @@ void ofi_monitors_init(void)
 	fi_param_get_size_t(NULL, "mr_cache_max_size", &cache_params.max_size);
 	fi_param_get_size_t(NULL, "mr_cache_max_count", &cache_params.max_cnt);
 	fi_param_get_str(NULL, "mr_cache_monitor", &cache_params.monitor);
+	fi_param_get_str(NULL, "mr_cache_trace", &cache_params.trace);
+	fi_param_get_bool(NULL, "mr_cache_lazy_invalidate",
+			  &cache_params.lazy_invalidate);
 	fi_param_get_bool(NULL, "mr_cuda_cache_monitor_enabled",
 			  &cache_params.cuda_monitor_enabled);
 	fi_param_get_bool(NULL, "mr_rocr_cache_monitor_enabled",
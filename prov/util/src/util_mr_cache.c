@@ -53,6 +53,67 @@ struct ofi_mr_cache_params cache_params = {
 	.ze_monitor_enabled = true,
 };
 
+/*
+ * With FI_MR_CACHE_TRACE set, every cache writes one line per event:
+ *
+ *   S <entry> <addr> <len> <iface> <H|M>	search hit or miss
+ *   D <entry>					release of a search result
+ *   R <addr> <len>				region registered
+ *   U <addr> <len>				region deregistered
+ *
+ * <entry> identifies the cache entry a search returned, so that releases
+ * can be paired with their search when the trace is replayed.
+ */
+static int util_mr_trace_cnt;
+
+static void util_mr_trace(struct ofi_mr_cache *cache, const char *fmt, ...)
+{
+	va_list args;
+
+	if (OFI_LIKELY(!cache->trace_file))
+		return;
+
+	va_start(args, fmt);
+	vfprintf(cache->trace_file, fmt, args);
+	va_end(args);
+}
+
+static void util_mr_trace_open(struct ofi_mr_cache *cache)
+{
+	char path[PATH_MAX];
+	int idx;
+
+	pthread_mutex_lock(&mm_lock);
+	idx = util_mr_trace_cnt++;
+	pthread_mutex_unlock(&mm_lock);
+
+	snprintf(path, sizeof(path), "%s.%d.%d", cache_params.trace,
+		 (int) getpid(), idx);
+	cache->trace_file = fopen(path, "w");
+	if (!cache->trace_file) {
+		FI_WARN(cache->prov, FI_LOG_MR,
+			"Unable to open MR cache trace %s: %s\n", path,
+			strerror(errno));
+		return;
+	}
+
+	fprintf(cache->trace_file, "# ofi_mr_cache trace prov %s "
+		"max_cnt %zu max_size %zu\n", cache->prov->name,
+		cache->cached_max_cnt, cache->cached_max_size);
+}
+
+static void util_mr_trace_close(struct ofi_mr_cache *cache)
+{
+	if (!cache->trace_file)
+		return;
+
+	fprintf(cache->trace_file, "# stats searches %zu deletes %zu "
+		"hits %zu notify %zu\n", cache->search_cnt,
+		cache->delete_cnt, cache->hit_cnt, cache->notify_cnt);
+	fclose(cache->trace_file);
+	cache->trace_file = NULL;
+}
+
 static int util_mr_find_within(struct ofi_rbmap *map, void *key, void *data)
 {
 	struct ofi_mr_entry *entry = data;
@@ -120,6 +181,8 @@ static void util_mr_free_entry(struct ofi_mr_cache *cache,
 	       entry->info.iov.iov_base, entry->info.iov.iov_len);
 
 	assert(!entry->node);
+	util_mr_trace(cache, "U %p %zu\n", entry->info.iov.iov_base,
+		      entry->info.iov.iov_len);
 	cache->delete_region(cache, entry);
 	util_mr_entry_free(cache, entry);
 }
@@ -185,16 +248,51 @@ static struct ofi_mr_entry *ofi_mr_rbt_overlap(struct ofi_rbmap *tree,
 	return node->data;
 }
 
+/* Mark every entry overlapping the region as stale without modifying the
+ * tree.  Stale entries are uncached by the next search that finds them,
+ * or by LRU eviction.
+ */
+static void util_mr_mark_stale(struct ofi_mr_cache *cache,
+			       struct ofi_rbnode *node, struct ofi_mr_info *info)
+{
+	struct ofi_mr_entry *entry;
+	int cmp;
+
+	while (node != &cache->tree.sentinel) {
+		entry = node->data;
+		cmp = util_mr_find_overlap(&cache->tree, info, entry);
+		if (cmp < 0) {
+			node = node->left;
+		} else if (cmp > 0) {
+			node = node->right;
+		} else {
+			if (!entry->stale) {
+				entry->stale = true;
+				cache->stale_cnt++;
+			}
+			util_mr_mark_stale(cache, node->left, info);
+			node = node->right;
+		}
+	}
+}
+
 /* Caller must hold ofi_mem_monitor lock as well as unsubscribe from the region */
 void ofi_mr_cache_notify(struct ofi_mr_cache *cache, const void *addr, size_t len)
 {
 	struct ofi_mr_entry *entry;
+	struct ofi_mr_info info = {0};
 	struct iovec iov;
 
 	cache->notify_cnt++;
 	iov.iov_base = (void *) addr;
 	iov.iov_len = len;
 
+	if (cache_params.lazy_invalidate) {
+		info.iov = iov;
+		util_mr_mark_stale(cache, cache->tree.root, &info);
+		return;
+	}
+
 	for (entry = ofi_mr_rbt_overlap(&cache->tree, &iov); entry;
 	     entry = ofi_mr_rbt_overlap(&cache->tree, &iov))
 		util_mr_uncache_entry(cache, entry);
@@ -247,6 +345,7 @@ void ofi_mr_cache_delete(struct ofi_mr_cache *cache, struct ofi_mr_entry *entry)
 
 	pthread_mutex_lock(&mm_lock);
 	cache->delete_cnt++;
+	util_mr_trace(cache, "D %p\n", entry);
 
 	if (--entry->use_cnt == 0) {
 		if (!entry->node) {
@@ -297,10 +396,13 @@ util_mr_cache_create(struct ofi_mr_cache *cache, struct ofi_mr_info *info,
 	(*entry)->node = NULL;
 	(*entry)->info = *info;
 	(*entry)->use_cnt = 1;
+	(*entry)->stale = false;
 
 	ret = cache->add_region(cache, *entry);
 	if (ret)
 		goto free;
+	util_mr_trace(cache, "R %p %zu\n", (*entry)->info.iov.iov_base,
+		      (*entry)->info.iov.iov_len);
 
 	/* Providers may have expanded the MR. Update MR info input
 	 * accordingly.
@@ -392,7 +494,7 @@ int ofi_mr_cache_search(struct ofi_mr_cache *cache, struct ofi_mr_info *info,
 		cache->search_cnt++;
 		*entry = ofi_mr_rbt_find(&cache->tree, info);
 
-		if (*entry &&
+		if (*entry && !(*entry)->stale &&
 		    ofi_iov_within(&info->iov, &(*entry)->info.iov) &&
 		    monitor->valid(monitor, info, *entry))
 			goto hit;
@@ -411,12 +513,18 @@ int ofi_mr_cache_search(struct ofi_mr_cache *cache, struct ofi_mr_info *info,
 		}
 	} while (ret == -FI_EAGAIN);
 
+	if (!ret)
+		util_mr_trace(cache, "S %p %p %zu %d M\n", *entry,
+			      info->iov.iov_base, info->iov.iov_len,
+			      info->iface);
 	return ret;
 
 hit:
 	cache->hit_cnt++;
 	if ((*entry)->use_cnt++ == 0)
 		dlist_remove_init(&(*entry)->list_entry);
+	util_mr_trace(cache, "S %p %p %zu %d H\n", *entry, info->iov.iov_base,
+		      info->iov.iov_len, info->iface);
 	pthread_mutex_unlock(&mm_lock);
 	return 0;
 }
@@ -452,11 +560,14 @@ struct ofi_mr_entry *ofi_mr_cache_find(struct ofi_mr_cache *cache,
 
 	monitor = cache->monitors[entry->info.iface];
 
-	if (ofi_iov_within(attr->mr_iov, &entry->info.iov) &&
+	if (!entry->stale && ofi_iov_within(attr->mr_iov, &entry->info.iov) &&
 	    monitor->valid(monitor, entry->info.iov.iov_base, entry)) {
 		cache->hit_cnt++;
 		if ((entry)->use_cnt++ == 0)
 			dlist_remove_init(&(entry)->list_entry);
+		util_mr_trace(cache, "S %p %p %zu %d H\n", entry,
+			      attr->mr_iov->iov_base, attr->mr_iov->iov_len,
+			      entry->info.iface);
 	} else {
 		while (entry) {
 			util_mr_uncache_entry(cache, entry);
@@ -490,11 +601,17 @@ int ofi_mr_cache_reg(struct ofi_mr_cache *cache, const struct fi_mr_attr *attr,
 	ofi_mr_info_get_iov_from_mr_attr(&(*entry)->info, attr, flags);
 	(*entry)->use_cnt = 1;
 	(*entry)->node = NULL;
+	(*entry)->stale = false;
 
 	ret = cache->add_region(cache, *entry);
 	if (ret)
 		goto buf_free;
 
+	util_mr_trace(cache, "R %p %zu\n", (*entry)->info.iov.iov_base,
+		      (*entry)->info.iov.iov_len);
+	util_mr_trace(cache, "S %p %p %zu %d M\n", *entry,
+		      attr->mr_iov->iov_base, attr->mr_iov->iov_len,
+		      (*entry)->info.iface);
 	return 0;
 
 buf_free:
@@ -513,12 +630,13 @@ void ofi_mr_cache_cleanup(struct ofi_mr_cache *cache)
 		return;
 
 	FI_INFO(cache->prov, FI_LOG_MR, "MR cache stats: "
-		"searches %zu, deletes %zu, hits %zu notify %zu\n",
+		"searches %zu, deletes %zu, hits %zu notify %zu stale %zu\n",
 		cache->search_cnt, cache->delete_cnt, cache->hit_cnt,
-		cache->notify_cnt);
+		cache->notify_cnt, cache->stale_cnt);
 
 	while (ofi_mr_cache_flush(cache, true))
 		;
+	util_mr_trace_close(cache);
 
 	pthread_mutex_destroy(&cache->lock);
 	ofi_monitors_del_cache(cache);
@@ -556,6 +674,7 @@ int ofi_mr_cache_init(struct util_domain *domain,
 	cache->delete_cnt = 0;
 	cache->hit_cnt = 0;
 	cache->notify_cnt = 0;
+	cache->stale_cnt = 0;
 	cache->domain = domain;
 	if (domain) {
 		cache->prov = domain->prov;
@@ -576,6 +695,9 @@ int ofi_mr_cache_init(struct util_domain *domain,
 	if (ret)
 		goto del;
 
+	cache->trace_file = NULL;
+	if (cache_params.trace)
+		util_mr_trace_open(cache);
 	return 0;
 del:
 	ofi_monitors_del_cache(cache);
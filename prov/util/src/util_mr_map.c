@@ -35,6 +35,7 @@
 #include "ofi_util.h"
 #include "ofi_mr.h"
 #include "ofi_hmem.h"
+#include "ofi_mb.h"
 #include <assert.h>
 
 
@@ -66,6 +67,165 @@ dup_mr_attr(const struct fi_mr_attr *attr, uint64_t flags)
 	return dup_attr;
 }
 
+struct ofi_mr_map_slot {
+	/* 0 while the slot is free, written last on insert */
+	uint64_t		key;
+	uint32_t		index;
+	uint32_t		gen;
+	void			*base;
+	size_t			len;
+	uint64_t		offset;
+	uint64_t		access;
+	void			*context;
+	struct fi_mr_attr	*attr;
+	struct dlist_entry	free_entry;
+};
+
+static inline size_t ofi_mr_key_index(uint64_t key)
+{
+	return (size_t) (key & ((1ULL << OFI_MR_MAP_GEN_SHIFT) - 1));
+}
+
+static inline uint32_t ofi_mr_key_gen(uint64_t key)
+{
+	return (uint32_t) (key >> OFI_MR_MAP_GEN_SHIFT);
+}
+
+static inline bool ofi_mr_map_dense(struct ofi_mr_map *map, uint64_t key)
+{
+	return map->slots && ofi_mr_key_gen(key);
+}
+
+static struct ofi_mr_map_slot *
+ofi_mr_map_slot(struct ofi_mr_map *map, size_t index)
+{
+	struct ofi_mr_map_slot *chunk;
+
+	if (index >= OFI_MR_MAP_CHUNK_SIZE * OFI_MR_MAP_MAX_CHUNKS)
+		return NULL;
+
+	chunk = map->slots[index / OFI_MR_MAP_CHUNK_SIZE];
+	return chunk ? &chunk[index % OFI_MR_MAP_CHUNK_SIZE] : NULL;
+}
+
+/*
+ * Chunks are published only after they are initialized and are not
+ * freed until the map is closed, so a lock-free reader may always
+ * dereference a slot it finds in the table.
+ */
+static int ofi_mr_map_grow(struct ofi_mr_map *map)
+{
+	struct ofi_mr_map_slot *chunk, **slots;
+	size_t i;
+
+	if (!map->slots) {
+		slots = calloc(OFI_MR_MAP_MAX_CHUNKS, sizeof(*slots));
+		if (!slots)
+			return -FI_ENOMEM;
+		ofi_wmb();
+		map->slots = slots;
+	}
+
+	if (map->chunk_cnt == OFI_MR_MAP_MAX_CHUNKS)
+		return -FI_ENOSPC;
+
+	chunk = calloc(OFI_MR_MAP_CHUNK_SIZE, sizeof(*chunk));
+	if (!chunk)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < OFI_MR_MAP_CHUNK_SIZE; i++) {
+		chunk[i].index = (uint32_t) (map->chunk_cnt *
+					     OFI_MR_MAP_CHUNK_SIZE + i);
+		chunk[i].gen = 1;
+		dlist_insert_tail(&chunk[i].free_entry, &map->free_slots);
+	}
+
+	ofi_wmb();
+	map->slots[map->chunk_cnt++] = chunk;
+	return 0;
+}
+
+static int ofi_mr_map_slot_insert(struct ofi_mr_map *map,
+				  struct fi_mr_attr *item, uint64_t flags)
+{
+	struct ofi_mr_map_slot *slot;
+	size_t index;
+	int ret;
+
+	if (flags & OFI_MR_MAP_KEEP_KEY) {
+		index = ofi_mr_key_index(item->requested_key);
+		if (index >= OFI_MR_MAP_CHUNK_SIZE * OFI_MR_MAP_MAX_CHUNKS)
+			return -FI_ENOKEY;
+
+		while (!map->slots || !(slot = ofi_mr_map_slot(map, index))) {
+			ret = ofi_mr_map_grow(map);
+			if (ret)
+				return ret;
+		}
+		if (slot->key)
+			return -FI_ENOKEY;
+
+		dlist_remove(&slot->free_entry);
+		slot->gen = ofi_mr_key_gen(item->requested_key);
+	} else {
+		if (dlist_empty(&map->free_slots)) {
+			ret = ofi_mr_map_grow(map);
+			if (ret)
+				return ret;
+		}
+		dlist_pop_front(&map->free_slots, struct ofi_mr_map_slot,
+				slot, free_entry);
+		item->requested_key = ((uint64_t) slot->gen <<
+				       OFI_MR_MAP_GEN_SHIFT) | slot->index;
+	}
+
+	slot->base = item->mr_iov[0].iov_base;
+	slot->len = item->mr_iov[0].iov_len;
+	slot->offset = item->offset;
+	slot->access = item->access;
+	slot->context = item->context;
+	slot->attr = item;
+
+	ofi_wmb();
+	slot->key = item->requested_key;
+	return 0;
+}
+
+/* Caller must hold the lock serializing map updates */
+static struct ofi_mr_map_slot *
+ofi_mr_map_slot_find(struct ofi_mr_map *map, uint64_t key)
+{
+	struct ofi_mr_map_slot *slot;
+
+	slot = ofi_mr_map_slot(map, ofi_mr_key_index(key));
+	return (slot && slot->key == key) ? slot : NULL;
+}
+
+/*
+ * Lock-free snapshot of a slot.  The key is checked before and after
+ * the fields are copied, so a concurrent remove or reuse of the slot
+ * is detected by the key no longer matching.
+ */
+static bool ofi_mr_map_slot_read(struct ofi_mr_map *map, uint64_t key,
+				 struct ofi_mr_map_slot *copy)
+{
+	struct ofi_mr_map_slot *slot;
+
+	slot = ofi_mr_map_slot(map, ofi_mr_key_index(key));
+	if (!slot || *(volatile uint64_t *) &slot->key != key)
+		return false;
+
+	ofi_rmb();
+	copy->base = slot->base;
+	copy->len = slot->len;
+	copy->offset = slot->offset;
+	copy->access = slot->access;
+	copy->context = slot->context;
+	ofi_rmb();
+
+	return *(volatile uint64_t *) &slot->key == key;
+}
+
 int ofi_mr_map_insert(struct ofi_mr_map *map, const struct fi_mr_attr *attr,
 		      uint64_t *key, void *context, uint64_t flags)
 {
@@ -78,9 +238,24 @@ int ofi_mr_map_insert(struct ofi_mr_map *map, const struct fi_mr_attr *attr,
 
 	if (!(map->mode & FI_MR_VIRT_ADDR))
 		item->offset = (uintptr_t) attr->mr_iov[0].iov_base;
+	item->context = context;
+
+	if ((map->mode & FI_MR_PROV_KEY) &&
+	    (!(flags & OFI_MR_MAP_KEEP_KEY) ||
+	     ofi_mr_key_gen(item->requested_key))) {
+		ret = ofi_mr_map_slot_insert(map, item, flags);
+		if (!ret)
+			goto out;
+		if (ret != -FI_ENOSPC || (flags & OFI_MR_MAP_KEEP_KEY))
+			goto err;
 
-	if (map->mode & FI_MR_PROV_KEY)
+		FI_DBG(map->prov, FI_LOG_MR,
+		       "MR key table full, using rbtree key\n");
 		item->requested_key = map->key++;
+	} else if ((map->mode & FI_MR_PROV_KEY) &&
+		   !(flags & OFI_MR_MAP_KEEP_KEY)) {
+		item->requested_key = map->key++;
+	}
 
 	ret = ofi_rbmap_insert(map->rbtree, &item->requested_key, item, NULL);
 	if (ret) {
@@ -88,9 +263,8 @@ int ofi_mr_map_insert(struct ofi_mr_map *map, const struct fi_mr_attr *attr,
 			ret = -FI_ENOKEY;
 		goto err;
 	}
+out:
 	*key = item->requested_key;
-	item->context = context;
-
 	return 0;
 err:
 	free(item);
@@ -99,9 +273,15 @@ err:
 
 void *ofi_mr_map_get(struct ofi_mr_map *map, uint64_t key)
 {
+	struct ofi_mr_map_slot *slot;
 	struct fi_mr_attr *attr;
 	struct ofi_rbnode *node;
 
+	if (ofi_mr_map_dense(map, key)) {
+		slot = ofi_mr_map_slot_find(map, key);
+		return slot ? slot->context : NULL;
+	}
+
 	node = ofi_rbmap_find(map->rbtree, &key);
 	if (!node)
 		return NULL;
@@ -114,56 +294,83 @@ int ofi_mr_map_verify(struct ofi_mr_map *map, uintptr_t *io_addr,
 		      size_t len, uint64_t key, uint64_t access,
 		      void **context)
 {
+	struct ofi_mr_map_slot region;
 	struct fi_mr_attr *attr;
 	struct ofi_rbnode *node;
 	void *addr;
 
-	node = ofi_rbmap_find(map->rbtree, &key);
-	if (!node) {
-                FI_WARN(map->prov, FI_LOG_MR,
-                        "unknown key: %" PRIu64 "\n", key);
-	        return -FI_EINVAL;
-        }
-
-	attr = node->data;
-	assert(attr);
+	if (ofi_mr_map_dense(map, key)) {
+		if (!ofi_mr_map_slot_read(map, key, &region))
+			goto unknown;
+	} else {
+		node = ofi_rbmap_find(map->rbtree, &key);
+		if (!node)
+			goto unknown;
+
+		attr = node->data;
+		assert(attr);
+		region.base = attr->mr_iov[0].iov_base;
+		region.len = attr->mr_iov[0].iov_len;
+		region.offset = attr->offset;
+		region.access = attr->access;
+		region.context = attr->context;
+	}
 
-	if ((access & attr->access) != access) {
+	if ((access & region.access) != access) {
                 FI_WARN(map->prov, FI_LOG_MR,
                         "invalid access: permitted %s\n",
-                        fi_tostr(&attr->access, FI_TYPE_MR_MODE));
+                        fi_tostr(&region.access, FI_TYPE_MR_MODE));
                 FI_WARN(map->prov, FI_LOG_MR,
                         "invalid access: requested %s\n",
                         fi_tostr(&access, FI_TYPE_MR_MODE));
 		return -FI_EACCES;
 	}
 
-	addr = (void *) (*io_addr + (uintptr_t) attr->offset);
+	addr = (void *) (*io_addr + (uintptr_t) region.offset);
 
-	if ((addr < attr->mr_iov[0].iov_base) ||
-	    (((char *) addr + len) > ((char *) attr->mr_iov[0].iov_base +
-			    	      attr->mr_iov[0].iov_len))) {
+	if ((addr < region.base) ||
+	    (((char *) addr + len) > ((char *) region.base + region.len))) {
                 FI_WARN(map->prov, FI_LOG_MR,
                         "target region (%p - %p) "
                         "out of registered range (%p - %p)\n",
                         addr, (char *) addr + len,
-                        (char *) attr->mr_iov[0].iov_base,
-                        (char *) attr->mr_iov[0].iov_base +
-                        attr->mr_iov[0].iov_len);
+                        (char *) region.base,
+                        (char *) region.base + region.len);
 		return -FI_EACCES;
 	}
 
 	if (context)
-		*context = attr->context;
+		*context = region.context;
 	*io_addr = (uintptr_t) addr;
 	return 0;
+
+unknown:
+	FI_WARN(map->prov, FI_LOG_MR, "unknown key: %" PRIu64 "\n", key);
+	return -FI_EINVAL;
 }
 
 int ofi_mr_map_remove(struct ofi_mr_map *map, uint64_t key)
 {
+	struct ofi_mr_map_slot *slot;
 	struct ofi_rbnode *node;
 	struct fi_mr_attr *attr;
 
+	if (ofi_mr_map_dense(map, key)) {
+		slot = ofi_mr_map_slot_find(map, key);
+		if (!slot)
+			return -FI_ENOKEY;
+
+		/* Invalidate the key before the slot can be reused */
+		slot->key = 0;
+		ofi_wmb();
+		free(slot->attr);
+		slot->attr = NULL;
+		if (!++slot->gen)
+			slot->gen = 1;
+		dlist_insert_head(&slot->free_entry, &map->free_slots);
+		return 0;
+	}
+
 	node = ofi_rbmap_find(map->rbtree, &key);
 	if (!node)
 		return -FI_ENOKEY;
@@ -175,6 +382,50 @@ int ofi_mr_map_remove(struct ofi_mr_map *map, uint64_t key)
 	return 0;
 }
 
+struct ofi_mr_map_foreach_arg {
+	struct ofi_mr_map *map;
+	int (*func)(struct ofi_mr_map *map, struct fi_mr_attr *attr,
+		    void *context);
+	void *context;
+};
+
+static int ofi_mr_map_foreach_node(struct ofi_rbmap *rbtree,
+				   struct ofi_rbnode *node, void *context)
+{
+	struct ofi_mr_map_foreach_arg *arg = context;
+
+	return arg->func(arg->map, node->data, arg->context);
+}
+
+int ofi_mr_map_foreach(struct ofi_mr_map *map,
+		       int (*func)(struct ofi_mr_map *map,
+				   struct fi_mr_attr *attr, void *context),
+		       void *context)
+{
+	struct ofi_mr_map_foreach_arg arg = {
+		.map = map,
+		.func = func,
+		.context = context,
+	};
+	struct ofi_mr_map_slot *chunk;
+	size_t i, j;
+	int ret;
+
+	for (i = 0; i < map->chunk_cnt; i++) {
+		chunk = map->slots[i];
+		for (j = 0; j < OFI_MR_MAP_CHUNK_SIZE; j++) {
+			if (!chunk[j].key)
+				continue;
+			ret = func(map, chunk[j].attr, context);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return ofi_rbmap_foreach(map->rbtree, map->rbtree->root,
+				 ofi_mr_map_foreach_node, &arg);
+}
+
 /* assumes uint64_t keys */
 static int compare_mr_keys(struct ofi_rbmap *rbtree,
 			   void *key, void *data)
@@ -210,12 +461,25 @@ int ofi_mr_map_init(const struct fi_provider *prov, int mode,
 	}
 	map->prov = prov;
 	map->key = 1;
+	map->slots = NULL;
+	map->chunk_cnt = 0;
+	dlist_init(&map->free_slots);
 
 	return 0;
 }
 
 void ofi_mr_map_close(struct ofi_mr_map *map)
 {
+	struct ofi_mr_map_slot *chunk;
+	size_t i, j;
+
+	for (i = 0; i < map->chunk_cnt; i++) {
+		chunk = map->slots[i];
+		for (j = 0; j < OFI_MR_MAP_CHUNK_SIZE; j++)
+			free(chunk[j].attr);
+		free(chunk);
+	}
+	free(map->slots);
 	ofi_rbmap_destroy(map->rbtree);
 }
 
@@ -405,10 +669,14 @@ int ofi_mr_verify(struct ofi_mr_map *map, ssize_t len,
 	struct util_domain *domain;
 	int ret;
 
+	/* Provider keys are verified against the slot table lock-free */
+	if (ofi_mr_map_dense(map, key))
+		return ofi_mr_map_verify(map, addr, len, key, access, NULL);
+
 	domain = container_of(map, struct util_domain, mr_map);
-	ofi_genlock_lock(&domain->lock);
+	ofi_genlock_rdlock(&domain->lock);
 	ret = ofi_mr_map_verify(&domain->mr_map, addr, len,
 				key, access, NULL);
-	ofi_genlock_unlock(&domain->lock);
+	ofi_genlock_rdunlock(&domain->lock);
 	return ret;
 }
@@ -0,0 +1,843 @@
+/*
+ * Copyright (c) 2026 The Libfabric Contributors. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ofi_util.h>
+
+/* A trigger references either an application owned fi_deferred_work, or
+ * the work request built into the trigger itself for an operation posted
+ * with FI_TRIGGER.  In the latter case the operation and its iov arrays
+ * are copied, since the application may reuse them once the call returns.
+ */
+struct util_trigger {
+	struct dlist_entry		entry;
+	struct util_cntr		*cntr;
+	uint64_t			threshold;
+	struct fi_deferred_work		*work;
+
+	struct fi_deferred_work		trig_work;
+	union {
+		struct fi_op_msg		msg;
+		struct fi_op_tagged		tagged;
+		struct fi_op_rma		rma;
+		struct fi_op_atomic		atomic;
+		struct fi_op_fetch_atomic	fetch_atomic;
+		struct fi_op_compare_atomic	compare_atomic;
+	} op;
+	union {
+		struct iovec			iov[OFI_TRIGGER_IOV_LIMIT];
+		struct fi_ioc			ioc[OFI_TRIGGER_IOV_LIMIT];
+	} msg_iov;
+	void				*desc[OFI_TRIGGER_IOV_LIMIT];
+	union {
+		struct fi_rma_iov		iov[OFI_TRIGGER_IOV_LIMIT];
+		struct fi_rma_ioc		ioc[OFI_TRIGGER_IOV_LIMIT];
+	} rma_iov;
+	struct fi_ioc			resultv[OFI_TRIGGER_IOV_LIMIT];
+	void				*result_desc[OFI_TRIGGER_IOV_LIMIT];
+	struct fi_ioc			comparev[OFI_TRIGGER_IOV_LIMIT];
+	void				*compare_desc[OFI_TRIGGER_IOV_LIMIT];
+};
+
+/* Errors do not count towards the threshold */
+static bool util_trigger_ready(struct util_trigger *trigger)
+{
+	return ofi_atomic_get64(&trigger->cntr->cnt) >= trigger->threshold;
+}
+
+/* Caller must hold the domain trigger_lock */
+static void util_trigger_move_ready(struct util_cntr *cntr)
+{
+	struct util_domain *domain = cntr->domain;
+	struct util_trigger *trigger;
+
+	while (!dlist_empty(&cntr->trigger_list)) {
+		trigger = container_of(cntr->trigger_list.next,
+				       struct util_trigger, entry);
+		if (!util_trigger_ready(trigger))
+			break;
+
+		dlist_remove(&trigger->entry);
+		dlist_insert_tail(&trigger->entry, &domain->trigger_ready_list);
+		ofi_atomic_dec32(&cntr->trigger_cnt);
+		ofi_atomic_inc32(&domain->trigger_ready_cnt);
+	}
+
+	if (dlist_empty(&cntr->trigger_list))
+		dlist_remove_init(&cntr->trigger_entry);
+}
+
+void ofi_trigger_check(struct util_cntr *cntr)
+{
+	ofi_mutex_lock(&cntr->domain->trigger_lock);
+	util_trigger_move_ready(cntr);
+	ofi_mutex_unlock(&cntr->domain->trigger_lock);
+}
+
+static ssize_t util_trigger_exec(struct fi_deferred_work *work)
+{
+	switch (work->op_type) {
+	case FI_OP_RECV:
+		return fi_recvmsg(work->op.msg->ep, &work->op.msg->msg,
+				  work->op.msg->flags);
+	case FI_OP_SEND:
+		return fi_sendmsg(work->op.msg->ep, &work->op.msg->msg,
+				  work->op.msg->flags);
+	case FI_OP_TRECV:
+		return fi_trecvmsg(work->op.tagged->ep, &work->op.tagged->msg,
+				   work->op.tagged->flags);
+	case FI_OP_TSEND:
+		return fi_tsendmsg(work->op.tagged->ep, &work->op.tagged->msg,
+				   work->op.tagged->flags);
+	case FI_OP_READ:
+		return fi_readmsg(work->op.rma->ep, &work->op.rma->msg,
+				  work->op.rma->flags);
+	case FI_OP_WRITE:
+		return fi_writemsg(work->op.rma->ep, &work->op.rma->msg,
+				   work->op.rma->flags);
+	case FI_OP_ATOMIC:
+		return fi_atomicmsg(work->op.atomic->ep, &work->op.atomic->msg,
+				    work->op.atomic->flags);
+	case FI_OP_FETCH_ATOMIC:
+		return fi_fetch_atomicmsg(work->op.fetch_atomic->ep,
+					  &work->op.fetch_atomic->msg,
+					  work->op.fetch_atomic->fetch.msg_iov,
+					  work->op.fetch_atomic->fetch.desc,
+					  work->op.fetch_atomic->fetch.iov_count,
+					  work->op.fetch_atomic->flags);
+	case FI_OP_COMPARE_ATOMIC:
+		return fi_compare_atomicmsg(work->op.compare_atomic->ep,
+					&work->op.compare_atomic->msg,
+					work->op.compare_atomic->compare.msg_iov,
+					work->op.compare_atomic->compare.desc,
+					work->op.compare_atomic->compare.iov_count,
+					work->op.compare_atomic->fetch.msg_iov,
+					work->op.compare_atomic->fetch.desc,
+					work->op.compare_atomic->fetch.iov_count,
+					work->op.compare_atomic->flags);
+	case FI_OP_CNTR_SET:
+		return fi_cntr_set(work->op.cntr->cntr, work->op.cntr->value);
+	case FI_OP_CNTR_ADD:
+		return fi_cntr_add(work->op.cntr->cntr, work->op.cntr->value);
+	default:
+		return -FI_ENOSYS;
+	}
+}
+
+/* Threads that block without driving progress must wake up periodically
+ * while this returns true, to issue operations as they become ready.
+ */
+bool ofi_trigger_pending(struct util_domain *domain)
+{
+	bool pending;
+
+	ofi_mutex_lock(&domain->trigger_lock);
+	pending = !dlist_empty(&domain->trigger_cntr_list) ||
+		  !dlist_empty(&domain->trigger_ready_list);
+	ofi_mutex_unlock(&domain->trigger_lock);
+	return pending;
+}
+
+static void util_trigger_insert(struct util_trigger *trigger)
+{
+	struct util_cntr *cntr = trigger->cntr;
+	struct util_domain *domain = cntr->domain;
+	struct util_trigger *cur;
+	struct dlist_entry *item;
+
+	ofi_mutex_lock(&domain->trigger_lock);
+	/* Schedules are usually posted with increasing thresholds */
+	for (item = cntr->trigger_list.prev; item != &cntr->trigger_list;
+	     item = item->prev) {
+		cur = container_of(item, struct util_trigger, entry);
+		if (cur->threshold <= trigger->threshold)
+			break;
+	}
+	dlist_insert_after(&trigger->entry, item);
+
+	if (dlist_empty(&cntr->trigger_entry))
+		dlist_insert_tail(&cntr->trigger_entry,
+				  &domain->trigger_cntr_list);
+	ofi_atomic_inc32(&cntr->trigger_cnt);
+
+	/* The threshold may already have been reached, or reached by an
+	 * update that did not see the trigger yet.
+	 */
+	util_trigger_move_ready(cntr);
+	ofi_mutex_unlock(&domain->trigger_lock);
+
+	ofi_trigger_progress(domain);
+}
+
+static struct util_trigger *
+util_trigger_alloc(struct fid_cntr *cntr_fid, uint64_t threshold)
+{
+	struct util_trigger *trigger;
+
+	if (!cntr_fid || cntr_fid->fid.fclass != FI_CLASS_CNTR)
+		return NULL;
+
+	trigger = calloc(1, sizeof(*trigger));
+	if (!trigger)
+		return NULL;
+
+	trigger->cntr = container_of(cntr_fid, struct util_cntr, cntr_fid);
+	trigger->threshold = threshold;
+	trigger->work = &trigger->trig_work;
+	return trigger;
+}
+
+static ssize_t
+util_trigger_check_context(void *context, uint64_t flags, size_t iov_count)
+{
+	struct fi_triggered_context *trig_context = context;
+
+	if (!trig_context || (flags & FI_INJECT) ||
+	    trig_context->event_type != FI_TRIGGER_THRESHOLD)
+		return -FI_EINVAL;
+
+	if (iov_count > OFI_TRIGGER_IOV_LIMIT)
+		return -FI_EINVAL;
+
+	return 0;
+}
+
+static struct util_trigger *util_trigger_get(void *context)
+{
+	struct fi_triggered_context *trig_context = context;
+
+	return util_trigger_alloc(trig_context->trigger.threshold.cntr,
+				  trig_context->trigger.threshold.threshold);
+}
+
+ssize_t ofi_trigger_queue_msg(struct fid_ep *ep, const struct fi_msg *msg,
+			      uint64_t flags, enum fi_op_type op_type)
+{
+	struct util_trigger *trigger;
+	ssize_t ret;
+
+	ret = util_trigger_check_context(msg->context, flags, msg->iov_count);
+	if (ret)
+		return ret;
+
+	trigger = util_trigger_get(msg->context);
+	if (!trigger)
+		return -FI_ENOMEM;
+
+	trigger->op.msg.ep = ep;
+	trigger->op.msg.msg = *msg;
+	trigger->op.msg.flags = flags & ~FI_TRIGGER;
+	memcpy(trigger->msg_iov.iov, msg->msg_iov,
+	       msg->iov_count * sizeof(*msg->msg_iov));
+	trigger->op.msg.msg.msg_iov = trigger->msg_iov.iov;
+	if (msg->desc) {
+		memcpy(trigger->desc, msg->desc,
+		       msg->iov_count * sizeof(*msg->desc));
+		trigger->op.msg.msg.desc = trigger->desc;
+	}
+
+	trigger->trig_work.op_type = op_type;
+	trigger->trig_work.op.msg = &trigger->op.msg;
+	util_trigger_insert(trigger);
+	return 0;
+}
+
+ssize_t ofi_trigger_queue_tagged(struct fid_ep *ep,
+				 const struct fi_msg_tagged *msg,
+				 uint64_t flags, enum fi_op_type op_type)
+{
+	struct util_trigger *trigger;
+	ssize_t ret;
+
+	ret = util_trigger_check_context(msg->context, flags, msg->iov_count);
+	if (ret)
+		return ret;
+
+	trigger = util_trigger_get(msg->context);
+	if (!trigger)
+		return -FI_ENOMEM;
+
+	trigger->op.tagged.ep = ep;
+	trigger->op.tagged.msg = *msg;
+	trigger->op.tagged.flags = flags & ~FI_TRIGGER;
+	memcpy(trigger->msg_iov.iov, msg->msg_iov,
+	       msg->iov_count * sizeof(*msg->msg_iov));
+	trigger->op.tagged.msg.msg_iov = trigger->msg_iov.iov;
+	if (msg->desc) {
+		memcpy(trigger->desc, msg->desc,
+		       msg->iov_count * sizeof(*msg->desc));
+		trigger->op.tagged.msg.desc = trigger->desc;
+	}
+
+	trigger->trig_work.op_type = op_type;
+	trigger->trig_work.op.tagged = &trigger->op.tagged;
+	util_trigger_insert(trigger);
+	return 0;
+}
+
+ssize_t ofi_trigger_queue_rma(struct fid_ep *ep, const struct fi_msg_rma *msg,
+			      uint64_t flags, enum fi_op_type op_type)
+{
+	struct util_trigger *trigger;
+	ssize_t ret;
+
+	ret = util_trigger_check_context(msg->context, flags,
+					 MAX(msg->iov_count,
+					     msg->rma_iov_count));
+	if (ret)
+		return ret;
+
+	trigger = util_trigger_get(msg->context);
+	if (!trigger)
+		return -FI_ENOMEM;
+
+	trigger->op.rma.ep = ep;
+	trigger->op.rma.msg = *msg;
+	trigger->op.rma.flags = flags & ~FI_TRIGGER;
+	memcpy(trigger->msg_iov.iov, msg->msg_iov,
+	       msg->iov_count * sizeof(*msg->msg_iov));
+	trigger->op.rma.msg.msg_iov = trigger->msg_iov.iov;
+	if (msg->desc) {
+		memcpy(trigger->desc, msg->desc,
+		       msg->iov_count * sizeof(*msg->desc));
+		trigger->op.rma.msg.desc = trigger->desc;
+	}
+	memcpy(trigger->rma_iov.iov, msg->rma_iov,
+	       msg->rma_iov_count * sizeof(*msg->rma_iov));
+	trigger->op.rma.msg.rma_iov = trigger->rma_iov.iov;
+
+	trigger->trig_work.op_type = op_type;
+	trigger->trig_work.op.rma = &trigger->op.rma;
+	util_trigger_insert(trigger);
+	return 0;
+}
+
+static struct fi_ioc *
+util_trigger_copy_ioc(struct fi_ioc *dst, void **dst_desc,
+		      const struct fi_ioc *src, void ***desc, size_t count)
+{
+	memcpy(dst, src, count * sizeof(*src));
+	if (*desc) {
+		memcpy(dst_desc, *desc, count * sizeof(**desc));
+		*desc = dst_desc;
+	}
+	return dst;
+}
+
+ssize_t ofi_trigger_queue_atomic(struct fid_ep *ep,
+				 const struct fi_msg_atomic *msg,
+				 const struct fi_ioc *comparev,
+				 void **compare_desc, size_t compare_count,
+				 struct fi_ioc *resultv, void **result_desc,
+				 size_t result_count, uint64_t flags,
+				 enum fi_op_type op_type)
+{
+	struct util_trigger *trigger;
+	struct fi_msg_atomic atomic_msg = *msg;
+	ssize_t ret;
+
+	ret = util_trigger_check_context(msg->context, flags,
+					 MAX(MAX(msg->iov_count,
+						 msg->rma_iov_count),
+					     MAX(compare_count, result_count)));
+	if (ret)
+		return ret;
+
+	trigger = util_trigger_get(msg->context);
+	if (!trigger)
+		return -FI_ENOMEM;
+
+	atomic_msg.msg_iov = util_trigger_copy_ioc(trigger->msg_iov.ioc,
+						   trigger->desc, msg->msg_iov,
+						   &atomic_msg.desc,
+						   msg->iov_count);
+	memcpy(trigger->rma_iov.ioc, msg->rma_iov,
+	       msg->rma_iov_count * sizeof(*msg->rma_iov));
+	atomic_msg.rma_iov = trigger->rma_iov.ioc;
+	flags &= ~FI_TRIGGER;
+
+	switch (op_type) {
+	case FI_OP_ATOMIC:
+		trigger->op.atomic.ep = ep;
+		trigger->op.atomic.msg = atomic_msg;
+		trigger->op.atomic.flags = flags;
+		trigger->trig_work.op.atomic = &trigger->op.atomic;
+		break;
+	case FI_OP_FETCH_ATOMIC:
+		trigger->op.fetch_atomic.ep = ep;
+		trigger->op.fetch_atomic.msg = atomic_msg;
+		trigger->op.fetch_atomic.fetch.desc = result_desc;
+		trigger->op.fetch_atomic.fetch.msg_iov =
+			util_trigger_copy_ioc(trigger->resultv,
+					      trigger->result_desc, resultv,
+					      &trigger->op.fetch_atomic.fetch.desc,
+					      result_count);
+		trigger->op.fetch_atomic.fetch.iov_count = result_count;
+		trigger->op.fetch_atomic.flags = flags;
+		trigger->trig_work.op.fetch_atomic = &trigger->op.fetch_atomic;
+		break;
+	case FI_OP_COMPARE_ATOMIC:
+		trigger->op.compare_atomic.ep = ep;
+		trigger->op.compare_atomic.msg = atomic_msg;
+		trigger->op.compare_atomic.fetch.desc = result_desc;
+		trigger->op.compare_atomic.fetch.msg_iov =
+			util_trigger_copy_ioc(trigger->resultv,
+					      trigger->result_desc, resultv,
+					      &trigger->op.compare_atomic.fetch.desc,
+					      result_count);
+		trigger->op.compare_atomic.fetch.iov_count = result_count;
+		trigger->op.compare_atomic.compare.desc = compare_desc;
+		trigger->op.compare_atomic.compare.msg_iov =
+			util_trigger_copy_ioc(trigger->comparev,
+					      trigger->compare_desc, comparev,
+					      &trigger->op.compare_atomic.compare.desc,
+					      compare_count);
+		trigger->op.compare_atomic.compare.iov_count = compare_count;
+		trigger->op.compare_atomic.flags = flags;
+		trigger->trig_work.op.compare_atomic =
+			&trigger->op.compare_atomic;
+		break;
+	default:
+		free(trigger);
+		return -FI_EINVAL;
+	}
+
+	trigger->trig_work.op_type = op_type;
+	util_trigger_insert(trigger);
+	return 0;
+}
+
+static enum ofi_cntr_index util_trigger_cntr_index(enum fi_op_type op_type)
+{
+	switch (op_type) {
+	case FI_OP_RECV:
+	case FI_OP_TRECV:
+		return CNTR_RX;
+	case FI_OP_SEND:
+	case FI_OP_TSEND:
+		return CNTR_TX;
+	case FI_OP_READ:
+	case FI_OP_FETCH_ATOMIC:
+	case FI_OP_COMPARE_ATOMIC:
+		return CNTR_RD;
+	default:
+		return CNTR_WR;
+	}
+}
+
+static struct fid_ep *util_trigger_work_ep(struct fi_deferred_work *work)
+{
+	switch (work->op_type) {
+	case FI_OP_RECV:
+	case FI_OP_SEND:
+		return work->op.msg->ep;
+	case FI_OP_TRECV:
+	case FI_OP_TSEND:
+		return work->op.tagged->ep;
+	case FI_OP_READ:
+	case FI_OP_WRITE:
+		return work->op.rma->ep;
+	case FI_OP_ATOMIC:
+		return work->op.atomic->ep;
+	case FI_OP_FETCH_ATOMIC:
+		return work->op.fetch_atomic->ep;
+	case FI_OP_COMPARE_ATOMIC:
+		return work->op.compare_atomic->ep;
+	default:
+		return NULL;
+	}
+}
+
+static void *util_trigger_work_context(struct fi_deferred_work *work)
+{
+	switch (work->op_type) {
+	case FI_OP_RECV:
+	case FI_OP_SEND:
+		return work->op.msg->msg.context;
+	case FI_OP_TRECV:
+	case FI_OP_TSEND:
+		return work->op.tagged->msg.context;
+	case FI_OP_READ:
+	case FI_OP_WRITE:
+		return work->op.rma->msg.context;
+	case FI_OP_ATOMIC:
+		return work->op.atomic->msg.context;
+	case FI_OP_FETCH_ATOMIC:
+		return work->op.fetch_atomic->msg.context;
+	case FI_OP_COMPARE_ATOMIC:
+		return work->op.compare_atomic->msg.context;
+	default:
+		return NULL;
+	}
+}
+
+static uint64_t util_trigger_comp_flags(enum fi_op_type op_type)
+{
+	switch (op_type) {
+	case FI_OP_RECV:
+		return FI_MSG | FI_RECV;
+	case FI_OP_SEND:
+		return FI_MSG | FI_SEND;
+	case FI_OP_TRECV:
+		return FI_TAGGED | FI_RECV;
+	case FI_OP_TSEND:
+		return FI_TAGGED | FI_SEND;
+	case FI_OP_READ:
+		return FI_RMA | FI_READ;
+	case FI_OP_WRITE:
+		return FI_RMA | FI_WRITE;
+	case FI_OP_ATOMIC:
+		return FI_ATOMIC | FI_WRITE;
+	default:
+		return FI_ATOMIC | FI_READ;
+	}
+}
+
+/* A data transfer that could not be issued is reported through the
+ * endpoint, as if it had failed after being posted.
+ */
+static void util_trigger_report(struct util_domain *domain,
+				struct fi_deferred_work *work, ssize_t err)
+{
+	struct fi_cq_err_entry err_entry = {0};
+	enum ofi_cntr_index index;
+	struct fid_ep *ep_fid;
+	struct util_ep *ep;
+	struct util_cq *cq;
+
+	FI_WARN(domain->prov, FI_LOG_EP_DATA,
+		"triggered operation %d failed: %s\n", work->op_type,
+		fi_strerror((int) -err));
+
+	ep_fid = util_trigger_work_ep(work);
+	if (!ep_fid)
+		return;
+
+	ep = container_of(ep_fid, struct util_ep, ep_fid);
+	index = util_trigger_cntr_index(work->op_type);
+	cq = index == CNTR_RX ? ep->rx_cq : ep->tx_cq;
+	if (cq) {
+		err_entry.op_context = util_trigger_work_context(work);
+		err_entry.flags = util_trigger_comp_flags(work->op_type);
+		err_entry.err = (int) -err;
+		err_entry.prov_errno = (int) err;
+		if (ofi_cq_write_error(cq, &err_entry))
+			FI_WARN(domain->prov, FI_LOG_EP_DATA,
+				"unable to report triggered operation error\n");
+	}
+
+	if (ep->cntrs[index])
+		(void) fi_cntr_adderr(&ep->cntrs[index]->cntr_fid, 1);
+}
+
+/* Issue the ready operations in order.  The trigger lock is dropped
+ * around each call, since the operation may itself update a counter, so
+ * only one thread issues operations at a time.  The operation being
+ * issued is the domain trigger_inflight.  If it returns -FI_EAGAIN, it
+ * goes back to the head of the list and is retried by the next call.
+ */
+void ofi_trigger_run(struct util_domain *domain)
+{
+	struct util_trigger *trigger;
+	ssize_t ret;
+
+	ofi_mutex_lock(&domain->trigger_lock);
+	if (domain->trigger_inflight)
+		goto out;
+
+	while (!dlist_empty(&domain->trigger_ready_list)) {
+		dlist_pop_front(&domain->trigger_ready_list,
+				struct util_trigger, trigger, entry);
+		domain->trigger_inflight = trigger;
+		ofi_mutex_unlock(&domain->trigger_lock);
+
+		ret = util_trigger_exec(trigger->work);
+		if (ret && ret != -FI_EAGAIN)
+			util_trigger_report(domain, trigger->work, ret);
+
+		ofi_mutex_lock(&domain->trigger_lock);
+		domain->trigger_inflight = NULL;
+		if (ret == -FI_EAGAIN) {
+			dlist_insert_head(&trigger->entry,
+					  &domain->trigger_ready_list);
+			break;
+		}
+
+		ofi_atomic_dec32(&domain->trigger_ready_cnt);
+		free(trigger);
+	}
+out:
+	ofi_mutex_unlock(&domain->trigger_lock);
+}
+
+/* Deferred data transfers complete through the endpoint like any other
+ * operation.  The endpoint must therefore be one opened on this domain,
+ * and a completion counter is only supported if it is the endpoint
+ * counter that the operation updates.
+ */
+static int util_trigger_check_work(struct util_domain *domain,
+				   struct fi_deferred_work *work)
+{
+	struct util_ep *ep;
+	struct fid_ep *ep_fid;
+
+	switch (work->op_type) {
+	case FI_OP_CNTR_SET:
+	case FI_OP_CNTR_ADD:
+		if (work->completion_cntr || !work->op.cntr ||
+		    !work->op.cntr->cntr)
+			return -FI_EINVAL;
+		return 0;
+	case FI_OP_RECV:
+	case FI_OP_SEND:
+	case FI_OP_TRECV:
+	case FI_OP_TSEND:
+	case FI_OP_READ:
+	case FI_OP_WRITE:
+	case FI_OP_ATOMIC:
+	case FI_OP_FETCH_ATOMIC:
+	case FI_OP_COMPARE_ATOMIC:
+		break;
+	default:
+		return -FI_ENOSYS;
+	}
+
+	ep_fid = util_trigger_work_ep(work);
+	if (!ep_fid || ep_fid->fid.fclass != FI_CLASS_EP)
+		return -FI_EINVAL;
+
+	ep = container_of(ep_fid, struct util_ep, ep_fid);
+	if (ep->domain != domain) {
+		FI_WARN(domain->prov, FI_LOG_DOMAIN,
+			"deferred work targets an endpoint of another domain\n");
+		return -FI_EINVAL;
+	}
+
+	if (!work->completion_cntr)
+		return 0;
+
+	if (!ep->cntrs[util_trigger_cntr_index(work->op_type)] ||
+	    &ep->cntrs[util_trigger_cntr_index(work->op_type)]->cntr_fid !=
+	    work->completion_cntr) {
+		FI_WARN(domain->prov, FI_LOG_DOMAIN,
+			"completion counter must be bound to the endpoint\n");
+		return -FI_ENOSYS;
+	}
+	return 0;
+}
+
+static int util_trigger_queue_work(struct util_domain *domain,
+				   struct fi_deferred_work *work)
+{
+	struct util_trigger *trigger;
+	int ret;
+
+	ret = util_trigger_check_work(domain, work);
+	if (ret)
+		return ret;
+
+	trigger = util_trigger_alloc(work->triggering_cntr, work->threshold);
+	if (!trigger)
+		return work->triggering_cntr ? -FI_ENOMEM : -FI_EINVAL;
+
+	trigger->work = work;
+	util_trigger_insert(trigger);
+	return 0;
+}
+
+/* Wait until the operation being issued, if it matches, is either issued
+ * or back on the ready list.  Caller must hold the domain trigger_lock.
+ */
+static void util_trigger_wait_inflight(struct util_domain *domain,
+				       struct fi_deferred_work *work,
+				       struct fid_ep *ep)
+{
+	while (domain->trigger_inflight &&
+	       ((work && domain->trigger_inflight->work == work) ||
+		(ep && util_trigger_work_ep(domain->trigger_inflight->work) ==
+		 ep))) {
+		ofi_mutex_unlock(&domain->trigger_lock);
+		sched_yield();
+		ofi_mutex_lock(&domain->trigger_lock);
+	}
+}
+
+/* Remove the triggers of the given work, or of the given endpoint, or all
+ * of them.  Caller must hold the domain trigger_lock.
+ */
+static int util_trigger_cancel_list(struct dlist_entry *list,
+				    struct fi_deferred_work *work,
+				    struct fid_ep *ep, ofi_atomic32_t *cnt)
+{
+	struct util_trigger *trigger;
+	struct dlist_entry *tmp;
+	int found = 0;
+
+	dlist_foreach_container_safe(list, struct util_trigger, trigger,
+				     entry, tmp) {
+		if (work && trigger->work != work)
+			continue;
+		if (ep && util_trigger_work_ep(trigger->work) != ep)
+			continue;
+
+		dlist_remove(&trigger->entry);
+		ofi_atomic_dec32(cnt);
+		free(trigger);
+		found++;
+		if (work)
+			break;
+	}
+	return found;
+}
+
+static int util_trigger_cancel(struct util_domain *domain,
+			       struct fi_deferred_work *work)
+{
+	struct util_cntr *cntr;
+	int found;
+
+	if (!work || !work->triggering_cntr)
+		return -FI_EINVAL;
+
+	cntr = container_of(work->triggering_cntr, struct util_cntr, cntr_fid);
+	ofi_mutex_lock(&domain->trigger_lock);
+	util_trigger_wait_inflight(domain, work, NULL);
+	found = util_trigger_cancel_list(&cntr->trigger_list, work, NULL,
+					 &cntr->trigger_cnt);
+	if (found && dlist_empty(&cntr->trigger_list))
+		dlist_remove_init(&cntr->trigger_entry);
+	if (!found)
+		found = util_trigger_cancel_list(&domain->trigger_ready_list,
+						 work, NULL,
+						 &domain->trigger_ready_cnt);
+	ofi_mutex_unlock(&domain->trigger_lock);
+
+	return found ? 0 : -FI_ENOENT;
+}
+
+/* Caller must hold the domain trigger_lock */
+static void util_trigger_flush_cntr(struct util_cntr *cntr)
+{
+	(void) util_trigger_cancel_list(&cntr->trigger_list, NULL, NULL,
+					&cntr->trigger_cnt);
+	dlist_remove_init(&cntr->trigger_entry);
+}
+
+/* FI_FLUSH_WORK cancels all work queued to the domain, or only the work
+ * waiting on the counter passed as argument.
+ */
+static int util_trigger_flush(struct util_domain *domain, struct fid *fid)
+{
+	struct util_cntr *cntr;
+	struct dlist_entry *tmp;
+
+	if (fid && fid->fclass != FI_CLASS_CNTR)
+		return -FI_EINVAL;
+
+	ofi_mutex_lock(&domain->trigger_lock);
+	if (fid) {
+		cntr = container_of(fid, struct util_cntr, cntr_fid.fid);
+		util_trigger_flush_cntr(cntr);
+	} else {
+		dlist_foreach_container_safe(&domain->trigger_cntr_list,
+					     struct util_cntr, cntr,
+					     trigger_entry, tmp)
+			util_trigger_flush_cntr(cntr);
+		(void) util_trigger_cancel_list(&domain->trigger_ready_list,
+						NULL, NULL,
+						&domain->trigger_ready_cnt);
+	}
+	ofi_mutex_unlock(&domain->trigger_lock);
+	return 0;
+}
+
+void ofi_trigger_ep_cleanup(struct util_ep *ep)
+{
+	struct util_domain *domain = ep->domain;
+	struct util_cntr *cntr;
+	struct dlist_entry *tmp;
+
+	ofi_mutex_lock(&domain->trigger_lock);
+	util_trigger_wait_inflight(domain, NULL, &ep->ep_fid);
+	dlist_foreach_container_safe(&domain->trigger_cntr_list,
+				     struct util_cntr, cntr, trigger_entry,
+				     tmp) {
+		(void) util_trigger_cancel_list(&cntr->trigger_list, NULL,
+						&ep->ep_fid,
+						&cntr->trigger_cnt);
+		if (dlist_empty(&cntr->trigger_list))
+			dlist_remove_init(&cntr->trigger_entry);
+	}
+	(void) util_trigger_cancel_list(&domain->trigger_ready_list, NULL,
+					&ep->ep_fid,
+					&domain->trigger_ready_cnt);
+	ofi_mutex_unlock(&domain->trigger_lock);
+}
+
+int ofi_trigger_control(struct util_domain *domain, int command, void *arg)
+{
+	switch (command) {
+	case FI_QUEUE_WORK:
+		return util_trigger_queue_work(domain, arg);
+	case FI_CANCEL_WORK:
+		return util_trigger_cancel(domain, arg);
+	case FI_FLUSH_WORK:
+		return util_trigger_flush(domain, arg);
+	default:
+		return -FI_ENOSYS;
+	}
+}
+
+void ofi_trigger_cntr_cleanup(struct util_cntr *cntr)
+{
+	ofi_mutex_lock(&cntr->domain->trigger_lock);
+	util_trigger_flush_cntr(cntr);
+	ofi_mutex_unlock(&cntr->domain->trigger_lock);
+}
+
+void ofi_trigger_init(struct util_domain *domain)
+{
+	ofi_mutex_init(&domain->trigger_lock);
+	dlist_init(&domain->trigger_cntr_list);
+	dlist_init(&domain->trigger_ready_list);
+	ofi_atomic_initialize32(&domain->trigger_ready_cnt, 0);
+	domain->trigger_inflight = NULL;
+}
+
+void ofi_trigger_cleanup(struct util_domain *domain)
+{
+	(void) util_trigger_flush(domain, NULL);
+	ofi_mutex_destroy(&domain->trigger_lock);
+}
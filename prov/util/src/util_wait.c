@@ -70,6 +70,9 @@ int ofi_trywait(struct fid_fabric *fabric, struct fid **fids, int count)
 			return -FI_EINVAL;
 		}
 
+		if (!wait)
+			return -FI_EINVAL;
+
 		ret = wait->wait_try(wait);
 		if (ret)
 			return ret;
@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2026 The Libfabric Contributors. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Multithreaded tests of OFI_BUFPOOL_MAGAZINE pools: buffers freed by a
+ * thread other than the one that allocated them, threads exiting with
+ * loaded magazines, and pools destroyed while other threads still hold a
+ * cache of them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "ofi_mem.h"
+
+extern void fi_ini(void);
+
+#define TEST_THREADS	4
+#define TEST_ITERS	2000
+#define TEST_BATCH	50
+#define TEST_CHUNK_CNT	64
+
+#define check(cond, ...)					\
+	do {							\
+		if (!(cond)) {					\
+			fprintf(stderr, "%s:%d: ", __func__,	\
+				__LINE__);			\
+			fprintf(stderr, __VA_ARGS__);		\
+			fprintf(stderr, "\n");			\
+			return -1;				\
+		}						\
+	} while (0)
+
+struct test_buf {
+	pthread_t	owner;
+	size_t		seq;
+};
+
+static struct ofi_bufpool *pool;
+
+static int create_pool(struct ofi_bufpool **buf_pool)
+{
+	return ofi_bufpool_create(buf_pool, sizeof(struct test_buf), 16, 0,
+				  TEST_CHUNK_CNT, OFI_BUFPOOL_MAGAZINE);
+}
+
+static int alloc_batch(struct test_buf **bufs, size_t cnt)
+{
+	size_t i;
+
+	for (i = 0; i < cnt; i++) {
+		bufs[i] = ofi_buf_alloc(pool);
+		check(bufs[i], "allocation %zu failed", i);
+		bufs[i]->owner = pthread_self();
+		bufs[i]->seq = i;
+	}
+	return 0;
+}
+
+static int check_batch(struct test_buf **bufs, size_t cnt, pthread_t owner)
+{
+	size_t i;
+
+	for (i = 0; i < cnt; i++) {
+		check(pthread_equal(bufs[i]->owner, owner) && bufs[i]->seq == i,
+		      "buffer %zu was handed out twice", i);
+	}
+	return 0;
+}
+
+static void free_batch(struct test_buf **bufs, size_t cnt)
+{
+	size_t i;
+
+	for (i = 0; i < cnt; i++)
+		ofi_buf_free(bufs[i]);
+}
+
+/*
+ * Threads pass batches of buffers around a shared slot, each freeing the
+ * batch allocated by the thread before it.
+ */
+static pthread_mutex_t slot_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct test_buf *slot_bufs[TEST_BATCH];
+static pthread_t slot_owner;
+static int slot_full;
+
+static void *exchange_thread(void *arg)
+{
+	struct test_buf *bufs[TEST_BATCH], *prev[TEST_BATCH];
+	pthread_t prev_owner;
+	int have_prev, i;
+
+	for (i = 0; i < TEST_ITERS; i++) {
+		if (alloc_batch(bufs, TEST_BATCH))
+			return (void *) -1L;
+
+		pthread_mutex_lock(&slot_lock);
+		have_prev = slot_full;
+		if (have_prev) {
+			memcpy(prev, slot_bufs, sizeof(prev));
+			prev_owner = slot_owner;
+		}
+		memcpy(slot_bufs, bufs, sizeof(bufs));
+		slot_owner = pthread_self();
+		slot_full = 1;
+		pthread_mutex_unlock(&slot_lock);
+
+		if (have_prev) {
+			if (check_batch(prev, TEST_BATCH, prev_owner))
+				return (void *) -1L;
+			free_batch(prev, TEST_BATCH);
+		}
+	}
+	return NULL;
+}
+
+static int test_cross_thread_free(void)
+{
+	pthread_t threads[TEST_THREADS];
+	void *status;
+	int i, ret = 0;
+
+	check(!create_pool(&pool), "pool creation failed");
+
+	slot_full = 0;
+	for (i = 0; i < TEST_THREADS; i++) {
+		check(!pthread_create(&threads[i], NULL, exchange_thread, NULL),
+		      "pthread_create failed");
+	}
+	for (i = 0; i < TEST_THREADS; i++) {
+		pthread_join(threads[i], &status);
+		if (status)
+			ret = -1;
+	}
+
+	if (slot_full)
+		free_batch(slot_bufs, TEST_BATCH);
+	ofi_bufpool_destroy(pool);
+	return ret;
+}
+
+static void *alloc_free_thread(void *arg)
+{
+	struct test_buf *bufs[TEST_BATCH];
+
+	if (alloc_batch(bufs, TEST_BATCH))
+		return (void *) -1L;
+	free_batch(bufs, TEST_BATCH);
+	return NULL;
+}
+
+/*
+ * A thread that exits with loaded magazines must give its buffers back,
+ * so that allocating every buffer of the pool does not grow it.
+ */
+static int test_thread_exit(void)
+{
+	struct test_buf **bufs;
+	pthread_t thread;
+	void *status;
+	size_t i, cnt;
+	int ret = 0;
+
+	check(!create_pool(&pool), "pool creation failed");
+
+	for (i = 0; i < TEST_THREADS; i++) {
+		check(!pthread_create(&thread, NULL, alloc_free_thread, NULL),
+		      "pthread_create failed");
+		pthread_join(thread, &status);
+		check(!status, "thread %zu failed", i);
+	}
+
+	cnt = pool->region_cnt * pool->attr.chunk_cnt;
+	check(cnt, "pool did not grow");
+	bufs = calloc(cnt, sizeof(*bufs));
+	check(bufs, "out of memory");
+
+	for (i = 0; i < cnt; i++) {
+		bufs[i] = ofi_buf_alloc(pool);
+		if (!bufs[i]) {
+			fprintf(stderr, "%s: allocation %zu failed\n",
+				__func__, i);
+			ret = -1;
+			break;
+		}
+	}
+	if (!ret && pool->region_cnt * pool->attr.chunk_cnt != cnt) {
+		fprintf(stderr, "%s: pool grew from %zu to %zu buffers, "
+			"buffers of exited threads were lost\n", __func__,
+			cnt, pool->region_cnt * pool->attr.chunk_cnt);
+		ret = -1;
+	}
+
+	free_batch(bufs, i);
+	free(bufs);
+	ofi_bufpool_destroy(pool);
+	return ret;
+}
+
+/*
+ * A pool is destroyed while another thread holds a cache of it.  The
+ * thread then uses a new pool, which may get the id of the destroyed one,
+ * and exits afterwards.
+ */
+static pthread_mutex_t step_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t step_cond = PTHREAD_COND_INITIALIZER;
+static int step;
+
+static void wait_step(int value)
+{
+	pthread_mutex_lock(&step_lock);
+	while (step < value)
+		pthread_cond_wait(&step_cond, &step_lock);
+	pthread_mutex_unlock(&step_lock);
+}
+
+static void set_step(int value)
+{
+	pthread_mutex_lock(&step_lock);
+	step = value;
+	pthread_cond_broadcast(&step_cond);
+	pthread_mutex_unlock(&step_lock);
+}
+
+static void *destroy_thread(void *arg)
+{
+	void *status;
+
+	status = alloc_free_thread(NULL);
+	set_step(1);
+	if (status)
+		return status;
+
+	wait_step(2);
+	return alloc_free_thread(NULL);
+}
+
+static int test_destroy(void)
+{
+	pthread_t thread;
+	void *status;
+
+	step = 0;
+	check(!create_pool(&pool), "pool creation failed");
+	check(!pthread_create(&thread, NULL, destroy_thread, NULL),
+	      "pthread_create failed");
+
+	wait_step(1);
+	ofi_bufpool_destroy(pool);
+	check(!create_pool(&pool), "pool creation failed");
+	set_step(2);
+
+	pthread_join(thread, &status);
+	check(!status, "thread failed");
+	check(!alloc_free_thread(NULL), "allocation failed");
+	ofi_bufpool_destroy(pool);
+	return 0;
+}
+
+struct test_entry {
+	const char *name;
+	int (*run)(void);
+};
+
+static struct test_entry tests[] = {
+	{ "cross thread free", test_cross_thread_free },
+	{ "thread exit", test_thread_exit },
+	{ "pool destroy", test_destroy },
+	{ NULL, NULL },
+};
+
+int main(int argc, char **argv)
+{
+	int i, failed = 0;
+
+	fi_ini();
+
+	for (i = 0; tests[i].name; i++) {
+		if (tests[i].run()) {
+			printf("%s: failed\n", tests[i].name);
+			failed++;
+		} else {
+			printf("%s: passed\n", tests[i].name);
+		}
+	}
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
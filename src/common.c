@@ -100,6 +100,43 @@ void ofi_params_init(void)
 			 &ofi_offload_coll_prov_name);
 }
 
+/* 1-based shard of the calling thread, 0 until first used */
+OFI_THREAD_LOCAL unsigned int ofi_genlock_shard_id;
+
+unsigned int ofi_genlock_shard_assign(void)
+{
+	static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+	static unsigned int next;
+
+	pthread_mutex_lock(&lock);
+	ofi_genlock_shard_id = (next++ % OFI_GENLOCK_SHARDS) + 1;
+	pthread_mutex_unlock(&lock);
+	return ofi_genlock_shard_id;
+}
+
+static int ofi_genlock_shards_init(struct ofi_genlock *lock)
+{
+	int i, ret;
+
+	ret = ofi_memalign((void **) &lock->base.shards,
+			   sizeof(*lock->base.shards),
+			   sizeof(*lock->base.shards) * OFI_GENLOCK_SHARDS);
+	if (ret)
+		return -FI_ENOMEM;
+
+	for (i = 0; i < OFI_GENLOCK_SHARDS; i++) {
+		ret = ofi_mutex_init(&lock->base.shards[i].lock);
+		if (ret)
+			goto err;
+	}
+	return 0;
+err:
+	while (i--)
+		ofi_mutex_destroy(&lock->base.shards[i].lock);
+	ofi_freealign(lock->base.shards);
+	return -ret;
+}
+
 int ofi_genlock_init(struct ofi_genlock *lock,
 		     enum ofi_lock_type lock_type)
 {
@@ -120,6 +157,12 @@ int ofi_genlock_init(struct ofi_genlock *lock,
 	case OFI_LOCK_NONE:
 		ret = 0;
 		break;
+	case OFI_LOCK_RWLOCK:
+		ret = pthread_rwlock_init(&lock->base.rwlock, NULL);
+		break;
+	case OFI_LOCK_SHARDED:
+		ret = ofi_genlock_shards_init(lock);
+		break;
 	default:
 		ret = -FI_EINVAL;
 		break;
@@ -130,6 +173,8 @@ int ofi_genlock_init(struct ofi_genlock *lock,
 
 void ofi_genlock_destroy(struct ofi_genlock *lock)
 {
+	int i;
+
 	switch (lock->lock_type) {
 	case OFI_LOCK_SPINLOCK:
 		ofi_spin_destroy(&lock->base.spinlock);
@@ -138,6 +183,14 @@ void ofi_genlock_destroy(struct ofi_genlock *lock)
 	case OFI_LOCK_NOOP:
 		ofi_mutex_destroy(&lock->base.mutex);
 		break;
+	case OFI_LOCK_RWLOCK:
+		pthread_rwlock_destroy(&lock->base.rwlock);
+		break;
+	case OFI_LOCK_SHARDED:
+		for (i = 0; i < OFI_GENLOCK_SHARDS; i++)
+			ofi_mutex_destroy(&lock->base.shards[i].lock);
+		ofi_freealign(lock->base.shards);
+		break;
 	case OFI_LOCK_NONE:
 		break;
 	default:
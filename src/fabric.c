@@ -1049,6 +1049,7 @@ FI_DESTRUCTOR(fi_fini(void))
 	ofi_monitors_cleanup();
 	ofi_hmem_cleanup();
 	ofi_hook_fini();
+	ofi_bufpool_fini();
 	ofi_mem_fini();
 	fi_log_fini();
 	fi_param_fini();
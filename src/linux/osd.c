@@ -45,9 +45,14 @@
 #include <sys/types.h>
 #include <linux/ethtool.h>
 #include <linux/sockios.h>
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
 #include <sys/ioctl.h>
 #include <inttypes.h>
 
+/* Largest node mask passed to mbind */
+#define OFI_MBIND_MAX_NODES 1024
+
 static size_t ofi_base_page_size;
 
 static unsigned long ofi_smaps_page_size(FILE *file)
@@ -146,6 +151,54 @@ ssize_t ofi_get_hugepage_size(void)
 	return val * 1024;
 }
 
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+/* Allocate huge pages of a given size, e.g. 2 MiB or 1 GiB */
+int ofi_alloc_hugepage_buf_size(void **memptr, size_t size, size_t page_size)
+{
+	int shift;
+
+	if (!page_size || (page_size & (page_size - 1)))
+		return -FI_EINVAL;
+
+	shift = ofi_msb(page_size) - 1;
+	return ofi_mmap_anon_pages(memptr, size,
+				   MAP_HUGETLB | (shift << MAP_HUGE_SHIFT));
+}
+
+/* NUMA node of the CPU the calling thread is running on */
+int ofi_get_numa_node(void)
+{
+	unsigned int cpu, node;
+
+	if (syscall(SYS_getcpu, &cpu, &node, NULL))
+		return -errno;
+
+	return (int) node;
+}
+
+/*
+ * Prefer the given node for pages of the range that have not been faulted
+ * in yet.  The kernel falls back to other nodes if the node is full.
+ */
+int ofi_mbind_node(void *addr, size_t size, int node)
+{
+	unsigned long mask[(OFI_MBIND_MAX_NODES + 8 * sizeof(long) - 1) /
+			   (8 * sizeof(long))] = {0};
+
+	if (node < 0 || node >= OFI_MBIND_MAX_NODES)
+		return -FI_EINVAL;
+
+	mask[node / (8 * sizeof(long))] = 1UL << (node % (8 * sizeof(long)));
+	if (syscall(SYS_mbind, addr, size, MPOL_PREFERRED, mask,
+		    OFI_MBIND_MAX_NODES + 1, 0))
+		return -errno;
+
+	return 0;
+}
+
 #ifdef HAVE_ETHTOOL
 
 #if HAVE_DECL_ETHTOOL_CMD_SPEED